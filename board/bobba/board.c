@@ -409,7 +409,8 @@ static void board_usb_charge_mode_init(void)
 
 	/*
 	 * Only overriding the USB_DISALLOW_SUSPEND_CHARGE in RO is enough because
-	 * USB_SYSJUMP_TAG preserves the settings to RW. And we should honor to it.
+	 * JUMP_TAG_USB_PORT preserves the settings to RW. And we should honor to
+	 * it.
 	 */
 	if (system_jumped_late())
 		return;
@@ -15,6 +15,7 @@
 #include "lid_switch.h"
 #include "motion_sense.h"
 #include "motion_lid.h"
+#include "power.h"
 #include "power_button.h"
 #include "spi.h"
 #include "temp_sensor.h"
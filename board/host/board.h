@@ -48,6 +48,18 @@ enum adc_channel {
 	ADC_CH_COUNT
 };
 
+#ifdef TEST_OCPC
+/*
+ * The OCPC test has a primary and a secondary charger, like the boards using
+ * OCPC. common/ocpc.c and charge_state_v2.c need them, not only the test.
+ */
+enum chg_id {
+	CHARGER_PRIMARY,
+	CHARGER_SECONDARY,
+	CHARGER_NUM,
+};
+#endif
+
 /* Fake test charge suppliers */
 enum {
 	CHARGE_SUPPLIER_TEST1,
@@ -9,7 +9,9 @@
 CHIP:=host
 
 board-y=board.o
+ifneq ($(CONFIG_POWER_COMMON),y)
 board-$(HAS_TASK_CHIPSET)+=chipset.o
+endif
 board-$(CONFIG_BATTERY_MOCK)+=battery.o charger.o
 board-$(CONFIG_FANS)+=fan.o
 board-$(CONFIG_USB_POWER_DELIVERY)+=usb_pd_policy.o usb_pd_config.o
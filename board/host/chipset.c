@@ -9,6 +9,7 @@
 #include "chipset.h"
 #include "common.h"
 #include "hooks.h"
+#include "power.h"
 #include "task.h"
 #include "test_util.h"
 
@@ -41,6 +42,11 @@ test_mockable int chipset_in_or_transitioning_to_state(int state_mask)
 	return state_mask & chipset_state;
 }
 
+test_mockable void power_signal_interrupt(enum gpio_signal signal)
+{
+	/* Do nothing */
+}
+
 void test_chipset_on(void)
 {
 	if (chipset_in_state(CHIPSET_STATE_ON))
@@ -5,6 +5,7 @@
 
 /* Mocked fan implementation for tests */
 
+#include "common.h"
 #include "fan.h"
 #include "util.h"
 
@@ -26,60 +27,60 @@ const struct fan_t fans[CONFIG_FANS] = {
 };
 
 static int mock_enabled;
-void fan_set_enabled(int ch, int enabled)
+test_mockable void fan_set_enabled(int ch, int enabled)
 {
 	mock_enabled = enabled;
 }
-int fan_get_enabled(int ch)
+test_mockable int fan_get_enabled(int ch)
 {
 	return mock_enabled;
 }
 
 static int mock_percent;
-void fan_set_duty(int ch, int percent)
+test_mockable void fan_set_duty(int ch, int percent)
 {
 	mock_percent = percent;
 }
-int fan_get_duty(int ch)
+test_mockable int fan_get_duty(int ch)
 {
 	return mock_percent;
 }
 
 static int mock_rpm_mode;
-void fan_set_rpm_mode(int ch, int rpm_mode)
+test_mockable void fan_set_rpm_mode(int ch, int rpm_mode)
 {
 	mock_rpm_mode = rpm_mode;
 }
-int fan_get_rpm_mode(int ch)
+test_mockable int fan_get_rpm_mode(int ch)
 {
 	return mock_rpm_mode;
 }
 
 int mock_rpm;
-void fan_set_rpm_target(int ch, int rpm)
+test_mockable void fan_set_rpm_target(int ch, int rpm)
 {
 	mock_rpm = rpm;
 }
-int fan_get_rpm_actual(int ch)
+test_mockable int fan_get_rpm_actual(int ch)
 {
 	return mock_rpm;
 }
-int fan_get_rpm_target(int ch)
+test_mockable int fan_get_rpm_target(int ch)
 {
 	return mock_rpm;
 }
 
-enum fan_status fan_get_status(int ch)
+test_mockable enum fan_status fan_get_status(int ch)
 {
 	return FAN_STATUS_LOCKED;
 }
 
-int fan_is_stalled(int ch)
+test_mockable int fan_is_stalled(int ch)
 {
 	return 0;
 }
 
-void fan_channel_setup(int ch, unsigned int flags)
+test_mockable void fan_channel_setup(int ch, unsigned int flags)
 {
 	/* nothing to do */
 }
@@ -8,6 +8,7 @@
 #include <linux/limits.h>
 #include <unistd.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 static void get_storage_path(char *out)
@@ -15,6 +16,14 @@ static void get_storage_path(char *out)
 	char buf[PATH_MAX];
 	int sz;
 	char *current;
+	/*
+	 * Test runners point this at a private directory so that concurrent
+	 * instances of the same test don't share flash and RAM contents.
+	 */
+	const char *dir = getenv("EC_PERSIST_DIR");
+
+	if (!dir)
+		dir = "/dev/shm";
 
 	sz = readlink("/proc/self/exe", buf, PATH_MAX - 1);
 	buf[sz] = '\0';
@@ -26,7 +35,7 @@ static void get_storage_path(char *out)
 		current = strchr(current, '/');
 	}
 
-	snprintf(out, PATH_MAX - 1, "/dev/shm/EC_persist_%s", buf);
+	snprintf(out, PATH_MAX - 1, "%s/EC_persist_%s", dir, buf);
 	out[PATH_MAX - 1] = '\0';
 }
 
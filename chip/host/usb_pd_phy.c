@@ -21,6 +21,9 @@
  */
 #define PD_BIT_LEN 429
 
+/* Symbol recorded for BMC with a missing transition; not a 5-bit symbol */
+#define BMC_INVALID 0xFF
+
 static struct pd_physical {
 	int hw_init_done;
 
@@ -31,6 +34,8 @@ static struct pd_physical {
 	int rx_monitoring;
 
 	int preamble_written;
+	/* Line level at the end of the last half bit written */
+	int level;
 	int has_msg;
 	int last_edge_written;
 	uint8_t out_msg[PD_BIT_LEN / 5];
@@ -58,6 +63,7 @@ static void pd_test_reset_phy(int port)
 	pd_phy[port].rx_started = 0;
 	pd_phy[port].rx_monitoring = 0;
 	pd_phy[port].preamble_written = 0;
+	pd_phy[port].level = 0;
 	pd_phy[port].has_msg = 0;
 	pd_phy[port].last_edge_written = 0;
 	pd_phy[port].verified_idx = 0;
@@ -148,6 +154,26 @@ void pd_simulate_rx(int port)
 	pd_rx_event(port);
 }
 
+void pd_test_rx_msg_ready(int port)
+{
+	pd_phy[port].rx_started = 1;
+}
+
+void pd_test_tx_msg_loopback(int port, int len)
+{
+	uint8_t out_msg[PD_BIT_LEN / 5];
+	int i;
+
+	/* Feed the symbols we just encoded back into the receiver */
+	memcpy(out_msg, pd_phy[port].out_msg, len);
+	pd_test_reset_phy(port);
+	pd_test_rx_set_preamble(port, 1);
+	for (i = 0; i < len; ++i)
+		pd_test_rx_msg_append_bits(port, out_msg[i], 5);
+	pd_test_rx_msg_append_last_edge(port);
+	pd_test_rx_msg_ready(port);
+}
+
 static int pd_test_tx_msg_verify(int port, uint8_t raw)
 {
 	int verified_idx = pd_phy[port].verified_idx++;
@@ -247,29 +273,60 @@ int pd_write_preamble(int port)
 {
 	ASSERT(pd_phy[port].preamble_written == 0);
 	pd_phy[port].preamble_written = 1;
+	/* The preamble ends with 1, like on the stm32 PHY */
+	pd_phy[port].level = 1;
 	ASSERT(pd_phy[port].has_msg == 0);
 	return 0;
 }
 
-static uint8_t decode_bmc(uint32_t val10)
+/*
+ * Decode a symbol from the half bit levels on the line, checking that each
+ * bit starts with a transition from the level the previous one ended on.
+ */
+static uint8_t decode_bmc(int port, uint32_t line10)
 {
+	int level = pd_phy[port].level;
 	uint8_t ret = 0;
 	int i;
 
-	for (i = 0; i < 5; ++i)
-		if (!!(val10 & (1 << (2 * i))) !=
-		    !!(val10 & (1 << (2 * i + 1))))
+	for (i = 0; i < 5; ++i) {
+		int first = !!(line10 & BIT(2 * i));
+		int second = !!(line10 & BIT(2 * i + 1));
+
+		if (first == level)
+			ret = BMC_INVALID;
+		else if (first != second && ret != BMC_INVALID)
 			ret |= BIT(i);
+		level = second;
+	}
+	pd_phy[port].level = level;
 	return ret;
 }
 
 int pd_write_sym(int port, int bit_off, uint32_t val10)
 {
-	pd_phy[port].out_msg[bit_off] = decode_bmc(val10);
+	/* Symbols are encoded as if the line were low before them */
+	if (pd_phy[port].level)
+		val10 ^= 0x3FF;
+	pd_phy[port].out_msg[bit_off] = decode_bmc(port, val10);
 	pd_phy[port].has_msg = 1;
 	return bit_off + 1;
 }
 
+int pd_write_byte(int port, int bit_off, uint32_t val20)
+{
+	/*
+	 * Only the level before the first symbol is corrected for; the
+	 * second one must already follow on from the first.
+	 */
+	if (pd_phy[port].level)
+		val20 ^= 0xFFFFF;
+	pd_phy[port].out_msg[bit_off++] = decode_bmc(port, val20 & 0x3FF);
+	pd_phy[port].out_msg[bit_off++] = decode_bmc(port, val20 >> 10);
+	pd_phy[port].has_msg = 1;
+	return bit_off;
+}
+
 int pd_write_last_edge(int port, int bit_off)
 {
 	pd_phy[port].last_edge_written = 1;
@@ -220,6 +220,25 @@ int pd_write_sym(int port, int bit_off, uint32_t val10)
 	return bit_off + 5*2;
 }
 
+int pd_write_byte(int port, int bit_off, uint32_t val20)
+{
+	uint32_t *msg = pd_phy[port].raw_samples;
+	int word_idx = bit_off / 32;
+	int bit_idx = bit_off % 32;
+	uint32_t val = (pd_phy[port].b_toggle ? 0xFFFFF : 0) ^ val20;
+	pd_phy[port].b_toggle = val & 0x80000 ? 0x3FF : 0;
+	if (bit_idx <= 12) {
+		if (bit_idx == 0)
+			msg[word_idx] = 0;
+		msg[word_idx] |= val << bit_idx;
+	} else {
+		msg[word_idx] |= val << bit_idx;
+		msg[word_idx+1] = val >> (32 - bit_idx);
+		/* side effect: clear the new word when starting it */
+	}
+	return bit_off + 5*4;
+}
+
 int pd_write_last_edge(int port, int bit_off)
 {
 	uint32_t *msg = pd_phy[port].raw_samples;
@@ -0,0 +1,177 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Boot timeline */
+
+#include "atomic.h"
+#include "boot_timeline.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "system.h"
+#include "timer.h"
+#include "util.h"
+
+#define TIMELINE_ENTRIES CONFIG_BOOT_TIMELINE_ENTRIES
+BUILD_ASSERT(TIMELINE_ENTRIES <= UINT16_MAX);
+
+static struct ec_boot_timeline_entry timeline[TIMELINE_ENTRIES];
+
+/* Entries recorded, which may be more than were kept */
+static atomic_t timeline_count;
+
+static const char * const step_names[] = {
+	[EC_BOOT_TIMELINE_TIMER] = "timer",
+	[EC_BOOT_TIMELINE_UART] = "uart",
+	[EC_BOOT_TIMELINE_KEYBOARD_SCAN] = "keyboard scan",
+	[EC_BOOT_TIMELINE_INITS_DONE] = "inits done",
+	[EC_BOOT_TIMELINE_HOOK_INIT] = "HOOK_INIT",
+	[EC_BOOT_TIMELINE_TASKS] = "tasks",
+	[EC_BOOT_TIMELINE_AP_STARTUP] = "AP startup",
+};
+BUILD_ASSERT(ARRAY_SIZE(step_names) == EC_BOOT_TIMELINE_STEP_COUNT);
+
+static const char * const lazy_names[] = {
+	[EC_BOOT_TIMELINE_LAZY_FIRST_USE] = "first use",
+	[EC_BOOT_TIMELINE_LAZY_AFTER_BOOT] = "after boot",
+	[EC_BOOT_TIMELINE_LAZY_AP_ON] = "AP on",
+};
+BUILD_ASSERT(ARRAY_SIZE(lazy_names) == EC_BOOT_TIMELINE_LAZY_COUNT);
+
+static void timeline_add(enum ec_boot_timeline_type type, int id,
+			 timestamp_t start, uint32_t arg)
+{
+	int i = atomic_add(&timeline_count, 1);
+	struct ec_boot_timeline_entry *e;
+
+	/* Keep counting, so it's known how many didn't fit */
+	if (i >= TIMELINE_ENTRIES) {
+		if (i >= UINT16_MAX)
+			atomic_sub(&timeline_count, 1);
+		return;
+	}
+
+	e = timeline + i;
+	e->time_us = start.le.lo;
+	e->type = type;
+	e->id = id;
+	e->duration_us = get_time().val - start.val;
+	e->arg = arg;
+}
+
+void boot_timeline_step(enum ec_boot_timeline_step step)
+{
+	timeline_add(EC_BOOT_TIMELINE_STEP, step, get_time(), 0);
+}
+
+void boot_timeline_hook(enum hook_type type, void (*routine)(void),
+			timestamp_t start)
+{
+	if (type == HOOK_INIT)
+		timeline_add(EC_BOOT_TIMELINE_INIT, 0, start,
+			     (uint32_t)(uintptr_t)routine);
+}
+
+void boot_timeline_lazy(enum ec_boot_timeline_lazy why, void (*routine)(void),
+			timestamp_t start)
+{
+	timeline_add(EC_BOOT_TIMELINE_LAZY, why, start,
+		     (uint32_t)(uintptr_t)routine);
+}
+
+/* Only the first time, which is what a boot waits for */
+static void boot_timeline_ap_startup(void)
+{
+	static int done;
+
+	if (!done) {
+		done = 1;
+		boot_timeline_step(EC_BOOT_TIMELINE_AP_STARTUP);
+	}
+}
+DECLARE_HOOK(HOOK_CHIPSET_STARTUP, boot_timeline_ap_startup, HOOK_PRIO_FIRST);
+
+static int timeline_kept(void)
+{
+	return MIN((int)timeline_count, TIMELINE_ENTRIES);
+}
+
+/*****************************************************************************/
+/* Host commands */
+
+static enum ec_status
+hc_boot_timeline(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_boot_timeline *p = args->params;
+	struct ec_response_boot_timeline *r = args->response;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entries[0]);
+	int kept = timeline_kept();
+	int i;
+
+	for (i = 0; i < max && p->index + i < kept; i++)
+		r->entries[i] = timeline[p->index + i];
+
+	r->recorded = timeline_count;
+	r->kept = kept;
+	r->count = i;
+	r->flags = system_jumped_to_this_image() ? EC_BOOT_TIMELINE_JUMPED : 0;
+	args->response_size = sizeof(*r) + i * sizeof(r->entries[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_BOOT_TIMELINE, hc_boot_timeline, EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_boottimeline(int argc, char **argv)
+{
+	const struct ec_boot_timeline_entry *e;
+	uint32_t step[EC_BOOT_TIMELINE_STEP_COUNT] = { 0 };
+	uint32_t done = 0;
+	int kept = timeline_kept();
+	int i;
+
+	for (i = 0; i < kept; i++) {
+		e = timeline + i;
+		ccprintf("%10u  ", e->time_us);
+
+		switch (e->type) {
+		case EC_BOOT_TIMELINE_STEP:
+			ccprintf("%s\n", step_names[e->id]);
+			step[e->id] = e->time_us;
+			done |= BIT(e->id);
+			break;
+		case EC_BOOT_TIMELINE_INIT:
+			ccprintf("init %pP took %u us\n",
+				 (void *)(uintptr_t)e->arg, e->duration_us);
+			break;
+		case EC_BOOT_TIMELINE_LAZY:
+			ccprintf("lazy init %pP (%s) took %u us\n",
+				 (void *)(uintptr_t)e->arg, lazy_names[e->id],
+				 e->duration_us);
+			break;
+		}
+		cflush();
+	}
+	if (timeline_count > kept)
+		ccprintf("(%d more)\n", timeline_count - kept);
+
+	if ((done & BIT(EC_BOOT_TIMELINE_HOOK_INIT)) &&
+	    (done & BIT(EC_BOOT_TIMELINE_TASKS)))
+		ccprintf("HOOK_INIT took %u us\n",
+			 step[EC_BOOT_TIMELINE_TASKS] -
+			 step[EC_BOOT_TIMELINE_HOOK_INIT]);
+	if ((done & BIT(EC_BOOT_TIMELINE_TIMER)) &&
+	    (done & BIT(EC_BOOT_TIMELINE_TASKS)))
+		ccprintf("Tasks running %u us after the clock started\n",
+			 step[EC_BOOT_TIMELINE_TASKS] -
+			 step[EC_BOOT_TIMELINE_TIMER]);
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(boottimeline, command_boottimeline, NULL,
+			     "Print the boot timeline");
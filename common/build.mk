@@ -45,6 +45,7 @@ common-$(CONFIG_BATTERY_FUEL_GAUGE)+=battery_fuel_gauge.o
 common-$(CONFIG_BLUETOOTH_LE)+=bluetooth_le.o
 common-$(CONFIG_BLUETOOTH_LE_STACK)+=btle_hci_controller.o btle_ll.o
 common-$(CONFIG_BODY_DETECTION)+=body_detection.o
+common-$(CONFIG_BOOT_TIMELINE)+=boot_timeline.o
 common-$(CONFIG_CAPSENSE)+=capsense.o
 common-$(CONFIG_CEC)+=cec.o
 common-$(CONFIG_CROS_BOARD_INFO)+=cbi.o
@@ -78,6 +79,7 @@ common-$(CONFIG_HOSTCMD_ESPI)+=espi.o
 common-$(CONFIG_EXTPOWER_GPIO)+=extpower_gpio.o
 common-$(CONFIG_EXTPOWER)+=extpower_common.o
 common-$(CONFIG_FANS)+=fan.o pwm.o
+common-$(CONFIG_FAN_RPM_CONTROL)+=fan_rpm_control.o
 common-$(CONFIG_FLASH)+=flash.o
 common-$(CONFIG_FMAP)+=fmap.o
 common-$(CONFIG_GESTURE_SW_DETECTION)+=gesture.o
@@ -98,6 +100,7 @@ common-$(CONFIG_KEYBOARD_PROTOCOL_8042)+=keyboard_8042.o \
 common-$(CONFIG_KEYBOARD_PROTOCOL_MKBP)+=keyboard_mkbp.o
 common-$(CONFIG_KEYBOARD_TEST)+=keyboard_test.o
 common-$(CONFIG_KEYBOARD_VIVALDI)+=keyboard_vivaldi.o
+common-$(CONFIG_LAZY_INIT)+=lazy_init.o
 common-$(CONFIG_LED_COMMON)+=led_common.o
 common-$(CONFIG_LED_POLICY_STD)+=led_policy_std.o
 common-$(CONFIG_LED_PWM)+=led_pwm.o
@@ -109,7 +112,7 @@ common-$(CONFIG_HOSTCMD_X86)+=acpi.o port80.o ec_features.o
 common-$(CONFIG_MAG_CALIBRATE)+= mag_cal.o math_util.o vec3.o mat33.o mat44.o \
 	kasa.o
 common-$(CONFIG_MKBP_EVENT)+=mkbp_event.o
-common-$(CONFIG_OCPC)+=ocpc.o
+common-$(CONFIG_OCPC)+=ocpc.o math_util.o
 common-$(CONFIG_ONEWIRE)+=onewire.o
 common-$(CONFIG_ORIENTATION_SENSOR)+=motion_orientation.o
 common-$(CONFIG_PECI_COMMON)+=peci.o
@@ -143,8 +146,10 @@ common-$(CONFIG_SPI_FLASH)+=spi_flash.o spi_flash_reg.o
 common-$(CONFIG_SPI_FLASH_REGS)+=spi_flash_reg.o
 common-$(CONFIG_SPI_NOR)+=spi_nor.o
 common-$(CONFIG_SWITCH)+=switch.o
+common-$(CONFIG_SYSJUMP_TIMING)+=sysjump_timing.o
 common-$(CONFIG_SW_CRC)+=crc.o
 common-$(CONFIG_TABLET_MODE)+=tablet_mode.o
+common-$(CONFIG_TASK_STATS)+=task_stats.o
 common-$(CONFIG_TEMP_SENSOR)+=temp_sensor.o
 common-$(CONFIG_THROTTLE_AP)+=thermal.o throttle_ap.o
 common-$(CONFIG_THROTTLE_AP_ON_BAT_DISCHG_CURRENT)+=throttle_ap.o
@@ -264,6 +269,14 @@ ifneq ($(bootblock_ls),$(old_bootblock_ls))
 endif
 endif # CONFIG_BOOTBLOCK
 
+ifneq ($(CONFIG_CURVE25519_FIXED_BASE),)
+$(out)/RO/common/curve25519-generic.o: $(out)/x25519_comb_table.h
+$(out)/RW/common/curve25519-generic.o: $(out)/x25519_comb_table.h
+
+$(out)/x25519_comb_table.h: $(out)/util/gen_x25519_comb
+	$(call quiet,x25519_comb,X25519 )
+endif # CONFIG_CURVE25519_FIXED_BASE
+
 ifneq ($(CONFIG_TOUCHPAD_HASH_FW),)
 $(out)/RO/common/update_fw.o: $(out)/touchpad_fw_hash.h
 $(out)/RW/common/update_fw.o: $(out)/touchpad_fw_hash.h
@@ -51,6 +51,55 @@ void fan_set_count(int count)
 	fan_count = count;
 }
 
+/*
+ * RPM control is done by the fan controller itself, unless the EC is running
+ * its own loop on top of the duty cycle.
+ */
+static void set_rpm_mode(int fan, int rpm_mode)
+{
+#ifdef CONFIG_FAN_RPM_CONTROL
+	fan_rpm_control_set_mode(fan, rpm_mode);
+#else
+	fan_set_rpm_mode(FAN_CH(fan), rpm_mode);
+#endif
+}
+
+static int get_rpm_mode(int fan)
+{
+#ifdef CONFIG_FAN_RPM_CONTROL
+	return fan_rpm_control_get_mode(fan);
+#else
+	return fan_get_rpm_mode(FAN_CH(fan));
+#endif
+}
+
+static void set_rpm_target(int fan, int rpm)
+{
+#ifdef CONFIG_FAN_RPM_CONTROL
+	fan_rpm_control_set_target(fan, rpm);
+#else
+	fan_set_rpm_target(FAN_CH(fan), rpm);
+#endif
+}
+
+static int get_rpm_target(int fan)
+{
+#ifdef CONFIG_FAN_RPM_CONTROL
+	return fan_rpm_control_get_target(fan);
+#else
+	return fan_get_rpm_target(FAN_CH(fan));
+#endif
+}
+
+static int is_stalled(int fan)
+{
+#ifdef CONFIG_FAN_RPM_CONTROL
+	if (fan_rpm_control_is_stalled(fan))
+		return 1;
+#endif
+	return fan_is_stalled(FAN_CH(fan));
+}
+
 #ifndef CONFIG_FAN_RPM_CUSTOM
 /* This is the default implementation. It's only called over [0,100].
  * Convert the percentage to a target RPM. We can't simply scale all
@@ -99,7 +148,7 @@ test_mockable void fan_set_percent_needed(int fan, int pct)
 	    new_rpm < fans[fan].rpm->rpm_start)
 		new_rpm = fans[fan].rpm->rpm_start;
 
-	fan_set_rpm_target(FAN_CH(fan), new_rpm);
+	set_rpm_target(fan, new_rpm);
 }
 
 static void set_enabled(int fan, int enable)
@@ -116,13 +165,13 @@ test_export_static void set_thermal_control_enabled(int fan, int enable)
 
 	/* If controlling the fan, need it in RPM-control mode */
 	if (enable)
-		fan_set_rpm_mode(FAN_CH(fan), 1);
+		set_rpm_mode(fan, 1);
 }
 
 static void set_duty_cycle(int fan, int percent)
 {
 	/* Move the fan to manual control */
-	fan_set_rpm_mode(FAN_CH(fan), 0);
+	set_rpm_mode(fan, 0);
 
 	/* enable the fan when non-zero duty */
 	set_enabled(fan, (percent > 0) ? 1 : 0);
@@ -192,14 +241,14 @@ static int cc_faninfo(int argc, char **argv)
 		ccprintf("%sActual: %4d rpm\n", leader,
 			 fan_get_rpm_actual(FAN_CH(fan)));
 		ccprintf("%sTarget: %4d rpm\n", leader,
-			 fan_get_rpm_target(FAN_CH(fan)));
+			 get_rpm_target(fan));
 		ccprintf("%sDuty:   %d%%\n", leader,
 			 fan_get_duty(FAN_CH(fan)));
 		tmp = fan_get_status(FAN_CH(fan));
 		ccprintf("%sStatus: %d (%s)\n", leader,
 			 tmp, human_status[tmp]);
 		ccprintf("%sMode:   %s\n", leader,
-			 fan_get_rpm_mode(FAN_CH(fan)) ? "rpm" : "duty");
+			 get_rpm_mode(fan) ? "rpm" : "duty");
 		ccprintf("%sAuto:   %s\n", leader,
 			 is_thermal_control_enabled(fan) ? "yes" : "no");
 		ccprintf("%sEnable: %s\n", leader,
@@ -255,7 +304,7 @@ static int cc_fanset(int argc, char **argv)
 	}
 
 	/* Move the fan to automatic control */
-	fan_set_rpm_mode(FAN_CH(fan), 1);
+	set_rpm_mode(fan, 1);
 
 	/* enable the fan when non-zero rpm */
 	set_enabled(fan, (rpm > 0) ? 1 : 0);
@@ -263,7 +312,7 @@ static int cc_fanset(int argc, char **argv)
 	/* Disable thermal engine automatic fan control. */
 	set_thermal_control_enabled(fan, 0);
 
-	fan_set_rpm_target(FAN_CH(fan), rpm);
+	set_rpm_target(fan, rpm);
 
 	ccprintf("Setting fan %d rpm target to %d\n", fan, rpm);
 
@@ -323,7 +372,7 @@ int dptf_get_fan_duty_target(void)
 	if (fan_count == 0)
 		return -1;
 
-	if (is_thermal_control_enabled(fan) || fan_get_rpm_mode(FAN_CH(fan)))
+	if (is_thermal_control_enabled(fan) || get_rpm_mode(fan))
 		return -1;
 
 	return fan_get_duty(FAN_CH(fan));
@@ -357,7 +406,7 @@ hc_pwm_get_fan_target_rpm(struct host_cmd_handler_args *args)
 		return EC_RES_ERROR;
 
 	/* TODO(crosbug.com/p/23803) */
-	r->rpm = fan_get_rpm_target(FAN_CH(0));
+	r->rpm = get_rpm_target(0);
 	args->response_size = sizeof(*r);
 
 	return EC_RES_SUCCESS;
@@ -379,8 +428,8 @@ hc_pwm_set_fan_target_rpm(struct host_cmd_handler_args *args)
 			set_enabled(fan, (p_v0->rpm > 0) ? 1 : 0);
 
 			set_thermal_control_enabled(fan, 0);
-			fan_set_rpm_mode(FAN_CH(fan), 1);
-			fan_set_rpm_target(FAN_CH(fan), p_v0->rpm);
+			set_rpm_mode(fan, 1);
+			set_rpm_target(fan, p_v0->rpm);
 		}
 
 		return EC_RES_SUCCESS;
@@ -394,8 +443,8 @@ hc_pwm_set_fan_target_rpm(struct host_cmd_handler_args *args)
 	set_enabled(fan, (p_v1->rpm > 0) ? 1 :0);
 
 	set_thermal_control_enabled(fan, 0);
-	fan_set_rpm_mode(FAN_CH(fan), 1);
-	fan_set_rpm_target(FAN_CH(fan), p_v1->rpm);
+	set_rpm_mode(fan, 1);
+	set_rpm_target(fan, p_v1->rpm);
 
 	return EC_RES_SUCCESS;
 }
@@ -463,7 +512,6 @@ DECLARE_HOST_COMMAND(EC_CMD_THERMAL_AUTO_FAN_CTRL,
  */
 BUILD_ASSERT(CONFIG_FANS <= EC_FAN_SPEED_ENTRIES);
 
-#define PWMFAN_SYSJUMP_TAG 0x5046  /* "PF" */
 #define PWM_HOOK_VERSION 1
 /* Saved PWM state across sysjumps */
 struct pwm_fan_state {
@@ -481,7 +529,6 @@ static void pwm_fan_init(void)
 	const struct pwm_fan_state *prev;
 	struct pwm_fan_state state;
 	uint16_t *mapped;
-	int version, size;
 	int i;
 	int fan;
 
@@ -492,9 +539,9 @@ static void pwm_fan_init(void)
 		fan_channel_setup(FAN_CH(fan), fans[fan].conf->flags);
 
 	/* Restore previous state. */
-	prev = (const struct pwm_fan_state *)
-		system_get_jump_tag(PWMFAN_SYSJUMP_TAG, &version, &size);
-	if (prev && version == PWM_HOOK_VERSION && size == sizeof(*prev)) {
+	prev = system_get_jump_slot(JUMP_TAG_FAN, PWM_HOOK_VERSION,
+				    sizeof(*prev));
+	if (prev) {
 		memcpy(&state, prev, sizeof(state));
 	} else {
 		memset(&state, 0, sizeof(state));
@@ -503,7 +550,7 @@ static void pwm_fan_init(void)
 	for (fan = 0; fan < fan_count; fan++) {
 		fan_set_enabled(FAN_CH(fan),
 				state.flag & FAN_STATE_FLAG_ENABLED);
-		fan_set_rpm_target(FAN_CH(fan), state.rpm);
+		set_rpm_target(fan, state.rpm);
 		set_thermal_control_enabled(
 				fan, state.flag & FAN_STATE_FLAG_THERMAL);
 	}
@@ -523,7 +570,7 @@ static void pwm_fan_second(void)
 	int fan;
 
 	for (fan = 0; fan < fan_count; fan++) {
-		if (fan_is_stalled(FAN_CH(fan))) {
+		if (is_stalled(fan)) {
 			rpm = EC_FAN_SPEED_STALLED;
 			stalled = 1;
 			cprints(CC_PWM, "Fan %d stalled!", fan);
@@ -556,10 +603,10 @@ static void pwm_fan_preserve_state(void)
 		state.flag |= FAN_STATE_FLAG_ENABLED;
 	if (is_thermal_control_enabled(fan))
 		state.flag |= FAN_STATE_FLAG_THERMAL;
-	state.rpm = fan_get_rpm_target(FAN_CH(fan));
+	state.rpm = get_rpm_target(fan);
 
-	system_add_jump_tag(PWMFAN_SYSJUMP_TAG, PWM_HOOK_VERSION,
-			    sizeof(state), &state);
+	system_add_jump_slot(JUMP_TAG_FAN, PWM_HOOK_VERSION,
+			     sizeof(state), &state);
 }
 DECLARE_HOOK(HOOK_SYSJUMP, pwm_fan_preserve_state, HOOK_PRIO_DEFAULT);
 
@@ -570,7 +617,7 @@ static void pwm_fan_control(int enable)
 	/* TODO(crosbug.com/p/23530): Still treating all fans as one. */
 	for (fan = 0; fan < fan_count; fan++) {
 		set_thermal_control_enabled(fan, enable);
-		fan_set_rpm_target(FAN_CH(fan), enable ?
+		set_rpm_target(fan, enable ?
 			fan_percent_to_rpm(FAN_CH(fan), CONFIG_FAN_INIT_SPEED) :
 			0);
 		set_enabled(fan, enable);
@@ -0,0 +1,281 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* EC-side closed-loop fan RPM control */
+
+#include "common.h"
+#include "console.h"
+#include "fan.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "math_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define CPRINTS(format, args...) cprints(CC_PWM, format, ## args)
+
+#define PERIOD_MS CONFIG_FAN_RPM_CONTROL_PERIOD_MS
+
+/* Duty cycles are worked out in 1/1024 percent */
+#define DUTY_SCALE 1024
+#define DUTY_FULL (100 * DUTY_SCALE)
+
+/*
+ * A fan has settled once it has stayed within 5% (or this many RPM, if more)
+ * of its target for this many periods, and until it leaves that band.
+ */
+#define SETTLE_BAND_MIN_RPM 50
+#define SETTLE_PERIODS 3
+
+struct fan_rpm_state {
+	int rpm_mode;
+	int target;
+	int duty;		/* 1/1024 percent */
+	int integral;		/* 1/1024 percent */
+
+	/* Tach readings, newest first, and their filtered value */
+	int tach[3];
+	int rpm;
+
+	int stalled;
+	int stall_ms;
+	int stall_count;
+
+	/* Response to the last target change */
+	timestamp_t target_time;
+	timestamp_t band_time;
+	int direction;
+	int in_band;
+	int settle_ms;		/* -1 until settled */
+	int overshoot;
+};
+
+static struct fan_rpm_state fan_state[CONFIG_FANS];
+static int loop_running;
+
+static int median3(int a, int b, int c)
+{
+	if (a > b)
+		return b > c ? b : MIN(a, c);
+	return a > c ? a : MIN(b, c);
+}
+
+static void track_response(struct fan_rpm_state *s)
+{
+	int band = MAX(s->target / 20, SETTLE_BAND_MIN_RPM);
+	int over = (s->rpm - s->target) * s->direction;
+
+	if (over > s->overshoot)
+		s->overshoot = over;
+
+	if (ABS(s->rpm - s->target) > band) {
+		s->in_band = 0;
+		s->settle_ms = -1;
+		return;
+	}
+
+	if (!s->in_band++)
+		s->band_time = get_time();
+	if (s->settle_ms < 0 && s->in_band >= SETTLE_PERIODS)
+		s->settle_ms = (s->band_time.val - s->target_time.val) / MSEC;
+}
+
+static void track_stall(int fan)
+{
+	struct fan_rpm_state *s = fan_state + fan;
+
+	if (s->rpm >= fans[fan].rpm->rpm_min / 2) {
+		if (s->stalled)
+			CPRINTS("Fan %d restarted", fan);
+		s->stalled = 0;
+		s->stall_ms = 0;
+		return;
+	}
+
+	s->stall_ms += PERIOD_MS;
+	if (!s->stalled && s->stall_ms >= CONFIG_FAN_RPM_CONTROL_STALL_MS) {
+		CPRINTS("Fan %d stalled!", fan);
+		s->stalled = 1;
+		s->stall_count++;
+	}
+}
+
+static void fan_rpm_update(int fan)
+{
+	struct fan_rpm_state *s = fan_state + fan;
+	int err, ff, p, integral, out, last_rpm;
+
+	if (!s->target) {
+		/* Nothing to control: stop the fan and start afresh next time */
+		fan_set_duty(FAN_CH(fan), 0);
+		s->duty = 0;
+		s->integral = 0;
+		s->rpm = 0;
+		memset(s->tach, 0, sizeof(s->tach));
+		s->stalled = 0;
+		s->stall_ms = 0;
+		return;
+	}
+
+	/*
+	 * A median of three drops single bad tach readings, and averaging
+	 * that smooths out jitter without lagging much.
+	 */
+	s->tach[2] = s->tach[1];
+	s->tach[1] = s->tach[0];
+	s->tach[0] = fan_get_rpm_actual(FAN_CH(fan));
+	last_rpm = s->rpm;
+	s->rpm += (median3(s->tach[0], s->tach[1], s->tach[2]) - s->rpm) / 2;
+
+	track_response(s);
+	track_stall(fan);
+
+	if (s->stalled) {
+		s->duty = DUTY_FULL;
+	} else {
+		/*
+		 * Start from the duty the target needs on a linear fan, so a
+		 * new thermal demand takes effect at once, and let the loop
+		 * correct for how far this fan is from linear.
+		 */
+		ff = (int64_t)s->target * DUTY_FULL / fans[fan].rpm->rpm_max;
+		err = s->target - s->rpm;
+		p = CONFIG_FAN_RPM_CONTROL_KP * err;
+
+		/*
+		 * Don't wind up while the duty is pinned, or while the fan is
+		 * still slewing towards the target by itself; that's what
+		 * overshoots.
+		 */
+		integral = s->integral +
+			   CONFIG_FAN_RPM_CONTROL_KI * err * PERIOD_MS / 1000;
+		out = ff + p + integral;
+		if (!(out > DUTY_FULL && err > 0) && !(out < 0 && err < 0) &&
+		    (s->rpm - last_rpm) * (err > 0 ? 1 : -1) <= s->target / 100)
+			s->integral = integral;
+
+		s->duty = CLAMP(ff + p + s->integral, 0, DUTY_FULL);
+	}
+
+	fan_set_duty(FAN_CH(fan), DIV_ROUND_NEAREST(s->duty, DUTY_SCALE));
+}
+
+static void fan_rpm_control(void);
+DECLARE_DEFERRED(fan_rpm_control);
+
+static void fan_rpm_control(void)
+{
+	int fan;
+
+	loop_running = 0;
+	for (fan = 0; fan < fan_get_count(); fan++) {
+		if (!fan_state[fan].rpm_mode)
+			continue;
+		fan_rpm_update(fan);
+		/* A fan without a target is off, until it gets one */
+		if (fan_state[fan].target)
+			loop_running = 1;
+	}
+
+	if (loop_running)
+		hook_call_deferred(&fan_rpm_control_data, PERIOD_MS * MSEC);
+}
+
+static void start_loop(void)
+{
+	if (!loop_running) {
+		loop_running = 1;
+		hook_call_deferred(&fan_rpm_control_data, 0);
+	}
+}
+
+void fan_rpm_control_set_mode(int fan, int rpm_mode)
+{
+	struct fan_rpm_state *s = fan_state + fan;
+
+	/* The controller only ever sees the duty cycle */
+	fan_set_rpm_mode(FAN_CH(fan), 0);
+
+	s->rpm_mode = rpm_mode;
+	if (!rpm_mode) {
+		s->stalled = 0;
+		s->stall_ms = 0;
+		return;
+	}
+
+	s->duty = fan_get_duty(FAN_CH(fan)) * DUTY_SCALE;
+	start_loop();
+}
+
+int fan_rpm_control_get_mode(int fan)
+{
+	return fan_state[fan].rpm_mode;
+}
+
+void fan_rpm_control_set_target(int fan, int rpm)
+{
+	struct fan_rpm_state *s = fan_state + fan;
+
+	if (rpm == s->target)
+		return;
+
+	s->direction = rpm >= s->rpm ? 1 : -1;
+	s->target = rpm;
+	s->target_time = get_time();
+	s->in_band = 0;
+	s->settle_ms = -1;
+	s->overshoot = 0;
+
+	/* React now, rather than at the next period */
+	if (s->rpm_mode) {
+		loop_running = 1;
+		hook_call_deferred(&fan_rpm_control_data, 0);
+	}
+}
+
+int fan_rpm_control_get_target(int fan)
+{
+	return fan_state[fan].target;
+}
+
+int fan_rpm_control_is_stalled(int fan)
+{
+	return fan_state[fan].stalled;
+}
+
+/*****************************************************************************/
+/* Host commands */
+
+static enum ec_status
+hc_fan_telemetry(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_fan_telemetry *p = args->params;
+	struct ec_response_fan_telemetry *r = args->response;
+	const struct fan_rpm_state *s;
+
+	if (p->fan_idx >= fan_get_count())
+		return EC_RES_INVALID_PARAM;
+	s = fan_state + p->fan_idx;
+
+	memset(r, 0, sizeof(*r));
+	r->target_rpm = s->target;
+	r->rpm = MAX(s->rpm, 0);
+	r->raw_rpm = MAX(s->tach[0], 0);
+	r->overshoot_rpm = s->overshoot;
+	r->stall_count = s->stall_count;
+	r->duty = DIV_ROUND_NEAREST(s->duty, DUTY_SCALE);
+	if (s->rpm_mode)
+		r->flags |= EC_FAN_TELEMETRY_RPM_MODE;
+	if (s->stalled)
+		r->flags |= EC_FAN_TELEMETRY_STALLED;
+	if (s->settle_ms >= 0) {
+		r->flags |= EC_FAN_TELEMETRY_SETTLED;
+		r->settle_ms = s->settle_ms;
+	}
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FAN_TELEMETRY, hc_fan_telemetry, EC_VER_MASK(0));
@@ -15,6 +15,8 @@
 #include "rwsig.h"
 #include "shared_mem.h"
 #include "system.h"
+#include "task.h"
+#include "timer.h"
 #include "util.h"
 #include "vboot_hash.h"
 
@@ -610,7 +612,13 @@ int flash_read(int offset, int size, char *data)
 {
 #ifdef CONFIG_MAPPED_STORAGE
 	const char *src;
+#endif
+
+	/* Make sure the caller sees queued erases and writes */
+	if (flash_queue_sync(offset, size))
+		return EC_ERROR_UNKNOWN;
 
+#ifdef CONFIG_MAPPED_STORAGE
 	if (flash_dataptr(offset, size, 1, &src) < 0)
 		return EC_ERROR_INVAL;
 
@@ -956,7 +964,7 @@ int flash_set_protect(uint32_t mask, uint32_t flags)
 	return retval;
 }
 
-#ifdef CONFIG_FLASH_DEFERRED_ERASE
+#if defined(CONFIG_FLASH_DEFERRED_ERASE) && !defined(CONFIG_FLASH_WRITE_QUEUE)
 static volatile enum ec_status erase_rc = EC_RES_SUCCESS;
 static struct ec_params_flash_erase_v1 erase_info;
 
@@ -971,6 +979,371 @@ static void flash_erase_deferred(void)
 DECLARE_DEFERRED(flash_erase_deferred);
 #endif
 
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+#ifndef CONFIG_FLASH_DEFERRED_ERASE
+#error "CONFIG_FLASH_WRITE_QUEUE requires CONFIG_FLASH_DEFERRED_ERASE"
+#endif
+
+#ifndef CONFIG_FLASH_ERASE_QUEUE_DEPTH
+#define CONFIG_FLASH_ERASE_QUEUE_DEPTH 4
+#endif
+
+/* Flush a partially filled write buffer once the host goes quiet */
+#define FLASH_QUEUE_FLUSH_DELAY_US (50 * MSEC)
+
+#define IDEAL_MASK (CONFIG_FLASH_WRITE_IDEAL_SIZE - 1)
+BUILD_ASSERT(POWER_OF_TWO(CONFIG_FLASH_WRITE_IDEAL_SIZE));
+
+struct flash_queue_range {
+	int offset;
+	int size;
+};
+
+static struct mutex flash_queue_lock;
+
+/*
+ * Async erase requests, oldest first.  The head entry shrinks as the
+ * background task erases it.
+ */
+static struct flash_queue_range erase_queue[CONFIG_FLASH_ERASE_QUEUE_DEPTH];
+static int erase_queue_head;
+static int erase_queue_count;
+/* Result of the queued erases, reported by FLASH_ERASE_GET_RESULT */
+static enum ec_status erase_queue_rc = EC_RES_SUCCESS;
+
+/*
+ * Coalescing buffer; holds data for at most one ideal-size aligned window.
+ * Data that failed to reach flash is kept, so whatever next needs it tries
+ * again and gets the error.
+ */
+static uint8_t write_buf[CONFIG_FLASH_WRITE_IDEAL_SIZE] __aligned(4);
+static int write_buf_offset;
+static int write_buf_len;
+
+static struct ec_response_flash_queue_info queue_stats;
+
+static int ranges_overlap(int off1, int size1, int off2, int size2)
+{
+	return off1 < off2 + size2 && off2 < off1 + size1;
+}
+
+/**
+ * Write the coalescing buffer to flash.  Must be called with
+ * flash_queue_lock held.
+ */
+static int flash_queue_flush_locked(void)
+{
+	timestamp_t start;
+	int rv;
+
+	if (!write_buf_len)
+		return EC_SUCCESS;
+
+	start = get_time();
+	rv = flash_write(write_buf_offset, write_buf_len, write_buf);
+	queue_stats.physical_writes++;
+	queue_stats.write_time_us += time_since32(start);
+
+	if (rv == EC_SUCCESS)
+		write_buf_len = 0;
+
+	return rv;
+}
+
+/**
+ * Erase the next block of the oldest queued erase request.  Must be called
+ * with flash_queue_lock held and a non-empty queue.
+ */
+static void flash_queue_erase_step_locked(void)
+{
+	struct flash_queue_range *r = &erase_queue[erase_queue_head];
+	timestamp_t start;
+	int size;
+
+#ifdef CONFIG_FLASH_MULTIPLE_REGION
+	/* Erase sizes vary between banks; erase the request in one go */
+	size = r->size;
+#else
+	/* One protection bank at a time, which is a multiple of erase size */
+	size = MIN(r->size, CONFIG_FLASH_BANK_SIZE -
+		   (r->offset & (CONFIG_FLASH_BANK_SIZE - 1)));
+#endif
+
+	start = get_time();
+	if (flash_erase(r->offset, size)) {
+		erase_queue_rc = EC_RES_ERROR;
+		/* Drop the rest of this request */
+		size = r->size;
+	}
+	queue_stats.erase_bytes += size;
+	queue_stats.erase_time_us += time_since32(start);
+
+	r->offset += size;
+	r->size -= size;
+	if (!r->size) {
+		erase_queue_head = (erase_queue_head + 1) %
+				   CONFIG_FLASH_ERASE_QUEUE_DEPTH;
+		erase_queue_count--;
+	}
+}
+
+/**
+ * Return 1 if any queued erase request overlaps the range.
+ */
+static int flash_queue_erase_pending(int offset, int size)
+{
+	int i;
+
+	for (i = 0; i < erase_queue_count; i++) {
+		const struct flash_queue_range *r = &erase_queue[
+			(erase_queue_head + i) % CONFIG_FLASH_ERASE_QUEUE_DEPTH];
+
+		if (ranges_overlap(r->offset, r->size, offset, size))
+			return 1;
+	}
+
+	return 0;
+}
+
+/**
+ * Complete queued operations touching the range, in the order they were
+ * received.  Must be called with flash_queue_lock held.
+ */
+static int flash_queue_sync_locked(int offset, int size)
+{
+	int rv = EC_SUCCESS;
+
+	if (write_buf_len &&
+	    ranges_overlap(write_buf_offset, write_buf_len, offset, size))
+		rv = flash_queue_flush_locked();
+
+	while (flash_queue_erase_pending(offset, size))
+		flash_queue_erase_step_locked();
+
+	return rv;
+}
+
+int flash_queue_sync(int offset, int size)
+{
+	int rv;
+
+	/* Nothing queued is the common case; skip the lock */
+	if (!write_buf_len && !erase_queue_count)
+		return EC_SUCCESS;
+
+	mutex_lock(&flash_queue_lock);
+	rv = flash_queue_sync_locked(offset, size);
+	mutex_unlock(&flash_queue_lock);
+
+	return rv;
+}
+
+static void flash_queue_sync_all(void)
+{
+	flash_queue_sync(0, CONFIG_FLASH_SIZE_BYTES);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, flash_queue_sync_all, HOOK_PRIO_DEFAULT);
+
+/**
+ * Flush buffered writes to a range about to be erased.  Must be called with
+ * flash_queue_lock held.
+ */
+static void flash_queue_flush_erased_locked(int offset, int size)
+{
+	/*
+	 * Writes received before the erase must land first.  If they can't,
+	 * drop them; the erase would clear them anyway.
+	 */
+	if (write_buf_len &&
+	    ranges_overlap(write_buf_offset, write_buf_len, offset, size) &&
+	    flash_queue_flush_locked())
+		write_buf_len = 0;
+}
+
+/**
+ * Complete queued operations ahead of a synchronous erase of the range.
+ */
+static void flash_queue_sync_erase(int offset, int size)
+{
+	mutex_lock(&flash_queue_lock);
+	flash_queue_flush_erased_locked(offset, size);
+	while (flash_queue_erase_pending(offset, size))
+		flash_queue_erase_step_locked();
+	mutex_unlock(&flash_queue_lock);
+}
+
+static void flash_queue_flush_deferred(void)
+{
+	mutex_lock(&flash_queue_lock);
+	flash_queue_flush_locked();
+	mutex_unlock(&flash_queue_lock);
+}
+DECLARE_DEFERRED(flash_queue_flush_deferred);
+
+static void flash_queue_erase_deferred(void);
+DECLARE_DEFERRED(flash_queue_erase_deferred);
+
+static void flash_queue_erase_deferred(void)
+{
+	int pending;
+
+	mutex_lock(&flash_queue_lock);
+	if (erase_queue_count)
+		flash_queue_erase_step_locked();
+	pending = erase_queue_count;
+	mutex_unlock(&flash_queue_lock);
+
+	/* Yield between blocks so the host can keep sending writes */
+	if (pending)
+		hook_call_deferred(&flash_queue_erase_deferred_data, 0);
+}
+
+/**
+ * Queue an async erase request.
+ *
+ * @return EC_RES_SUCCESS if queued, EC_RES_BUSY if the queue is full or the
+ * result of earlier erases has not been collected.
+ */
+static enum ec_status flash_queue_erase(int offset, int size)
+{
+	struct flash_queue_range *r;
+	enum ec_status rc = EC_RES_SUCCESS;
+
+#ifndef CONFIG_FLASH_MULTIPLE_REGION
+	if (!flash_range_ok(offset, size, CONFIG_FLASH_ERASE_SIZE))
+		return EC_RES_INVALID_PARAM;
+#endif
+
+	mutex_lock(&flash_queue_lock);
+
+	if (erase_queue_rc != EC_RES_SUCCESS ||
+	    erase_queue_count == CONFIG_FLASH_ERASE_QUEUE_DEPTH) {
+		rc = EC_RES_BUSY;
+		goto out;
+	}
+
+	flash_queue_flush_erased_locked(offset, size);
+
+	r = &erase_queue[(erase_queue_head + erase_queue_count) %
+			 CONFIG_FLASH_ERASE_QUEUE_DEPTH];
+	r->offset = offset;
+	r->size = size;
+	erase_queue_count++;
+	queue_stats.erase_depth_max = MAX(queue_stats.erase_depth_max,
+					  erase_queue_count);
+
+	/* Give the host time to receive the response before the first erase */
+	if (erase_queue_count == 1)
+		hook_call_deferred(&flash_queue_erase_deferred_data,
+				   100 * MSEC);
+out:
+	mutex_unlock(&flash_queue_lock);
+	return rc;
+}
+
+static enum ec_status flash_queue_erase_result(void)
+{
+	enum ec_status rc;
+
+	mutex_lock(&flash_queue_lock);
+	if (erase_queue_count) {
+		rc = EC_RES_BUSY;
+	} else {
+		rc = erase_queue_rc;
+		/* Ready for another command */
+		erase_queue_rc = EC_RES_SUCCESS;
+	}
+	mutex_unlock(&flash_queue_lock);
+
+	return rc;
+}
+
+static int flash_queue_write_locked(int offset, int size, const char *data)
+{
+	int rv;
+
+	/* Erase ahead of the write if the background task hasn't got there */
+	while (flash_queue_erase_pending(offset, size))
+		flash_queue_erase_step_locked();
+
+	/*
+	 * Flush data this write doesn't continue, or a full window left over
+	 * from a failed flush.
+	 */
+	if (write_buf_len && (offset != write_buf_offset + write_buf_len ||
+			      !(offset & IDEAL_MASK))) {
+		rv = flash_queue_flush_locked();
+		if (rv)
+			return rv;
+	}
+
+	while (size) {
+		int chunk;
+
+		if (!write_buf_len && !(offset & IDEAL_MASK) &&
+		    size > IDEAL_MASK) {
+			/* Whole ideal-size blocks go straight to flash */
+			timestamp_t start = get_time();
+
+			chunk = size & ~IDEAL_MASK;
+			rv = flash_write(offset, chunk, data);
+			queue_stats.physical_writes++;
+			queue_stats.write_time_us += time_since32(start);
+			if (rv)
+				return rv;
+		} else {
+			int window_end;
+
+			if (!write_buf_len)
+				write_buf_offset = offset;
+			window_end = (write_buf_offset & ~IDEAL_MASK) +
+				     CONFIG_FLASH_WRITE_IDEAL_SIZE;
+			chunk = MIN(size, window_end - offset);
+			memcpy(write_buf + write_buf_len, data, chunk);
+			write_buf_len += chunk;
+
+			if (offset + chunk == window_end) {
+				rv = flash_queue_flush_locked();
+				if (rv)
+					return rv;
+			}
+		}
+
+		offset += chunk;
+		data += chunk;
+		size -= chunk;
+	}
+
+	if (write_buf_len)
+		hook_call_deferred(&flash_queue_flush_deferred_data,
+				   FLASH_QUEUE_FLUSH_DELAY_US);
+
+	return EC_SUCCESS;
+}
+
+/**
+ * Queue a host write, coalescing it with adjacent writes.
+ */
+static int flash_queue_write(int offset, int size, const char *data)
+{
+	int rv;
+
+	if (!flash_range_ok(offset, size, CONFIG_FLASH_WRITE_SIZE))
+		return EC_ERROR_INVAL;
+
+	mutex_lock(&flash_queue_lock);
+
+	queue_stats.write_requests++;
+	queue_stats.write_bytes += size;
+
+	rv = flash_queue_write_locked(offset, size, data);
+
+	mutex_unlock(&flash_queue_lock);
+
+	return rv;
+}
+#endif /* CONFIG_FLASH_WRITE_QUEUE */
+
 /*****************************************************************************/
 /* Console commands */
 
@@ -1360,8 +1733,13 @@ static enum ec_status flash_command_write(struct host_cmd_handler_args *args)
 		return EC_RES_ACCESS_DENIED;
 #endif
 
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+	if (flash_queue_write(offset, p->size, (const uint8_t *)(p + 1)))
+		return EC_RES_ERROR;
+#else
 	if (flash_write(offset, p->size, (const uint8_t *)(p + 1)))
 		return EC_RES_ERROR;
+#endif
 
 	return EC_RES_SUCCESS;
 }
@@ -1409,6 +1787,9 @@ static enum ec_status flash_command_erase(struct host_cmd_handler_args *args)
 #if defined(HAS_TASK_HOSTCMD) && defined(CONFIG_HOST_COMMAND_STATUS)
 		args->result = EC_RES_IN_PROGRESS;
 		host_send_response(args);
+#endif
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+		flash_queue_sync_erase(offset, p->size);
 #endif
 		if (flash_erase(offset, p->size))
 			return EC_RES_ERROR;
@@ -1416,6 +1797,9 @@ static enum ec_status flash_command_erase(struct host_cmd_handler_args *args)
 		break;
 #ifdef CONFIG_FLASH_DEFERRED_ERASE
 	case FLASH_ERASE_SECTOR_ASYNC:
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+		rc = flash_queue_erase(offset, p->size);
+#else
 		rc = erase_rc;
 		if (rc == EC_RES_SUCCESS) {
 			memcpy(&erase_info, p_1, sizeof(*p_1));
@@ -1428,12 +1812,17 @@ static enum ec_status flash_command_erase(struct host_cmd_handler_args *args)
 			 */
 			rc = EC_RES_BUSY;
 		}
+#endif
 		break;
 	case FLASH_ERASE_GET_RESULT:
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+		rc = flash_queue_erase_result();
+#else
 		rc = erase_rc;
 		if (rc != EC_RES_BUSY)
 			/* Ready for another command */
 			erase_rc = EC_RES_SUCCESS;
+#endif
 		break;
 #endif
 	default:
@@ -1461,8 +1850,13 @@ static enum ec_status flash_command_protect(struct host_cmd_handler_args *args)
 	 * via the flags in the response.  (If we returned error, the caller
 	 * wouldn't get the response.)
 	 */
-	if (p->mask)
+	if (p->mask) {
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+		/* Land queued operations before protection changes */
+		flash_queue_sync_all();
+#endif
 		flash_set_protect(p->mask, p->flags);
+	}
 
 	/*
 	 * Retrieve the current flags.  The caller can use this to determine
@@ -1534,6 +1928,31 @@ DECLARE_HOST_COMMAND(EC_CMD_FLASH_REGION_INFO,
 		     EC_VER_MASK(EC_VER_FLASH_REGION_INFO));
 
 
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+static enum ec_status
+flash_command_queue_info(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_flash_queue_info *p = args->params;
+	struct ec_response_flash_queue_info *r = args->response;
+
+	mutex_lock(&flash_queue_lock);
+	queue_stats.write_pending = write_buf_len;
+	queue_stats.erase_depth = erase_queue_count;
+	memcpy(r, &queue_stats, sizeof(*r));
+	if (p->flags & EC_FLASH_QUEUE_INFO_RESET) {
+		memset(&queue_stats, 0, sizeof(queue_stats));
+		queue_stats.erase_depth_max = erase_queue_count;
+	}
+	mutex_unlock(&flash_queue_lock);
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_FLASH_QUEUE_INFO,
+		     flash_command_queue_info,
+		     EC_VER_MASK(EC_VER_FLASH_QUEUE_INFO));
+#endif /* CONFIG_FLASH_WRITE_QUEUE */
+
 #ifdef CONFIG_FLASH_SELECT_REQUIRED
 
 static enum ec_status flash_command_select(struct host_cmd_handler_args *args)
@@ -143,9 +143,9 @@ static uint32_t fp_process_match(void)
 	fp_disable_positive_match_secret(&positive_match_secret_state);
 	CPRINTS("Matching/%d ...", templ_valid);
 	if (templ_valid) {
-		res = fp_finger_match(fp_template[0], templ_valid, fp_buffer,
-				      &fgr, &updated);
-		CPRINTS("Match =>%d (finger %d)", res, fgr);
+		res = fp_match_templates(fp_buffer, &fgr, &updated);
+		CPRINTS("Match =>%d (finger %d, %d tried)", res, fgr,
+			fp_templates_tried);
 		if (res < 0 || fgr < 0 || fgr >= FP_MAX_FINGER_COUNT) {
 			res = EC_MKBP_FP_ERR_MATCH_NO_INTERNAL;
 			timestamps_invalid |= FPSTATS_MATCHING_INV;
@@ -428,8 +428,7 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 		/* Positive match salt is after the template. */
 		uint8_t *positive_match_salt =
 			encrypted_template + sizeof(fp_template[0]);
-		size_t encrypted_blob_size = sizeof(fp_template[0]) +
-					     sizeof(fp_positive_match_salt[0]);
+		struct aes_gcm_stream gcm;
 
 		/* b/114160734: Not more than 1 encrypted message per second. */
 		if (!timestamp_expired(encryption_deadline, &now))
@@ -469,21 +468,27 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 		}
 
 		/*
-		 * Copy the payload to |fp_enc_buffer| where it will be
-		 * encrypted in-place.
+		 * Encrypt the template and its salt straight from where they
+		 * live: the tag goes in the metadata the host reads first, so
+		 * the whole blob still has to be ciphered before replying.
 		 */
-		memcpy(encrypted_template, fp_template[fgr],
-		       sizeof(fp_template[0]));
-		memcpy(positive_match_salt, fp_positive_match_salt[fgr],
-		       sizeof(fp_positive_match_salt[0]));
-
-		/* Encrypt the secret blob in-place. */
-		ret = aes_gcm_encrypt(key, SBP_ENC_KEY_LEN, encrypted_template,
-				      encrypted_template,
-				      encrypted_blob_size,
-				      enc_info->nonce, FP_CONTEXT_NONCE_BYTES,
-				      enc_info->tag, FP_CONTEXT_TAG_BYTES);
+		ret = aes_gcm_stream_init(&gcm, key, SBP_ENC_KEY_LEN,
+					  enc_info->nonce,
+					  FP_CONTEXT_NONCE_BYTES);
 		always_memset(key, 0, sizeof(key));
+		if (ret == EC_SUCCESS)
+			ret = aes_gcm_stream_encrypt(&gcm, fp_template[fgr],
+						     encrypted_template,
+						     sizeof(fp_template[0]));
+		if (ret == EC_SUCCESS)
+			ret = aes_gcm_stream_encrypt(
+				&gcm, fp_positive_match_salt[fgr],
+				positive_match_salt,
+				sizeof(fp_positive_match_salt[0]));
+		if (ret == EC_SUCCESS)
+			aes_gcm_stream_tag(&gcm, enc_info->tag,
+					   FP_CONTEXT_TAG_BYTES);
+		aes_gcm_stream_clear(&gcm);
 		if (ret != EC_SUCCESS) {
 			CPRINTS("fgr%d: Failed to encrypt template", fgr);
 			return EC_RES_UNAVAILABLE;
@@ -499,6 +504,7 @@ DECLARE_HOST_COMMAND(EC_CMD_FP_FRAME, fp_command_frame, EC_VER_MASK(0));
 
 static enum ec_status fp_command_stats(struct host_cmd_handler_args *args)
 {
+	struct ec_response_fp_stats_v1 *r_v1 = args->response;
 	struct ec_response_fp_stats *r = args->response;
 
 	r->capture_time_us = capture_time_us;
@@ -512,11 +518,20 @@ static enum ec_status fp_command_stats(struct host_cmd_handler_args *args)
 	 * secret is read/disabled, and we are not using this field in biod.
 	 */
 	r->template_matched = positive_match_secret_state.template_matched;
-
 	args->response_size = sizeof(*r);
+
+	/* V1 is identical to V0 with more information appended */
+	if (args->version == 1) {
+		r_v1->templates_tried = fp_templates_tried;
+		r_v1->reserved = 0;
+		memcpy(r_v1->template_time_us, fp_template_match_time_us,
+		       sizeof(fp_template_match_time_us));
+		args->response_size = sizeof(*r_v1);
+	}
 	return EC_RES_SUCCESS;
 }
-DECLARE_HOST_COMMAND(EC_CMD_FP_STATS, fp_command_stats, EC_VER_MASK(0));
+DECLARE_HOST_COMMAND(EC_CMD_FP_STATS, fp_command_stats,
+		     EC_VER_MASK(0) | EC_VER_MASK(1));
 
 static bool template_needs_validation_value(
 	struct ec_fp_template_encryption_metadata *enc_info)
@@ -539,6 +554,231 @@ static int validate_template_format(
 	return EC_RES_SUCCESS;
 }
 
+/*
+ * Set up |gcm| from the start with the key of the template being uploaded.
+ * The caller must clear |gcm| when done.
+ */
+static int template_upload_stream(struct aes_gcm_stream *gcm)
+{
+	struct ec_fp_template_encryption_metadata *enc_info =
+		(void *)fp_enc_buffer;
+	uint8_t key[SBP_ENC_KEY_LEN];
+	int ret;
+
+	ret = derive_encryption_key(key, enc_info->encryption_salt);
+	if (ret == EC_SUCCESS)
+		ret = aes_gcm_stream_init(gcm, key, SBP_ENC_KEY_LEN,
+					  enc_info->nonce,
+					  FP_CONTEXT_NONCE_BYTES);
+	always_memset(key, 0, sizeof(key));
+	return ret;
+}
+
+/*
+ * Decipher in-place the part of the encrypted blob received so far in
+ * |fp_enc_buffer|, and check the tag once all of it is.
+ */
+static int template_upload_decipher(void)
+{
+	struct fp_template_upload *up = &fp_template_upload;
+	struct ec_fp_template_encryption_metadata *enc_info =
+		(void *)fp_enc_buffer;
+	uint8_t *blob = fp_enc_buffer + sizeof(*enc_info);
+	uint32_t n = MIN(up->received - sizeof(*enc_info), up->blob_size) -
+		     up->deciphered;
+	int ret;
+
+	if (!n)
+		return EC_SUCCESS;
+
+	ret = aes_gcm_stream_decrypt(&up->gcm, blob + up->deciphered,
+				     blob + up->deciphered, n);
+	if (ret != EC_SUCCESS)
+		return ret;
+
+	up->deciphered += n;
+	if (up->deciphered == up->blob_size) {
+		up->authentic = aes_gcm_stream_check_tag(
+			&up->gcm, enc_info->tag, FP_CONTEXT_TAG_BYTES) ==
+				EC_SUCCESS;
+		/* Nothing left to decipher: don't keep the key around. */
+		aes_gcm_stream_clear(&up->gcm);
+	}
+	return EC_SUCCESS;
+}
+
+static void template_upload_reset(void)
+{
+	always_memset(&fp_template_upload, 0, sizeof(fp_template_upload));
+}
+
+/*
+ * Give up deciphering the template as it comes in: encipher again what was
+ * deciphered in-place, so that the commit finds |fp_enc_buffer| as the host
+ * sent it.
+ */
+static void template_upload_fall_back(void)
+{
+	struct fp_template_upload *up = &fp_template_upload;
+	uint8_t *blob =
+		fp_enc_buffer + sizeof(struct ec_fp_template_encryption_metadata);
+	struct aes_gcm_stream gcm;
+
+	if (up->deciphered && template_upload_stream(&gcm) == EC_SUCCESS) {
+		/* GCM uses AES in counter mode, this is the same keystream. */
+		aes_gcm_stream_encrypt(&gcm, blob, blob, up->deciphered);
+		aes_gcm_stream_clear(&gcm);
+	}
+	template_upload_reset();
+	up->buffered = true;
+}
+
+/*
+ * Store the chunk of |size| bytes at |offset| in |fp_enc_buffer| and
+ * decipher the template in-place as the chunks come in, so that the commit
+ * only has to copy it. If the host sends them out of order, fall back to
+ * deciphering the whole buffer on commit.
+ */
+static void template_upload_chunk(uint32_t offset, const uint8_t *data,
+				  uint32_t size)
+{
+	struct fp_template_upload *up = &fp_template_upload;
+	struct ec_fp_template_encryption_metadata *enc_info =
+		(void *)fp_enc_buffer;
+
+	if (offset == 0)
+		/* A new template: drop whatever was deciphered before. */
+		template_upload_reset();
+	else if (!up->buffered && offset != up->received)
+		template_upload_fall_back();
+
+	memcpy(&fp_enc_buffer[offset], data, size);
+	if (up->buffered)
+		return;
+	up->received = offset + size;
+
+	if (!up->blob_size) {
+		if (up->received < sizeof(*enc_info))
+			return;
+		/* Let the commit report an invalid format or key. */
+		if (validate_template_format(enc_info) != EC_RES_SUCCESS) {
+			template_upload_fall_back();
+			return;
+		}
+		if (enc_info->struct_version <= 3)
+			up->blob_size = sizeof(fp_template[0]);
+		else
+			up->blob_size = sizeof(fp_template[0]) +
+					sizeof(fp_positive_match_salt[0]);
+		/* Expand the key once for all the chunks to come. */
+		if (template_upload_stream(&up->gcm) != EC_SUCCESS) {
+			template_upload_fall_back();
+			return;
+		}
+	}
+
+	if (template_upload_decipher() != EC_SUCCESS)
+		template_upload_fall_back();
+}
+
+/*
+ * Decipher the complete encrypted template held in |fp_enc_buffer| in-place.
+ */
+static enum ec_status template_decipher_buffer(uint32_t idx)
+{
+	struct ec_fp_template_encryption_metadata *enc_info =
+		(void *)fp_enc_buffer;
+	/* Encrypted template is after the metadata. */
+	uint8_t *encrypted_template = fp_enc_buffer + sizeof(*enc_info);
+	uint8_t key[SBP_ENC_KEY_LEN];
+	size_t encrypted_blob_size;
+	int ret;
+
+	if (enc_info->struct_version <= 3) {
+		encrypted_blob_size = sizeof(fp_template[0]);
+	} else {
+		encrypted_blob_size =
+			sizeof(fp_template[0]) +
+			sizeof(fp_positive_match_salt[0]);
+	}
+
+	ret = derive_encryption_key(key, enc_info->encryption_salt);
+	if (ret != EC_SUCCESS) {
+		CPRINTS("fgr%d: Failed to derive key", idx);
+		return EC_RES_UNAVAILABLE;
+	}
+
+	/* Decrypt the secret blob in-place. */
+	ret = aes_gcm_decrypt(key, SBP_ENC_KEY_LEN, encrypted_template,
+			      encrypted_template,
+			      encrypted_blob_size,
+			      enc_info->nonce, FP_CONTEXT_NONCE_BYTES,
+			      enc_info->tag, FP_CONTEXT_TAG_BYTES);
+	always_memset(key, 0, sizeof(key));
+	if (ret != EC_SUCCESS) {
+		CPRINTS("fgr%d: Failed to decipher template", idx);
+		return EC_RES_UNAVAILABLE;
+	}
+	return EC_RES_SUCCESS;
+}
+
+static enum ec_status template_upload_commit(uint32_t idx)
+{
+	struct fp_template_upload *up = &fp_template_upload;
+	/*
+	 * The beginning of the buffer contains nonce, encryption_salt
+	 * and tag.
+	 */
+	struct ec_fp_template_encryption_metadata *enc_info =
+		(void *)fp_enc_buffer;
+	/* Encrypted template is after the metadata. */
+	uint8_t *template = fp_enc_buffer + sizeof(*enc_info);
+	/* Positive match salt is after the template. */
+	uint8_t *positive_match_salt = template + sizeof(fp_template[0]);
+	enum ec_status res;
+
+	if (validate_template_format(enc_info) != EC_RES_SUCCESS) {
+		CPRINTS("fgr%d: Template format not supported", idx);
+		fp_clear_finger_context(idx);
+		return EC_RES_INVALID_PARAM;
+	}
+
+	if (up->blob_size && up->deciphered == up->blob_size) {
+		/* Everything was deciphered on the fly, tag included. */
+		res = EC_RES_SUCCESS;
+		if (!up->authentic) {
+			CPRINTS("fgr%d: Failed to decipher template", idx);
+			res = EC_RES_UNAVAILABLE;
+		}
+	} else {
+		res = template_decipher_buffer(idx);
+	}
+	if (res != EC_RES_SUCCESS) {
+		/* Don't leave bad data in the template buffer */
+		fp_clear_finger_context(idx);
+		return res;
+	}
+
+	if (template_needs_validation_value(enc_info)) {
+		CPRINTS("fgr%d: Generating positive match salt.", idx);
+		init_trng();
+		rand_bytes(positive_match_salt, FP_POSITIVE_MATCH_SALT_BYTES);
+		exit_trng();
+	}
+	if (bytes_are_trivial(positive_match_salt,
+			      sizeof(fp_positive_match_salt[0]))) {
+		CPRINTS("fgr%d: Trivial positive match salt.", idx);
+		fp_clear_finger_context(idx);
+		return EC_RES_INVALID_PARAM;
+	}
+	memcpy(fp_template[idx], template, sizeof(fp_template[0]));
+	memcpy(fp_positive_match_salt[idx], positive_match_salt,
+	       sizeof(fp_positive_match_salt[0]));
+
+	templ_valid++;
+	return EC_RES_SUCCESS;
+}
+
 static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 {
 	const struct ec_params_fp_template *params = args->params;
@@ -546,8 +786,7 @@ static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 	int xfer_complete = params->size & FP_TEMPLATE_COMMIT;
 	uint32_t offset = params->offset;
 	uint32_t idx = templ_valid;
-	uint8_t key[SBP_ENC_KEY_LEN];
-	struct ec_fp_template_encryption_metadata *enc_info;
+	enum ec_status res;
 	int ret;
 
 	/* Can we store one more template ? */
@@ -556,84 +795,23 @@ static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 
 	if (args->params_size !=
 	    size + offsetof(struct ec_params_fp_template, data))
+		ret = EC_ERROR_INVAL;
+	else
+		ret = validate_fp_buffer_offset(sizeof(fp_enc_buffer), offset,
+						size);
+	if (ret != EC_SUCCESS) {
+		/* Stop streaming rather than keep the key for a broken host. */
+		template_upload_fall_back();
 		return EC_RES_INVALID_PARAM;
-	ret = validate_fp_buffer_offset(sizeof(fp_enc_buffer), offset, size);
-	if (ret != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
+	}
 
-	memcpy(&fp_enc_buffer[offset], params->data, size);
+	template_upload_chunk(offset, params->data, size);
 
 	if (xfer_complete) {
-		/* Encrypted template is after the metadata. */
-		uint8_t *encrypted_template = fp_enc_buffer + sizeof(*enc_info);
-		/* Positive match salt is after the template. */
-		uint8_t *positive_match_salt =
-			encrypted_template + sizeof(fp_template[0]);
-		size_t encrypted_blob_size;
-
-		/*
-		 * The complete encrypted template has been received, start
-		 * decryption.
-		 */
-		fp_clear_finger_context(idx);
-		/*
-		 * The beginning of the buffer contains nonce, encryption_salt
-		 * and tag.
-		 */
-		enc_info = (void *)fp_enc_buffer;
-		ret = validate_template_format(enc_info);
-		if (ret != EC_RES_SUCCESS) {
-			CPRINTS("fgr%d: Template format not supported", idx);
-			return EC_RES_INVALID_PARAM;
-		}
-
-		if (enc_info->struct_version <= 3) {
-			encrypted_blob_size = sizeof(fp_template[0]);
-		} else {
-			encrypted_blob_size =
-				sizeof(fp_template[0]) +
-				sizeof(fp_positive_match_salt[0]);
-		}
-
-		ret = derive_encryption_key(key, enc_info->encryption_salt);
-		if (ret != EC_SUCCESS) {
-			CPRINTS("fgr%d: Failed to derive key", idx);
-			return EC_RES_UNAVAILABLE;
-		}
-
-		/* Decrypt the secret blob in-place. */
-		ret = aes_gcm_decrypt(key, SBP_ENC_KEY_LEN, encrypted_template,
-				      encrypted_template,
-				      encrypted_blob_size,
-				      enc_info->nonce, FP_CONTEXT_NONCE_BYTES,
-				      enc_info->tag, FP_CONTEXT_TAG_BYTES);
-		always_memset(key, 0, sizeof(key));
-		if (ret != EC_SUCCESS) {
-			CPRINTS("fgr%d: Failed to decipher template", idx);
-			/* Don't leave bad data in the template buffer */
-			fp_clear_finger_context(idx);
-			return EC_RES_UNAVAILABLE;
-		}
-		memcpy(fp_template[idx], encrypted_template,
-		       sizeof(fp_template[0]));
-		if (template_needs_validation_value(enc_info)) {
-			CPRINTS("fgr%d: Generating positive match salt.", idx);
-			init_trng();
-			rand_bytes(positive_match_salt,
-				   FP_POSITIVE_MATCH_SALT_BYTES);
-			exit_trng();
-		}
-		if (bytes_are_trivial(positive_match_salt,
-				      sizeof(fp_positive_match_salt[0]))) {
-			CPRINTS("fgr%d: Trivial positive match salt.", idx);
-			always_memset(fp_template[idx], 0,
-				      sizeof(fp_template[0]));
-			return EC_RES_INVALID_PARAM;
-		}
-		memcpy(fp_positive_match_salt[idx], positive_match_salt,
-		       sizeof(fp_positive_match_salt[0]));
-
-		templ_valid++;
+		/* The complete encrypted template has been received. */
+		res = template_upload_commit(idx);
+		template_upload_reset();
+		return res;
 	}
 
 	return EC_RES_SUCCESS;
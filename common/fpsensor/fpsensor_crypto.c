@@ -11,12 +11,64 @@
 #include "fpsensor_private.h"
 #include "fpsensor_state.h"
 #include "rollback.h"
+#include "timer.h"
 
 #if !defined(CONFIG_AES) || !defined(CONFIG_AES_GCM) || \
 	!defined(CONFIG_ROLLBACK_SECRET_SIZE)
 #error "fpsensor requires AES, AES_GCM and ROLLBACK_SECRET_SIZE"
 #endif
 
+struct fp_crypto_stats fp_crypto_stats;
+
+/*
+ * Template encryption keys of the current user context, by salt, so that
+ * uploading a template in chunks only derives its key once. They are wiped
+ * with the context, and dropped when the rollback block is rewritten since
+ * the secret they come from may have changed.
+ */
+static struct {
+	bool valid;
+	uint32_t rollback_update_count;
+	uint8_t salt[FP_CONTEXT_ENCRYPTION_SALT_BYTES];
+	uint8_t key[SBP_ENC_KEY_LEN];
+} key_cache[FP_MAX_FINGER_COUNT];
+static int key_cache_next;
+
+void fp_clear_key_cache(void)
+{
+	always_memset(key_cache, 0, sizeof(key_cache));
+	key_cache_next = 0;
+}
+
+static bool key_cache_get(uint8_t *out_key, const uint8_t *salt)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(key_cache); i++) {
+		if (key_cache[i].valid &&
+		    key_cache[i].rollback_update_count ==
+			    rollback_get_update_count() &&
+		    !memcmp(key_cache[i].salt, salt,
+			    sizeof(key_cache[i].salt))) {
+			memcpy(out_key, key_cache[i].key, SBP_ENC_KEY_LEN);
+			return true;
+		}
+	}
+	return false;
+}
+
+static void key_cache_put(const uint8_t *key, const uint8_t *salt,
+			  uint32_t rollback_update_count)
+{
+	int i = key_cache_next;
+
+	memcpy(key_cache[i].salt, salt, sizeof(key_cache[i].salt));
+	memcpy(key_cache[i].key, key, sizeof(key_cache[i].key));
+	key_cache[i].rollback_update_count = rollback_update_count;
+	key_cache[i].valid = true;
+	key_cache_next = (i + 1) % ARRAY_SIZE(key_cache);
+}
+
 static int get_ikm(uint8_t *ikm)
 {
 	int ret;
@@ -30,6 +82,7 @@ static int get_ikm(uint8_t *ikm)
 	 * The first CONFIG_ROLLBACK_SECRET_SIZE bytes of IKM are read from the
 	 * anti-rollback blocks.
 	 */
+	fp_crypto_stats.ikm_reads++;
 	ret = rollback_get_secret(ikm);
 	if (ret != EC_SUCCESS) {
 		CPRINTS("Failed to read rollback secret: %d", ret);
@@ -142,6 +195,7 @@ int hkdf_expand(uint8_t *out_key, size_t L, const uint8_t *prk,
 int derive_positive_match_secret(uint8_t *output,
 				 const uint8_t *input_positive_match_salt)
 {
+	timestamp_t t0 = get_time();
 	int ret;
 	uint8_t ikm[CONFIG_ROLLBACK_SECRET_SIZE + sizeof(tpm_seed)];
 	uint8_t prk[SHA256_DIGEST_SIZE];
@@ -180,19 +234,26 @@ int derive_positive_match_secret(uint8_t *output,
 			"derived secret bytes are trivial.");
 		ret = EC_ERROR_HW_INTERNAL;
 	}
+	fp_crypto_stats.derivations++;
+	fp_crypto_stats.derive_time_us += time_since32(t0);
 	return ret;
 }
 
 int derive_encryption_key(uint8_t *out_key, const uint8_t *salt)
 {
+	timestamp_t t0 = get_time();
 	int ret;
 	uint8_t ikm[CONFIG_ROLLBACK_SECRET_SIZE + sizeof(tpm_seed)];
 	uint8_t prk[SHA256_DIGEST_SIZE];
+	uint32_t rollback_update_count = rollback_get_update_count();
 
 	BUILD_ASSERT(SBP_ENC_KEY_LEN <= SHA256_DIGEST_SIZE);
 	BUILD_ASSERT(SBP_ENC_KEY_LEN <= CONFIG_ROLLBACK_SECRET_SIZE);
 	BUILD_ASSERT(sizeof(user_id) == SHA256_DIGEST_SIZE);
 
+	if (key_cache_get(out_key, salt))
+		return EC_SUCCESS;
+
 	ret = get_ikm(ikm);
 	if (ret != EC_SUCCESS) {
 		CPRINTS("Failed to get IKM: %d", ret);
@@ -212,75 +273,123 @@ int derive_encryption_key(uint8_t *out_key, const uint8_t *salt)
 	ret = hkdf_expand_one_step(out_key, SBP_ENC_KEY_LEN, prk, sizeof(prk),
 				   (uint8_t *)user_id, sizeof(user_id));
 	always_memset(prk, 0, sizeof(prk));
+	if (ret == EC_SUCCESS)
+		key_cache_put(out_key, salt, rollback_update_count);
 
+	fp_crypto_stats.derivations++;
+	fp_crypto_stats.derive_time_us += time_since32(t0);
 	return ret;
 }
 
-int aes_gcm_encrypt(const uint8_t *key, int key_size,
-		    const uint8_t *plaintext,
-		    uint8_t *ciphertext, int text_size,
-		    const uint8_t *nonce, int nonce_size,
-		    uint8_t *tag, int tag_size)
+int aes_gcm_stream_init(struct aes_gcm_stream *stream, const uint8_t *key,
+			int key_size, const uint8_t *nonce, int nonce_size)
 {
 	int res;
-	AES_KEY aes_key;
-	GCM128_CONTEXT ctx;
 
 	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
 		CPRINTS("Invalid nonce size %d bytes", nonce_size);
 		return EC_ERROR_INVAL;
 	}
 
-	res = AES_set_encrypt_key(key, 8 * key_size, &aes_key);
+	res = AES_set_encrypt_key(key, 8 * key_size, &stream->key);
 	if (res) {
 		CPRINTS("Failed to set encryption key: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
-	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
+	CRYPTO_gcm128_init(&stream->ctx, &stream->key, (block128_f)AES_encrypt,
+			   0);
+	CRYPTO_gcm128_setiv(&stream->ctx, &stream->key, nonce, nonce_size);
+	return EC_SUCCESS;
+}
+
+int aes_gcm_stream_encrypt(struct aes_gcm_stream *stream,
+			   const uint8_t *plaintext, uint8_t *ciphertext,
+			   int text_size)
+{
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_encrypt(&ctx, &aes_key, plaintext, ciphertext,
-				    text_size);
+	int res = CRYPTO_gcm128_encrypt_ctr32(
+		&stream->ctx, &stream->key, plaintext, ciphertext, text_size,
+		(ctr128_f)aes_nohw_ctr32_encrypt_blocks);
+
 	if (!res) {
 		CPRINTS("Failed to encrypt: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	CRYPTO_gcm128_tag(&ctx, tag, tag_size);
 	return EC_SUCCESS;
 }
 
-int aes_gcm_decrypt(const uint8_t *key, int key_size, uint8_t *plaintext,
-		    const uint8_t *ciphertext, int text_size,
-		    const uint8_t *nonce, int nonce_size,
-		    const uint8_t *tag, int tag_size)
+int aes_gcm_stream_decrypt(struct aes_gcm_stream *stream,
+			   const uint8_t *ciphertext, uint8_t *plaintext,
+			   int text_size)
 {
-	int res;
-	AES_KEY aes_key;
-	GCM128_CONTEXT ctx;
-
-	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
-		CPRINTS("Invalid nonce size %d bytes", nonce_size);
-		return EC_ERROR_INVAL;
-	}
-
-	res = AES_set_encrypt_key(key, 8 * key_size, &aes_key);
-	if (res) {
-		CPRINTS("Failed to set decryption key: %d", res);
-		return EC_ERROR_UNKNOWN;
-	}
-	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
-	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_decrypt(&ctx, &aes_key, ciphertext, plaintext,
-				    text_size);
+	int res = CRYPTO_gcm128_decrypt_ctr32(
+		&stream->ctx, &stream->key, ciphertext, plaintext, text_size,
+		(ctr128_f)aes_nohw_ctr32_encrypt_blocks);
+
 	if (!res) {
 		CPRINTS("Failed to decrypt: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	res = CRYPTO_gcm128_finish(&ctx, tag, tag_size);
+	return EC_SUCCESS;
+}
+
+void aes_gcm_stream_tag(struct aes_gcm_stream *stream, uint8_t *tag,
+			int tag_size)
+{
+	CRYPTO_gcm128_tag(&stream->ctx, tag, tag_size);
+}
+
+int aes_gcm_stream_check_tag(struct aes_gcm_stream *stream,
+			     const uint8_t *tag, int tag_size)
+{
+	int res = CRYPTO_gcm128_finish(&stream->ctx, tag, tag_size);
+
 	if (!res) {
 		CPRINTS("Found incorrect tag: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
 	return EC_SUCCESS;
 }
+
+void aes_gcm_stream_clear(struct aes_gcm_stream *stream)
+{
+	always_memset(stream, 0, sizeof(*stream));
+}
+
+int aes_gcm_encrypt(const uint8_t *key, int key_size,
+		    const uint8_t *plaintext,
+		    uint8_t *ciphertext, int text_size,
+		    const uint8_t *nonce, int nonce_size,
+		    uint8_t *tag, int tag_size)
+{
+	struct aes_gcm_stream stream;
+	int ret;
+
+	ret = aes_gcm_stream_init(&stream, key, key_size, nonce, nonce_size);
+	if (ret == EC_SUCCESS)
+		ret = aes_gcm_stream_encrypt(&stream, plaintext, ciphertext,
+					     text_size);
+	if (ret == EC_SUCCESS)
+		aes_gcm_stream_tag(&stream, tag, tag_size);
+	aes_gcm_stream_clear(&stream);
+	return ret;
+}
+
+int aes_gcm_decrypt(const uint8_t *key, int key_size, uint8_t *plaintext,
+		    const uint8_t *ciphertext, int text_size,
+		    const uint8_t *nonce, int nonce_size,
+		    const uint8_t *tag, int tag_size)
+{
+	struct aes_gcm_stream stream;
+	int ret;
+
+	ret = aes_gcm_stream_init(&stream, key, key_size, nonce, nonce_size);
+	if (ret == EC_SUCCESS)
+		ret = aes_gcm_stream_decrypt(&stream, ciphertext, plaintext,
+					     text_size);
+	if (ret == EC_SUCCESS)
+		ret = aes_gcm_stream_check_tag(&stream, tag, tag_size);
+	aes_gcm_stream_clear(&stream);
+	return ret;
+}
@@ -0,0 +1,99 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Fingerprint match scheduling */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "fpsensor.h"
+#include "fpsensor_private.h"
+#include "fpsensor_state.h"
+#include "timer.h"
+#include "util.h"
+
+BUILD_ASSERT(FP_MAX_FINGER_COUNT <= FP_STATS_MAX_TEMPLATES);
+
+uint32_t fp_template_match_time_us[FP_MAX_FINGER_COUNT];
+uint8_t fp_templates_tried;
+
+/* Only builds with a matching library (or its mock) can match anything. */
+#if defined(HAVE_FP_PRIVATE_DRIVER) || defined(HAS_MOCK_FP_SENSOR)
+
+/*
+ * Fill |order| with the indexes of the valid templates, most recently
+ * matched first. Templates that never matched keep their enrollment order.
+ */
+test_export_static void fp_match_order(uint8_t *order)
+{
+	int i, j;
+
+	for (i = 0; i < templ_valid; i++) {
+		for (j = i; j > 0 &&
+		     templ_last_match[order[j - 1]] < templ_last_match[i]; j--)
+			order[j] = order[j - 1];
+		order[j] = i;
+	}
+}
+
+static void fp_template_matched(int fgr)
+{
+	uint32_t latest = 0;
+	int i;
+
+	for (i = 0; i < FP_MAX_FINGER_COUNT; i++)
+		latest = MAX(latest, templ_last_match[i]);
+	templ_last_match[fgr] = latest + 1;
+}
+
+static int is_match(int res)
+{
+	return res == EC_MKBP_FP_ERR_MATCH_YES ||
+	       res == EC_MKBP_FP_ERR_MATCH_YES_UPDATED ||
+	       res == EC_MKBP_FP_ERR_MATCH_YES_UPDATE_FAILED;
+}
+
+int fp_match_templates(uint8_t *image, int32_t *match_index,
+		       uint32_t *update_bitmap)
+{
+	uint8_t order[FP_MAX_FINGER_COUNT];
+	int res = EC_MKBP_FP_ERR_MATCH_NO;
+	int i;
+
+	*match_index = FP_NO_SUCH_TEMPLATE;
+	*update_bitmap = 0;
+	memset(fp_template_match_time_us, 0,
+	       sizeof(fp_template_match_time_us));
+	fp_templates_tried = 0;
+
+	fp_match_order(order);
+	for (i = 0; i < templ_valid; i++) {
+		const int fgr = order[i];
+		timestamp_t t0 = get_time();
+		int32_t idx = FP_NO_SUCH_TEMPLATE;
+		uint32_t updated = 0;
+
+		res = fp_finger_match(fp_template[fgr], 1, image, &idx,
+				      &updated);
+		fp_template_match_time_us[fgr] = time_since32(t0);
+		fp_templates_tried++;
+
+		if (is_match(res)) {
+			*match_index = fgr;
+			*update_bitmap = updated ? BIT(fgr) : 0;
+			fp_template_matched(fgr);
+			return res;
+		}
+		/*
+		 * Errors and low quality images will not do better against
+		 * the other templates.
+		 */
+		if (res != EC_MKBP_FP_ERR_MATCH_NO)
+			return res;
+	}
+	return res;
+}
+
+#endif /* HAVE_FP_PRIVATE_DRIVER || HAS_MOCK_FP_SENSOR */
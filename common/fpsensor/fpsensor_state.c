@@ -21,7 +21,6 @@ uint8_t fp_buffer[FP_SENSOR_IMAGE_SIZE] FP_FRAME_SECTION __aligned(4);
 uint8_t fp_template[FP_MAX_FINGER_COUNT][FP_ALGORITHM_TEMPLATE_SIZE]
 	FP_TEMPLATE_SECTION;
 /* Encryption/decryption buffer */
-/* TODO: On-the-fly encryption/decryption without a dedicated buffer */
 /*
  * Store the encryption metadata at the beginning of the buffer containing the
  * ciphered data.
@@ -38,12 +37,16 @@ struct positive_match_secret_state positive_match_secret_state = {
 	.deadline.val = 0,
 };
 
+struct fp_template_upload fp_template_upload;
+
 /* Index of the last enrolled but not retrieved template. */
 int8_t template_newly_enrolled = FP_NO_SUCH_TEMPLATE;
 /* Number of used templates */
 uint32_t templ_valid;
 /* Bitmap of the templates with local modifications */
 uint32_t templ_dirty;
+/* Rank of the last successful match of each template, 0 if none */
+uint32_t templ_last_match[FP_MAX_FINGER_COUNT];
 /* Current user ID */
 uint32_t user_id[FP_CONTEXT_USERID_WORDS];
 /* Part of the IKM used to derive encryption keys received from the TPM. */
@@ -68,6 +71,7 @@ void fp_clear_finger_context(int idx)
 	always_memset(fp_template[idx], 0, sizeof(fp_template[0]));
 	always_memset(fp_positive_match_salt[idx], 0,
 		      sizeof(fp_positive_match_salt[0]));
+	templ_last_match[idx] = 0;
 }
 
 /**
@@ -83,7 +87,9 @@ static void _fp_clear_context(void)
 	templ_dirty = 0;
 	always_memset(fp_buffer, 0, sizeof(fp_buffer));
 	always_memset(fp_enc_buffer, 0, sizeof(fp_enc_buffer));
+	always_memset(&fp_template_upload, 0, sizeof(fp_template_upload));
 	always_memset(user_id, 0, sizeof(user_id));
+	fp_clear_key_cache();
 	fp_disable_positive_match_secret(&positive_match_secret_state);
 	for (idx = 0; idx < FP_MAX_FINGER_COUNT; idx++)
 		fp_clear_finger_context(idx);
@@ -236,6 +242,8 @@ static enum ec_status fp_command_context(struct host_cmd_handler_args *args)
 			return EC_RES_BUSY;
 
 		memcpy(user_id, p->userid, sizeof(user_id));
+		/* The keys kept were derived for the previous user id. */
+		fp_clear_key_cache();
 		return EC_RES_SUCCESS;
 	}
 
@@ -6,9 +6,13 @@
 /* System hooks for Chrome EC */
 
 #include "atomic.h"
+#include "boot_timeline.h"
 #include "console.h"
 #include "hooks.h"
 #include "link_defs.h"
+#include "power_timeline.h"
+#include "sysjump_timing.h"
+#include "task.h"
 #include "timer.h"
 #include "util.h"
 
@@ -102,10 +106,293 @@ static void record_hook_delay(uint64_t now, uint64_t last, uint64_t interval,
 }
 #endif
 
+#if defined(CONFIG_POWER_TIMELINE) || defined(CONFIG_SYSJUMP_TIMING) || \
+	defined(CONFIG_BOOT_TIMELINE)
+/* Whether a timeline records the routines of this type of hook */
+static int hook_type_timed(enum hook_type type)
+{
+	switch (type) {
+#ifdef CONFIG_POWER_TIMELINE
+	case HOOK_CHIPSET_PRE_INIT:
+	case HOOK_CHIPSET_STARTUP:
+	case HOOK_CHIPSET_RESUME:
+	case HOOK_CHIPSET_SUSPEND:
+#ifdef CONFIG_CHIPSET_RESUME_INIT_HOOK
+	case HOOK_CHIPSET_RESUME_INIT:
+	case HOOK_CHIPSET_SUSPEND_COMPLETE:
+#endif
+	case HOOK_CHIPSET_SHUTDOWN:
+	case HOOK_CHIPSET_SHUTDOWN_COMPLETE:
+	case HOOK_CHIPSET_RESET:
+#endif
+#ifdef CONFIG_SYSJUMP_TIMING
+	case HOOK_SYSJUMP:
+#endif
+#if defined(CONFIG_SYSJUMP_TIMING) || defined(CONFIG_BOOT_TIMELINE)
+	case HOOK_INIT:
+#endif
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+static void hook_call(enum hook_type type, const struct hook_data *p)
+{
+	timestamp_t t;
+
+	if (!hook_type_timed(type)) {
+		p->routine();
+		return;
+	}
+
+	t = get_time();
+	p->routine();
+	power_timeline_hook(type, p->routine, t);
+	sysjump_timing_hook(type, p->routine, t);
+	boot_timeline_hook(type, p->routine, t);
+}
+#else
+static void hook_call(enum hook_type type, const struct hook_data *p)
+{
+	p->routine();
+}
+#endif
+
+#ifdef CONFIG_HOOK_CONCURRENT
+#define BATCH_MAX CONFIG_HOOK_CONCURRENT_MAX
+BUILD_ASSERT(BATCH_MAX <= INT8_MAX);
+
+static const task_id_t hook_workers[] = {
+#ifdef HAS_TASK_HOOKW0
+	TASK_ID_HOOKW0,
+#endif
+#ifdef HAS_TASK_HOOKW1
+	TASK_ID_HOOKW1,
+#endif
+#ifdef HAS_TASK_HOOKW2
+	TASK_ID_HOOKW2,
+#endif
+#ifdef HAS_TASK_HOOKW3
+	TASK_ID_HOOKW3,
+#endif
+};
+
+enum batch_state {
+	BATCH_PENDING = 0,
+	BATCH_RUNNING,
+	BATCH_DONE,
+};
+
+/* The routines of one priority being run, by whoever's free */
+static struct {
+	enum hook_type type;
+	int count;
+	int left;		/* Not done yet */
+	int running;
+	const struct hook_data *hook[BATCH_MAX];
+	int8_t after[BATCH_MAX];	/* Index of the routine to wait for */
+	uint8_t state[BATCH_MAX];
+} batch;
+static mutex_t batch_lock;
+static atomic_t batch_busy;
+static task_id_t batch_caller;
+
+static int hook_type_concurrent(enum hook_type type)
+{
+	switch (type) {
+	case HOOK_CHIPSET_PRE_INIT:
+	case HOOK_CHIPSET_STARTUP:
+	case HOOK_CHIPSET_RESUME:
+	case HOOK_CHIPSET_SUSPEND:
+#ifdef CONFIG_CHIPSET_RESUME_INIT_HOOK
+	case HOOK_CHIPSET_RESUME_INIT:
+	case HOOK_CHIPSET_SUSPEND_COMPLETE:
+#endif
+	case HOOK_CHIPSET_SHUTDOWN:
+	case HOOK_CHIPSET_SHUTDOWN_COMPLETE:
+	case HOOK_CHIPSET_RESET:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+ * Claim the next routine that can be started, or return -1.  Only the
+ * calling task runs the routines that aren't concurrent, so those stay in
+ * order, and it runs them first, as nobody else can.  With force, a routine
+ * waiting on another is claimed anyway.
+ */
+static int batch_claim(int caller, int force)
+{
+	int pass, i, a;
+
+	for (pass = !caller; pass < 2; pass++) {
+		for (i = 0; i < batch.count; i++) {
+			if (batch.state[i] != BATCH_PENDING ||
+			    batch.hook[i]->concurrent != pass)
+				continue;
+			a = batch.after[i];
+			if (a >= 0 && batch.state[a] != BATCH_DONE && !force)
+				continue;
+
+			batch.state[i] = BATCH_RUNNING;
+			batch.running++;
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+static void batch_wake(void)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(hook_workers); i++)
+		task_wake(hook_workers[i]);
+	task_wake(batch_caller);
+}
+
+static void batch_run(int i)
+{
+	hook_call(batch.type, batch.hook[i]);
+
+	mutex_lock(&batch_lock);
+	batch.state[i] = BATCH_DONE;
+	batch.running--;
+	batch.left--;
+	mutex_unlock(&batch_lock);
+
+	/* Something may have been waiting for that */
+	batch_wake();
+}
+
+void hook_worker_task(void *u)
+{
+	int i;
+
+	while (1) {
+		task_wait_event(-1);
+
+		for (;;) {
+			mutex_lock(&batch_lock);
+			i = batch.count ? batch_claim(0, 0) : -1;
+			mutex_unlock(&batch_lock);
+			if (i < 0)
+				break;
+			batch_run(i);
+		}
+	}
+}
+
+/*
+ * Run the routines of one priority, if any can be run concurrently, and
+ * return how many there were.  Otherwise, return 0.
+ */
+static int hook_run_concurrent(enum hook_type type, int prio,
+			       const struct hook_data *start,
+			       const struct hook_data *end)
+{
+	const struct hook_data *p;
+	int count = 0, concurrent = 0, waited = 0;
+	int i, j, done;
+
+	if (!hook_type_concurrent(type) || !task_start_called() ||
+	    in_interrupt_context())
+		return 0;
+
+	for (p = start; p < end; p++) {
+		if (p->priority == prio) {
+			count++;
+			concurrent |= p->concurrent;
+		}
+	}
+	if (!concurrent)
+		return 0;
+	if (count > BATCH_MAX) {
+		CPRINTS("hook %d: too many at prio %d to run concurrently",
+			type, prio);
+		return 0;
+	}
+
+	/* One batch at a time; others, or nested ones, run one by one */
+	if (atomic_or(&batch_busy, 1))
+		return 0;
+
+	mutex_lock(&batch_lock);
+	batch.type = type;
+	batch_caller = task_get_current();
+	batch.running = 0;
+	for (p = start, i = 0; p < end; p++) {
+		if (p->priority == prio) {
+			batch.hook[i] = p;
+			batch.state[i] = BATCH_PENDING;
+			batch.after[i] = -1;
+			i++;
+		}
+	}
+	for (i = 0; i < count; i++) {
+		for (j = 0; batch.hook[i]->after && j < count; j++) {
+			if (batch.hook[j]->routine == batch.hook[i]->after)
+				batch.after[i] = j;
+		}
+	}
+	batch.left = count;
+	batch.count = count;
+	mutex_unlock(&batch_lock);
+
+	batch_wake();
+
+	for (;;) {
+		mutex_lock(&batch_lock);
+		i = batch_claim(1, 0);
+		/* Only routines waiting on each other are left */
+		if (i < 0 && !batch.running && batch.left) {
+			CPRINTS("hook %d: ordering loop at prio %d", type, prio);
+			i = batch_claim(1, 1);
+		}
+		done = !batch.left;
+		mutex_unlock(&batch_lock);
+
+		if (done)
+			break;
+		if (i >= 0) {
+			batch_run(i);
+		} else {
+			task_wait_event_mask(TASK_EVENT_WAKE, -1);
+			waited = 1;
+		}
+	}
+
+	mutex_lock(&batch_lock);
+	batch.count = 0;
+	mutex_unlock(&batch_lock);
+	atomic_clear(&batch_busy);
+
+	/*
+	 * Waiting for the workers may have taken a wake meant for this task;
+	 * put it back, as an extra one does no harm.
+	 */
+	if (waited)
+		task_wake(task_get_current());
+
+	return count;
+}
+#else
+static inline int hook_run_concurrent(enum hook_type type, int prio,
+				      const struct hook_data *start,
+				      const struct hook_data *end)
+{
+	return 0;
+}
+#endif
+
 void hook_notify(enum hook_type type)
 {
 	const struct hook_data *start, *end, *p;
-	int count, called = 0;
+	int count, called = 0, ran;
 	int last_prio = HOOK_PRIO_FIRST - 1, prio;
 #ifdef CONFIG_HOOK_DEBUG
 	uint64_t start_time = get_time().val;
@@ -127,11 +414,17 @@ void hook_notify(enum hook_type type)
 		}
 		last_prio = prio;
 
+		ran = hook_run_concurrent(type, prio, start, end);
+		if (ran) {
+			called += ran;
+			continue;
+		}
+
 		/* Call all the hooks with that priority */
 		for (p = start; p < end; p++) {
 			if (p->priority == prio) {
 				called++;
-				p->routine();
+				hook_call(type, p);
 			}
 		}
 	}
@@ -181,9 +474,11 @@ void hook_task(void *u)
 	hook_task_started = 1;
 
 	/* Call HOOK_INIT hooks. */
+	boot_timeline_step(EC_BOOT_TIMELINE_HOOK_INIT);
 	hook_notify(HOOK_INIT);
 
 	/* Now, enable the rest of the tasks. */
+	boot_timeline_step(EC_BOOT_TIMELINE_TASKS);
 	task_enable_all_tasks();
 
 	while (1) {
@@ -644,6 +644,12 @@ static void host_command_debug_request(struct host_cmd_handler_args *args)
 			dump_host_command_suppressed(0);
 			return;
 		}
+		/*
+		 * Whoever follows the console log polls with this, and would
+		 * read back its own debug output every time.
+		 */
+		if (args->command == EC_CMD_CONSOLE_READ_SEQ)
+			return;
 		if (args->command == hc_prev_cmd &&
 		    t - hc_prev_time < HCDEBUG_MAX_REPEAT_DELAY) {
 			hc_prev_count++;
@@ -161,7 +161,6 @@ static int typematic_len;  /* length of typematic_scan_code */
 static uint8_t typematic_scan_code[MAX_SCAN_CODE_LEN];
 static timestamp_t typematic_deadline;
 
-#define KB_SYSJUMP_TAG 0x4b42  /* "KB" */
 #define KB_HOOK_VERSION 2
 /* the previous keyboard state before reboot_ec. */
 struct kb_state {
@@ -1288,8 +1287,8 @@ static void keyboard_preserve_state(void)
 	state.ctlram = controller_ram[0];
 	state.keystroke_enabled = keystroke_enabled;
 
-	system_add_jump_tag(KB_SYSJUMP_TAG, KB_HOOK_VERSION,
-			    sizeof(state), &state);
+	system_add_jump_slot(JUMP_TAG_KEYBOARD, KB_HOOK_VERSION,
+			     sizeof(state), &state);
 }
 DECLARE_HOOK(HOOK_SYSJUMP, keyboard_preserve_state, HOOK_PRIO_DEFAULT);
 
@@ -1299,11 +1298,10 @@ DECLARE_HOOK(HOOK_SYSJUMP, keyboard_preserve_state, HOOK_PRIO_DEFAULT);
 static void keyboard_restore_state(void)
 {
 	const struct kb_state *prev;
-	int version, size;
 
-	prev = (const struct kb_state *)system_get_jump_tag(KB_SYSJUMP_TAG,
-							    &version, &size);
-	if (prev && version == KB_HOOK_VERSION && size == sizeof(*prev)) {
+	prev = system_get_jump_slot(JUMP_TAG_KEYBOARD, KB_HOOK_VERSION,
+				    sizeof(*prev));
+	if (prev) {
 		/* Coming back from a sysjump, so restore settings. */
 		scancode_set = prev->codeset;
 		update_ctl_ram(0, prev->ctlram);
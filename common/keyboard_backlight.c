@@ -17,6 +17,8 @@
 
 static struct kblight_conf kblight;
 static int current_percent;
+/* Asked for from interrupt context before the backlight was initialized */
+static int enable_pending;
 
 void __attribute__((weak)) board_kblight_init(void)
 { }
@@ -28,8 +30,22 @@ static int kblight_init(void)
 	return kblight.drv->init();
 }
 
+/* Nothing needs the backlight until the AP is on */
+static void keyboard_backlight_init(void)
+{
+	/* Uses PWM by default. Can be customized by board_kblight_init */
+#ifdef CONFIG_PWM_KBLIGHT
+	kblight_register(&kblight_pwm);
+#endif
+	board_kblight_init();
+	if (kblight_init())
+		CPRINTS("kblight init failed");
+}
+DECLARE_LAZY_INIT(keyboard_backlight_init, HOOK_PRIO_DEFAULT, LAZY_INIT_AP_ON);
+
 static void kblight_set_deferred(void)
 {
+	lazy_init(keyboard_backlight_init);
 	if (!kblight.drv || !kblight.drv->set)
 		return;
 	kblight.drv->set(current_percent);
@@ -54,8 +70,23 @@ int kblight_get(void)
 	return current_percent;
 }
 
+static void kblight_enable_deferred(void)
+{
+	kblight_enable(enable_pending);
+}
+DECLARE_DEFERRED(kblight_enable_deferred);
+
 int kblight_enable(int enable)
 {
+	/*
+	 * From interrupt context (e.g. the LPC interrupt), initialization is
+	 * only asked for, so do this once it's done.
+	 */
+	if (!lazy_init(keyboard_backlight_init)) {
+		enable_pending = enable;
+		hook_call_deferred(&kblight_enable_deferred_data, 0);
+		return EC_SUCCESS;
+	}
 	if (!kblight.drv || !kblight.drv->enable)
 		return -1;
 	return kblight.drv->enable(enable);
@@ -71,18 +102,6 @@ int kblight_register(const struct kblight_drv *drv)
 /*
  * Hooks
  */
-static void keyboard_backlight_init(void)
-{
-	/* Uses PWM by default. Can be customized by board_kblight_init */
-#ifdef CONFIG_PWM_KBLIGHT
-	kblight_register(&kblight_pwm);
-#endif
-	board_kblight_init();
-	if (kblight_init())
-		CPRINTS("kblight init failed");
-}
-DECLARE_HOOK(HOOK_INIT, keyboard_backlight_init, HOOK_PRIO_DEFAULT);
-
 static void kblight_suspend(void)
 {
 	kblight_enable(0);
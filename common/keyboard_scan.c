@@ -462,6 +462,64 @@ static int check_runtime_keys(const uint8_t *state)
 }
 #endif /* CONFIG_KEYBOARD_RUNTIME_KEYS */
 
+/*
+ * Incremental ghosting detection state.
+ *
+ * ghost_state[] holds the matrix last passed to has_ghosting().  For each
+ * column, ghost_pairs[c] has bit c2 set if columns c and c2 share at least two
+ * rows.  ghost_row_cols[r] counts the columns with row r set; ghosting needs
+ * at least two rows shared by two or more columns, so when fewer rows qualify
+ * the pairwise masks don't need to be consulted at all.
+ */
+static uint8_t __bss_slow ghost_state[KEYBOARD_COLS_MAX];
+static uint32_t __bss_slow ghost_pairs[KEYBOARD_COLS_MAX];
+static uint8_t __bss_slow ghost_row_cols[KEYBOARD_ROWS];
+static uint8_t __bss_slow ghost_cols;
+
+BUILD_ASSERT(KEYBOARD_COLS_MAX <= 32);
+BUILD_ASSERT(KEYBOARD_ROWS <= 8);
+
+/**
+ * Update the cached row counts and column pairs for one changed column.
+ *
+ * @param c		Column whose state changed.
+ * @param new_col	New state of the column.
+ */
+static void ghost_update_column(int c, uint8_t new_col)
+{
+	uint8_t old_col = ghost_state[c];
+	uint32_t pairs = 0;
+	int c2, r;
+
+	for (r = 0; r < KEYBOARD_ROWS; r++) {
+		if (old_col & BIT(r))
+			ghost_row_cols[r]--;
+		if (new_col & BIT(r))
+			ghost_row_cols[r]++;
+	}
+
+	ghost_state[c] = new_col;
+
+	for (c2 = 0; c2 < ghost_cols; c2++) {
+		/*
+		 * A little bit of cleverness here.  Ghosting happens if 2
+		 * columns share at least 2 keys.  So we AND the columns
+		 * together and then see if more than one bit is set.
+		 * x&(x-1) is non-zero only if x has more than one bit set.
+		 */
+		uint8_t common = new_col & ghost_state[c2];
+
+		if (c2 != c && (common & (common - 1))) {
+			pairs |= BIT(c2);
+			ghost_pairs[c2] |= BIT(c);
+		} else {
+			ghost_pairs[c2] &= ~BIT(c);
+		}
+	}
+
+	ghost_pairs[c] = pairs;
+}
+
 /**
  * Check for ghosting in the keyboard state.
  *
@@ -469,31 +527,41 @@ static int check_runtime_keys(const uint8_t *state)
  * that coords which don't correspond with actual keys don't trigger ghosting
  * detection.
  *
+ * Only columns which changed since the previous call are re-evaluated, so the
+ * cost of a scan where a single key changed is O(cols) rather than O(cols^2).
+ *
  * @param state		Keyboard state to check.
  *
  * @return 1 if ghosting detected, else 0.
  */
-static int has_ghosting(const uint8_t *state)
+test_export_static int has_ghosting(const uint8_t *state)
 {
-	int c, c2;
+	int c, r;
+	int shared_rows = 0;
+
+	/* Start over if the number of columns changed at runtime */
+	if (ghost_cols != keyboard_cols) {
+		memset(ghost_state, 0, sizeof(ghost_state));
+		memset(ghost_pairs, 0, sizeof(ghost_pairs));
+		memset(ghost_row_cols, 0, sizeof(ghost_row_cols));
+		ghost_cols = keyboard_cols;
+	}
 
 	for (c = 0; c < keyboard_cols; c++) {
-		if (!state[c])
-			continue;
+		if (state[c] != ghost_state[c])
+			ghost_update_column(c, state[c]);
+	}
 
-		for (c2 = c + 1; c2 < keyboard_cols; c2++) {
-			/*
-			 * A little bit of cleverness here.  Ghosting happens
-			 * if 2 columns share at least 2 keys.  So we OR the
-			 * columns together and then see if more than one bit
-			 * is set.  x&(x-1) is non-zero only if x has more than
-			 * one bit set.
-			 */
-			uint8_t common = state[c] & state[c2];
+	for (r = 0; r < KEYBOARD_ROWS; r++) {
+		if (ghost_row_cols[r] >= 2)
+			shared_rows++;
+	}
+	if (shared_rows < 2)
+		return 0;
 
-			if (common & (common - 1))
-				return 1;
-		}
+	for (c = 0; c < keyboard_cols; c++) {
+		if (ghost_pairs[c])
+			return 1;
 	}
 
 	return 0;
@@ -0,0 +1,153 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Initialization put off until after boot */
+
+#include "boot_timeline.h"
+#include "chipset.h"
+#include "common.h"
+#include "hooks.h"
+#include "task.h"
+#include "timer.h"
+#include "util.h"
+
+/* Routines declared with DECLARE_LAZY_INIT(), in priority order */
+static struct lazy_init_data *lazy_list;
+
+/*
+ * Held while running a routine, so each is run once and those using what it
+ * initializes wait for it.  Routines may make sure of others they depend on,
+ * so the task holding it doesn't take it again.
+ */
+static mutex_t lazy_lock;
+static task_id_t lazy_owner = TASK_ID_INVALID;
+
+static int lazy_init_lock(void)
+{
+	task_id_t me;
+
+	/* Nothing else runs before the tasks are started */
+	if (!task_start_called())
+		return 0;
+
+	me = task_get_current();
+	if (lazy_owner == me)
+		return 0;
+
+	mutex_lock(&lazy_lock);
+	lazy_owner = me;
+	return 1;
+}
+
+static void lazy_init_unlock(int locked)
+{
+	if (locked) {
+		lazy_owner = TASK_ID_INVALID;
+		mutex_unlock(&lazy_lock);
+	}
+}
+
+static void lazy_init_call(struct lazy_init_data *data,
+			   enum ec_boot_timeline_lazy why)
+{
+	timestamp_t t;
+
+	if (data->done)
+		return;
+
+	t = get_time();
+	data->routine();
+	data->done = 1;
+	boot_timeline_lazy(why, data->routine, t);
+}
+
+void lazy_init_register(struct lazy_init_data *data)
+{
+	struct lazy_init_data **p;
+	int locked = lazy_init_lock();
+
+	for (p = &lazy_list; *p && (*p)->priority <= data->priority;
+	     p = &(*p)->next)
+		;
+	data->next = *p;
+	*p = data;
+
+	lazy_init_unlock(locked);
+}
+
+static void lazy_init_wanted(void)
+{
+	struct lazy_init_data *p;
+	int locked = lazy_init_lock();
+
+	for (p = lazy_list; p; p = p->next) {
+		if (p->wanted)
+			lazy_init_call(p, EC_BOOT_TIMELINE_LAZY_FIRST_USE);
+	}
+
+	lazy_init_unlock(locked);
+}
+DECLARE_DEFERRED(lazy_init_wanted);
+
+int lazy_init_run(struct lazy_init_data *data)
+{
+	int locked;
+
+	if (data->done)
+		return 1;
+
+	if (in_interrupt_context()) {
+		data->wanted = 1;
+		hook_call_deferred(&lazy_init_wanted_data, 0);
+		return 0;
+	}
+
+	locked = lazy_init_lock();
+	lazy_init_call(data, EC_BOOT_TIMELINE_LAZY_FIRST_USE);
+	lazy_init_unlock(locked);
+	return 1;
+}
+
+/*
+ * Run in the hook task, which the tasks enabled at the end of HOOK_INIT have
+ * priority over, so they get going first.
+ */
+static void lazy_init_after_boot(void)
+{
+	struct lazy_init_data *p;
+	int ap_on = !chipset_in_state(CHIPSET_STATE_ANY_OFF);
+	int locked = lazy_init_lock();
+
+	for (p = lazy_list; p; p = p->next) {
+		if (p->when == LAZY_INIT_AFTER_BOOT)
+			lazy_init_call(p, EC_BOOT_TIMELINE_LAZY_AFTER_BOOT);
+		else if (ap_on)
+			lazy_init_call(p, EC_BOOT_TIMELINE_LAZY_AP_ON);
+	}
+
+	lazy_init_unlock(locked);
+}
+DECLARE_DEFERRED(lazy_init_after_boot);
+
+static void lazy_init_boot_done(void)
+{
+	hook_call_deferred(&lazy_init_after_boot_data,
+			   CONFIG_LAZY_INIT_DELAY_MS * MSEC);
+}
+DECLARE_HOOK(HOOK_INIT, lazy_init_boot_done, HOOK_PRIO_LAST);
+
+static void lazy_init_ap_on(void)
+{
+	struct lazy_init_data *p;
+	int locked = lazy_init_lock();
+
+	for (p = lazy_list; p; p = p->next) {
+		if (p->when == LAZY_INIT_AP_ON)
+			lazy_init_call(p, EC_BOOT_TIMELINE_LAZY_AP_ON);
+	}
+
+	lazy_init_unlock(locked);
+}
+DECLARE_HOOK(HOOK_CHIPSET_STARTUP, lazy_init_ap_on, HOOK_PRIO_FIRST);
@@ -162,21 +162,19 @@ static const struct lightbar_params_v1 default_params = {
 	},
 };
 
-#define LB_SYSJUMP_TAG 0x4c42			/* "LB" */
 static void lightbar_preserve_state(void)
 {
-	system_add_jump_tag(LB_SYSJUMP_TAG, 0, sizeof(st), &st);
+	system_add_jump_slot(JUMP_TAG_LIGHTBAR, 0, sizeof(st), &st);
 }
 DECLARE_HOOK(HOOK_SYSJUMP, lightbar_preserve_state, HOOK_PRIO_DEFAULT);
 
 static void lightbar_restore_state(void)
 {
-	const uint8_t *old_state = 0;
-	int size;
+	const struct p_state *old_state;
 
-	old_state = system_get_jump_tag(LB_SYSJUMP_TAG, 0, &size);
-	if (old_state && size == sizeof(st)) {
-		memcpy(&st, old_state, size);
+	old_state = system_get_jump_slot(JUMP_TAG_LIGHTBAR, 0, sizeof(st));
+	if (old_state) {
+		memcpy(&st, old_state, sizeof(st));
 		CPRINTS("LB state restored: %d %d - %d %d/%d",
 			st.cur_seq, st.prev_seq,
 			st.battery_is_charging,
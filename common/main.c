@@ -6,6 +6,7 @@
  */
 
 #include "board_config.h"
+#include "boot_timeline.h"
 #include "button.h"
 #include "chipset.h"
 #include "clock.h"
@@ -123,6 +124,7 @@ test_mockable __keep int main(void)
 	 * timer init() must be before uart_init().
 	 */
 	timer_init();
+	boot_timeline_step(EC_BOOT_TIMELINE_TIMER);
 
 	/* Compensate the elapsed time for the RTC. */
 	if (IS_ENABLED(CONFIG_HIBERNATE_PSL_COMPENSATE_RTC))
@@ -138,6 +140,7 @@ test_mockable __keep int main(void)
 
 	/* Initialize UART.  Console output functions may now be used. */
 	uart_init();
+	boot_timeline_step(EC_BOOT_TIMELINE_UART);
 
 	/* We wait to report the failure until here where we have console. */
 	if (mpu_pre_init_rv != EC_SUCCESS)
@@ -200,6 +203,7 @@ test_mockable __keep int main(void)
 	}
 #ifdef HAS_TASK_KEYSCAN
 	keyboard_scan_init();
+	boot_timeline_step(EC_BOOT_TIMELINE_KEYBOARD_SCAN);
 #endif
 #if defined(CONFIG_DEDICATED_RECOVERY_BUTTON) || defined(CONFIG_VOLUME_BUTTONS)
 	button_init();
@@ -256,6 +260,7 @@ test_mockable __keep int main(void)
 	 * the majority of the time.
 	 */
 	CPRINTS("Inits done");
+	boot_timeline_step(EC_BOOT_TIMELINE_INITS_DONE);
 
 	/* Launch task scheduling (never returns) */
 	return task_start();
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 
 #include "common.h"
+#include "driver/fingerprint/fpsensor.h"
 #include "fpsensor.h"
 #include "mock/fp_sensor_mock.h"
 
@@ -59,11 +60,32 @@ int fp_sensor_acquire_image_with_mode(uint8_t *image_data, int mode)
 	return mock_ctrl_fp_sensor.fp_sensor_acquire_image_with_mode_return;
 }
 
+static int mock_finger_matched(int32_t idx, int32_t *match_index,
+			       uint32_t *update_bitmap)
+{
+	int res = mock_ctrl_fp_sensor.fp_finger_match_return;
+
+	*match_index = idx;
+	if (res == EC_MKBP_FP_ERR_MATCH_YES_UPDATED)
+		*update_bitmap = BIT(idx);
+	return res;
+}
+
 int fp_finger_match(void *templ, uint32_t templ_count,
 		    uint8_t *image, int32_t *match_index,
 		    uint32_t *update_bitmap)
 {
-	return mock_ctrl_fp_sensor.fp_finger_match_return;
+	const void *match = mock_ctrl_fp_sensor.fp_finger_match_template;
+	uint32_t i;
+
+	mock_ctrl_fp_sensor.fp_finger_match_templates_tried += templ_count;
+	if (match == NULL)
+		return mock_finger_matched(0, match_index, update_bitmap);
+	for (i = 0; i < templ_count; i++)
+		if ((uint8_t *)templ + i * FP_ALGORITHM_TEMPLATE_SIZE == match)
+			return mock_finger_matched(i, match_index,
+						   update_bitmap);
+	return EC_MKBP_FP_ERR_MATCH_NO;
 }
 
 int fp_enrollment_begin(void)
@@ -34,8 +34,14 @@ BUILD_ASSERT(sizeof(fake_rollback_secret) == CONFIG_ROLLBACK_SECRET_SIZE);
 /* Mock the rollback for unit or fuzz tests. */
 int rollback_get_secret(uint8_t *secret)
 {
+	mock_ctrl_rollback.get_secret_calls++;
 	if (mock_ctrl_rollback.get_secret_fail)
 		return EC_ERROR_UNKNOWN;
 	memcpy(secret, fake_rollback_secret, sizeof(fake_rollback_secret));
 	return EC_SUCCESS;
 }
+
+uint32_t rollback_get_update_count(void)
+{
+	return mock_ctrl_rollback.update_count;
+}
@@ -15,6 +15,7 @@
 #include "hooks.h"
 #include "math_util.h"
 #include "ocpc.h"
+#include "system.h"
 #include "timer.h"
 #include "usb_pd.h"
 #include "util.h"
@@ -30,6 +31,39 @@
 #define KD 1
 #define KD_DIV 10
 
+/*
+ * The gains are applied as fixed-point fractions with this many bits after the
+ * point, and whatever is left over of a mV of drive is carried to the next
+ * iteration.  That way a small error under a small gain still moves VSYS
+ * eventually, rather than being truncated away every time.
+ */
+#define GAIN_SHIFT 16
+
+/* Bound on the accumulated error, in mA, either way */
+#define INTEGRAL_MAX 500
+
+/*
+ * Auto-tuned gains, as fractions of the combined Rsys+Rbatt in mOhms.  A mV of
+ * VSYS moves the battery current by 1000/R mA, so Kp = R/2000 corrects half of
+ * the error each iteration, which stays well clear of oscillating even with
+ * the fuel gauge lagging behind.  The small Ki lets VSYS follow the battery
+ * voltage up as it charges.
+ */
+#define AUTOTUNE_KP_DIV 2000
+#define AUTOTUNE_KI_DIV 20000
+
+/*
+ * Only tune once the resistance measurements agree to within this many
+ * percent, and only retune once the resistance has moved by more than that.
+ */
+#define AUTOTUNE_TOLERANCE_PCT 10
+
+/* How much of the drop across the tuned resistance VSYS starts out with */
+#define SEED_PCT 90
+
+#define OCPC_SYSJUMP_TAG 0x4f43 /* "OC" */
+#define OCPC_HOOK_VERSION 1
+
 /* Console output macros */
 #define CPUTS(outstr) cputs(CC_CHARGER, outstr)
 #define CPRINTS(format, args...) cprints(CC_CHARGER, format, ## args)
@@ -59,6 +93,11 @@ static int k_d = KD;
 static int k_p_div = KP_DIV;
 static int k_i_div = KI_DIV;
 static int k_d_div = KD_DIV;
+static int32_t k_p_q;
+static int32_t k_i_q;
+static int32_t k_d_q;
+static int autotune = IS_ENABLED(CONFIG_OCPC_PID_AUTOTUNE);
+static int tuned_mohms;
 static int debug_output;
 static int viz_output;
 
@@ -95,8 +134,56 @@ __overridable void board_ocpc_init(struct ocpc_data *ocpc)
 {
 }
 
+/* What's kept of the auto-tuning across a sysjump */
+struct ocpc_tuning {
+	int32_t combined_mohms;
+	int32_t kp, kp_div;
+	int32_t ki, ki_div;
+	int32_t kd, kd_div;
+};
+
 static enum ec_error_list ocpc_precharge_enable(bool enable);
 
+static int32_t gain_to_q(int num, int div)
+{
+	if (div <= 0)
+		return 0;
+	return ((int64_t)num << GAIN_SHIFT) / div;
+}
+
+static void update_gains(void)
+{
+	k_p_q = gain_to_q(k_p, k_p_div);
+	k_i_q = gain_to_q(k_i, k_i_div);
+	k_d_q = gain_to_q(k_d, k_d_div);
+}
+
+/*
+ * Derive the gains from the mean combined resistance, once the measurements
+ * have settled down, or if they've moved on since the last time.
+ */
+static void ocpc_autotune(void)
+{
+	int r = mean_resistance[COMBINED_IDX];
+
+	if (!autotune || r <= 0 ||
+	    stddev_resistance[COMBINED_IDX] * 100 > r * AUTOTUNE_TOLERANCE_PCT)
+		return;
+
+	if (ABS(r - tuned_mohms) * 100 <= r * AUTOTUNE_TOLERANCE_PCT)
+		return;
+
+	tuned_mohms = r;
+	k_p = r;
+	k_p_div = AUTOTUNE_KP_DIV;
+	k_i = r;
+	k_i_div = AUTOTUNE_KI_DIV;
+	k_d = 0;
+	k_d_div = 1;
+	update_gains();
+	CPRINTS("OCPC: PID tuned for %dmOhm", r);
+}
+
 static void calc_resistance_stats(struct ocpc_data *ocpc)
 {
 	int i;
@@ -240,6 +327,7 @@ enum ec_error_list ocpc_calc_resistances(struct ocpc_data *ocpc,
 		}
 
 		CPRINTS_DBG("Rsys+Rbatt: %dmOhm", ocpc->combined_rsys_rbatt_mo);
+		ocpc_autotune();
 	} else {
 		seeded = ++initial_samples >= (2 * NUM_RESISTANCE_SAMPLES) ?
 			true : false;
@@ -263,6 +351,10 @@ int ocpc_config_secondary_charger(int *desired_input_current,
 	int min_vsys_target;
 	int error = 0;
 	int derivative = 0;
+	int integral = ocpc->integral;
+	int64_t drive_q;
+	bool limited = false;
+	int unclamped;
 	static enum phase ph;
 	static int prev_limited;
 	int chgnum;
@@ -466,15 +558,14 @@ int ocpc_config_secondary_charger(int *desired_input_current,
 
 		derivative = error - ocpc->last_error;
 		ocpc->last_error = error;
-		ocpc->integral += error;
-		if (ocpc->integral > 500)
-			ocpc->integral = 500;
+		integral = CLAMP(ocpc->integral + error, -INTEGRAL_MAX,
+				 INTEGRAL_MAX);
 	}
 
 	CPRINTS_DBG("phase = %d", ph);
 	CPRINTS_DBG("error = %dmA", error);
 	CPRINTS_DBG("derivative = %d", derivative);
-	CPRINTS_DBG("integral = %d", ocpc->integral);
+	CPRINTS_DBG("integral = %d", integral);
 	CPRINTS_DBG("batt.voltage = %dmV", batt.voltage);
 	CPRINTS_DBG("batt.desired_voltage = %dmV", batt.desired_voltage);
 	CPRINTS_DBG("batt.desired_current = %dmA", batt.desired_current);
@@ -487,16 +578,22 @@ int ocpc_config_secondary_charger(int *desired_input_current,
 	/* Obtain the drive from our PID controller. */
 	if ((ocpc->last_vsys != OCPC_UNINIT) &&
 	    (ph > PHASE_PRECHARGE)) {
-		drive = (k_p * error / k_p_div) +
-			(k_i * ocpc->integral / k_i_div) +
-			(k_d * derivative / k_d_div);
+		drive_q = (int64_t)k_p_q * error +
+			  (int64_t)k_i_q * integral +
+			  (int64_t)k_d_q * derivative +
+			  ocpc->drive_frac;
+		drive = drive_q >> GAIN_SHIFT;
+		ocpc->drive_frac = drive_q - ((int64_t)drive << GAIN_SHIFT);
 		/*
 		 * Let's limit upward transitions to 10mV.  It's okay to reduce
 		 * VSYS rather quickly, but we'll be conservative on
 		 * increasing VSYS.
 		 */
-		if (drive > 10)
+		if (drive > 10) {
 			drive = 10;
+			ocpc->drive_frac = 0;
+			limited = true;
+		}
 		CPRINTS_DBG("drive = %d", drive);
 	}
 
@@ -507,6 +604,16 @@ int ocpc_config_secondary_charger(int *desired_input_current,
 	if (ph == PHASE_PRECHARGE)
 		vsys_target = batt.desired_voltage;
 
+	/*
+	 * Once the resistance has been characterized, start most of the way to
+	 * the VSYS it says the target current needs, rather than ramping all
+	 * the way up to it a few mV at a time.  The loop closes the rest.
+	 */
+	if ((ocpc->last_vsys == OCPC_UNINIT) && tuned_mohms &&
+	    (ph == PHASE_CC))
+		vsys_target = batt.voltage +
+			      (i_ma * tuned_mohms * SEED_PCT / (1000 * 100));
+
 	/*
 	 * Adjust our VSYS target by applying the calculated drive.  Note that
 	 * we won't apply our drive the first time through this function such
@@ -534,9 +641,12 @@ int ocpc_config_secondary_charger(int *desired_input_current,
 	 * Ensure VSYS is no higher than the specified maximum battery voltage
 	 * plus the voltage drop across the system.
 	 */
+	unclamped = vsys_target;
 	vsys_target = CLAMP(vsys_target, min_vsys_target,
 			    batt_info->voltage_max +
 			    (i_ma * ocpc->combined_rsys_rbatt_mo / 1000));
+	if (vsys_target != unclamped)
+		limited = true;
 
 	/* If we're input current limited, we cannot increase VSYS any more. */
 	CPRINTS_DBG("OCPC: Inst. Input Current: %dmA (Limit: %dmA)",
@@ -562,6 +672,14 @@ int ocpc_config_secondary_charger(int *desired_input_current,
 	}
 	prev_limited = 0;
 
+	/*
+	 * Only integrate the error while VSYS is free to move to correct it.
+	 * Otherwise, time spent limited winds up the loop, and it overshoots
+	 * once it's let go.
+	 */
+	if (!limited)
+		ocpc->integral = integral;
+
 set_vsys:
 	/* VSYS should never be below the battery's min voltage. */
 	vsys_target = MAX(vsys_target, batt_info->voltage_min);
@@ -659,6 +777,7 @@ void ocpc_reset(struct ocpc_data *ocpc)
 	battery_get_params(&batt);
 	ocpc->integral = 0;
 	ocpc->last_error = 0;
+	ocpc->drive_frac = 0;
 	ocpc->last_vsys = OCPC_UNINIT;
 
 	/*
@@ -674,10 +793,46 @@ void ocpc_reset(struct ocpc_data *ocpc)
 
 static void ocpc_set_pid_constants(void)
 {
+	const struct ocpc_tuning *prev;
+	int version, size;
+
 	ocpc_get_pid_constants(&k_p, &k_p_div, &k_i, &k_i_div, &k_d, &k_d_div);
+
+	/* Pick up where the last image left off tuning, if it did. */
+	prev = (const struct ocpc_tuning *)
+		system_get_jump_tag(OCPC_SYSJUMP_TAG, &version, &size);
+	if (autotune && prev && version == OCPC_HOOK_VERSION &&
+	    size == sizeof(*prev) && prev->combined_mohms > 0) {
+		tuned_mohms = prev->combined_mohms;
+		k_p = prev->kp;
+		k_p_div = prev->kp_div;
+		k_i = prev->ki;
+		k_i_div = prev->ki_div;
+		k_d = prev->kd;
+		k_d_div = prev->kd_div;
+	}
+
+	update_gains();
 }
 DECLARE_HOOK(HOOK_INIT, ocpc_set_pid_constants, HOOK_PRIO_DEFAULT);
 
+static void ocpc_preserve_tuning(void)
+{
+	struct ocpc_tuning tuning = {
+		.combined_mohms = tuned_mohms,
+		.kp = k_p, .kp_div = k_p_div,
+		.ki = k_i, .ki_div = k_i_div,
+		.kd = k_d, .kd_div = k_d_div,
+	};
+
+	if (!tuned_mohms)
+		return;
+
+	system_add_jump_tag(OCPC_SYSJUMP_TAG, OCPC_HOOK_VERSION,
+			    sizeof(tuning), &tuning);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, ocpc_preserve_tuning, HOOK_PRIO_DEFAULT);
+
 void ocpc_init(struct ocpc_data *ocpc)
 {
 	/*
@@ -688,6 +843,10 @@ void ocpc_init(struct ocpc_data *ocpc)
 	ocpc->combined_rsys_rbatt_mo = CONFIG_OCPC_DEF_RBATT_MOHMS;
 	ocpc->rbatt_mo = CONFIG_OCPC_DEF_RBATT_MOHMS;
 
+	/* Though if it's been tuned before, we already know better. */
+	if (tuned_mohms)
+		ocpc->combined_rsys_rbatt_mo = tuned_mohms;
+
 	board_ocpc_init(ocpc);
 }
 
@@ -725,7 +884,14 @@ static int command_ocpcpid(int argc, char **argv)
 {
 	int *num, *denom;
 
-	if (argc == 4) {
+	if (argc == 2) {
+		if (strcasecmp(argv[1], "auto"))
+			return EC_ERROR_PARAM1;
+
+		/* Retune at the next resistance measurement */
+		autotune = 1;
+		tuned_mohms = 0;
+	} else if (argc == 4) {
 		switch (argv[1][0]) {
 		case 'p':
 			num = &k_p;
@@ -747,14 +913,28 @@ static int command_ocpcpid(int argc, char **argv)
 
 		*num = atoi(argv[2]);
 		*denom = atoi(argv[3]);
+		if (*denom <= 0)
+			return EC_ERROR_PARAM3;
+
+		/* Hand-picked constants stay put. */
+		autotune = 0;
+		tuned_mohms = 0;
+		update_gains();
+	} else if (argc != 1) {
+		return EC_ERROR_PARAM_COUNT;
 	}
 
 	/* Print the current constants */
 	ccprintf("Kp = %d / %d\n", k_p, k_p_div);
 	ccprintf("Ki = %d / %d\n", k_i, k_i_div);
 	ccprintf("Kd = %d / %d\n", k_d, k_d_div);
+	if (autotune && tuned_mohms)
+		ccprintf("Tuned for %dmOhm\n", tuned_mohms);
+	else if (autotune)
+		ccprintf("Tuning once the resistance is known\n");
 	return EC_SUCCESS;
 }
 DECLARE_SAFE_CONSOLE_COMMAND(ocpcpid, command_ocpcpid,
-			     "[<k/p/d> <numerator> <denominator>]",
-			     "Show/Set PID constants for OCPC PID loop");
+			     "[auto | <k/p/d> <numerator> <denominator>]",
+			     "Show/Set PID constants for OCPC PID loop, or "
+			     "tune them from the measured resistance");
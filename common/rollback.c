@@ -164,6 +164,14 @@ failed:
 	return ret;
 }
 
+/* Number of successful rollback block updates since boot. */
+static uint32_t rollback_update_count;
+
+test_mockable uint32_t rollback_get_update_count(void)
+{
+	return rollback_update_count;
+}
+
 #ifdef CONFIG_ROLLBACK_SECRET_SIZE
 test_mockable int rollback_get_secret(uint8_t *secret)
 {
@@ -333,6 +341,8 @@ static int rollback_update(int32_t next_min_version,
 
 	ret = flash_write(offset, sizeof(block), block);
 	lock_rollback();
+	if (ret == EC_SUCCESS)
+		rollback_update_count++;
 
 out:
 	clear_rollback(data);
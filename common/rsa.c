@@ -227,18 +227,21 @@ static int check_padding(const uint8_t *sig)
 }
 
 /*
- * Verify a SHA256WithRSA PKCS#1 v1.5 signature against an expected
- * SHA256 hash.
+ * Recover the SHA256 hash signed by a SHA256WithRSA PKCS#1 v1.5 signature.
+ *
+ * Nothing here depends on the signed content, so callers can do this before
+ * hashing it, and reject a bad signature without reading the content at all.
  *
  * @param key           RSA public key
  * @param signature     RSA signature
- * @param sha           SHA-256 digest of the content to verify
+ * @param sha           Output for the SHA-256 digest the signature is over
  * @param workbuf32     Work buffer; caller must verify this is
  *                      3 x RSANUMWORDS elements long.
  * @return 0 on failure, 1 on success.
  */
-int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
-	       const uint8_t *sha, uint32_t *workbuf32)
+int rsa_recover_digest(const struct rsa_public_key *key,
+		       const uint8_t *signature, uint8_t *sha,
+		       uint32_t *workbuf32)
 {
 	uint8_t buf[RSANUMBYTES];
 
@@ -251,8 +254,32 @@ int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
 	if (check_padding(buf) != 0)
 		return 0;
 
+	memcpy(sha, buf + PKCS_PAD_SIZE, SHA256_DIGEST_SIZE);
+
+	return 1;
+}
+
+/*
+ * Verify a SHA256WithRSA PKCS#1 v1.5 signature against an expected
+ * SHA256 hash.
+ *
+ * @param key           RSA public key
+ * @param signature     RSA signature
+ * @param sha           SHA-256 digest of the content to verify
+ * @param workbuf32     Work buffer; caller must verify this is
+ *                      3 x RSANUMWORDS elements long.
+ * @return 0 on failure, 1 on success.
+ */
+int rsa_verify(const struct rsa_public_key *key, const uint8_t *signature,
+	       const uint8_t *sha, uint32_t *workbuf32)
+{
+	uint8_t digest[SHA256_DIGEST_SIZE];
+
+	if (!rsa_recover_digest(key, signature, digest, workbuf32))
+		return 0;
+
 	/* Check the digest. */
-	if (memcmp(buf + PKCS_PAD_SIZE, sha, SHA256_DIGEST_SIZE) != 0)
+	if (memcmp(digest, sha, SHA256_DIGEST_SIZE) != 0)
 		return 0;
 
 	return 1;  /* All checked out OK. */
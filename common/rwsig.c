@@ -19,6 +19,7 @@
 #include "shared_mem.h"
 #include "system.h"
 #include "task.h"
+#include "timer.h"
 #include "usb_pd.h"
 #include "util.h"
 #include "vb21_struct.h"
@@ -36,6 +37,12 @@
 static uint32_t * const rw_rst =
 	(uint32_t *)(CONFIG_PROGRAM_MEMORY_BASE + CONFIG_RW_MEM_OFF + 4);
 
+static struct rwsig_timing rwsig_timing;
+
+const struct rwsig_timing *rwsig_get_timing(void)
+{
+	return &rwsig_timing;
+}
 
 void rwsig_jump_now(void)
 {
@@ -97,11 +104,14 @@ int rwsig_check_signature(void)
 	int res;
 	const struct rsa_public_key *key;
 	const uint8_t *sig;
+	uint8_t digest[SHA256_DIGEST_SIZE];
 	uint8_t *hash;
 	uint32_t *rsa_workbuf = NULL;
 	const uint8_t *rwdata = (uint8_t *)CONFIG_PROGRAM_MEMORY_BASE
 					+ CONFIG_RW_MEM_OFF;
 	int good = 0;
+	timestamp_t start = get_time();
+	timestamp_t phase;
 
 	unsigned int rwlen;
 #ifdef CONFIG_RWSIG_TYPE_RWSIG
@@ -113,6 +123,13 @@ int rwsig_check_signature(void)
 	int32_t min_rollback_version;
 #endif
 
+	memset(&rwsig_timing, 0, sizeof(rwsig_timing));
+
+	/* RW is read straight from mapped storage; land host writes first */
+	if (flash_queue_sync(CONFIG_EC_WRITABLE_STORAGE_OFF +
+			     CONFIG_RW_STORAGE_OFF, CONFIG_RW_SIZE))
+		goto out;
+
 	/* Check if we have a RW firmware flashed */
 	if (*rw_rst == 0xffffffff)
 		goto out;
@@ -175,22 +192,42 @@ int rwsig_check_signature(void)
 	rwlen = vb21_sig->data_size;
 #endif
 
+	/*
+	 * The exponentiation and PKCS#1 padding check only need the
+	 * signature, so do them before reading RW: a bad signature is
+	 * rejected without hashing the image, and all that is left once the
+	 * hash is done is comparing it with the recovered digest.
+	 */
+	phase = get_time();
+	good = rsa_recover_digest(key, sig, digest, rsa_workbuf);
+	rwsig_timing.rsa_us = time_since32(phase);
+	if (!good)
+		goto out;
+
 	/*
 	 * Check that unverified RW region is actually filled with ones.
 	 */
+	phase = get_time();
 	good = check_padding(rwdata, rwlen,
 			CONFIG_RW_SIZE - CONFIG_RW_SIG_SIZE);
+	rwsig_timing.padding_us = time_since32(phase);
 	if (!good) {
 		CPRINTS("Invalid padding.");
 		goto out;
 	}
 
-	/* SHA-256 Hash of the RW firmware */
+	/*
+	 * SHA-256 Hash of the RW firmware, read straight from mapped
+	 * storage.
+	 */
+	phase = get_time();
 	SHA256_init(&ctx);
 	SHA256_update(&ctx, rwdata, rwlen);
 	hash = SHA256_final(&ctx);
+	rwsig_timing.hash_us = time_since32(phase);
+	rwsig_timing.hash_bytes = rwlen;
 
-	good = rsa_verify(key, sig, hash, rsa_workbuf);
+	good = !memcmp(digest, hash, SHA256_DIGEST_SIZE);
 	if (!good)
 		goto out;
 
@@ -227,7 +264,12 @@ int rwsig_check_signature(void)
 	}
 #endif
 out:
+	rwsig_timing.total_us = time_since32(start);
 	CPRINTS("RW verify %s", good ? "OK" : "FAILED");
+	if (IS_ENABLED(CONFIG_RWSIG_PRINT_TIMING))
+		CPRINTS("RW verify took %d us (rsa %d us, hash %d us)",
+			rwsig_timing.total_us, rwsig_timing.rsa_us,
+			rwsig_timing.hash_us);
 
 	if (!good) {
 		pd_log_event(PD_EVENT_ACC_RW_FAIL, 0, 0, NULL);
@@ -241,6 +283,21 @@ out:
 	return good;
 }
 
+#ifdef CONFIG_CMD_RWSIG_TIMING
+static int command_rwsig_timing(int argc, char **argv)
+{
+	const struct rwsig_timing *t = &rwsig_timing;
+
+	ccprintf("total   %u us\n", t->total_us);
+	ccprintf("rsa     %u us\n", t->rsa_us);
+	ccprintf("padding %u us\n", t->padding_us);
+	ccprintf("hash    %u us (%u bytes)\n", t->hash_us, t->hash_bytes);
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(rwsigtiming, command_rwsig_timing, NULL,
+			     "Show how long the last RW signature check took");
+#endif
+
 #ifdef HAS_TASK_RWSIG
 #define TASK_EVENT_ABORT TASK_EVENT_CUSTOM_BIT(0)
 #define TASK_EVENT_CONTINUE TASK_EVENT_CUSTOM_BIT(1)
@@ -29,9 +29,14 @@
 /* This driver only supports v1.* SFDP. */
 #define SPI_NOR_SUPPORTED_SFDP_MAJOR_VERSION 1
 
+/* JEDEC Fast Read (1-1-1) is followed by 8 wait state clocks. */
+#define SPI_NOR_FAST_READ_DUMMY_BYTES 1
+
 /* Ensure a Serial NOR Flash read command in 4B addressing mode fits. */
 BUILD_ASSERT(CONFIG_SPI_NOR_MAX_READ_SIZE + 5 <=
 	     CONFIG_SPI_NOR_MAX_MESSAGE_SIZE);
+BUILD_ASSERT(5 + SPI_NOR_FAST_READ_DUMMY_BYTES <=
+	     CONFIG_SPI_NOR_MAX_MESSAGE_SIZE);
 /* The maximum write size must be a power of two so it can be used as an
  * emulated maximum page size. */
 BUILD_ASSERT(POWER_OF_TWO(CONFIG_SPI_NOR_MAX_WRITE_SIZE));
@@ -52,6 +57,29 @@ static uint8_t buf[CONFIG_SPI_NOR_MAX_MESSAGE_SIZE];
 /******************************************************************************/
 /* Internal driver functions. */
 
+/**
+ * Stage an opcode followed by an address in the device's current addressing
+ * mode in the shared buffer. Returns the number of Bytes staged.
+ */
+static size_t spi_nor_stage_command(
+		const struct spi_nor_device_t *spi_nor_device,
+		uint8_t opcode, uint32_t offset)
+{
+	buf[0] = opcode;
+	if (spi_nor_device->in_4b_addressing_mode) {
+		buf[1] = (offset & 0xFF000000) >> 24;
+		buf[2] = (offset & 0xFF0000) >> 16;
+		buf[3] = (offset & 0xFF00) >> 8;
+		buf[4] = (offset & 0xFF);
+		return 5;
+	}
+	/* in 3 byte addressing mode */
+	buf[1] = (offset & 0xFF0000) >> 16;
+	buf[2] = (offset & 0xFF00) >> 8;
+	buf[3] = (offset & 0xFF);
+	return 4;
+}
+
 /**
  * Blocking read of the Serial Flash's first status register.
  */
@@ -451,6 +479,11 @@ static int spi_nor_read_internal(const struct spi_nor_device_t *spi_nor_device,
 				 uint32_t offset, size_t size, uint8_t *data)
 {
 	int rv;
+	uint8_t opcode = spi_nor_device->read_opcode;
+
+	/* Zero is the slow read, which needs no wait state clocks. */
+	if (!opcode)
+		opcode = SPI_NOR_OPCODE_SLOW_READ;
 
 	/* Split up the read operation into multiple transactions if the size
 	 * is larger than the maximum read size.
@@ -461,19 +494,11 @@ static int spi_nor_read_internal(const struct spi_nor_device_t *spi_nor_device,
 		size_t read_command_size;
 
 		/* Set up the read command in the TX buffer. */
-		buf[0] = SPI_NOR_OPCODE_SLOW_READ;
-		if (spi_nor_device->in_4b_addressing_mode) {
-			buf[1] = (offset & 0xFF000000) >> 24;
-			buf[2] = (offset & 0xFF0000) >> 16;
-			buf[3] = (offset & 0xFF00) >> 8;
-			buf[4] = (offset & 0xFF);
-			read_command_size = 5;
-		} else {  /* in 3 byte addressing mode */
-			buf[1] = (offset & 0xFF0000) >> 16;
-			buf[2] = (offset & 0xFF00) >> 8;
-			buf[3] = (offset & 0xFF);
-			read_command_size = 4;
-		}
+		read_command_size = spi_nor_stage_command(spi_nor_device,
+							  opcode, offset);
+		memset(buf + read_command_size, 0,
+		       spi_nor_device->read_dummy_bytes);
+		read_command_size += spi_nor_device->read_dummy_bytes;
 
 		rv = spi_transaction(&spi_devices[spi_nor_device->spi_master],
 				     buf, read_command_size, data, read_size);
@@ -496,7 +521,8 @@ static int spi_nor_read_internal(const struct spi_nor_device_t *spi_nor_device,
  * will check if the part has a compatible SFDP Basic Flash Parameter table
  * and update the part's page_size, capacity, and forces the addressing mode.
  * Parts with more than 16MiB of capacity are initialized into 4B addressing
- * and parts with less are initialized into 3B addressing mode.
+ * and parts with less are initialized into 3B addressing mode. With
+ * CONFIG_SPI_NOR_FAST_READ, parts are read through the Fast Read opcode.
  *
  * WARNING: This must successfully return before invoking any other Serial NOR
  * Flash APIs.
@@ -515,6 +541,16 @@ int spi_nor_init(void)
 		struct spi_nor_device_t *spi_nor_device =
 			&spi_nor_devices[i];
 
+		/* SFDP only describes the multi I/O fast reads, so whether the
+		 * part takes the single I/O Fast Read is up to the board. */
+		if (IS_ENABLED(CONFIG_SPI_NOR_FAST_READ)) {
+			mutex_lock(&driver_mutex);
+			spi_nor_device->read_opcode = SPI_NOR_OPCODE_FAST_READ;
+			spi_nor_device->read_dummy_bytes =
+				SPI_NOR_FAST_READ_DUMMY_BYTES;
+			mutex_unlock(&driver_mutex);
+		}
+
 		rv |= locate_sfdp_basic_parameter_table(spi_nor_device,
 							&sfdp_major_rev,
 							&sfdp_minor_rev,
@@ -759,19 +795,9 @@ int spi_nor_erase(const struct spi_nor_device_t *spi_nor_device,
 			goto err_free;
 
 		/* Set up the erase instruction. */
-		buf[0] = erase_opcode;
-		if (spi_nor_device->in_4b_addressing_mode) {
-			buf[1] = (offset & 0xFF000000) >> 24;
-			buf[2] = (offset & 0xFF0000) >> 16;
-			buf[3] = (offset & 0xFF00) >> 8;
-			buf[4] = (offset & 0xFF);
-			erase_command_size = 5;
-		} else {  /* in 3 byte addressing mode */
-			buf[1] = (offset & 0xFF0000) >> 16;
-			buf[2] = (offset & 0xFF00) >> 8;
-			buf[3] = (offset & 0xFF);
-			erase_command_size = 4;
-		}
+		erase_command_size = spi_nor_stage_command(spi_nor_device,
+							   erase_opcode,
+							   offset);
 
 		rv = spi_transaction(
 			&spi_devices[spi_nor_device->spi_master],
@@ -835,19 +861,8 @@ int spi_nor_write(const struct spi_nor_device_t *spi_nor_device,
 			goto err_free;
 
 		/* Set up the page program command. */
-		buf[0] = SPI_NOR_OPCODE_PAGE_PROGRAM;
-		if (spi_nor_device->in_4b_addressing_mode) {
-			buf[1] = (offset & 0xFF000000) >> 24;
-			buf[2] = (offset & 0xFF0000) >> 16;
-			buf[3] = (offset & 0xFF00) >> 8;
-			buf[4] = (offset & 0xFF);
-			prefix_size = 5;
-		} else {  /* in 3 byte addressing mode */
-			buf[1] = (offset & 0xFF0000) >> 16;
-			buf[2] = (offset & 0xFF00) >> 8;
-			buf[3] = (offset & 0xFF);
-			prefix_size = 4;
-		}
+		prefix_size = spi_nor_stage_command(spi_nor_device,
+				SPI_NOR_OPCODE_PAGE_PROGRAM, offset);
 		/* Copy data to write into the buffer after the prefix. */
 		memmove(buf + prefix_size, data, write_size);
 
@@ -912,8 +927,12 @@ static int command_spi_nor_info(int argc, char **argv)
 			 spi_nor_device->capacity >> 10),
 		ccprintf("\tAddressing: %s addressing mode\n",
 			 spi_nor_device->in_4b_addressing_mode ? "4B" : "3B");
-		ccprintf("\tPage Size: %d Bytes\n",
+		ccprintf("\tPage Size: %zu Bytes\n",
 			 spi_nor_device->page_size);
+		ccprintf("\tRead: opcode 0x%02x w/ %d dummy Bytes\n",
+			 spi_nor_device->read_opcode ?
+			 spi_nor_device->read_opcode : SPI_NOR_OPCODE_SLOW_READ,
+			 spi_nor_device->read_dummy_bytes);
 
 		/* Get JEDEC ID info. */
 		rv = spi_nor_read_jedec_mfn_id(spi_nor_device, &mfn_bank,
@@ -932,7 +951,7 @@ static int command_spi_nor_info(int argc, char **argv)
 			continue;  /* Go on to the next device. */
 		}
 		ccprintf("\tSFDP v%d.%d\n", sfdp_major_rev, sfdp_minor_rev);
-		ccprintf("\tFlash Parameter Table v%d.%d (%dB @ 0x%x)\n",
+		ccprintf("\tFlash Parameter Table v%d.%d (%zuB @ 0x%x)\n",
 			 table_major_rev, table_minor_rev,
 			 table_size, table_offset);
 	}
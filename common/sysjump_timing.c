@@ -0,0 +1,231 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Timing of jumps between images */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "sysjump_timing.h"
+#include "system.h"
+#include "timer.h"
+#include "util.h"
+
+/* HOOK_SYSJUMP routines timed; as many as fit in a jump tag */
+#define SYSJUMP_HOOKS 16
+#define INIT_HOOKS CONFIG_SYSJUMP_TIMING_INIT_HOOKS
+BUILD_ASSERT(INIT_HOOKS <= UINT8_MAX);
+
+#define SYSJUMP_TIMING_VERSION 1
+
+/* What the image jumping timed, handed to the one it jumps to */
+struct sysjump_timing {
+	uint32_t jump_start;	/* When it started getting ready to jump */
+	uint32_t hooks_start;	/* When it started running HOOK_SYSJUMP */
+	uint32_t hooks_end;	/* And when it finished */
+	uint8_t hooks_run;
+	uint8_t reserved[3];
+	struct ec_sysjump_timing_hook hook[SYSJUMP_HOOKS];
+};
+BUILD_ASSERT(sizeof(struct sysjump_timing) <= UINT8_MAX);
+
+/* The previous image's part of the jump to this one, or this one's jump */
+static struct sysjump_timing jump;
+static int have_prev;
+
+/* This image's part, if it was jumped to */
+static uint32_t boot_start;	/* When the clock started again */
+static int have_boot_start;
+static uint32_t init_start;
+static uint32_t init_end;
+static uint8_t init_run;
+static struct ec_sysjump_timing_hook init_hook[INIT_HOOKS];
+
+void sysjump_timing_start(void)
+{
+	memset(&jump, 0, sizeof(jump));
+	have_prev = 0;
+	jump.jump_start = get_time().le.lo;
+}
+
+void sysjump_timing_hooks_start(void)
+{
+	jump.hooks_start = get_time().le.lo;
+}
+
+void sysjump_timing_preserve(void)
+{
+	jump.hooks_end = get_time().le.lo;
+	system_add_jump_slot(JUMP_TAG_SYSJUMP_TIMING, SYSJUMP_TIMING_VERSION,
+			     sizeof(jump), &jump);
+}
+
+/*
+ * Pick up what the image which jumped here timed, before the first HOOK_INIT
+ * routine.  The clock starts again from when it was saved, part way through
+ * the previous image's HOOK_SYSJUMP routines, so booting is timed from there.
+ */
+static void sysjump_timing_restore(void)
+{
+	const struct sysjump_timing *prev;
+	const timestamp_t *clock;
+
+	prev = system_get_jump_slot(JUMP_TAG_SYSJUMP_TIMING,
+				    SYSJUMP_TIMING_VERSION, sizeof(*prev));
+	if (prev) {
+		jump = *prev;
+		have_prev = 1;
+	}
+
+	clock = system_get_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+				     sizeof(*clock));
+	if (clock) {
+		boot_start = clock->le.lo;
+		have_boot_start = 1;
+	}
+}
+
+static void record_hook(struct ec_sysjump_timing_hook *hook, int max,
+			uint8_t *run, void (*routine)(void), uint32_t us)
+{
+	if (*run < max) {
+		hook[*run].routine = (uint32_t)(uintptr_t)routine;
+		hook[*run].duration_us = us;
+	}
+	if (*run < UINT8_MAX)
+		(*run)++;
+}
+
+void sysjump_timing_hook(enum hook_type type, void (*routine)(void),
+			 timestamp_t start)
+{
+	uint32_t now = get_time().le.lo;
+
+	switch (type) {
+	case HOOK_SYSJUMP:
+		record_hook(jump.hook, SYSJUMP_HOOKS, &jump.hooks_run,
+			    routine, now - start.le.lo);
+		break;
+	case HOOK_INIT:
+		if (!system_jumped_to_this_image())
+			break;
+		if (!init_run) {
+			sysjump_timing_restore();
+			init_start = start.le.lo;
+		}
+		record_hook(init_hook, INIT_HOOKS, &init_run, routine,
+			    now - start.le.lo);
+		init_end = now;
+		break;
+	default:
+		break;
+	}
+}
+
+static void get_summary(struct ec_response_sysjump_timing *r)
+{
+	memset(r, 0, sizeof(*r));
+
+	if (have_prev) {
+		r->flags |= EC_SYSJUMP_TIMING_PREV;
+		r->prepare_us = jump.hooks_start - jump.jump_start;
+		r->sysjump_us = jump.hooks_end - jump.hooks_start;
+	}
+
+	if (system_jumped_to_this_image()) {
+		r->flags |= EC_SYSJUMP_TIMING_JUMPED;
+		if (have_boot_start && init_run)
+			r->boot_us = init_start - boot_start;
+		r->init_us = init_end - init_start;
+	}
+}
+
+/*****************************************************************************/
+/* Host commands */
+
+static enum ec_status
+hc_sysjump_timing(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_sysjump_timing *p = args->params;
+	struct ec_response_sysjump_timing *r = args->response;
+	const struct ec_sysjump_timing_hook *hook = NULL;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->hooks[0]);
+	int i;
+
+	get_summary(r);
+
+	switch (p->type) {
+	case EC_SYSJUMP_TIMING_SYSJUMP:
+		if (have_prev) {
+			hook = jump.hook;
+			r->run = jump.hooks_run;
+			r->kept = MIN(jump.hooks_run, SYSJUMP_HOOKS);
+		}
+		break;
+	case EC_SYSJUMP_TIMING_INIT:
+		hook = init_hook;
+		r->run = init_run;
+		r->kept = MIN(init_run, INIT_HOOKS);
+		break;
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+
+	for (i = 0; i < max && p->index + i < r->kept; i++)
+		r->hooks[i] = hook[p->index + i];
+
+	r->count = i;
+	args->response_size = sizeof(*r) + i * sizeof(r->hooks[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_SYSJUMP_TIMING, hc_sysjump_timing,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_sysjumptime(int argc, char **argv)
+{
+	struct ec_response_sysjump_timing r;
+	int i;
+
+	get_summary(&r);
+	if (!(r.flags & EC_SYSJUMP_TIMING_JUMPED)) {
+		ccprintf("Not jumped to\n");
+		return EC_SUCCESS;
+	}
+
+	if (r.flags & EC_SYSJUMP_TIMING_PREV) {
+		ccprintf("Prepare:      %8u us\n", r.prepare_us);
+		ccprintf("HOOK_SYSJUMP: %8u us\n", r.sysjump_us);
+		/* Routines of the image which jumped, so no symbols */
+		for (i = 0; i < MIN(jump.hooks_run, SYSJUMP_HOOKS); i++)
+			ccprintf("  0x%08x  %8u us\n", jump.hook[i].routine,
+				 jump.hook[i].duration_us);
+		if (jump.hooks_run > SYSJUMP_HOOKS)
+			ccprintf("  (%d more)\n",
+				 jump.hooks_run - SYSJUMP_HOOKS);
+	}
+
+	ccprintf("Boot:         %8u us\n", r.boot_us);
+	ccprintf("HOOK_INIT:    %8u us\n", r.init_us);
+	for (i = 0; i < MIN(init_run, INIT_HOOKS); i++) {
+		ccprintf("  %pP  %8u us\n",
+			 (void *)(uintptr_t)init_hook[i].routine,
+			 init_hook[i].duration_us);
+		cflush();
+	}
+	if (init_run > INIT_HOOKS)
+		ccprintf("  (%d more)\n", init_run - INIT_HOOKS);
+
+	ccprintf("Total:        %8u us\n",
+		 r.prepare_us + r.sysjump_us + r.boot_us + r.init_us);
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(sysjumptime, command_sysjumptime, NULL,
+			     "Print how long the jump to this image took");
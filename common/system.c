@@ -28,6 +28,7 @@
 #endif
 #include "panic.h"
 #include "sysjump.h"
+#include "sysjump_timing.h"
 #include "system.h"
 #include "task.h"
 #include "timer.h"
@@ -55,9 +56,38 @@ struct jump_tag {
 	/* Followed by data_size bytes of data */
 };
 
+/* Tag IDs of the jump tag slots.  Other images look for these, so keep them. */
+static const uint16_t jump_slot_tags[] = {
+	[JUMP_TAG_TIMER] = 0x4d54,		/* "TM" */
+	[JUMP_TAG_KEYBOARD] = 0x4b42,		/* "KB" */
+	[JUMP_TAG_LIGHTBAR] = 0x4c42,		/* "LB" */
+	[JUMP_TAG_FAN] = 0x5046,		/* "PF" */
+	[JUMP_TAG_VBOOT_HASH] = 0x5648,		/* "VH" */
+	[JUMP_TAG_USB_PORT] = 0x5550,		/* "UP" */
+	[JUMP_TAG_SYSJUMP_TIMING] = 0x534a,	/* "SJ" */
+};
+BUILD_ASSERT(ARRAY_SIZE(jump_slot_tags) == JUMP_TAG_SLOT_COUNT);
+
+/*
+ * Checksum of all the other tags.  It's added last, so it's the first tag
+ * found.  Images from before it was added don't add one, so their tags are
+ * taken as they are.
+ */
+#define JUMP_TAG_CHECKSUM 0x4353		/* "CS" */
+
+enum jump_tag_check {
+	JUMP_TAG_CHECK_NONE = 0,
+	JUMP_TAG_CHECK_GOOD,
+	JUMP_TAG_CHECK_BAD,
+};
+
 /* Jump data (at end of RAM, or preceding panic data) */
 static struct jump_data *jdata;
 
+/* Tag in each jump tag slot, if the previous image preserved one */
+static const struct jump_tag *jump_slot[JUMP_TAG_SLOT_COUNT];
+static enum jump_tag_check jump_tag_check;
+
 static uint32_t reset_flags;
 static int jumped_to_image;
 static int disable_jump;  /* Disable ALL jumps if system is locked */
@@ -345,6 +375,100 @@ const uint8_t *system_get_jump_tag(uint16_t tag, int *version, int *size)
 	return NULL;
 }
 
+int system_add_jump_slot(enum jump_tag_slot slot, int version, int size,
+			 const void *data)
+{
+	if (slot >= JUMP_TAG_SLOT_COUNT)
+		return EC_ERROR_INVAL;
+
+	return system_add_jump_tag(jump_slot_tags[slot], version, size, data);
+}
+
+const void *system_get_jump_slot(enum jump_tag_slot slot, int version,
+				 int size)
+{
+	const struct jump_tag *t;
+
+	if (slot >= JUMP_TAG_SLOT_COUNT)
+		return NULL;
+
+	t = jump_slot[slot];
+	if (!t || t->data_version != version || t->data_size != size)
+		return NULL;
+
+	return t + 1;
+}
+
+/* FNV-1a, over the tags preserved */
+static uint32_t jump_tag_checksum(const uint8_t *data, int size)
+{
+	uint32_t sum = 0x811c9dc5;
+
+	while (size--) {
+		sum ^= *data++;
+		sum *= 0x01000193;
+	}
+
+	return sum;
+}
+
+/* Seal the tags preserved by the HOOK_SYSJUMP handlers with a checksum. */
+static void jump_tags_seal(void)
+{
+	const uint8_t *tags = (const uint8_t *)system_usable_ram_end();
+	uint32_t sum = jump_tag_checksum(tags, jdata->jump_tag_total);
+
+	system_add_jump_tag(JUMP_TAG_CHECKSUM, 1, sizeof(sum), &sum);
+}
+
+/*
+ * Check the tags the previous image preserved, and find those in the jump tag
+ * slots.  If they've been corrupted, throw all of them away: modules start
+ * afresh, as they would after a reboot.
+ */
+static void jump_tags_restore(void)
+{
+	const uint8_t *base = (const uint8_t *)system_usable_ram_end();
+	const struct jump_tag *t;
+	int used, next, i;
+
+	memset(jump_slot, 0, sizeof(jump_slot));
+	jump_tag_check = JUMP_TAG_CHECK_NONE;
+
+	for (used = 0; used < jdata->jump_tag_total; used = next) {
+		t = (const struct jump_tag *)(base + used);
+		next = used + sizeof(struct jump_tag) + ROUNDUP4(t->data_size);
+		if (next > jdata->jump_tag_total) {
+			jump_tag_check = JUMP_TAG_CHECK_BAD;
+			break;
+		}
+
+		if (used == 0 && t->tag == JUMP_TAG_CHECKSUM &&
+		    t->data_size == sizeof(uint32_t)) {
+			uint32_t sum = jump_tag_checksum(base + next,
+					jdata->jump_tag_total - next);
+
+			if (sum != *(const uint32_t *)(t + 1)) {
+				jump_tag_check = JUMP_TAG_CHECK_BAD;
+				break;
+			}
+			jump_tag_check = JUMP_TAG_CHECK_GOOD;
+			continue;
+		}
+
+		/* The latest tag for a slot wins, as it would searching */
+		for (i = 0; i < JUMP_TAG_SLOT_COUNT; i++) {
+			if (t->tag == jump_slot_tags[i] && !jump_slot[i])
+				jump_slot[i] = t;
+		}
+	}
+
+	if (jump_tag_check == JUMP_TAG_CHECK_BAD) {
+		memset(jump_slot, 0, sizeof(jump_slot));
+		jdata->jump_tag_total = 0;
+	}
+}
+
 void system_disable_jump(void)
 {
 	disable_jump = 1;
@@ -502,6 +626,8 @@ static void jump_to_image(uintptr_t init_addr)
 {
 	void (*resetvec)(void);
 
+	sysjump_timing_start();
+
 	/*
 	 * Jumping to any image asserts the signal to the Silego chip that that
 	 * EC is not in read-only firmware.  (This is not technically true if
@@ -545,9 +671,13 @@ static void jump_to_image(uintptr_t init_addr)
 	jdata->reset_flags = reset_flags;
 	jdata->jump_tag_total = 0;  /* Reset tags */
 	jdata->struct_size = sizeof(struct jump_data);
+	memset(jump_slot, 0, sizeof(jump_slot));
 
 	/* Call other hooks; these may add tags */
+	sysjump_timing_hooks_start();
 	hook_notify(HOOK_SYSJUMP);
+	sysjump_timing_preserve();
+	jump_tags_seal();
 
 	/* Disable interrupts before jump */
 	interrupt_disable();
@@ -860,6 +990,8 @@ void system_common_pre_init(void)
 		/* Struct size is now the current struct size */
 		jdata->struct_size = sizeof(struct jump_data);
 
+		jump_tags_restore();
+
 		/*
 		 * Clear the jump struct's magic number.  This prevents
 		 * accidentally detecting a jump when there wasn't one, and
@@ -882,6 +1014,11 @@ int system_is_manual_recovery(void)
  */
 static int handle_pending_reboot(enum ec_reboot_cmd cmd)
 {
+	/* Host writes held in RAM would be lost; don't go until they land */
+	if (cmd != EC_REBOOT_CANCEL && cmd != EC_REBOOT_DISABLE_JUMP &&
+	    flash_queue_sync(0, CONFIG_FLASH_SIZE_BYTES))
+		return EC_ERROR_UNKNOWN;
+
 	switch (cmd) {
 	case EC_REBOOT_CANCEL:
 		return EC_SUCCESS;
@@ -1308,6 +1445,8 @@ static int command_reboot(int argc, char **argv)
 		ccputs("Rebooting!\n\n\n");
 	cflush();
 
+	/* Keep host writes held in RAM; nothing else can be done on error */
+	flash_queue_sync(0, CONFIG_FLASH_SIZE_BYTES);
 	system_reset(flags);
 	return EC_SUCCESS;
 }
@@ -1380,11 +1519,16 @@ static int command_jumptags(int argc, char **argv)
 		used += sizeof(struct jump_tag) + ROUNDUP4(t->data_size);
 
 		ccprintf("%08x: 0x%04x %c%c.%d %3d\n",
-			 (uintptr_t)t,
+			 (uint32_t)(uintptr_t)t,
 			 t->tag, t->tag >> 8, (uint8_t)t->tag,
 			 t->data_version, t->data_size);
 	}
 
+	if (jump_tag_check == JUMP_TAG_CHECK_GOOD)
+		ccprintf("Checksum good\n");
+	else if (jump_tag_check == JUMP_TAG_CHECK_BAD)
+		ccprintf("Checksum bad; tags discarded\n");
+
 	return EC_SUCCESS;
 }
 DECLARE_CONSOLE_COMMAND(jumptags, command_jumptags,
@@ -1592,6 +1736,10 @@ enum ec_status host_command_reboot(struct host_cmd_handler_args *args)
 	    p.cmd == EC_REBOOT_COLD ||
 	    p.cmd == EC_REBOOT_HIBERNATE ||
 	    p.cmd == EC_REBOOT_COLD_AP_OFF) {
+		/* Report a failed write of held host data before going */
+		if (flash_queue_sync(0, CONFIG_FLASH_SIZE_BYTES))
+			return EC_RES_ERROR;
+
 		/* Clean busy bits on host for commands that won't return */
 		args->result = EC_RES_SUCCESS;
 		host_send_response(args);
@@ -1701,6 +1849,8 @@ void clock_enable_module(enum module_id module, int enable)
 __test_only void system_common_reset_state(void)
 {
 	jdata = 0;
+	memset(jump_slot, 0, sizeof(jump_slot));
+	jump_tag_check = JUMP_TAG_CHECK_NONE;
 	reset_flags = 0;
 	jumped_to_image = 0;
 }
@@ -0,0 +1,48 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Host command reporting per-task scheduling statistics */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "task.h"
+#include "util.h"
+
+BUILD_ASSERT(TASK_ID_COUNT <= UINT8_MAX);
+BUILD_ASSERT(member_size(struct ec_response_task_stats, event_wakeups) ==
+	     member_size(struct task_stats, event_wakeups));
+
+static enum ec_status
+host_command_task_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_task_stats *p = args->params;
+	struct ec_response_task_stats *r = args->response;
+	struct task_stats stats;
+
+	if (p->task_id >= TASK_ID_COUNT)
+		return EC_RES_INVALID_PARAM;
+
+	task_get_stats(p->task_id, &stats);
+	if (p->flags & EC_TASK_STATS_RESET)
+		task_reset_stats(p->task_id);
+
+	memset(r, 0, sizeof(*r));
+	r->run_time_us = stats.run_time_us;
+	r->isr_time_us = stats.isr_time_us;
+	r->wakeups = stats.wakeups;
+	r->max_latency_us = stats.max_latency_us;
+	r->stack_used = stats.stack_used;
+	r->stack_size = stats.stack_size;
+	r->task_count = TASK_ID_COUNT;
+	strzcpy(r->name, task_get_name(p->task_id), sizeof(r->name));
+	memcpy(r->event_wakeups, stats.event_wakeups,
+	       sizeof(r->event_wakeups));
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_TASK_STATS, host_command_task_stats,
+		     EC_VER_MASK(0));
@@ -17,6 +17,7 @@
 #include "system.h"
 #include "task.h"
 #include "test_util.h"
+#include "timer.h"
 #include "util.h"
 
 struct test_util_tag {
@@ -89,6 +90,14 @@ void test_fail(void)
 
 void test_print_result(void)
 {
+#ifdef EMU_BUILD
+	uint64_t skipped_us;
+	uint32_t skips;
+
+	emulator_get_time_stats(&skipped_us, &skips);
+	ccprintf("Virtual time: %.6lld s (%.6lld s skipped in %d jumps)\n",
+		 (long long)get_time().val, (long long)skipped_us, skips);
+#endif
 	if (__test_error_count)
 		ccprintf("Fail! (%d tests)\n", __test_error_count);
 	else
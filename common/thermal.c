@@ -49,106 +49,84 @@ BUILD_ASSERT(EC_TEMP_THRESH_COUNT == 3);
 /* Keep track of which thresholds have triggered */
 static cond_t cond_hot[EC_TEMP_THRESH_COUNT];
 
-static void thermal_control(void)
-{
-	int i, j, t, rv, f;
-	int count_over[EC_TEMP_THRESH_COUNT];
-	int count_under[EC_TEMP_THRESH_COUNT];
-	int num_valid_limits[EC_TEMP_THRESH_COUNT];
-	int num_sensors_read;
-	int fmax;
-	int temp_fan_configured;
-
-#ifdef CONFIG_CUSTOM_FAN_CONTROL
-	int temp[TEMP_SENSOR_COUNT];
-#endif
-
-	/* Get ready to count things */
-	memset(count_over, 0, sizeof(count_over));
-	memset(count_under, 0, sizeof(count_under));
-	memset(num_valid_limits, 0, sizeof(num_valid_limits));
-	num_sensors_read = 0;
-	fmax = 0;
-	temp_fan_configured = 0;
+/* Sensor sets are kept as bitmasks */
+BUILD_ASSERT(TEMP_SENSOR_COUNT <= 32);
+#define ALL_SENSORS ((uint32_t)((1ULL << TEMP_SENSOR_COUNT) - 1))
 
-	/* go through all the sensors */
-	for (i = 0; i < TEMP_SENSOR_COUNT; ++i) {
+/* Last reading of each sensor, and which of those readings are good */
+static int sensor_temp[TEMP_SENSOR_COUNT];
+static uint32_t sensor_valid;
 
-		/* read one */
-		rv = temp_sensor_read(i, &t);
-
-#ifdef CONFIG_CUSTOM_FAN_CONTROL
-		/* Store all sensors value */
-		temp[i] = K_TO_C(t);
-#endif
+/*
+ * Sensors which have each threshold set. thermal_params can be changed at any
+ * time, so this is rebuilt on every full pass over the sensors.
+ */
+static uint32_t limit_mask[EC_TEMP_THRESH_COUNT];
 
-		if (rv != EC_SUCCESS)
-			continue;
-		else
-			num_sensors_read++;
+static void thermal_update_limits(void)
+{
+	int i, j;
 
-		/* check all the limits */
+	memset(limit_mask, 0, sizeof(limit_mask));
+	for (i = 0; i < TEMP_SENSOR_COUNT; i++) {
 		for (j = 0; j < EC_TEMP_THRESH_COUNT; j++) {
-			int limit = thermal_params[i].temp_host[j];
-			int release = thermal_params[i].temp_host_release[j];
-			if (limit) {
-				num_valid_limits[j]++;
-				if (t > limit) {
-					count_over[j]++;
-				} else if (release) {
-					if (t < release)
-						count_under[j]++;
-				} else if (t < limit) {
-					count_under[j]++;
-				}
-			}
+			if (thermal_params[i].temp_host[j])
+				limit_mask[j] |= BIT(i);
 		}
+	}
+}
 
-		/* figure out the max fan needed, too */
-		if (thermal_params[i].temp_fan_off &&
-		    thermal_params[i].temp_fan_max) {
-			f = thermal_fan_percent(thermal_params[i].temp_fan_off,
-						thermal_params[i].temp_fan_max,
-						t);
-			if (f > fmax)
-				fmax = f;
+/* Read the sensors in mask, keeping the old value of any that fail. */
+static void thermal_sample(uint32_t mask)
+{
+	uint32_t ok = 0;
+	uint32_t m = mask;
+	int i, t;
 
-			temp_fan_configured = 1;
-		}
+	while (m) {
+		i = get_next_bit(&m);
+		if (temp_sensor_read(i, &t) != EC_SUCCESS)
+			continue;
+		sensor_temp[i] = t;
+		ok |= BIT(i);
 	}
 
-	if (!num_sensors_read) {
-		/*
-		 * Trigger a SMI event if we can't read any sensors.
-		 *
-		 * In theory we could do something more elaborate like forcing
-		 * the system to shut down if no sensors are available after
-		 * several retries.  This is a very unlikely scenario -
-		 * particularly on LM4-based boards, since the LM4 has its own
-		 * internal temp sensor.  It's most likely to occur during
-		 * bringup of a new board, where we haven't debugged the I2C
-		 * bus to the sensors; forcing a shutdown in that case would
-		 * merely hamper board bringup.
-		 *
-		 * If in G3, then there is no need trigger an SMI event since
-		 * the AP is off and this can be an expected state if
-		 * temperature sensors are powered by a power rail that's only
-		 * on if the AP is out of G3. Note this could be 'ANY_OFF' as
-		 * well, but that causes the thermal unit test to fail.
-		 */
-		if (!chipset_in_state(CHIPSET_STATE_HARD_OFF))
-			smi_sensor_failure_warning();
+	sensor_valid = (sensor_valid & ~mask) | ok;
+}
+
+static void thermal_evaluate(void)
+{
+	uint32_t m, over, under;
+	int i, j, t;
+
+	/* Nothing to go on, so leave things as they are. */
+	if (!sensor_valid)
 		return;
-	}
 
 	/* See what the aggregated limits are. Any temp over the limit
 	 * means it's hot, but all temps have to be under the limit to
 	 * be cool again.
 	 */
 	for (j = 0; j < EC_TEMP_THRESH_COUNT; j++) {
-		if (count_over[j])
+		over = 0;
+		under = 0;
+		m = limit_mask[j] & sensor_valid;
+		while (m) {
+			int limit, release;
+
+			i = get_next_bit(&m);
+			t = sensor_temp[i];
+			limit = thermal_params[i].temp_host[j];
+			release = thermal_params[i].temp_host_release[j];
+			if (t > limit)
+				over |= BIT(i);
+			else if (t < (release ? release : limit))
+				under |= BIT(i);
+		}
+
+		if (over)
 			cond_set_true(&cond_hot[j]);
-		else if (count_under[j] == num_valid_limits[j])
+		else if (under == (limit_mask[j] & sensor_valid))
 			cond_set_false(&cond_hot[j]);
 	}
 
@@ -188,6 +166,153 @@ static void thermal_control(void)
 		CPRINTS("thermal no longer warn");
 		throttle_ap(THROTTLE_OFF, THROTTLE_SOFT, THROTTLE_SRC_THERMAL);
 	}
+}
+
+#ifdef CONFIG_THERMAL_FAN_PID
+/*
+ * Controller state, in 1/256 percent of fan duty. The error is in 1/256
+ * percent of the sensor's fan range.
+ */
+static int pid_integral;
+static int pid_last_error;
+static int pid_active;
+
+/*
+ * Work out the fan duty which holds the hottest sensor (relative to its fan
+ * range) at the middle of its range. Called once a second.
+ *
+ * Each sensor's error is scaled to its own fan range, so that a sensor with a
+ * narrow range isn't outweighed by one with a wide range.
+ *
+ * Outside the range, or if a fan sensor can't be read, the linear fan curve
+ * is used instead; the loop picks up from there without a bump when it
+ * takes over again.
+ */
+static int thermal_fan_pid(int linear_pct)
+{
+	const int full = 100 * 256;
+	int i, t, e, p, d, integral, out;
+	int err = 0;
+	int have_err = 0;
+	int in_range = 0;
+	int above = 0;
+
+	for (i = 0; i < TEMP_SENSOR_COUNT; i++) {
+		int off = thermal_params[i].temp_fan_off;
+		int max = thermal_params[i].temp_fan_max;
+
+		if (!off || !max || max <= off)
+			continue;
+		if (!(sensor_valid & BIT(i))) {
+			pid_active = 0;
+			return linear_pct;
+		}
+
+		t = sensor_temp[i];
+		if (t >= max)
+			above = 1;
+		else if (t > off)
+			in_range = 1;
+
+		e = MAX(t - off, 0) * 100 * 256 / (max - off) - 50 * 256;
+		if (!have_err || e > err)
+			err = e;
+		have_err = 1;
+	}
+
+	if (above || !in_range) {
+		pid_active = 0;
+		return linear_pct;
+	}
+
+	p = CONFIG_THERMAL_FAN_PID_KP * err / 256;
+	if (!pid_active) {
+		pid_integral = linear_pct * 256 - p;
+		pid_last_error = err;
+		pid_active = 1;
+	}
+	d = CONFIG_THERMAL_FAN_PID_KD * (err - pid_last_error) / 256;
+	pid_last_error = err;
+
+	/* Don't wind up further while the output is pinned. */
+	integral = pid_integral + CONFIG_THERMAL_FAN_PID_KI * err / 256;
+	out = p + integral + d;
+	if (!(out > full && err > 0) && !(out < 0 && err < 0))
+		pid_integral = integral;
+
+	out = p + pid_integral + d;
+	if (out < 0)
+		out = 0;
+	else if (out > full)
+		out = full;
+
+	return DIV_ROUND_NEAREST(out, 256);
+}
+#endif
+
+static void thermal_control(void)
+{
+	int i, f;
+	int fmax;
+	int temp_fan_configured;
+
+#ifdef CONFIG_CUSTOM_FAN_CONTROL
+	int temp[TEMP_SENSOR_COUNT];
+#endif
+
+	fmax = 0;
+	temp_fan_configured = 0;
+
+	thermal_update_limits();
+	thermal_sample(ALL_SENSORS);
+
+	if (!sensor_valid) {
+		/*
+		 * Trigger a SMI event if we can't read any sensors.
+		 *
+		 * In theory we could do something more elaborate like forcing
+		 * the system to shut down if no sensors are available after
+		 * several retries.  This is a very unlikely scenario -
+		 * particularly on LM4-based boards, since the LM4 has its own
+		 * internal temp sensor.  It's most likely to occur during
+		 * bringup of a new board, where we haven't debugged the I2C
+		 * bus to the sensors; forcing a shutdown in that case would
+		 * merely hamper board bringup.
+		 *
+		 * If in G3, then there is no need trigger an SMI event since
+		 * the AP is off and this can be an expected state if
+		 * temperature sensors are powered by a power rail that's only
+		 * on if the AP is out of G3. Note this could be 'ANY_OFF' as
+		 * well, but that causes the thermal unit test to fail.
+		 */
+		if (!chipset_in_state(CHIPSET_STATE_HARD_OFF))
+			smi_sensor_failure_warning();
+		return;
+	}
+
+	thermal_evaluate();
+
+	/* figure out the max fan needed */
+	for (i = 0; i < TEMP_SENSOR_COUNT; ++i) {
+#ifdef CONFIG_CUSTOM_FAN_CONTROL
+		/* Store all sensors value */
+		temp[i] = K_TO_C(sensor_temp[i]);
+#endif
+
+		if (!(sensor_valid & BIT(i)))
+			continue;
+
+		if (thermal_params[i].temp_fan_off &&
+		    thermal_params[i].temp_fan_max) {
+			f = thermal_fan_percent(thermal_params[i].temp_fan_off,
+						thermal_params[i].temp_fan_max,
+						sensor_temp[i]);
+			if (f > fmax)
+				fmax = f;
+
+			temp_fan_configured = 1;
+		}
+	}
 
 	if (temp_fan_configured) {
 #ifdef CONFIG_FANS
@@ -199,6 +324,9 @@ static void thermal_control(void)
 			board_override_fan_control(i, temp);
 		}
 #else
+#ifdef CONFIG_THERMAL_FAN_PID
+		fmax = thermal_fan_pid(fmax);
+#endif
 		/* TODO(crosbug.com/p/23797): For now, we just treat all
 		 * fans the same. It would be better if we could assign
 		 * different thermal profiles to each fan - in case one
@@ -211,10 +339,35 @@ static void thermal_control(void)
 #endif
 	}
 }
-
 /* Wait until after the sensors have been read */
 DECLARE_HOOK(HOOK_SECOND, thermal_control, HOOK_PRIO_TEMP_SENSOR_DONE);
 
+#ifdef CONFIG_THERMAL_FAST_SAMPLE_MS
+/*
+ * Between full passes, keep re-reading the sensors that can throttle or shut
+ * down the AP, so that a fast ramp is caught within a sample period rather
+ * than up to a second later. That is only as fresh as what the drivers have:
+ * those which measure on HOOK_SECOND still only change once a second.
+ */
+static void thermal_fast_control(void);
+DECLARE_DEFERRED(thermal_fast_control);
+
+static void thermal_fast_control(void)
+{
+	uint32_t mask = limit_mask[EC_TEMP_THRESH_HIGH] |
+			limit_mask[EC_TEMP_THRESH_HALT];
+
+	if (mask && !chipset_in_state(CHIPSET_STATE_HARD_OFF)) {
+		thermal_sample(mask);
+		thermal_evaluate();
+	}
+
+	hook_call_deferred(&thermal_fast_control_data,
+			   CONFIG_THERMAL_FAST_SAMPLE_MS * MSEC);
+}
+DECLARE_HOOK(HOOK_INIT, thermal_fast_control, HOOK_PRIO_DEFAULT);
+#endif
+
 /*****************************************************************************/
 /* Console commands */
 
@@ -23,8 +23,6 @@ extern __error("k_usleep() should only be called from Zephyr code")
 int32_t k_usleep(int32_t);
 #endif /* CONFIG_ZEPHYR */
 
-#define TIMER_SYSJUMP_TAG 0x4d54  /* "TM" */
-
 /* High 32-bits of the 64-bit timestamp counter. */
 STATIC_IF_NOT(CONFIG_HWTIMER_64BIT) uint32_t clksrc_high;
 
@@ -271,14 +269,13 @@ void timer_print_info(void)
 void timer_init(void)
 {
 	const timestamp_t *ts;
-	int size, version;
 
 	BUILD_ASSERT(TASK_ID_COUNT < sizeof(timer_running) * 8);
 
 	/* Restore time from before sysjump */
-	ts = (const timestamp_t *)system_get_jump_tag(TIMER_SYSJUMP_TAG,
-						      &version, &size);
-	if (ts && version == 1 && size == sizeof(timestamp_t)) {
+	ts = system_get_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+				  sizeof(timestamp_t));
+	if (ts) {
 		if (IS_ENABLED(CONFIG_HWTIMER_64BIT)) {
 			timer_irq = __hw_clock_source_init64(ts->val);
 		} else {
@@ -298,7 +295,8 @@ static void timer_sysjump(void)
 {
 	timestamp_t ts = get_time();
 
-	system_add_jump_tag(TIMER_SYSJUMP_TAG, 1, sizeof(ts), &ts);
+	system_add_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+			     sizeof(ts), &ts);
 }
 DECLARE_HOOK(HOOK_SYSJUMP, timer_sysjump, HOOK_PRIO_DEFAULT);
 
@@ -45,6 +45,8 @@ static volatile char tx_buf[CONFIG_UART_TX_BUF_SIZE]
 			__uncached __preserved_logs(tx_buf);
 static volatile int tx_buf_head __preserved_logs(tx_buf_head);
 static volatile int tx_buf_tail __preserved_logs(tx_buf_tail);
+/* Number of bytes ever written to tx_buf, modulo 2^32 */
+static volatile uint32_t tx_buf_seq __preserved_logs(tx_buf_seq);
 static volatile char rx_buf[CONFIG_UART_RX_BUF_SIZE] __uncached;
 static volatile int rx_buf_head;
 static volatile int rx_buf_tail;
@@ -69,6 +71,14 @@ void uart_init_buffer(void)
 		tx_buf_tail = 0;
 		tx_checksum = 0;
 	}
+
+	/*
+	 * The sequence number isn't covered by the checksum, so that images
+	 * which don't know about it can still preserve logs for us. Just
+	 * keep it consistent with the head.
+	 */
+	if ((tx_buf_seq & (CONFIG_UART_TX_BUF_SIZE - 1)) != tx_buf_head)
+		tx_buf_seq = tx_buf_head;
 }
 
 int uart_tx_char_raw(void *context, int c)
@@ -102,6 +112,7 @@ int uart_tx_char_raw(void *context, int c)
 
 	tx_buf[tx_buf_head] = c;
 	tx_buf_head = tx_buf_next;
+	tx_buf_seq++;
 
 	if (IS_ENABLED(CONFIG_PRESERVE_LOGS))
 		tx_checksum = uart_buffer_calc_checksum();
@@ -385,3 +396,50 @@ int uart_console_read_buffer(uint8_t type,
 
 	return EC_RES_SUCCESS;
 }
+
+/* Sequence number of the oldest byte still in tx_buf, given the newest */
+static uint32_t tx_buf_oldest_seq(uint32_t head)
+{
+	return head - MIN(head, CONFIG_UART_TX_BUF_SIZE - 1);
+}
+
+int uart_console_read_seq(uint32_t seq, char *dest, int size,
+			  uint32_t *first, uint32_t *head)
+{
+	uint32_t oldest;
+	int start, len, chunk;
+
+	*head = tx_buf_seq;
+	oldest = tx_buf_oldest_seq(*head);
+
+	/*
+	 * Bytes before the oldest one have been overwritten. A sequence
+	 * number past the head means the EC restarted since the caller last
+	 * read, so start over from the oldest byte in that case too.
+	 */
+	if ((int32_t)(seq - oldest) < 0 || (int32_t)(*head - seq) < 0)
+		seq = oldest;
+
+	len = MIN(*head - seq, size);
+	start = seq & (CONFIG_UART_TX_BUF_SIZE - 1);
+	chunk = MIN(len, CONFIG_UART_TX_BUF_SIZE - start);
+	memcpy(dest, (const char *)tx_buf + start, chunk);
+	memcpy(dest + chunk, (const char *)tx_buf, len - chunk);
+
+	/*
+	 * Nothing stops other tasks and interrupts from printing while we
+	 * copy. If they wrapped around into what we copied, drop those bytes
+	 * rather than return a mix of old and new output.
+	 */
+	oldest = tx_buf_oldest_seq(tx_buf_seq);
+	if ((int32_t)(oldest - seq) > 0) {
+		int overwritten = MIN(oldest - seq, len);
+
+		len -= overwritten;
+		memmove(dest, dest + overwritten, len);
+		seq += overwritten;
+	}
+
+	*first = seq;
+	return len;
+}
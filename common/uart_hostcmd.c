@@ -8,6 +8,7 @@
 #include "ec_commands.h"
 #include "host_command.h"
 #include "uart.h"
+#include "util.h"
 
 static enum ec_status
 host_command_console_snapshot(struct host_cmd_handler_args *args)
@@ -52,3 +53,32 @@ host_command_console_read(struct host_cmd_handler_args *args)
 
 DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ, host_command_console_read,
 		     EC_VER_MASK(0) | READ_V1_MASK);
+
+static enum ec_status
+host_command_console_read_seq(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_console_read_seq *p = args->params;
+	struct ec_response_console_read_seq *r = args->response;
+	int size;
+
+	if (args->response_max < sizeof(*r))
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	size = uart_console_read_seq(p->seq, (char *)r->data,
+				     args->response_max - sizeof(*r),
+				     &r->seq, &r->head);
+
+	r->flags = 0;
+	memset(r->reserved, 0, sizeof(r->reserved));
+	if ((int32_t)(r->head - p->seq) < 0) {
+		r->flags |= EC_CONSOLE_READ_SEQ_RESTARTED;
+		r->lost = 0;
+	} else {
+		r->lost = r->seq - p->seq;
+	}
+
+	args->response_size = sizeof(*r) + size;
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_CONSOLE_READ_SEQ, host_command_console_read_seq,
+		     EC_VER_MASK(0));
@@ -51,24 +51,24 @@ static const int debug_level;
 		^ (x &  8 ? 0x040 : 0x3C0) \
 		^ (x & 16 ? 0x100 : 0x300))
 
-/* 4b/5b + Bimark Phase encoding */
-static const uint16_t bmc4b5b[] = {
-/* 0 = 0000 */ BMC(0x1E) /* 11110 */,
-/* 1 = 0001 */ BMC(0x09) /* 01001 */,
-/* 2 = 0010 */ BMC(0x14) /* 10100 */,
-/* 3 = 0011 */ BMC(0x15) /* 10101 */,
-/* 4 = 0100 */ BMC(0x0A) /* 01010 */,
-/* 5 = 0101 */ BMC(0x0B) /* 01011 */,
-/* 6 = 0110 */ BMC(0x0E) /* 01110 */,
-/* 7 = 0111 */ BMC(0x0F) /* 01111 */,
-/* 8 = 1000 */ BMC(0x12) /* 10010 */,
-/* 9 = 1001 */ BMC(0x13) /* 10011 */,
-/* A = 1010 */ BMC(0x16) /* 10110 */,
-/* B = 1011 */ BMC(0x17) /* 10111 */,
-/* C = 1100 */ BMC(0x1A) /* 11010 */,
-/* D = 1101 */ BMC(0x1B) /* 11011 */,
-/* E = 1110 */ BMC(0x1C) /* 11100 */,
-/* F = 1111 */ BMC(0x1D) /* 11101 */,
+/* 4b/5b encoding of a quartet, usable in constant expressions */
+#define ENC4B5B(q) ( \
+	(q) == 0x0 ? 0x1E /* 11110 */ : \
+	(q) == 0x1 ? 0x09 /* 01001 */ : \
+	(q) == 0x2 ? 0x14 /* 10100 */ : \
+	(q) == 0x3 ? 0x15 /* 10101 */ : \
+	(q) == 0x4 ? 0x0A /* 01010 */ : \
+	(q) == 0x5 ? 0x0B /* 01011 */ : \
+	(q) == 0x6 ? 0x0E /* 01110 */ : \
+	(q) == 0x7 ? 0x0F /* 01111 */ : \
+	(q) == 0x8 ? 0x12 /* 10010 */ : \
+	(q) == 0x9 ? 0x13 /* 10011 */ : \
+	(q) == 0xA ? 0x16 /* 10110 */ : \
+	(q) == 0xB ? 0x17 /* 10111 */ : \
+	(q) == 0xC ? 0x1A /* 11010 */ : \
+	(q) == 0xD ? 0x1B /* 11011 */ : \
+	(q) == 0xE ? 0x1C /* 11100 */ : \
+		     0x1D /* 11101 */)
 /* Sync-1      K-code       11000 Startsynch #1 */
 /* Sync-2      K-code       10001 Startsynch #2 */
 /* RST-1       K-code       00111 Hard Reset #1 */
@@ -85,8 +85,50 @@ static const uint16_t bmc4b5b[] = {
 /* Reserved    Error        01100 */
 /* Reserved    Error        10000 */
 /* Reserved    Error        11111 */
+
+/*
+ * Two BMC symbols sent back to back by pd_write_byte(): the second one is
+ * inverted when the first one ends on a high level, so the PHY only has to
+ * track the line level once per byte.
+ */
+#define BMC_PAIR(lo, hi) ((lo) | (((hi) ^ ((lo) & 0x200 ? 0x3FF : 0)) << 10))
+
+#ifdef CONFIG_USB_PD_TCPC_BMC_BYTE_TABLE
+#define BMC_BYTE(b) BMC_PAIR(BMC(ENC4B5B((b) & 0xF)), BMC(ENC4B5B((b) >> 4)))
+#define BMC_BYTE4(b) BMC_BYTE(b), BMC_BYTE((b) + 1), \
+		     BMC_BYTE((b) + 2), BMC_BYTE((b) + 3)
+#define BMC_BYTE16(b) BMC_BYTE4(b), BMC_BYTE4((b) + 4), \
+		      BMC_BYTE4((b) + 8), BMC_BYTE4((b) + 12)
+
+/* 4b/5b + Bimark Phase encoding of a byte, low quartet first */
+static const uint32_t bmc4b5b_byte[256] = {
+	BMC_BYTE16(0x00), BMC_BYTE16(0x10), BMC_BYTE16(0x20), BMC_BYTE16(0x30),
+	BMC_BYTE16(0x40), BMC_BYTE16(0x50), BMC_BYTE16(0x60), BMC_BYTE16(0x70),
+	BMC_BYTE16(0x80), BMC_BYTE16(0x90), BMC_BYTE16(0xA0), BMC_BYTE16(0xB0),
+	BMC_BYTE16(0xC0), BMC_BYTE16(0xD0), BMC_BYTE16(0xE0), BMC_BYTE16(0xF0),
+};
+
+static inline uint32_t bmc_byte(uint8_t b)
+{
+	return bmc4b5b_byte[b];
+}
+#else
+/* 4b/5b + Bimark Phase encoding */
+static const uint16_t bmc4b5b[] = {
+	BMC(ENC4B5B(0x0)), BMC(ENC4B5B(0x1)), BMC(ENC4B5B(0x2)),
+	BMC(ENC4B5B(0x3)), BMC(ENC4B5B(0x4)), BMC(ENC4B5B(0x5)),
+	BMC(ENC4B5B(0x6)), BMC(ENC4B5B(0x7)), BMC(ENC4B5B(0x8)),
+	BMC(ENC4B5B(0x9)), BMC(ENC4B5B(0xA)), BMC(ENC4B5B(0xB)),
+	BMC(ENC4B5B(0xC)), BMC(ENC4B5B(0xD)), BMC(ENC4B5B(0xE)),
+	BMC(ENC4B5B(0xF)),
 };
 
+static inline uint32_t bmc_byte(uint8_t b)
+{
+	return BMC_PAIR(bmc4b5b[b & 0xF], bmc4b5b[b >> 4]);
+}
+#endif
+
 static const uint8_t dec4b5b[] = {
 /* Error    */ 0x10 /* 00000 */,
 /* Error    */ 0x10 /* 00001 */,
@@ -295,16 +337,16 @@ static void rx_buf_increment(int port, int *buf_ptr)
 
 static inline int encode_short(int port, int off, uint16_t val16)
 {
-	off = pd_write_sym(port, off, bmc4b5b[(val16 >> 0) & 0xF]);
-	off = pd_write_sym(port, off, bmc4b5b[(val16 >> 4) & 0xF]);
-	off = pd_write_sym(port, off, bmc4b5b[(val16 >> 8) & 0xF]);
-	return pd_write_sym(port, off, bmc4b5b[(val16 >> 12) & 0xF]);
+	off = pd_write_byte(port, off, bmc_byte(val16 & 0xFF));
+	return pd_write_byte(port, off, bmc_byte(val16 >> 8));
 }
 
 int encode_word(int port, int off, uint32_t val32)
 {
-	off = encode_short(port, off, (val32 >> 0) & 0xFFFF);
-	return encode_short(port, off, (val32 >> 16) & 0xFFFF);
+	off = pd_write_byte(port, off, bmc_byte(val32 & 0xFF));
+	off = pd_write_byte(port, off, bmc_byte((val32 >> 8) & 0xFF));
+	off = pd_write_byte(port, off, bmc_byte((val32 >> 16) & 0xFF));
+	return pd_write_byte(port, off, bmc_byte(val32 >> 24));
 }
 
 /* prepare a 4b/5b-encoded PD message to send */
@@ -556,9 +598,12 @@ static void bist_mode_2_tx(int port)
 static inline int decode_short(int port, int off, uint16_t *val16)
 {
 	uint32_t w;
+	uint8_t s0, s1, s2, s3;
 	int end;
 
 	end = pd_dequeue_bits(port, off, 20, &w);
+	if (end < 0)
+		return end;
 
 #if 0 /* DEBUG */
 	CPRINTS("%d-%d: %05x %x:%x:%x:%x",
@@ -566,16 +611,23 @@ static inline int decode_short(int port, int off, uint16_t *val16)
 		dec4b5b[(w >> 15) & 0x1f], dec4b5b[(w >> 10) & 0x1f],
 		dec4b5b[(w >>  5) & 0x1f], dec4b5b[(w >>  0) & 0x1f]);
 #endif
-	*val16 = dec4b5b[w & 0x1f] |
-		(dec4b5b[(w >>  5) & 0x1f] << 4) |
-		(dec4b5b[(w >> 10) & 0x1f] << 8) |
-		(dec4b5b[(w >> 15) & 0x1f] << 12);
+	s0 = dec4b5b[w & 0x1f];
+	s1 = dec4b5b[(w >>  5) & 0x1f];
+	s2 = dec4b5b[(w >> 10) & 0x1f];
+	s3 = dec4b5b[(w >> 15) & 0x1f];
+	/* K-codes and reserved symbols are not valid inside the message */
+	if ((s0 | s1 | s2 | s3) & 0x10)
+		return PD_RX_ERR_INVAL;
+
+	*val16 = s0 | (s1 << 4) | (s2 << 8) | (s3 << 12);
 	return end;
 }
 
 static inline int decode_word(int port, int off, uint32_t *val32)
 {
 	off = decode_short(port, off, (uint16_t *)val32);
+	if (off < 0)
+		return off;
 	return decode_short(port, off, ((uint16_t *)val32 + 1));
 }
 
@@ -709,6 +761,11 @@ int pd_analyze_rx(int port, uint32_t *payload)
 
 	/* read header */
 	bit = decode_short(port, bit, &phs.pd_header);
+	/* pd_header is left as it was for the last packet */
+	if (bit < 0) {
+		msg = "header";
+		goto packet_err;
+	}
 
 #ifdef CONFIG_COMMON_RUNTIME
 	mutex_lock(&pd_crc_lock);
@@ -735,7 +792,9 @@ int pd_analyze_rx(int port, uint32_t *payload)
 	/* read payload data */
 	for (p = 0; p < cnt && bit > 0; p++) {
 		bit = decode_word(port, bit, payload+p);
-		crc32_hash32(payload[p]);
+		/* Nothing is decoded from an invalid symbol */
+		if (bit >= 0)
+			crc32_hash32(payload[p]);
 	}
 	ccrc = crc32_result();
 
@@ -750,10 +809,14 @@ int pd_analyze_rx(int port, uint32_t *payload)
 
 	/* check transmitted CRC */
 	bit = decode_word(port, bit, &pcrc);
-	if (bit < 0 || pcrc != ccrc) {
+	if (bit < 0) {
+		/* pcrc is not set when the CRC has an invalid symbol */
+		msg = "CRC";
+		goto packet_err;
+	}
+	if (pcrc != ccrc) {
 		msg = "CRC";
-		if (pcrc != ccrc)
-			bit = PD_RX_ERR_CRC;
+		bit = PD_RX_ERR_CRC;
 		if (debug_level >= 1)
 			CPRINTF("CRC%d %08x <> %08x\n", port, pcrc, ccrc);
 		goto packet_err;
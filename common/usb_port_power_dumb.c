@@ -120,20 +120,19 @@ DECLARE_CONSOLE_COMMAND(usbchargemode, command_set_mode,
 
 static void usb_port_preserve_state(void)
 {
-	system_add_jump_tag(USB_SYSJUMP_TAG, USB_HOOK_VERSION,
-			    sizeof(charge_mode), charge_mode);
+	system_add_jump_slot(JUMP_TAG_USB_PORT, USB_HOOK_VERSION,
+			     sizeof(charge_mode), charge_mode);
 }
 DECLARE_HOOK(HOOK_SYSJUMP, usb_port_preserve_state, HOOK_PRIO_DEFAULT);
 
 static void usb_port_init(void)
 {
 	const uint8_t *prev;
-	int version, size, i;
+	int i;
 
-	prev = (const uint8_t *)system_get_jump_tag(USB_SYSJUMP_TAG,
-						    &version, &size);
-	if (!prev || version != USB_HOOK_VERSION ||
-			size != sizeof(charge_mode)) {
+	prev = system_get_jump_slot(JUMP_TAG_USB_PORT, USB_HOOK_VERSION,
+				    sizeof(charge_mode));
+	if (!prev) {
 		usb_port_all_ports_off();
 		return;
 	}
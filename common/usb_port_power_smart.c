@@ -198,21 +198,19 @@ DECLARE_HOST_COMMAND(EC_CMD_USB_CHARGE_SET_MODE,
 
 static void usb_charge_preserve_state(void)
 {
-	system_add_jump_tag(USB_SYSJUMP_TAG, USB_HOOK_VERSION,
-			    sizeof(charge_mode), charge_mode);
+	system_add_jump_slot(JUMP_TAG_USB_PORT, USB_HOOK_VERSION,
+			     sizeof(charge_mode), charge_mode);
 }
 DECLARE_HOOK(HOOK_SYSJUMP, usb_charge_preserve_state, HOOK_PRIO_DEFAULT);
 
 static void usb_charge_init(void)
 {
 	const struct charge_mode_t *prev;
-	int version, size, i;
-
-	prev = (const struct charge_mode_t *)system_get_jump_tag(USB_SYSJUMP_TAG,
-						    &version, &size);
+	int i;
 
-	if (!prev || version != USB_HOOK_VERSION ||
-			size != sizeof(charge_mode)) {
+	prev = system_get_jump_slot(JUMP_TAG_USB_PORT, USB_HOOK_VERSION,
+				    sizeof(charge_mode));
+	if (!prev) {
 		usb_charge_all_ports_ctrl(USB_CHARGE_MODE_DISABLED);
 		return;
 	}
@@ -36,6 +36,7 @@ int vboot_verify(const uint8_t *data, int len,
 		 const struct rsa_public_key *key, const uint8_t *sig)
 {
 	struct sha256_ctx ctx;
+	uint8_t digest[SHA256_DIGEST_SIZE];
 	uint8_t *hash;
 	uint32_t *workbuf;
 	int err = EC_SUCCESS;
@@ -43,15 +44,25 @@ int vboot_verify(const uint8_t *data, int len,
 	if (SHARED_MEM_ACQUIRE_CHECK(3 * RSANUMBYTES, (char **)&workbuf))
 		return EC_ERROR_MEMORY_ALLOCATION;
 
+	/*
+	 * The signature doesn't depend on the data, so check it first: a bad
+	 * one is rejected without hashing the whole image.
+	 */
+	if (rsa_recover_digest(key, sig, digest, workbuf) != 1) {
+		err = EC_ERROR_VBOOT_DATA_VERIFY;
+		goto out;
+	}
+
 	/* Compute hash of the RW firmware */
 	SHA256_init(&ctx);
 	SHA256_update(&ctx, data, len);
 	hash = SHA256_final(&ctx);
 
 	/* Verify the data */
-	if (rsa_verify(key, sig, hash, workbuf) != 1)
+	if (memcmp(digest, hash, SHA256_DIGEST_SIZE) != 0)
 		err = EC_ERROR_VBOOT_DATA_VERIFY;
 
+out:
 	shared_mem_release(workbuf);
 
 	return err;
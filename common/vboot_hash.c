@@ -30,7 +30,6 @@ struct vboot_hash_tag {
 	uint32_t size;
 };
 
-#define VBOOT_HASH_SYSJUMP_TAG 0x5648 /* "VH" */
 #define VBOOT_HASH_SYSJUMP_VERSION 1
 
 #define CHUNK_SIZE 1024       /* Bytes to hash per deferred call */
@@ -118,6 +117,15 @@ static int read_and_hash_chunk(int offset, int size)
 static void hash_next_chunk(size_t size)
 {
 #ifdef CONFIG_MAPPED_STORAGE
+	/*
+	 * Land host writes received since the hash started; they invalidate
+	 * it once written.
+	 */
+	if (flash_queue_sync(data_offset + curr_pos, size) != EC_SUCCESS) {
+		vboot_hash_abort();
+		return;
+	}
+
 	flash_lock_mapped_storage(1);
 	SHA256_update(&ctx, (const uint8_t *)(CONFIG_MAPPED_STORAGE_BASE +
 					      data_offset + curr_pos), size);
@@ -217,6 +225,10 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 		return EC_ERROR_INVAL;
 	}
 
+	/* Host writes may still be on their way to flash */
+	if (flash_queue_sync(offset, size))
+		return EC_ERROR_UNKNOWN;
+
 	clock_enable_module(MODULE_FAST_CPU, 1);
 	/* Save new hash request */
 	data_offset = offset;
@@ -285,12 +297,10 @@ static void vboot_hash_init(void)
 {
 #ifdef CONFIG_SAVE_VBOOT_HASH
 	const struct vboot_hash_tag *tag;
-	int version, size;
 
-	tag = (const struct vboot_hash_tag *)system_get_jump_tag(
-		VBOOT_HASH_SYSJUMP_TAG, &version, &size);
-	if (tag && version == VBOOT_HASH_SYSJUMP_VERSION &&
-	    size == sizeof(*tag)) {
+	tag = system_get_jump_slot(JUMP_TAG_VBOOT_HASH,
+				   VBOOT_HASH_SYSJUMP_VERSION, sizeof(*tag));
+	if (tag) {
 		/* Already computed a hash, so don't recompute */
 		CPRINTS("hash precomputed");
 		hash = tag->hash;
@@ -338,9 +348,8 @@ static int vboot_hash_preserve_state(void)
 	memcpy(tag.hash, hash, sizeof(tag.hash));
 	tag.offset = data_offset;
 	tag.size = data_size;
-	system_add_jump_tag(VBOOT_HASH_SYSJUMP_TAG,
-			    VBOOT_HASH_SYSJUMP_VERSION,
-			    sizeof(tag), &tag);
+	system_add_jump_slot(JUMP_TAG_VBOOT_HASH, VBOOT_HASH_SYSJUMP_VERSION,
+			     sizeof(tag), &tag);
 	return EC_SUCCESS;
 }
 DECLARE_HOOK(HOOK_SYSJUMP, vboot_hash_preserve_state, HOOK_PRIO_DEFAULT);
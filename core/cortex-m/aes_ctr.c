@@ -0,0 +1,34 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* AES-CTR on top of the assembly block cipher in aes.S. */
+
+#include "aes.h"
+#include "common.h"
+#include "endian.h"
+#include "util.h"
+
+void aes_nohw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+				   size_t blocks, const AES_KEY *key,
+				   const uint8_t ivec[16])
+{
+	uint32_t counter[4];
+	uint8_t keystream[AES_BLOCK_SIZE] __aligned(4);
+	uint32_t ctr;
+	int i;
+
+	memcpy(counter, ivec, sizeof(counter));
+	ctr = be32toh(counter[3]);
+
+	while (blocks--) {
+		aes_nohw_encrypt((const uint8_t *)counter, keystream, key);
+		counter[3] = htobe32(++ctr);
+		/* |in| and |out| may not be word aligned. */
+		for (i = 0; i < AES_BLOCK_SIZE; i++)
+			out[i] = in[i] ^ keystream[i];
+		in += AES_BLOCK_SIZE;
+		out += AES_BLOCK_SIZE;
+	}
+}
@@ -25,7 +25,7 @@ LDFLAGS_EXTRA+=-flto
 endif
 
 core-y=cpu.o init.o ldivmod.o llsr.o uldivmod.o vecttable.o
-core-$(CONFIG_AES)+=aes.o
+core-$(CONFIG_AES)+=aes.o aes_ctr.o
 core-$(CONFIG_AES_GCM)+=ghash.o
 core-$(CONFIG_ARMV7M_CACHE)+=cache.o
 core-$(CONFIG_COMMON_PANIC_OUTPUT)+=panic.o
@@ -5,6 +5,10 @@
 
 /* Entry point of unit test executable */
 
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "boot_timeline.h"
 #include "console.h"
 #include "flash.h"
 #include "hooks.h"
@@ -28,6 +32,23 @@ const char *__get_prog_name(void)
 	return __prog_name;
 }
 
+int test_shard_next(void)
+{
+	static int shard = -1, shard_count, test_index;
+
+	if (shard < 0) {
+		const char *env = getenv("TEST_SHARD");
+
+		if (!env || sscanf(env, "%d/%d", &shard, &shard_count) != 2 ||
+		    shard < 0 || shard >= shard_count) {
+			shard = 0;
+			shard_count = 1;
+		}
+	}
+
+	return test_index++ % shard_count == shard;
+}
+
 static int test_main(void)
 {
 	/*
@@ -47,10 +68,13 @@ static int test_main(void)
 	test_init();
 
 	timer_init();
+	boot_timeline_step(EC_BOOT_TIMELINE_TIMER);
 #ifdef HAS_TASK_KEYSCAN
 	keyboard_scan_init();
+	boot_timeline_step(EC_BOOT_TIMELINE_KEYBOARD_SCAN);
 #endif
 	uart_init();
+	boot_timeline_step(EC_BOOT_TIMELINE_UART);
 
 	if (system_jumped_to_this_image()) {
 		CPRINTS("Emulator initialized after sysjump");
@@ -61,6 +85,7 @@ static int test_main(void)
 		CPUTS("]\n");
 	}
 
+	boot_timeline_step(EC_BOOT_TIMELINE_INITS_DONE);
 	task_start();
 
 	return 0;
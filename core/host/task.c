@@ -22,6 +22,7 @@
 #include "task_id.h"
 #include "test_util.h"
 #include "timer.h"
+#include "util.h"
 
 #define SIGNAL_INTERRUPT SIGUSR1
 
@@ -31,6 +32,13 @@ struct emu_task_t {
 	uint32_t event;
 	timestamp_t wake_time;
 	uint8_t started;
+#ifdef CONFIG_TASK_STATS
+	struct task_stats stats;
+	/* First task_set_event() not yet seen by the task, 0 if none */
+	timestamp_t event_time;
+	/* Frame address of the task routine's caller */
+	uintptr_t stack_top;
+#endif
 };
 
 struct task_args {
@@ -53,6 +61,11 @@ static void (*pending_isr)(void);
 static int generator_sleeping;
 static timestamp_t generator_sleep_deadline;
 static int has_interrupt_generator = 1;
+static int generator_started;
+
+/* Virtual time skipped over while every task was waiting */
+static uint64_t skipped_us;
+static uint32_t skip_count;
 
 /* thread local task id */
 static __thread task_id_t my_task_id = TASK_ID_INVALID;
@@ -140,8 +153,17 @@ test_mockable void interrupt_enable(void)
 
 static void _task_execute_isr(int sig)
 {
+#ifdef CONFIG_TASK_STATS
+	timestamp_t start = get_time();
+#endif
+
 	in_interrupt = 1;
 	pending_isr();
+#ifdef CONFIG_TASK_STATS
+	if (task_started)
+		tasks[running_task_id].stats.isr_time_us +=
+			get_time().val - start.val;
+#endif
 	sem_post(&interrupt_sem);
 	in_interrupt = 0;
 }
@@ -155,6 +177,8 @@ void task_register_interrupt(void)
 void task_trigger_test_interrupt(void (*isr)(void))
 {
 	pid_t main_pid;
+
+	generator_started = 1;
 	pthread_mutex_lock(&interrupt_lock);
 	if (interrupt_disabled) {
 		pthread_mutex_unlock(&interrupt_lock);
@@ -183,6 +207,7 @@ void interrupt_generator_udelay(unsigned us)
 {
 	generator_sleep_deadline.val = get_time().val + us;
 	generator_sleeping = 1;
+	generator_started = 1;
 	while (get_time().val < generator_sleep_deadline.val)
 		;
 	generator_sleeping = 0;
@@ -200,7 +225,13 @@ pthread_t task_get_thread(task_id_t tskid)
 
 uint32_t task_set_event(task_id_t tskid, uint32_t event)
 {
+#ifdef CONFIG_TASK_STATS
+	/* Scheduling latency runs from the first event the task hasn't seen */
+	if (!atomic_or(&tasks[tskid].event, event))
+		tasks[tskid].event_time = get_time();
+#else
 	atomic_or(&tasks[tskid].event, event);
+#endif
 	return 0;
 }
 
@@ -209,6 +240,48 @@ uint32_t *task_get_event_bitmap(task_id_t tskid)
 	return &tasks[tskid].event;
 }
 
+#ifdef CONFIG_TASK_STATS
+static void account_wakeup(task_id_t tid, uint32_t events)
+{
+	struct emu_task_t *t = &tasks[tid];
+	uintptr_t sp = (uintptr_t)__builtin_frame_address(0);
+	uint32_t latency;
+
+	t->stats.wakeups++;
+	while (events) {
+		int bit = __builtin_ctz(events);
+
+		t->stats.event_wakeups[bit]++;
+		events &= ~BIT(bit);
+	}
+
+	if (t->event_time.val) {
+		latency = get_time().val - t->event_time.val;
+		t->stats.max_latency_us = MAX(t->stats.max_latency_us,
+					      latency);
+		t->event_time.val = 0;
+	}
+
+	/*
+	 * Host threads don't have their own EC-sized stacks, so sample the
+	 * depth at each wakeup instead of scanning for a watermark.
+	 */
+	if (t->stack_top > sp)
+		t->stats.stack_used = MAX(t->stats.stack_used,
+					  t->stack_top - sp);
+}
+
+void task_get_stats(task_id_t tskid, struct task_stats *stats)
+{
+	*stats = tasks[tskid].stats;
+}
+
+void task_reset_stats(task_id_t tskid)
+{
+	memset(&tasks[tskid].stats, 0, sizeof(tasks[tskid].stats));
+}
+#endif
+
 uint32_t task_wait_event(int timeout_us)
 {
 	int tid = task_get_current();
@@ -223,6 +296,9 @@ uint32_t task_wait_event(int timeout_us)
 
 	/* Resume */
 	ret = atomic_clear(&tasks[tid].event);
+#ifdef CONFIG_TASK_STATS
+	account_wakeup(tid, ret);
+#endif
 	pthread_mutex_unlock(&interrupt_lock);
 	return ret;
 }
@@ -352,6 +428,41 @@ void wait_for_task_started_nosleep(void)
 	_wait_for_task_started(0);
 }
 
+/*
+ * Jump the clock forward to ts. Nothing runs in the skipped interval, so
+ * this is what makes long timeouts in tests cost no wall-clock time.
+ */
+static void skip_to(timestamp_t ts)
+{
+	timestamp_t now = get_time();
+
+	if (ts.val <= now.val)
+		return;
+
+	skipped_us += ts.val - now.val;
+	skip_count++;
+	force_time(ts);
+}
+
+int emulator_skip_udelay(unsigned us)
+{
+	timestamp_t deadline;
+
+	/* The interrupt generator could fire in the middle of the delay */
+	if (has_interrupt_generator)
+		return 0;
+
+	deadline.val = get_time().val + us;
+	skip_to(deadline);
+	return 1;
+}
+
+void emulator_get_time_stats(uint64_t *skipped, uint32_t *skips)
+{
+	*skipped = skipped_us;
+	*skips = skip_count;
+}
+
 static task_id_t task_get_next_wake(void)
 {
 	int i;
@@ -383,11 +494,18 @@ static int fast_forward(void)
 	 */
 	int task_id = task_get_next_wake();
 
+	/*
+	 * Every task is waiting without a timeout, so only an interrupt can
+	 * make progress. Don't jump the clock to the end of time.
+	 */
+	if (task_id != TASK_ID_INVALID && tasks[task_id].wake_time.val == ~0ull)
+		task_id = TASK_ID_INVALID;
+
 	if (!has_interrupt_generator) {
 		if (task_id == TASK_ID_INVALID) {
 			return TASK_ID_IDLE;
 		} else {
-			force_time(tasks[task_id].wake_time);
+			skip_to(tasks[task_id].wake_time);
 			return task_id;
 		}
 	}
@@ -398,10 +516,10 @@ static int fast_forward(void)
 	if (task_id != TASK_ID_INVALID &&
 	    tasks[task_id].thread != (pthread_t)NULL &&
 	    tasks[task_id].wake_time.val < generator_sleep_deadline.val) {
-		force_time(tasks[task_id].wake_time);
+		skip_to(tasks[task_id].wake_time);
 		return task_id;
 	} else {
-		force_time(generator_sleep_deadline);
+		skip_to(generator_sleep_deadline);
 		return TASK_ID_IDLE;
 	}
 }
@@ -415,6 +533,9 @@ void task_scheduler(void)
 {
 	int i;
 	timestamp_t now;
+#ifdef CONFIG_TASK_STATS
+	uint64_t isr_time;
+#endif
 
 	task_started = 1;
 
@@ -442,8 +563,16 @@ void task_scheduler(void)
 		tasks[i].wake_time.val = ~0ull;
 		running_task_id = i;
 		tasks[i].started = 1;
+#ifdef CONFIG_TASK_STATS
+		isr_time = tasks[i].stats.isr_time_us;
+#endif
 		pthread_cond_signal(&tasks[i].resume);
 		pthread_cond_wait(&scheduler_cond, &run_lock);
+#ifdef CONFIG_TASK_STATS
+		/* Interrupts taken while the task ran are billed separately */
+		tasks[i].stats.run_time_us += get_time().val - now.val -
+			(tasks[i].stats.isr_time_us - isr_time);
+#endif
 	}
 }
 
@@ -452,6 +581,9 @@ void *_task_start_impl(void *a)
 	long tid = (long)a;
 	const struct task_args *arg = task_info + tid;
 	my_task_id = tid;
+#ifdef CONFIG_TASK_STATS
+	tasks[tid].stack_top = (uintptr_t)__builtin_frame_address(0);
+#endif
 	pthread_mutex_lock(&run_lock);
 
 	/* Wait for scheduler */
@@ -514,6 +646,15 @@ int task_start(void)
 	pthread_create(&interrupt_thread, NULL,
 		       _task_int_generator_start, NULL);
 
+	/*
+	 * Wait for the interrupt generator to either return or start
+	 * generating, so that the scheduler knows from its first pass whether
+	 * it may skip time. Otherwise how far the clock has crept by then
+	 * depends on the host's thread scheduling.
+	 */
+	while (has_interrupt_generator && !generator_started)
+		_usleep(10);
+
 	/*
 	 * Tell the hooks task to continue so that it can call back to enable
 	 * the other tasks.
@@ -71,6 +71,10 @@ void udelay(unsigned us)
 		return;
 	}
 
+	/* Once tasks run, nothing else can happen during the delay */
+	if (task_start_called() && emulator_skip_udelay(us))
+		return;
+
 	deadline.val = get_time().val + us;
 	while (get_time().val < deadline.val)
 		;
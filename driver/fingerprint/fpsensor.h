@@ -18,7 +18,12 @@
 #define FP_SENSOR_IMAGE_SIZE 0
 #define FP_SENSOR_RES_X 0
 #define FP_SENSOR_RES_Y 0
+#ifdef BOARD_HOST
+/* Not a multiple of the AES block size, to exercise partial blocks. */
+#define FP_ALGORITHM_TEMPLATE_SIZE 1000
+#else
 #define FP_ALGORITHM_TEMPLATE_SIZE 0
+#endif
 #define FP_MAX_FINGER_COUNT 5
 #endif
 
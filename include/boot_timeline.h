@@ -0,0 +1,57 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Boot timeline */
+
+#ifndef __CROS_EC_BOOT_TIMELINE_H
+#define __CROS_EC_BOOT_TIMELINE_H
+
+#include "common.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "timer.h"
+
+#ifdef CONFIG_BOOT_TIMELINE
+
+/**
+ * Record that a step of booting is done.
+ *
+ * @param step		Step done
+ */
+void boot_timeline_step(enum ec_boot_timeline_step step);
+
+/**
+ * Record how long a hook routine took, if it's a HOOK_INIT routine.
+ *
+ * @param type		Hook type
+ * @param routine	Hook routine
+ * @param start		When the routine was called
+ */
+void boot_timeline_hook(enum hook_type type, void (*routine)(void),
+			timestamp_t start);
+
+/**
+ * Record how long a lazy initialization routine took.
+ *
+ * @param why		What made it run
+ * @param routine	Initialization routine
+ * @param start		When the routine was called
+ */
+void boot_timeline_lazy(enum ec_boot_timeline_lazy why, void (*routine)(void),
+			timestamp_t start);
+
+#else
+
+static inline void boot_timeline_step(enum ec_boot_timeline_step step) { }
+static inline void boot_timeline_hook(enum hook_type type,
+				      void (*routine)(void),
+				      timestamp_t start) { }
+static inline void boot_timeline_lazy(enum ec_boot_timeline_lazy why,
+				      void (*routine)(void),
+				      timestamp_t start) { }
+
+#endif /* CONFIG_BOOT_TIMELINE */
+
+#endif /* __CROS_EC_BOOT_TIMELINE_H */
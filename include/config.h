@@ -667,6 +667,15 @@
 /* Size of boot header in storage. */
 #undef CONFIG_BOOT_HEADER_STORAGE_SIZE
 
+/*
+ * Record a timeline of booting: when each step of getting the tasks started
+ * was done, how long each HOOK_INIT routine took, and when lazy initialization
+ * ran.  It's read with EC_CMD_BOOT_TIMELINE, or the boottimeline console
+ * command.  This many entries are kept from each boot.
+ */
+#undef CONFIG_BOOT_TIMELINE
+#define CONFIG_BOOT_TIMELINE_ENTRIES 64
+
 /*****************************************************************************/
 /* Bootblock config */
 
@@ -1089,6 +1098,13 @@
  */
 #undef CONFIG_OCPC_DEF_RBATT_MOHMS
 
+/*
+ * Tune the OCPC PID loop from the measured Rsys+Rbatt, in place of the board's
+ * constants, once the measurements settle.  The tuned gains are kept across
+ * sysjumps.  "ocpcpid auto" turns this on at runtime too.
+ */
+#undef CONFIG_OCPC_PID_AUTOTUNE
+
 /* Enable trickle charging */
 #undef CONFIG_TRICKLE_CHARGING
 
@@ -1264,6 +1280,20 @@
 /* Support curve25519 public key cryptography */
 #undef CONFIG_CURVE25519
 
+/*
+ * Compute X25519 public keys with a fixed-base comb over precomputed
+ * edwards25519 points instead of the Montgomery ladder. Shared secrets still
+ * use the ladder. Not available with the cortex-m0 assembly implementation.
+ */
+#undef CONFIG_CURVE25519_FIXED_BASE
+
+/*
+ * Number of comb teeth for CONFIG_CURVE25519_FIXED_BASE. The table generated
+ * at build time holds 2^n - 1 entries of 96 bytes of flash, and a public key
+ * costs ceil(255 / n) point doublings and additions.
+ */
+#define CONFIG_CURVE25519_COMB_TEETH 4
+
 /*****************************************************************************/
 /* PMIC config */
 
@@ -1379,6 +1409,7 @@
 #undef  CONFIG_CMD_RTC
 #undef  CONFIG_CMD_RTC_ALARM
 #define CONFIG_CMD_RW
+#undef  CONFIG_CMD_RWSIG_TIMING
 #undef  CONFIG_CMD_SCRATCHPAD
 #undef	CONFIG_CMD_SEVEN_SEG_DISPLAY
 #define CONFIG_CMD_SHMEM
@@ -1717,6 +1748,23 @@
  */
 #undef CONFIG_FAN_RPM_CUSTOM
 
+/*
+ * Run the fan RPM control loop on the EC, driving the duty cycle from
+ * filtered tach readings, instead of using the fan controller's own RPM mode.
+ * The loop runs every CONFIG_FAN_RPM_CONTROL_PERIOD_MS, and a fan that doesn't
+ * turn for CONFIG_FAN_RPM_CONTROL_STALL_MS is reported stalled and kicked at
+ * full duty.
+ *
+ * The duty cycle is a feed-forward estimate from the target RPM plus a PI
+ * correction. Gains are in 1/1024 percent of duty per RPM of error (P) and per
+ * RPM*s (I).
+ */
+#undef CONFIG_FAN_RPM_CONTROL
+#define CONFIG_FAN_RPM_CONTROL_PERIOD_MS 100
+#define CONFIG_FAN_RPM_CONTROL_STALL_MS 1000
+#define CONFIG_FAN_RPM_CONTROL_KP 8
+#define CONFIG_FAN_RPM_CONTROL_KI 24
+
 /*
  * We normally check and update the fans once per second (HOOK_SECOND). If this
  * is #defined to a postive integer N, we will only update the fans every N
@@ -1740,6 +1788,15 @@
 #undef CONFIG_FLASH_ERASE_SIZE
 /* Allow deferred (async) flash erase */
 #undef CONFIG_FLASH_DEFERRED_ERASE
+/*
+ * Queue host flash operations.  Contiguous host writes are coalesced into
+ * CONFIG_FLASH_WRITE_IDEAL_SIZE physical writes, and async erase requests are
+ * queued and erased in the background ahead of the writes that follow them.
+ * Requires CONFIG_FLASH_DEFERRED_ERASE.
+ */
+#undef CONFIG_FLASH_WRITE_QUEUE
+/* Number of async erase requests that can be queued; default is 4 */
+#undef CONFIG_FLASH_ERASE_QUEUE_DEPTH
 /* Flash must be selected for write/erase operations to succeed. */
 #undef CONFIG_FLASH_SELECT_REQUIRED
 
@@ -2238,6 +2295,27 @@
 /* Enable debugging and profiling statistics for hook functions */
 #undef CONFIG_HOOK_DEBUG
 
+/*
+ * Run CHIPSET_* hook routines declared with DECLARE_CONCURRENT_HOOK() at the
+ * same time as the others of their priority, on the task calling
+ * hook_notify() and on any hook worker tasks the board has: HOOKW0 to
+ * HOOKW3, each TASK_ALWAYS(HOOKWn, hook_worker_task, NULL,
+ * LARGER_TASK_STACK_SIZE).  Every routine of one priority is done before any
+ * of the next is started.  Priorities with more than
+ * CONFIG_HOOK_CONCURRENT_MAX routines are run one at a time.
+ */
+#undef CONFIG_HOOK_CONCURRENT
+#define CONFIG_HOOK_CONCURRENT_MAX 32
+
+/*
+ * Put off initialization declared with DECLARE_LAZY_INIT() until HOOK_INIT is
+ * done and the other tasks are running, or until the AP powers on, or until
+ * something needs it first.  Without this, such routines are HOOK_INIT
+ * routines.  Routines to run once booting is done are run this many ms after.
+ */
+#undef CONFIG_LAZY_INIT
+#define CONFIG_LAZY_INIT_DELAY_MS 0
+
 /*****************************************************************************/
 /* CRC configuration */
 
@@ -3200,6 +3278,15 @@
  */
 #undef CONFIG_POWER_SIGNAL_INTERRUPT_STORM_DETECT_THRESHOLD
 
+/*
+ * Record a timeline of power sequencing: power signal edges, state machine
+ * transitions, waits for power signals and how long each CHIPSET_* hook
+ * routine takes.  It's read with EC_CMD_POWER_TIMELINE, or the powertimeline
+ * console command.  This many entries are kept; it must be a power of two.
+ */
+#undef CONFIG_POWER_TIMELINE
+#define CONFIG_POWER_TIMELINE_ENTRIES 64
+
 /* Use part of the EC's data EEPROM to hold persistent storage for the AP. */
 #undef CONFIG_PSTORE
 
@@ -3353,6 +3440,12 @@
  */
 #undef CONFIG_RWSIG_DONT_CHECK_ON_PIN_RESET
 
+/*
+ * Print how long each phase of the RW signature check took, on top of the
+ * result.
+ */
+#undef CONFIG_RWSIG_PRINT_TIMING
+
 /*
  * When RWSIG verification is performed as a task, time to wait from signature
  * verification to an automatic jump to RW (if AP does not request the wait to
@@ -3497,6 +3590,13 @@
 /* If defined will enable block (64KiB) erase operations. */
 #undef CONFIG_SPI_NOR_BLOCK_ERASE
 
+/*
+ * If defined, read Serial NOR flash with the JEDEC Fast Read opcode (0x0b)
+ * and 8 wait state clocks, which allows a higher SPI clock. SFDP doesn't say
+ * whether a part supports it, so only define it for parts known to.
+ */
+#undef CONFIG_SPI_NOR_FAST_READ
+
 /* If defined will read the sector/block to be erased first and only initiate
  * the erase operation if not already in an erased state. The read operation
  * (performed in CONFIG_SPI_NOR_MAX_READ_SIZE chunks) is aborted early if a
@@ -3550,6 +3650,15 @@
 /* Support dedicated recovery signal from servo board */
 #undef CONFIG_SWITCH_DEDICATED_RECOVERY
 
+/*
+ * Time jumps between images: getting ready and each HOOK_SYSJUMP routine in
+ * the image jumping, then booting and each HOOK_INIT routine in the one
+ * jumped to.  It's read with EC_CMD_SYSJUMP_TIMING, or the sysjumptime
+ * console command.  This many HOOK_INIT routines are timed.
+ */
+#undef CONFIG_SYSJUMP_TIMING
+#define CONFIG_SYSJUMP_TIMING_INIT_HOOKS 64
+
 /*
  * System should remain unlocked even if write protect is enabled.
  *
@@ -3673,6 +3782,13 @@
  */
 #define CONFIG_TASK_PROFILING
 
+/*
+ * Keep per-task run time, wakeups by event bit, scheduling latency and the
+ * deepest stack seen at wakeup, reported by EC_CMD_TASK_STATS. Costs about
+ * 180 bytes of RAM per task. Currently only implemented by the host core.
+ */
+#undef CONFIG_TASK_STATS
+
 /*****************************************************************************/
 /* Mock config */
 
@@ -3736,6 +3852,33 @@
 /* Compile common code for throttling the CPU based on the temp sensors */
 #undef CONFIG_THROTTLE_AP
 
+/*
+ * Sample the sensors which have a HIGH or HALT threshold this often, in ms,
+ * instead of only once a second, so that throttling and shutdown react to
+ * fast temperature ramps. Fan control still runs once a second.
+ *
+ * This only helps with sensors whose driver measures the temperature when it
+ * is read, like ADC thermistors. Drivers which refresh a cached reading on
+ * HOOK_SECOND, like tmp432 and f75303, still only change once a second.
+ */
+#undef CONFIG_THERMAL_FAST_SAMPLE_MS
+
+/*
+ * Drive the fans with a PID loop holding the hottest sensor, relative to its
+ * fan range, midway between its temp_fan_off and temp_fan_max, instead of
+ * following the linear fan curve. The linear curve is still used whenever a
+ * fan sensor can't be read.
+ *
+ * The error is in percent of each sensor's fan range, so that sensors with
+ * different ranges compare. Gains are in 1/256 percent of fan duty per
+ * percent (P), per percent*s (I) and per percent/s (D) of that; a KP of 256
+ * has the slope of the linear curve.
+ */
+#undef CONFIG_THERMAL_FAN_PID
+#define CONFIG_THERMAL_FAN_PID_KP 512
+#define CONFIG_THERMAL_FAN_PID_KI 25
+#define CONFIG_THERMAL_FAN_PID_KD 0
+
 /*
  * Throttle the CPU when battery discharge current is too high. When
  * this feature is enabled, BAT_MAX_DISCHG_CURRENT must be defined in board.h.
@@ -4169,6 +4312,13 @@
 /* Board provides specific TCPC init function */
 #undef CONFIG_USB_PD_TCPC_BOARD_INIT
 
+/*
+ * Encode outgoing PD messages with a 1KB table giving the 4b5b + BMC symbols
+ * of a whole byte, instead of composing them from the 16-entry quartet table.
+ * Faster, but costs flash, so leave this off on boards which are tight.
+ */
+#undef CONFIG_USB_PD_TCPC_BMC_BYTE_TABLE
+
 /* Enable TCPC to enter low power mode */
 #undef CONFIG_USB_PD_TCPC_LOW_POWER
 
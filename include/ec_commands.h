@@ -1958,6 +1958,35 @@ struct ec_response_sysinfo {
 	uint32_t flags;			/**< enum sysinfo_flags */
 } __ec_align4;
 
+/**
+ * Get statistics from the flash write queue (CONFIG_FLASH_WRITE_QUEUE).
+ *
+ * Supplements EC_CMD_FLASH_INFO on ECs which coalesce host flash writes and
+ * erase queued FLASH_ERASE_SECTOR_ASYNC requests in the background.
+ */
+#define EC_CMD_FLASH_QUEUE_INFO 0x001D
+#define EC_VER_FLASH_QUEUE_INFO 0
+
+/* Clear the counters after reporting them */
+#define EC_FLASH_QUEUE_INFO_RESET BIT(0)
+
+struct ec_params_flash_queue_info {
+	uint8_t flags;			/**< EC_FLASH_QUEUE_INFO_* flags */
+	uint8_t reserved[3];
+} __ec_align4;
+
+struct ec_response_flash_queue_info {
+	uint32_t write_requests;	/**< FLASH_WRITE commands received */
+	uint32_t write_bytes;		/**< Bytes received by FLASH_WRITE */
+	uint32_t physical_writes;	/**< Writes issued to the flash */
+	uint32_t write_time_us;		/**< Time spent writing the flash */
+	uint32_t erase_bytes;		/**< Bytes erased */
+	uint32_t erase_time_us;		/**< Time spent erasing the flash */
+	uint16_t write_pending;		/**< Bytes in the coalescing buffer */
+	uint8_t erase_depth;		/**< Erase requests currently queued */
+	uint8_t erase_depth_max;	/**< Most erase requests ever queued */
+} __ec_align4;
+
 /*****************************************************************************/
 /* PWM commands */
 
@@ -4283,6 +4312,35 @@ struct ec_params_console_read_v1 {
 	uint8_t subcmd; /* enum ec_console_read_subcmd */
 } __ec_align1;
 
+/*
+ * Read console output by sequence number, without a snapshot.
+ *
+ * Every byte of console output is numbered from 0 at boot. The response
+ * holds the bytes starting at params.seq that are still in the EC's buffer,
+ * as many as fit. Pass response.seq plus the number of data bytes as
+ * params.seq of the next request to keep following the output.
+ */
+#define EC_CMD_CONSOLE_READ_SEQ 0x0137
+
+struct ec_params_console_read_seq {
+	uint32_t seq;		/* Sequence number of the first byte wanted */
+} __ec_align4;
+
+/*
+ * params.seq was past the newest byte, meaning the EC restarted since it was
+ * returned. Data starts from the oldest byte in the buffer instead.
+ */
+#define EC_CONSOLE_READ_SEQ_RESTARTED	BIT(0)
+
+struct ec_response_console_read_seq {
+	uint32_t seq;		/* Sequence number of data[0] */
+	uint32_t head;		/* Sequence number of the next byte to come */
+	uint32_t lost;		/* Bytes overwritten before they could be read */
+	uint8_t flags;		/* EC_CONSOLE_READ_SEQ_* */
+	uint8_t reserved[3];
+	uint8_t data[];		/* Rest of the response, not null-terminated */
+} __ec_align4;
+
 /*****************************************************************************/
 
 /*
@@ -6824,6 +6882,262 @@ enum pchg_state {
 	[PCHG_STATE_FULL] = "FULL", \
 	}
 
+/*****************************************************************************/
+/*
+ * Get scheduling statistics of a task (CONFIG_TASK_STATS).
+ *
+ * Tasks are numbered as in the "taskinfo" console command. Hosts can walk
+ * them by asking for task 0 and then up to task_count - 1.
+ */
+#define EC_CMD_TASK_STATS 0x0136
+
+/* Clear the task's counters after reporting them */
+#define EC_TASK_STATS_RESET BIT(0)
+
+#define EC_TASK_STATS_NAME_LEN 16
+#define EC_TASK_STATS_EVENT_BITS 32
+
+struct ec_params_task_stats {
+	uint8_t task_id;
+	uint8_t flags;			/**< EC_TASK_STATS_* flags */
+	uint8_t reserved[2];
+} __ec_align4;
+
+struct ec_response_task_stats {
+	uint64_t run_time_us;		/**< Time running, excluding ISRs */
+	uint64_t isr_time_us;		/**< Time in ISRs taken while running */
+	uint32_t wakeups;		/**< Returns from task_wait_event() */
+	uint32_t max_latency_us;	/**< Longest task_set_event() to run */
+	uint32_t stack_used;		/**< Deepest stack seen at wakeup */
+	uint32_t stack_size;		/**< Stack size in bytes, 0 if unknown */
+	uint8_t task_count;		/**< Number of tasks */
+	uint8_t reserved[3];
+	char name[EC_TASK_STATS_NAME_LEN];
+	/** Wakeups which returned each TASK_EVENT_* bit */
+	uint32_t event_wakeups[EC_TASK_STATS_EVENT_BITS];
+} __ec_align4;
+
+/*****************************************************************************/
+/*
+ * Get the state of the EC-side fan RPM control loop (CONFIG_FAN_RPM_CONTROL)
+ * for one fan.
+ *
+ * Settle time and overshoot are measured from the last change of target.
+ */
+#define EC_CMD_FAN_TELEMETRY 0x0138
+
+/* The fan is under RPM control, rather than a fixed duty cycle */
+#define EC_FAN_TELEMETRY_RPM_MODE BIT(0)
+/* The fan is stalled, and being driven at full duty to restart it */
+#define EC_FAN_TELEMETRY_STALLED BIT(1)
+/* The fan has settled at its target; settle_ms is valid */
+#define EC_FAN_TELEMETRY_SETTLED BIT(2)
+
+struct ec_params_fan_telemetry {
+	uint8_t fan_idx;
+} __ec_align1;
+
+struct ec_response_fan_telemetry {
+	uint16_t target_rpm;
+	uint16_t rpm;			/**< Filtered tach reading */
+	uint16_t raw_rpm;		/**< Last unfiltered tach reading */
+	uint16_t overshoot_rpm;		/**< Furthest past the target */
+	uint32_t settle_ms;		/**< Target change to settling */
+	uint16_t stall_count;		/**< Stalls since boot */
+	uint8_t duty;			/**< Current duty cycle, percent */
+	uint8_t flags;			/**< EC_FAN_TELEMETRY_* flags */
+} __ec_align4;
+
+/*****************************************************************************/
+/*
+ * Read the power sequencing timeline: what happened to the power signals,
+ * the power state machine and the CHIPSET_* hooks, and when.
+ *
+ * Entries are numbered as they're recorded.  Ask for entries from a sequence
+ * number; the response starts from the oldest one the EC still has if that's
+ * later, and says where to continue from.
+ */
+#define EC_CMD_POWER_TIMELINE 0x0139
+
+enum ec_power_timeline_type {
+	/* A power signal changed: id is its index, value its new level. */
+	EC_POWER_TIMELINE_SIGNAL = 0,
+	/* The power state machine moved on: id is an ec_power_timeline_state */
+	EC_POWER_TIMELINE_STATE = 1,
+	/*
+	 * A hook routine ran: id is an ec_power_timeline_hook, arg the
+	 * routine's address, and duration_us how long it took.
+	 */
+	EC_POWER_TIMELINE_HOOK = 2,
+	/*
+	 * The chipset waited for power signals: arg is the mask it wanted,
+	 * duration_us how long it waited, and value 1 if it gave up.
+	 */
+	EC_POWER_TIMELINE_WAIT = 3,
+};
+
+enum ec_power_timeline_state {
+	EC_POWER_TIMELINE_G3 = 0,
+	EC_POWER_TIMELINE_S5,
+	EC_POWER_TIMELINE_S3,
+	EC_POWER_TIMELINE_S0,
+	EC_POWER_TIMELINE_S0IX,
+	EC_POWER_TIMELINE_G3S5,
+	EC_POWER_TIMELINE_S5S3,
+	EC_POWER_TIMELINE_S3S0,
+	EC_POWER_TIMELINE_S0S3,
+	EC_POWER_TIMELINE_S3S5,
+	EC_POWER_TIMELINE_S5G3,
+	EC_POWER_TIMELINE_S0IXS0,
+	EC_POWER_TIMELINE_S0S0IX,
+	EC_POWER_TIMELINE_STATE_COUNT,
+};
+
+enum ec_power_timeline_hook {
+	EC_POWER_TIMELINE_HOOK_PRE_INIT = 0,
+	EC_POWER_TIMELINE_HOOK_STARTUP,
+	EC_POWER_TIMELINE_HOOK_RESUME,
+	EC_POWER_TIMELINE_HOOK_SUSPEND,
+	EC_POWER_TIMELINE_HOOK_RESUME_INIT,
+	EC_POWER_TIMELINE_HOOK_SUSPEND_COMPLETE,
+	EC_POWER_TIMELINE_HOOK_SHUTDOWN,
+	EC_POWER_TIMELINE_HOOK_SHUTDOWN_COMPLETE,
+	EC_POWER_TIMELINE_HOOK_RESET,
+	EC_POWER_TIMELINE_HOOK_COUNT,
+};
+
+struct ec_power_timeline_entry {
+	uint32_t time_us;	/**< EC clock (low 32 bits) when it started */
+	uint8_t type;		/**< enum ec_power_timeline_type */
+	uint8_t id;
+	uint16_t value;
+	uint32_t duration_us;
+	uint32_t arg;
+} __ec_align4;
+
+struct ec_params_power_timeline {
+	uint32_t seq;		/**< First entry wanted */
+} __ec_align4;
+
+struct ec_response_power_timeline {
+	uint32_t seq;		/**< Sequence number of entries[0] */
+	uint32_t next_seq;	/**< Where to continue reading from */
+	uint32_t count;		/**< Entries returned */
+	struct ec_power_timeline_entry entries[0];
+} __ec_align4;
+
+/*****************************************************************************/
+/*
+ * How long the last jump between images took: getting ready to jump and
+ * running the HOOK_SYSJUMP routines in the image which jumped, then booting
+ * and running the HOOK_INIT routines in the one jumped to.  The reset itself,
+ * and the boot up to starting the clock again, can't be timed.
+ *
+ * Ask for how long each routine of one hook type took, from an index; the
+ * response has as many as fit.
+ */
+#define EC_CMD_SYSJUMP_TIMING 0x013A
+
+enum ec_sysjump_timing_type {
+	EC_SYSJUMP_TIMING_SYSJUMP = 0,
+	EC_SYSJUMP_TIMING_INIT = 1,
+};
+
+/* This image was jumped to */
+#define EC_SYSJUMP_TIMING_JUMPED BIT(0)
+/* The image which jumped timed its part: prepare_us and sysjump_us are set */
+#define EC_SYSJUMP_TIMING_PREV BIT(1)
+
+struct ec_params_sysjump_timing {
+	uint8_t type;		/**< enum ec_sysjump_timing_type */
+	uint8_t index;		/**< First routine wanted */
+} __ec_align1;
+
+struct ec_sysjump_timing_hook {
+	uint32_t routine;	/**< Address, in the image which ran it */
+	uint32_t duration_us;
+} __ec_align4;
+
+struct ec_response_sysjump_timing {
+	uint32_t prepare_us;	/**< Before HOOK_SYSJUMP, in the old image */
+	uint32_t sysjump_us;	/**< Running HOOK_SYSJUMP, in the old image */
+	uint32_t boot_us;	/**< From the clock starting to HOOK_INIT */
+	uint32_t init_us;	/**< Running HOOK_INIT */
+	uint8_t flags;		/**< EC_SYSJUMP_TIMING_* */
+	uint8_t run;		/**< Routines of the type asked for which ran */
+	uint8_t kept;		/**< And how many of them were timed */
+	uint8_t count;		/**< Routines in this response */
+	struct ec_sysjump_timing_hook hooks[0];
+} __ec_align4;
+
+/*****************************************************************************/
+/*
+ * Read the boot timeline: when the EC got through each step of booting, how
+ * long each HOOK_INIT routine took, and when each initialization put off
+ * until after boot (DECLARE_LAZY_INIT) ran, and why.
+ *
+ * Only the first entries of each boot are kept.  Ask for entries from an
+ * index; the response has as many as fit.
+ */
+#define EC_CMD_BOOT_TIMELINE 0x013B
+
+enum ec_boot_timeline_type {
+	/* A step of booting was done: id is an ec_boot_timeline_step */
+	EC_BOOT_TIMELINE_STEP = 0,
+	/*
+	 * A HOOK_INIT routine ran: arg is the routine's address, and
+	 * duration_us how long it took.
+	 */
+	EC_BOOT_TIMELINE_INIT = 1,
+	/*
+	 * A lazy initialization routine ran: id is an ec_boot_timeline_lazy,
+	 * arg the routine's address, and duration_us how long it took.
+	 */
+	EC_BOOT_TIMELINE_LAZY = 2,
+};
+
+enum ec_boot_timeline_step {
+	EC_BOOT_TIMELINE_TIMER = 0,	/* The clock started */
+	EC_BOOT_TIMELINE_UART,		/* The console works */
+	EC_BOOT_TIMELINE_KEYBOARD_SCAN,	/* The keyboard can be scanned */
+	EC_BOOT_TIMELINE_INITS_DONE,	/* About to start the tasks */
+	EC_BOOT_TIMELINE_HOOK_INIT,	/* Starting the HOOK_INIT routines */
+	EC_BOOT_TIMELINE_TASKS,		/* Done, so the other tasks can run */
+	EC_BOOT_TIMELINE_AP_STARTUP,	/* The AP was first powered on */
+	EC_BOOT_TIMELINE_STEP_COUNT,
+};
+
+enum ec_boot_timeline_lazy {
+	EC_BOOT_TIMELINE_LAZY_FIRST_USE = 0,	/* Something needed it */
+	EC_BOOT_TIMELINE_LAZY_AFTER_BOOT,	/* Booting was done */
+	EC_BOOT_TIMELINE_LAZY_AP_ON,		/* The AP was on */
+	EC_BOOT_TIMELINE_LAZY_COUNT,
+};
+
+struct ec_boot_timeline_entry {
+	uint32_t time_us;	/**< EC clock (low 32 bits) when it started */
+	uint8_t type;		/**< enum ec_boot_timeline_type */
+	uint8_t id;
+	uint16_t reserved;
+	uint32_t duration_us;
+	uint32_t arg;
+} __ec_align4;
+
+/* This image was jumped to, so the clock didn't start from 0 */
+#define EC_BOOT_TIMELINE_JUMPED BIT(0)
+
+struct ec_params_boot_timeline {
+	uint16_t index;		/**< First entry wanted */
+} __ec_align2;
+
+struct ec_response_boot_timeline {
+	uint16_t recorded;	/**< Entries this boot, whether kept or not */
+	uint16_t kept;		/**< Entries kept */
+	uint16_t count;		/**< Entries in this response */
+	uint16_t flags;		/**< EC_BOOT_TIMELINE_* */
+	struct ec_boot_timeline_entry entries[0];
+} __ec_align4;
+
 /*****************************************************************************/
 /* The command range 0x200-0x2FF is reserved for Rotor. */
 
@@ -7068,6 +7382,26 @@ struct ec_response_fp_stats {
 	int8_t template_matched;
 } __ec_align2;
 
+/* Number of templates the per-template matching times are reported for. */
+#define FP_STATS_MAX_TEMPLATES 5
+
+struct ec_response_fp_stats_v1 {
+	uint32_t capture_time_us;
+	uint32_t matching_time_us;
+	uint32_t overall_time_us;
+	struct {
+		uint32_t lo;
+		uint32_t hi;
+	} overall_t0;
+	uint8_t timestamps_invalid;
+	int8_t template_matched;
+	/* Number of templates compared with the last capture */
+	uint8_t templates_tried;
+	uint8_t reserved;
+	/* Time spent on each template by the last match, 0 if not tried */
+	uint32_t template_time_us[FP_STATS_MAX_TEMPLATES];
+} __ec_align2;
+
 #define EC_CMD_FP_SEED 0x0408
 struct ec_params_fp_seed {
 	/*
@@ -67,6 +67,20 @@ void fan_set_percent_needed(int fan, int pct);
  */
 int fan_percent_to_rpm(int fan, int pct);
 
+/**
+ * EC-side RPM control (CONFIG_FAN_RPM_CONTROL). These stand in for the
+ * chip's own RPM mode, which is left off while the EC drives the duty cycle.
+ *
+ * All take a fan number (index into fans[]), not a channel.
+ */
+void fan_rpm_control_set_mode(int fan, int rpm_mode);
+int fan_rpm_control_get_mode(int fan);
+void fan_rpm_control_set_target(int fan, int rpm);
+int fan_rpm_control_get_target(int fan);
+
+/* Has the fan failed to turn for CONFIG_FAN_RPM_CONTROL_STALL_MS? */
+int fan_rpm_control_is_stalled(int fan);
+
 
 /**
  * These functions require chip-specific implementations.
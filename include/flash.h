@@ -370,6 +370,25 @@ const char *flash_read_pstate_mac_addr(void);
  */
 int flash_write_pstate_mac_addr(const char *mac_addr);
 
+/**
+ * Complete queued host writes and erases touching a range of flash.
+ *
+ * Must be called before reading the range other than through flash_read(),
+ * e.g. straight from mapped storage, and before anything that loses RAM.
+ *
+ * @param offset	Flash offset of the range.
+ * @param size		Size of the range in bytes.
+ * @return EC_SUCCESS, or the error from writing buffered data to flash.
+ */
+#ifdef CONFIG_FLASH_WRITE_QUEUE
+int flash_queue_sync(int offset, int size);
+#else
+static inline int flash_queue_sync(int offset, int size)
+{
+	return EC_SUCCESS;
+}
+#endif /* CONFIG_FLASH_WRITE_QUEUE */
+
 /**
  * Lock or unlock HW necessary for mapped storage read.
  *
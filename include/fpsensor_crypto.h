@@ -10,11 +10,30 @@
 
 #include <stddef.h>
 
+#include "aes.h"
+#include "aes-gcm.h"
 #include "sha256.h"
 
 #define HKDF_MAX_INFO_SIZE 128
 #define HKDF_SHA256_MAX_BLOCK_COUNT 255
 
+/* Cost of the key derivations since boot. */
+struct fp_crypto_stats {
+	/* Number of keys and secrets derived */
+	uint32_t derivations;
+	/* Number of times the rollback secret had to be read for them */
+	uint32_t ikm_reads;
+	/* Total time spent deriving them */
+	uint32_t derive_time_us;
+};
+
+extern struct fp_crypto_stats fp_crypto_stats;
+
+/**
+ * Forget the template encryption keys kept for the current user context.
+ */
+void fp_clear_key_cache(void);
+
 /**
  * Expand hkdf pseudorandom key |prk| to length |out_key_size|.
  *
@@ -92,4 +111,83 @@ int aes_gcm_decrypt(const uint8_t *key, int key_size, uint8_t *plaintext,
 		    const uint8_t *nonce, int nonce_size,
 		    const uint8_t *tag, int tag_size);
 
+/* State of an AES-GCM128 operation spread over several calls. */
+struct aes_gcm_stream {
+	AES_KEY key;
+	GCM128_CONTEXT ctx;
+};
+
+/**
+ * Start an incremental AES-GCM128 operation.
+ *
+ * The data can then be fed in chunks of any size with
+ * aes_gcm_stream_encrypt() or aes_gcm_stream_decrypt(), but not both.
+ *
+ * @param stream the state to initialize.
+ * @param key the key to use in AES.
+ * @param key_size the size of |key| in bytes.
+ * @param nonce the nonce value to use in GCM128.
+ * @param nonce_size the size of |nonce| in bytes.
+ * @return EC_SUCCESS on success and error code otherwise.
+ */
+int aes_gcm_stream_init(struct aes_gcm_stream *stream, const uint8_t *key,
+			int key_size, const uint8_t *nonce, int nonce_size);
+
+/**
+ * Encrypt the next |text_size| bytes of the message.
+ *
+ * @param stream the state set up by aes_gcm_stream_init().
+ * @param plaintext the plain text to encrypt.
+ * @param ciphertext buffer to hold encryption result, may be |plaintext|.
+ * @param text_size size of both |plaintext| and output ciphertext in bytes.
+ * @return EC_SUCCESS on success and error code otherwise.
+ */
+int aes_gcm_stream_encrypt(struct aes_gcm_stream *stream,
+			   const uint8_t *plaintext, uint8_t *ciphertext,
+			   int text_size);
+
+/**
+ * Decrypt the next |text_size| bytes of the message.
+ *
+ * The plain text must not be trusted before aes_gcm_stream_check_tag()
+ * succeeds.
+ *
+ * @param stream the state set up by aes_gcm_stream_init().
+ * @param ciphertext the cipher text to decrypt.
+ * @param plaintext buffer to hold decryption result, may be |ciphertext|.
+ * @param text_size size of both |ciphertext| and output plaintext in bytes.
+ * @return EC_SUCCESS on success and error code otherwise.
+ */
+int aes_gcm_stream_decrypt(struct aes_gcm_stream *stream,
+			   const uint8_t *ciphertext, uint8_t *plaintext,
+			   int text_size);
+
+/**
+ * Compute the authenticator of everything encrypted so far.
+ *
+ * @param stream the state set up by aes_gcm_stream_init().
+ * @param tag the buffer to hold the authenticator.
+ * @param tag_size the size of |tag|.
+ */
+void aes_gcm_stream_tag(struct aes_gcm_stream *stream, uint8_t *tag,
+			int tag_size);
+
+/**
+ * Compare the authenticator of everything decrypted so far with |tag|.
+ *
+ * @param stream the state set up by aes_gcm_stream_init().
+ * @param tag the tag to compare against.
+ * @param tag_size the length of tag to compare against.
+ * @return EC_SUCCESS if the tag matches and error code otherwise.
+ */
+int aes_gcm_stream_check_tag(struct aes_gcm_stream *stream,
+			     const uint8_t *tag, int tag_size);
+
+/**
+ * Wipe the key material held by |stream|.
+ *
+ * @param stream the state to clear.
+ */
+void aes_gcm_stream_clear(struct aes_gcm_stream *stream);
+
 #endif /* __CROS_EC_FPSENSOR_CRYPTO_H */
@@ -12,6 +12,7 @@
 #include <stdint.h>
 #include "common.h"
 #include "ec_commands.h"
+#include "fpsensor_crypto.h"
 #include "link_defs.h"
 #include "timer.h"
 
@@ -44,7 +45,6 @@ extern uint8_t fp_buffer[FP_SENSOR_IMAGE_SIZE];
 /* Fingers templates for the current user */
 extern uint8_t fp_template[FP_MAX_FINGER_COUNT][FP_ALGORITHM_TEMPLATE_SIZE];
 /* Encryption/decryption buffer */
-/* TODO: On-the-fly encryption/decryption without a dedicated buffer */
 /*
  * Store the encryption metadata at the beginning of the buffer containing the
  * ciphered data.
@@ -59,6 +59,8 @@ extern int8_t template_newly_enrolled;
 extern uint32_t templ_valid;
 /* Bitmap of the templates with local modifications */
 extern uint32_t templ_dirty;
+/* Rank of the last successful match of each template, 0 if none */
+extern uint32_t templ_last_match[FP_MAX_FINGER_COUNT];
 /* Current user ID */
 extern uint32_t user_id[FP_CONTEXT_USERID_WORDS];
 /* Part of the IKM used to derive encryption keys received from the TPM. */
@@ -79,6 +81,27 @@ struct positive_match_secret_state {
 
 extern struct positive_match_secret_state positive_match_secret_state;
 
+/* Progress of the template being uploaded with EC_CMD_FP_TEMPLATE. */
+struct fp_template_upload {
+	/* Bytes of |fp_enc_buffer| received in order from offset 0. */
+	uint32_t received;
+	/* Bytes of the encrypted blob already deciphered. */
+	uint32_t deciphered;
+	/* Size of the encrypted blob, 0 until the metadata is received. */
+	uint32_t blob_size;
+	/* Chunks came out of order: decipher |fp_enc_buffer| on commit. */
+	bool buffered;
+	/* The whole blob was deciphered and its tag matched. */
+	bool authentic;
+	/*
+	 * Key schedule and GCM state, set up once the metadata is received
+	 * and wiped as soon as the blob is deciphered or the upload ends.
+	 */
+	struct aes_gcm_stream gcm;
+};
+
+extern struct fp_template_upload fp_template_upload;
+
 /* Simulation for unit tests. */
 void fp_task_simulate(void);
 
@@ -128,6 +151,28 @@ int fp_set_sensor_mode(uint32_t mode, uint32_t *mode_output);
 int fp_enable_positive_match_secret(uint32_t fgr,
 	struct positive_match_secret_state *state);
 
+/* --- Match scheduling, see fpsensor_match.c --- */
+
+/* Time spent on each template by the last match, 0 if it was not tried. */
+extern uint32_t fp_template_match_time_us[FP_MAX_FINGER_COUNT];
+/* Number of templates compared with the last capture. */
+extern uint8_t fp_templates_tried;
+
+/**
+ * Match |image| against the valid templates one at a time, most recently
+ * matched first, and stop as soon as one matches.
+ *
+ * @param image the buffer containing the finger image.
+ * @param match_index index of the matched template if any, else
+ * FP_NO_SUCH_TEMPLATE.
+ * @param update_bitmap bit set for the matched template if the matching
+ * library updated it.
+ * @return negative value on error, else the fp_finger_match() result for
+ * the last template tried.
+ */
+int fp_match_templates(uint8_t *image, int32_t *match_index,
+		       uint32_t *update_bitmap);
+
 /**
  * Disallow positive match secret for any finger to be read.
  *
@@ -258,8 +258,21 @@ struct hook_data {
 	void (*routine)(void);
 	/* Priority; low numbers = higher priority. */
 	int priority;
+#ifdef CONFIG_HOOK_CONCURRENT
+	/* Routine of the same type and priority to wait for, if any. */
+	void (*after)(void);
+	/* May run at the same time as other routines of its priority. */
+	int concurrent;
+#endif
 };
 
+/*
+ * The linker lays hook_data end to end, so they mustn't be aligned any more
+ * than the type needs; x86-64 puts objects of 32 bytes or more on 32 byte
+ * boundaries, leaving gaps.
+ */
+#define __hook_aligned __aligned(__alignof__(struct hook_data))
+
 /**
  * Call all the hook routines of a specified type.
  *
@@ -331,10 +344,36 @@ int hook_call_deferred(const struct deferred_data *data, int us);
  */
 #define DECLARE_HOOK(hooktype, routine, priority)			\
 	const struct hook_data __keep __no_sanitize_address		\
-	CONCAT4(__hook_, hooktype, _, routine)				\
+	__hook_aligned CONCAT4(__hook_, hooktype, _, routine)		\
 	__attribute__((section(".rodata." STRINGIFY(hooktype))))	\
 	     = {routine, priority}
 
+/**
+ * Register a hook routine that may run alongside the others of its priority.
+ *
+ * With CONFIG_HOOK_CONCURRENT, CHIPSET_* hook routines declared this way are
+ * run on whichever of the notifying task and the hook worker tasks is free,
+ * rather than one after another, so routines that spend their time waiting
+ * on slow buses overlap.  They must not touch anything other routines of the
+ * same priority use, except through a mutex.  Routines of other hook types,
+ * or without CONFIG_HOOK_CONCURRENT, are run as if declared by
+ * DECLARE_HOOK().
+ *
+ * @param hooktype	Type of hook for routine (enum hook_type)
+ * @param routine	Hook routine, with prototype void routine(void)
+ * @param priority      Priority, as for DECLARE_HOOK(); all routines of a
+ *			higher priority are done before this one starts.
+ * @param after		Routine of the same type and priority that must be
+ *			done before this one starts, or NULL.
+ */
+#ifdef CONFIG_HOOK_CONCURRENT
+#define DECLARE_CONCURRENT_HOOK(hooktype, routine, priority, after)	\
+	const struct hook_data __keep __no_sanitize_address		\
+	__hook_aligned CONCAT4(__hook_, hooktype, _, routine)		\
+	__attribute__((section(".rodata." STRINGIFY(hooktype))))	\
+	     = {routine, priority, after, 1}
+#endif
+
 /**
  * Register a deferred function call.
  *
@@ -371,4 +410,91 @@ int hook_call_deferred(const struct deferred_data *data, int us);
 	void CONCAT2(unused_deferred_, func)(void) { func(); }
 #endif
 
+#ifndef DECLARE_CONCURRENT_HOOK
+#define DECLARE_CONCURRENT_HOOK(hooktype, routine, priority, after)	\
+	DECLARE_HOOK(hooktype, routine, priority)
+#endif
+
+/* When initialization declared with DECLARE_LAZY_INIT() is run, at latest */
+enum lazy_init_when {
+	/* Once HOOK_INIT is done and the other tasks have had a chance to run */
+	LAZY_INIT_AFTER_BOOT,
+	/* At HOOK_CHIPSET_STARTUP, or once booting is done if the AP is on */
+	LAZY_INIT_AP_ON,
+};
+
+struct lazy_init_data {
+	/* Initialization routine. */
+	void (*routine)(void);
+	/* Priority; low numbers = higher priority. */
+	int priority;
+	enum lazy_init_when when;
+	/* Routine has been run. */
+	int done;
+	/* Asked for from interrupt context, so to be run soon. */
+	int wanted;
+	/* Next routine waiting to be run, in priority order. */
+	struct lazy_init_data *next;
+};
+
+#ifdef CONFIG_LAZY_INIT
+/**
+ * Add a lazy initialization routine to those waiting to be run.  Used by
+ * DECLARE_LAZY_INIT().
+ */
+void lazy_init_register(struct lazy_init_data *data);
+
+/**
+ * Run a lazy initialization routine now, unless it's been run already.  Used
+ * by lazy_init().
+ *
+ * @return 1 if the routine has run, 0 if called from interrupt context and it
+ * hasn't yet.
+ */
+int lazy_init_run(struct lazy_init_data *data);
+
+/**
+ * Declare initialization that can wait until after boot.
+ *
+ * Without CONFIG_LAZY_INIT, the routine is a HOOK_INIT routine.  With it, the
+ * routine is run once, by whichever comes first of: something calling
+ * lazy_init() for it, booting being done, or the AP powering on if when is
+ * LAZY_INIT_AP_ON.  Routines run at the same time are run in priority order.
+ *
+ * The routine may run in the hook task, the chipset task or whichever task
+ * calls lazy_init(), so it mustn't assume which.
+ *
+ * @param routine	Initialization routine, with prototype void routine(void)
+ * @param priority	Priority, as for DECLARE_HOOK(HOOK_INIT, ...)
+ * @param when		When to run it, at latest (enum lazy_init_when)
+ */
+#define DECLARE_LAZY_INIT(routine, priority, when)			\
+	static struct lazy_init_data CONCAT2(routine, _lazy_init) =	\
+		{ routine, priority, when };				\
+	static void CONCAT2(routine, _lazy_register)(void)		\
+	{								\
+		lazy_init_register(&CONCAT2(routine, _lazy_init));	\
+	}								\
+	DECLARE_HOOK(HOOK_INIT, CONCAT2(routine, _lazy_register),	\
+		     HOOK_PRIO_FIRST)
+
+/**
+ * Make sure a routine declared by DECLARE_LAZY_INIT() has been run, before
+ * using what it initializes.  Runs it if not, and waits for it if another
+ * task is running it.  From interrupt context it can't, so it only asks for
+ * the routine to be run soon in the hook task; callers which may be called
+ * from interrupt context need to check and defer their own work if it hasn't
+ * run yet.
+ *
+ * @param routine	Initialization routine
+ * @return 1 if the routine has run, 0 if not yet.
+ */
+#define lazy_init(routine) lazy_init_run(&CONCAT2(routine, _lazy_init))
+#else
+#define DECLARE_LAZY_INIT(routine, priority, when)			\
+	DECLARE_HOOK(HOOK_INIT, routine, priority)
+static inline int lazy_init_done(void) { return 1; }
+#define lazy_init(routine) lazy_init_done()
+#endif
+
 #endif  /* __CROS_EC_HOOKS_H */
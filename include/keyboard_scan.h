@@ -135,4 +135,14 @@ void set_vol_up_key(uint8_t row, uint8_t col);
 static inline void set_vol_up_key(uint8_t row, uint8_t col) {}
 #endif
 
+#ifdef TEST_BUILD
+/**
+ * Check whether a key matrix state has ghosting.  Exported for tests.
+ *
+ * @param state		Key matrix state, one byte per column
+ * @return 1 if keys may be ghosting, 0 if not
+ */
+int has_ghosting(const uint8_t *state);
+#endif
+
 #endif  /* __CROS_EC_KEYBOARD_SCAN_H */
@@ -22,6 +22,10 @@ struct mock_ctrl_fp_sensor {
 	int fp_sensor_acquire_image_return;
 	int fp_sensor_acquire_image_with_mode_return;
 	int fp_finger_match_return;
+	/* When set, only this template matches, the others return MATCH_NO. */
+	const void *fp_finger_match_template;
+	/* Number of templates compared by fp_finger_match(). */
+	int fp_finger_match_templates_tried;
 	int fp_enrollment_begin_return;
 	int fp_enrollment_finish_return;
 	int fp_finger_enroll_return;
@@ -37,6 +41,8 @@ struct mock_ctrl_fp_sensor {
 	.fp_sensor_acquire_image_return              = 0,              \
 	.fp_sensor_acquire_image_with_mode_return    = 0,              \
 	.fp_finger_match_return    = EC_MKBP_FP_ERR_MATCH_YES_UPDATED, \
+	.fp_finger_match_template                    = NULL,           \
+	.fp_finger_match_templates_tried             = 0,              \
 	.fp_enrollment_begin_return                  = 0,              \
 	.fp_enrollment_finish_return                 = 0,              \
 	.fp_finger_enroll_return   = EC_MKBP_FP_ERR_ENROLL_OK,         \
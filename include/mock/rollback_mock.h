@@ -13,13 +13,21 @@
 
 #include <stdbool.h>
 
+#include <stdint.h>
+
 struct mock_ctrl_rollback {
 	bool get_secret_fail;
+	/* Number of times rollback_get_secret() was called. */
+	int get_secret_calls;
+	/* Returned by rollback_get_update_count(). */
+	uint32_t update_count;
 };
 
 #define MOCK_CTRL_DEFAULT_ROLLBACK             \
 (struct mock_ctrl_rollback) {                  \
 	.get_secret_fail = false,              \
+	.get_secret_calls = 0,                 \
+	.update_count = 0,                     \
 }
 
 extern struct mock_ctrl_rollback mock_ctrl_rollback;
@@ -33,9 +33,10 @@ struct ocpc_data {
 	int last_error;
 	int integral;
 	int last_vsys;
-#ifdef HAS_TASK_PD_C1
+	int drive_frac; /* Fraction of a mV of drive carried over */
+#if defined(HAS_TASK_PD_C1) || defined(CONFIG_OCPC)
 	uint32_t chg_flags[CONFIG_USB_PD_PORT_MAX_COUNT];
-#endif /* HAS_TASK_PD_C1 */
+#endif
 };
 
 #define OCPC_NO_ISYS_MEAS_CAP	BIT(0)
@@ -0,0 +1,64 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Power sequencing timeline */
+
+#ifndef __CROS_EC_POWER_TIMELINE_H
+#define __CROS_EC_POWER_TIMELINE_H
+
+#include "common.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "power.h"
+#include "timer.h"
+
+#ifdef CONFIG_POWER_TIMELINE
+
+/**
+ * Record a power signal edge.  Safe to call from interrupt context.
+ *
+ * @param signal	GPIO of the power signal which changed
+ */
+void power_timeline_signal(enum gpio_signal signal);
+
+/**
+ * Record a move of the power state machine.
+ *
+ * @param state		New state
+ */
+void power_timeline_state(enum power_state state);
+
+/**
+ * Record how long the chipset waited for power signals.
+ *
+ * @param want		Mask of signals it wanted
+ * @param start		When it started waiting
+ * @param timed_out	Whether it gave up
+ */
+void power_timeline_wait(uint32_t want, timestamp_t start, int timed_out);
+
+/**
+ * Record how long a hook routine took, if it's one of the CHIPSET_* hooks.
+ *
+ * @param type		Hook type
+ * @param routine	Hook routine
+ * @param start		When the routine was called
+ */
+void power_timeline_hook(enum hook_type type, void (*routine)(void),
+			 timestamp_t start);
+
+#else
+
+static inline void power_timeline_signal(enum gpio_signal signal) { }
+static inline void power_timeline_state(enum power_state state) { }
+static inline void power_timeline_wait(uint32_t want, timestamp_t start,
+				       int timed_out) { }
+static inline void power_timeline_hook(enum hook_type type,
+				       void (*routine)(void),
+				       timestamp_t start) { }
+
+#endif /* CONFIG_POWER_TIMELINE */
+
+#endif /* __CROS_EC_POWER_TIMELINE_H */
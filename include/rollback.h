@@ -30,6 +30,15 @@ int rollback_get_minimum_version(void);
  */
 int rollback_get_secret(uint8_t *secret);
 
+/**
+ * Get the number of times the rollback block was rewritten since boot.
+ *
+ * Lets callers keeping a copy of the secret notice that it went stale.
+ *
+ * @return the number of successful rollback block updates.
+ */
+uint32_t rollback_get_update_count(void);
+
 /**
  * Update rollback protection block to the version passed as parameter.
  *
@@ -63,6 +63,15 @@ int rsa_verify(const struct rsa_public_key *key,
 	       const uint8_t *sha,
 	       uint32_t *workbuf32);
 
+/*
+ * Check the PKCS#1 padding of @signature and copy the SHA-256 digest it
+ * signs into @sha, without needing the signed content.
+ */
+int rsa_recover_digest(const struct rsa_public_key *key,
+		       const uint8_t *signature,
+		       uint8_t *sha,
+		       uint32_t *workbuf32);
+
 #endif /* !__ASSEMBLER__ */
 
 #endif /* __CROS_EC_RSA_H */
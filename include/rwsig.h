@@ -10,6 +10,23 @@
 #include "rsa.h"
 
 #ifndef __ASSEMBLER__
+/* Time spent in each phase of the last RW signature check */
+struct rwsig_timing {
+	/* Signature exponentiation and PKCS#1 padding check */
+	uint32_t rsa_us;
+	/* Checking that unsigned RW space is erased */
+	uint32_t padding_us;
+	/* SHA-256 of the signed part of RW */
+	uint32_t hash_us;
+	/* Whole check, including key and signature header validation */
+	uint32_t total_us;
+	/* Number of bytes hashed; 0 if rejected before hashing */
+	uint32_t hash_bytes;
+};
+
+/* Returns the phase timings of the last RW signature check. */
+const struct rwsig_timing *rwsig_get_timing(void);
+
 #ifdef HAS_TASK_RWSIG
 /* The functions below only make sense if RWSIG task is defined. */
 
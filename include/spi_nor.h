@@ -54,6 +54,12 @@ struct spi_nor_device_t {
 	uint32_t capacity;
 	size_t page_size;
 	int in_4b_addressing_mode;
+
+	/* Read opcode and the number of dummy Bytes sent after the address.
+	 * Zero selects the slow read opcode, which needs no dummy Bytes;
+	 * CONFIG_SPI_NOR_FAST_READ selects the Fast Read opcode. */
+	uint8_t read_opcode;
+	uint8_t read_dummy_bytes;
 };
 
 extern struct spi_nor_device_t spi_nor_devices[];
@@ -97,7 +103,8 @@ extern const unsigned int spi_nor_devices_used;
  * will check if the part has a compatible SFDP Basic Flash Parameter table
  * and update the part's page_size, capacity, and forces the addressing mode.
  * Parts with more than 16MiB of capacity are initialized into 4B addressing
- * and parts with less are initialized into 3B addressing mode.
+ * and parts with less are initialized into 3B addressing mode. With
+ * CONFIG_SPI_NOR_FAST_READ, parts are read through the Fast Read opcode.
  *
  * WARNING: This must successfully return before invoking any other Serial NOR
  * Flash APIs.
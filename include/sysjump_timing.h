@@ -0,0 +1,55 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Timing of jumps between images */
+
+#ifndef __CROS_EC_SYSJUMP_TIMING_H
+#define __CROS_EC_SYSJUMP_TIMING_H
+
+#include "common.h"
+#include "hooks.h"
+#include "timer.h"
+
+#ifdef CONFIG_SYSJUMP_TIMING
+
+/**
+ * Record that this image has started getting ready to jump to another.
+ */
+void sysjump_timing_start(void);
+
+/**
+ * Record that it's about to run the HOOK_SYSJUMP routines.
+ */
+void sysjump_timing_hooks_start(void);
+
+/**
+ * Hand how long the jump has taken so far to the image being jumped to.
+ * Called once the HOOK_SYSJUMP routines have run.
+ */
+void sysjump_timing_preserve(void);
+
+/**
+ * Record how long a hook routine took, if it's a HOOK_SYSJUMP routine, or a
+ * HOOK_INIT routine after a jump.
+ *
+ * @param type		Hook type
+ * @param routine	Hook routine
+ * @param start		When the routine was called
+ */
+void sysjump_timing_hook(enum hook_type type, void (*routine)(void),
+			 timestamp_t start);
+
+#else
+
+static inline void sysjump_timing_start(void) { }
+static inline void sysjump_timing_hooks_start(void) { }
+static inline void sysjump_timing_preserve(void) { }
+static inline void sysjump_timing_hook(enum hook_type type,
+				       void (*routine)(void),
+				       timestamp_t start) { }
+
+#endif /* CONFIG_SYSJUMP_TIMING */
+
+#endif /* __CROS_EC_SYSJUMP_TIMING_H */
@@ -188,6 +188,50 @@ int system_add_jump_tag(uint16_t tag, int version, int size, const void *data);
  */
 const uint8_t *system_get_jump_tag(uint16_t tag, int *version, int *size);
 
+/*
+ * Jump tags with a fixed slot.  Their tags are found once, when the image
+ * starts, rather than searched for by each module restoring its state.  They
+ * keep the tag IDs they've always had, so an image which only knows
+ * system_get_jump_tag() can still find them.
+ */
+enum jump_tag_slot {
+	JUMP_TAG_TIMER,
+	JUMP_TAG_KEYBOARD,
+	JUMP_TAG_LIGHTBAR,
+	JUMP_TAG_FAN,
+	JUMP_TAG_VBOOT_HASH,
+	JUMP_TAG_USB_PORT,
+	JUMP_TAG_SYSJUMP_TIMING,
+	JUMP_TAG_SLOT_COUNT
+};
+
+/**
+ * Preserve data across a jump between images, in a jump tag slot.
+ *
+ * This may ONLY be called from within a HOOK_SYSJUMP handler.
+ *
+ * @param slot		Jump tag slot
+ * @param version	Data version
+ * @param size		Size of data; must be less than 255 bytes.
+ * @param data		Pointer to data to save
+ * @return EC_SUCCESS, or non-zero if error.
+ */
+int system_add_jump_slot(enum jump_tag_slot slot, int version, int size,
+			 const void *data);
+
+/**
+ * Retrieve data preserved in a jump tag slot by the previous image.
+ *
+ * @param slot		Jump tag slot
+ * @param version	Data version expected
+ * @param size		Size of data expected
+ * @return		A pointer to the data, or NULL if there isn't any, or
+ *			it isn't the version and size expected.  This pointer
+ *			will be 32-bit aligned.
+ */
+const void *system_get_jump_slot(enum jump_tag_slot slot, int version,
+				 int size);
+
 /**
  * Return the address just past the last usable byte in RAM.
  */
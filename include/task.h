@@ -211,6 +211,43 @@ void task_print_list(void);
  */
 const char *task_get_name(task_id_t tskid);
 
+#ifdef CONFIG_TASK_STATS
+/* Scheduling statistics of a task, see CONFIG_TASK_STATS */
+struct task_stats {
+	/* Time spent running the task, excluding interrupts */
+	uint64_t run_time_us;
+	/* Time spent in interrupts taken while the task was running */
+	uint64_t isr_time_us;
+	/* Number of returns from task_wait_event() */
+	uint32_t wakeups;
+	/* Longest delay from task_set_event() to the task running */
+	uint32_t max_latency_us;
+	/*
+	 * Deepest stack seen when the task woke up, in bytes. Only sampled
+	 * at wakeups, so deeper calls in between are missed.
+	 */
+	uint32_t stack_used;
+	/* Stack size in bytes, 0 if the core doesn't bound task stacks */
+	uint32_t stack_size;
+	/* Number of wakeups which returned each TASK_EVENT_* bit */
+	uint32_t event_wakeups[32];
+};
+
+/**
+ * Get the scheduling statistics of a task.
+ *
+ * @param tskid		Task to report on
+ * @param stats		Filled with the statistics gathered since boot or
+ *			the last task_reset_stats()
+ */
+void task_get_stats(task_id_t tskid, struct task_stats *stats);
+
+/**
+ * Clear the scheduling statistics of a task.
+ */
+void task_reset_stats(task_id_t tskid);
+#endif
+
 #ifdef CONFIG_TASK_PROFILING
 /**
  * Start tracking an interrupt.
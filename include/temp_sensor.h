@@ -33,7 +33,11 @@ struct temp_sensor_t {
 	const char *name;
 	/* Temperature sensor type. */
 	enum temp_sensor_type type;
-	/* Read sensor value in K into temp_ptr; return non-zero if error. */
+	/*
+	 * Read sensor value in K into temp_ptr; return non-zero if error.
+	 * Drivers which only measure on HOOK_SECOND return that reading, which
+	 * CONFIG_THERMAL_FAST_SAMPLE_MS can't make any fresher.
+	 */
 	int (*read)(int idx, int *temp_ptr);
 	/* Index among the same kind of sensors. */
 	int idx;
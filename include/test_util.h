@@ -22,6 +22,8 @@
 
 #define RUN_TEST(n) \
 	do { \
+		if (!test_shard_next()) \
+			break; \
 		ccprintf("Running %s...\n", #n); \
 		cflush(); \
 		before_test(); \
@@ -191,12 +193,32 @@ void task_trigger_test_interrupt(void (*isr)(void));
  */
 void interrupt_generator_udelay(unsigned us);
 
+/*
+ * Skip the emulator clock over a udelay() if no interrupt generator could
+ * fire during it. Returns non-zero if the delay was skipped.
+ */
+int emulator_skip_udelay(unsigned us);
+
+/*
+ * Get how much virtual time the emulator skipped because every task was
+ * waiting or delaying, and in how many jumps.
+ */
+void emulator_get_time_stats(uint64_t *skipped_us, uint32_t *skips);
+
 #ifdef EMU_BUILD
 void wait_for_task_started(void);
 void wait_for_task_started_nosleep(void);
+
+/*
+ * Returns non-zero if the next RUN_TEST() belongs to the shard selected with
+ * TEST_SHARD=<index>/<count> in the environment. Without it, every test
+ * belongs to the only shard.
+ */
+int test_shard_next(void);
 #else
 static inline void wait_for_task_started(void) { }
 static inline void wait_for_task_started_nosleep(void) { }
+static inline int test_shard_next(void) { return 1; }
 #endif
 
 uint32_t prng(uint32_t seed);
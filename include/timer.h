@@ -18,6 +18,9 @@
 #define MINUTE   60000000
 #define HOUR   3600000000ull  /* Too big to fit in a signed int */
 
+/* Version of the time preserved across a sysjump, in JUMP_TAG_TIMER */
+#define TIMER_SYSJUMP_VERSION 1
+
 /* Microsecond timestamp. */
 typedef union {
 	uint64_t val;
@@ -377,6 +377,27 @@ int uart_console_read_buffer(uint8_t type,
 			     uint16_t dest_size,
 			     uint16_t *write_count);
 
+/**
+ * Read console output by sequence number.
+ *
+ * Every byte of console output is numbered, starting from 0 at boot. This
+ * copies the bytes from `seq` onwards that are still in the uart buffer, so
+ * that a caller can keep reading from where it left off without snapshots.
+ * If some of them have been overwritten already, it starts from the oldest
+ * byte that hasn't.
+ *
+ * @param seq		sequence number of the first byte wanted.
+ * @param dest		output buffer; not null-terminated.
+ * @param size		size of output buffer.
+ * @param first		returns the sequence number of dest[0].
+ * @param head		returns the sequence number of the next byte that
+ *			will be written.
+ *
+ * @return number of bytes copied to dest
+ */
+int uart_console_read_seq(uint32_t seq, char *dest, int size,
+			  uint32_t *first, uint32_t *head);
+
 /**
  * Initialize tx buffer head and tail
  */
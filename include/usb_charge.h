@@ -26,7 +26,6 @@
  */
 #define USB_CHARGER_MAX_CURR_MA 1500
 
-#define USB_SYSJUMP_TAG 0x5550 /* "UP" - Usb Port */
 #define USB_HOOK_VERSION 1
 
 #ifdef CONFIG_USB_PORT_POWER_SMART
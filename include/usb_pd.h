@@ -229,6 +229,7 @@ enum pd_rx_errors {
 #define PD_T_BIST_TRANSMIT          (50*MSEC) /* 50ms (for task_wait arg) */
 #define PD_T_BIST_RECEIVE           (60*MSEC) /* 60ms (time to process bist) */
 #define PD_T_BIST_CONT_MODE         (60*MSEC) /* 30ms to 60ms */
+#define PD_T_RECEIVE_MAX_US          (1100)   /* between 0.9ms and 1.1ms */
 #define PD_T_VCONN_SOURCE_ON       (100*MSEC) /* 100ms */
 #define PD_T_DRP_TRY               (125*MSEC) /* between 75ms and 150ms */
 #define PD_T_TRY_TIMEOUT           (550*MSEC) /* between 550ms and 1100ms */
@@ -2449,6 +2450,21 @@ int pd_write_preamble(int port);
  */
 int pd_write_sym(int port, int bit_off, uint32_t val10);
 
+/**
+ * Write two 10-period symbols in the TX packet, corresponding to
+ * one byte with 4b5b encoding and Biphase Mark Coding.
+ *
+ * The second symbol (bits 10-19) is already inverted if the first one
+ * ends on a high level, so the whole value only needs to be adjusted
+ * for the level at the end of the previous symbol.
+ *
+ * @param port USB-C port number
+ * @param bit_off current position in the packet buffer.
+ * @param val20    the 20-bit integer.
+ * @return new position in the packet buffer.
+ */
+int pd_write_byte(int port, int bit_off, uint32_t val20);
+
 
 /**
  * Ensure that we have an edge after EOP and we end up at level 0,
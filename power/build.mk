@@ -26,4 +26,5 @@ power-$(CONFIG_CHIPSET_SDM845)+=sdm845.o
 power-$(CONFIG_CHIPSET_SKYLAKE)+=skylake.o intel_x86.o
 power-$(CONFIG_CHIPSET_STONEY)+=amd_x86.o
 power-$(CONFIG_POWER_COMMON)+=common.o
+power-$(CONFIG_POWER_TIMELINE)+=timeline.o
 power-$(CONFIG_POWER_TRACK_HOST_SLEEP_STATE)+=host_sleep.o
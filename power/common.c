@@ -19,6 +19,7 @@
 #include "lpc.h"
 #include "power.h"
 #include "power/intel_x86.h"
+#include "power_timeline.h"
 #include "system.h"
 #include "task.h"
 #include "timer.h"
@@ -206,13 +207,17 @@ int power_wait_signals_timeout(uint32_t want, int timeout)
 
 int power_wait_mask_signals_timeout(uint32_t want, uint32_t mask, int timeout)
 {
+	timestamp_t start;
+
 	in_want = want;
 	if (!mask)
 		return EC_SUCCESS;
 
+	start = get_time();
 	while ((in_signals & mask) != in_want) {
 		if (task_wait_event(timeout) == TASK_EVENT_TIMER) {
 			power_update_signals();
+			power_timeline_wait(want, start, 1);
 			return EC_ERROR_TIMEOUT;
 		}
 		/*
@@ -222,6 +227,7 @@ int power_wait_mask_signals_timeout(uint32_t want, uint32_t mask, int timeout)
 		 * longer in the same state we were when we started waiting.
 		 */
 	}
+	power_timeline_wait(want, start, 0);
 	return EC_SUCCESS;
 }
 
@@ -235,6 +241,7 @@ void power_set_state(enum power_state new_state)
 	print_system_rtc(CC_CHIPSET);
 
 	state = new_state;
+	power_timeline_state(state);
 
 	/*
 	 * Reset want_g3_exit flag here to prevent the situation that if the
@@ -851,6 +858,7 @@ void power_signal_interrupt(enum gpio_signal signal)
 #endif
 
 	SIGLOG(signal);
+	power_timeline_signal(signal);
 
 	/* Shadow signals and compare with our desired signal state. */
 	power_update_signals();
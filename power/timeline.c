@@ -0,0 +1,224 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Power sequencing timeline */
+
+#include "atomic.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "power.h"
+#include "power_timeline.h"
+#include "timer.h"
+#include "util.h"
+
+#define TIMELINE_ENTRIES CONFIG_POWER_TIMELINE_ENTRIES
+BUILD_ASSERT(POWER_OF_TWO(TIMELINE_ENTRIES));
+
+static struct ec_power_timeline_entry timeline[TIMELINE_ENTRIES];
+
+/* Sequence number of the next entry, which is also how many there have been */
+static atomic_t timeline_seq;
+
+static const char * const state_names[] = {
+	[EC_POWER_TIMELINE_G3] = "G3",
+	[EC_POWER_TIMELINE_S5] = "S5",
+	[EC_POWER_TIMELINE_S3] = "S3",
+	[EC_POWER_TIMELINE_S0] = "S0",
+	[EC_POWER_TIMELINE_S0IX] = "S0ix",
+	[EC_POWER_TIMELINE_G3S5] = "G3->S5",
+	[EC_POWER_TIMELINE_S5S3] = "S5->S3",
+	[EC_POWER_TIMELINE_S3S0] = "S3->S0",
+	[EC_POWER_TIMELINE_S0S3] = "S0->S3",
+	[EC_POWER_TIMELINE_S3S5] = "S3->S5",
+	[EC_POWER_TIMELINE_S5G3] = "S5->G3",
+	[EC_POWER_TIMELINE_S0IXS0] = "S0ix->S0",
+	[EC_POWER_TIMELINE_S0S0IX] = "S0->S0ix",
+};
+BUILD_ASSERT(ARRAY_SIZE(state_names) == EC_POWER_TIMELINE_STATE_COUNT);
+
+static const char * const hook_names[] = {
+	[EC_POWER_TIMELINE_HOOK_PRE_INIT] = "PRE_INIT",
+	[EC_POWER_TIMELINE_HOOK_STARTUP] = "STARTUP",
+	[EC_POWER_TIMELINE_HOOK_RESUME] = "RESUME",
+	[EC_POWER_TIMELINE_HOOK_SUSPEND] = "SUSPEND",
+	[EC_POWER_TIMELINE_HOOK_RESUME_INIT] = "RESUME_INIT",
+	[EC_POWER_TIMELINE_HOOK_SUSPEND_COMPLETE] = "SUSPEND_COMPLETE",
+	[EC_POWER_TIMELINE_HOOK_SHUTDOWN] = "SHUTDOWN",
+	[EC_POWER_TIMELINE_HOOK_SHUTDOWN_COMPLETE] = "SHUTDOWN_COMPLETE",
+	[EC_POWER_TIMELINE_HOOK_RESET] = "RESET",
+};
+BUILD_ASSERT(ARRAY_SIZE(hook_names) == EC_POWER_TIMELINE_HOOK_COUNT);
+
+static void timeline_add(enum ec_power_timeline_type type, int id, int value,
+			 timestamp_t start, uint32_t arg)
+{
+	uint32_t seq = atomic_add(&timeline_seq, 1);
+	struct ec_power_timeline_entry *e =
+		timeline + (seq & (TIMELINE_ENTRIES - 1));
+
+	e->time_us = start.le.lo;
+	e->type = type;
+	e->id = id;
+	e->value = value;
+	e->duration_us = get_time().val - start.val;
+	e->arg = arg;
+}
+
+void power_timeline_signal(enum gpio_signal signal)
+{
+	int i;
+
+	for (i = 0; i < POWER_SIGNAL_COUNT; i++) {
+		if (power_signal_list[i].gpio == signal) {
+			timeline_add(EC_POWER_TIMELINE_SIGNAL, i,
+				     power_signal_get_level(signal),
+				     get_time(), 0);
+			return;
+		}
+	}
+}
+
+void power_timeline_state(enum power_state state)
+{
+	int id = state;
+
+	/* The timeline always numbers the S0ix states, to be decodable. */
+	if (!IS_ENABLED(CONFIG_POWER_S0IX) && state > POWER_S0)
+		id++;
+
+	timeline_add(EC_POWER_TIMELINE_STATE, id, 0, get_time(), 0);
+}
+
+void power_timeline_wait(uint32_t want, timestamp_t start, int timed_out)
+{
+	timeline_add(EC_POWER_TIMELINE_WAIT, 0, timed_out, start, want);
+}
+
+void power_timeline_hook(enum hook_type type, void (*routine)(void),
+			 timestamp_t start)
+{
+	int id;
+
+	switch (type) {
+	case HOOK_CHIPSET_PRE_INIT:
+		id = EC_POWER_TIMELINE_HOOK_PRE_INIT;
+		break;
+	case HOOK_CHIPSET_STARTUP:
+		id = EC_POWER_TIMELINE_HOOK_STARTUP;
+		break;
+	case HOOK_CHIPSET_RESUME:
+		id = EC_POWER_TIMELINE_HOOK_RESUME;
+		break;
+	case HOOK_CHIPSET_SUSPEND:
+		id = EC_POWER_TIMELINE_HOOK_SUSPEND;
+		break;
+#ifdef CONFIG_CHIPSET_RESUME_INIT_HOOK
+	case HOOK_CHIPSET_RESUME_INIT:
+		id = EC_POWER_TIMELINE_HOOK_RESUME_INIT;
+		break;
+	case HOOK_CHIPSET_SUSPEND_COMPLETE:
+		id = EC_POWER_TIMELINE_HOOK_SUSPEND_COMPLETE;
+		break;
+#endif
+	case HOOK_CHIPSET_SHUTDOWN:
+		id = EC_POWER_TIMELINE_HOOK_SHUTDOWN;
+		break;
+	case HOOK_CHIPSET_SHUTDOWN_COMPLETE:
+		id = EC_POWER_TIMELINE_HOOK_SHUTDOWN_COMPLETE;
+		break;
+	case HOOK_CHIPSET_RESET:
+		id = EC_POWER_TIMELINE_HOOK_RESET;
+		break;
+	default:
+		return;
+	}
+
+	timeline_add(EC_POWER_TIMELINE_HOOK, id, 0, start,
+		     (uint32_t)(uintptr_t)routine);
+}
+
+/*****************************************************************************/
+/* Host commands */
+
+static enum ec_status
+hc_power_timeline(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_power_timeline *p = args->params;
+	struct ec_response_power_timeline *r = args->response;
+	uint32_t next = timeline_seq;
+	uint32_t seq = p->seq;
+	int max = (args->response_max - sizeof(*r)) / sizeof(r->entries[0]);
+	int i;
+
+	/* Skip ahead over whatever has been overwritten since */
+	if ((int32_t)(next - seq) > TIMELINE_ENTRIES)
+		seq = next - TIMELINE_ENTRIES;
+	/* And don't go past the end, if asked for the future */
+	if ((int32_t)(next - seq) < 0)
+		seq = next;
+
+	for (i = 0; i < max && seq + i != next; i++)
+		r->entries[i] = timeline[(seq + i) & (TIMELINE_ENTRIES - 1)];
+
+	r->seq = seq;
+	r->next_seq = seq + i;
+	r->count = i;
+	args->response_size = sizeof(*r) + i * sizeof(r->entries[0]);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_POWER_TIMELINE, hc_power_timeline,
+		     EC_VER_MASK(0));
+
+/*****************************************************************************/
+/* Console commands */
+
+static int command_powertimeline(int argc, char **argv)
+{
+	const struct ec_power_timeline_entry *e;
+	uint32_t next = timeline_seq;
+	uint32_t seq = 0;
+	uint32_t last = 0;
+
+	if ((int32_t)next > TIMELINE_ENTRIES)
+		seq = next - TIMELINE_ENTRIES;
+
+	for (; seq != next; seq++) {
+		e = timeline + (seq & (TIMELINE_ENTRIES - 1));
+		ccprintf("%10u +%8u  ", e->time_us, e->time_us - last);
+		last = e->time_us;
+
+		switch (e->type) {
+		case EC_POWER_TIMELINE_SIGNAL:
+			ccprintf("%s => %d\n", e->id < POWER_SIGNAL_COUNT ?
+				 power_signal_list[e->id].name : "?",
+				 e->value);
+			break;
+		case EC_POWER_TIMELINE_STATE:
+			ccprintf("state %s\n",
+				 e->id < ARRAY_SIZE(state_names) ?
+				 state_names[e->id] : "?");
+			break;
+		case EC_POWER_TIMELINE_HOOK:
+			ccprintf("hook %s %pP took %u us\n",
+				 e->id < ARRAY_SIZE(hook_names) ?
+				 hook_names[e->id] : "?",
+				 (void *)(uintptr_t)e->arg, e->duration_us);
+			break;
+		case EC_POWER_TIMELINE_WAIT:
+			ccprintf("wait for 0x%04x %s after %u us\n", e->arg,
+				 e->value ? "timed out" : "done",
+				 e->duration_us);
+			break;
+		}
+		cflush();
+	}
+
+	return EC_SUCCESS;
+}
+DECLARE_SAFE_CONSOLE_COMMAND(powertimeline, command_powertimeline, NULL,
+			     "Print the power sequencing timeline");
@@ -26,6 +26,15 @@
 /* Temporary buffer, to avoid using too much stack space. */
 static uint8_t tmp[512];
 
+/* Roughly the size of a fingerprint template. */
+#define TEMPLATE_SIZE (5 * 1024 + 37)
+static uint8_t template_in[TEMPLATE_SIZE];
+static uint8_t template_out[TEMPLATE_SIZE];
+static uint8_t template_ref[TEMPLATE_SIZE];
+
+/* If set, the GCM tests use the multi-block CTR path. */
+static ctr128_f gcm_stream;
+
 /*
  * Do encryption, put result in |result|, and compare with |ciphertext|.
  */
@@ -47,8 +56,14 @@ static int test_aes_gcm_encrypt(uint8_t *result,
 
 	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f) AES_encrypt, 0);
 	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
-	TEST_ASSERT(CRYPTO_gcm128_encrypt(&ctx, &aes_key, plaintext, result,
-					  plaintext_size));
+	if (gcm_stream)
+		TEST_ASSERT(CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key,
+							plaintext, result,
+							plaintext_size,
+							gcm_stream));
+	else
+		TEST_ASSERT(CRYPTO_gcm128_encrypt(&ctx, &aes_key, plaintext,
+						  result, plaintext_size));
 	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, tag_size));
 	TEST_ASSERT_ARRAY_EQ(ciphertext, result, plaintext_size);
 
@@ -76,8 +91,14 @@ static int test_aes_gcm_decrypt(uint8_t *result,
 
 	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f) AES_encrypt, 0);
 	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
-	TEST_ASSERT(CRYPTO_gcm128_decrypt(&ctx, &aes_key, ciphertext, result,
-					  plaintext_size));
+	if (gcm_stream)
+		TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(&ctx, &aes_key,
+							ciphertext, result,
+							plaintext_size,
+							gcm_stream));
+	else
+		TEST_ASSERT(CRYPTO_gcm128_decrypt(&ctx, &aes_key, ciphertext,
+						  result, plaintext_size));
 	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag, tag_size));
 	TEST_ASSERT_ARRAY_EQ(plaintext, result, plaintext_size);
 
@@ -532,6 +553,178 @@ static void test_aes_gcm_speed(void)
 	ccprintf("AES-GCM duration %lld us\n", (long long)(t1.val - t0.val));
 }
 
+static int test_aes_gcm_ctr32(void)
+{
+	int rv;
+
+	/* Same known-answer vectors, through the multi-block CTR path. */
+	gcm_stream = (ctr128_f)aes_nohw_ctr32_encrypt_blocks;
+	rv = test_aes_gcm();
+	gcm_stream = NULL;
+
+	return rv;
+}
+
+static int test_aes_gcm_ctr32_template(void)
+{
+	static const uint8_t key[] = {
+		0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+		0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+	};
+	static const uint8_t nonce[] = {
+		0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+		0xde, 0xca, 0xf8, 0x88,
+	};
+	/* Uneven pieces, to go through the partial block paths */
+	static const int pieces[] = { 5, 27, 1024, 3, TEMPLATE_SIZE };
+	uint8_t tag_ref[16], tag[16];
+	static AES_KEY aes_key;
+	static GCM128_CONTEXT ctx;
+	int i, off, n;
+
+	for (i = 0; i < TEMPLATE_SIZE; i++)
+		template_in[i] = i * 7 + (i >> 8);
+
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key) == 0);
+
+	/* Reference: one block at a time */
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_encrypt(&ctx, &aes_key, template_in,
+					  template_ref, TEMPLATE_SIZE));
+	CRYPTO_gcm128_tag(&ctx, tag_ref, sizeof(tag_ref));
+
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	for (off = 0, i = 0; off < TEMPLATE_SIZE; off += n, i++) {
+		n = MIN(pieces[i], TEMPLATE_SIZE - off);
+		TEST_ASSERT(CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key,
+				template_in + off, template_out + off, n,
+				(ctr128_f)aes_nohw_ctr32_encrypt_blocks));
+	}
+	CRYPTO_gcm128_tag(&ctx, tag, sizeof(tag));
+	TEST_ASSERT_ARRAY_EQ(template_ref, template_out, TEMPLATE_SIZE);
+	TEST_ASSERT_ARRAY_EQ(tag_ref, tag, sizeof(tag));
+
+	/* Decrypt in place */
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+	TEST_ASSERT(CRYPTO_gcm128_decrypt_ctr32(&ctx, &aes_key, template_out,
+				template_out, TEMPLATE_SIZE,
+				(ctr128_f)aes_nohw_ctr32_encrypt_blocks));
+	TEST_ASSERT(CRYPTO_gcm128_finish(&ctx, tag_ref, sizeof(tag_ref)));
+	TEST_ASSERT_ARRAY_EQ(template_in, template_out, TEMPLATE_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_aes_ctr32(void)
+{
+	/* Test vectors from NIST SP 800-38A, F.5.1 CTR-AES128.Encrypt. */
+	static const uint8_t key[] = {
+		0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+		0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c,
+	};
+	static const uint8_t counter[] = {
+		0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+		0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff,
+	};
+	static const uint8_t plain[] = {
+		0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+		0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+		0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+		0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+		0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+		0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+		0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+		0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10,
+	};
+	static const uint8_t cipher[] = {
+		0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+		0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+		0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+		0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+		0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+		0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+		0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+		0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee,
+	};
+	uint8_t iv[AES_BLOCK_SIZE], block[AES_BLOCK_SIZE];
+	AES_KEY aes_key;
+	int blocks = 300;
+	int i, j;
+
+	TEST_ASSERT(AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key) == 0);
+
+	aes_nohw_ctr32_encrypt_blocks(plain, tmp, sizeof(plain) / 16,
+				      &aes_key, counter);
+	TEST_ASSERT_ARRAY_EQ(cipher, tmp, sizeof(cipher));
+
+	/*
+	 * Compare against single blocks across a 32-bit counter wrap, which
+	 * also crosses the 256-block boundaries where the first round is
+	 * recomputed.
+	 */
+	TEST_ASSERT(blocks * AES_BLOCK_SIZE <= TEMPLATE_SIZE);
+	memcpy(iv, counter, sizeof(iv));
+	iv[12] = iv[13] = iv[14] = 0xff;
+	iv[15] = 0x37;
+	memset(template_in, 0x5a, blocks * AES_BLOCK_SIZE);
+	aes_nohw_ctr32_encrypt_blocks(template_in, template_out, blocks,
+				      &aes_key, iv);
+
+	for (i = 0; i < blocks; i++) {
+		AES_encrypt(iv, block, &aes_key);
+		for (j = 0; j < AES_BLOCK_SIZE; j++)
+			block[j] ^= 0x5a;
+		TEST_ASSERT_ARRAY_EQ(block, template_out + i * AES_BLOCK_SIZE,
+				     AES_BLOCK_SIZE);
+		/* Increment the 32-bit counter, without carry into the IV */
+		for (j = 15; j >= 12 && !++iv[j]; j--)
+			;
+	}
+
+	return EC_SUCCESS;
+}
+
+static void test_aes_gcm_template_speed(void)
+{
+	static const uint8_t key[16] = { 0 };
+	static const uint8_t nonce[12] = { 0 };
+	static AES_KEY aes_key;
+	static GCM128_CONTEXT ctx;
+	timestamp_t t0, t1, t2;
+	uint8_t tag[16];
+	int i;
+
+	AES_set_encrypt_key(key, 8 * sizeof(key), &aes_key);
+
+	t0 = get_time();
+	for (i = 0; i < 10; i++) {
+		CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+		CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+		CRYPTO_gcm128_encrypt(&ctx, &aes_key, template_in, template_out,
+				      TEMPLATE_SIZE);
+		CRYPTO_gcm128_tag(&ctx, tag, sizeof(tag));
+	}
+	t1 = get_time();
+	for (i = 0; i < 10; i++) {
+		CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+		CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, sizeof(nonce));
+		CRYPTO_gcm128_encrypt_ctr32(&ctx, &aes_key, template_in,
+				template_out, TEMPLATE_SIZE,
+				(ctr128_f)aes_nohw_ctr32_encrypt_blocks);
+		CRYPTO_gcm128_tag(&ctx, tag, sizeof(tag));
+	}
+	t2 = get_time();
+	ccprintf("AES-GCM %d byte template: block %lld us, ctr32 %lld us\n",
+		 TEMPLATE_SIZE, (long long)(t1.val - t0.val) / 10,
+		 (long long)(t2.val - t1.val) / 10);
+	if (t2.val > t1.val)
+		ccprintf("AES-GCM ctr32 %lld bytes/s\n",
+			 10LL * TEMPLATE_SIZE * SECOND / (t2.val - t1.val));
+}
+
 static int test_aes_raw(const uint8_t *key, int key_size,
 			const uint8_t *plaintext, const uint8_t *ciphertext)
 {
@@ -660,5 +853,13 @@ void run_test(int argc, char **argv)
 	watchdog_reload();
 	RUN_TEST(test_aes_gcm);
 
+	watchdog_reload();
+	RUN_TEST(test_aes_ctr32);
+	RUN_TEST(test_aes_gcm_ctr32);
+	RUN_TEST(test_aes_gcm_ctr32_template);
+
+	/* do not check result, just as a benchmark */
+	test_aes_gcm_template_speed();
+
 	test_print_result();
 }
@@ -0,0 +1,388 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the boot timeline and putting initialization off until after boot.
+ */
+
+#include "chipset.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define KEYBOARD_INIT_US (2 * MSEC)
+#define TABLES_INIT_US (10 * MSEC)
+#define SENSOR_INIT_US (20 * MSEC)
+
+/* Order the lazy routines ran in */
+static void (*ran[8])(void);
+static int ran_count;
+
+static void record_run(void (*routine)(void))
+{
+	if (ran_count < (int)ARRAY_SIZE(ran))
+		ran[ran_count] = routine;
+	ran_count++;
+}
+
+static int times_run(void (*routine)(void))
+{
+	int i, n = 0;
+
+	for (i = 0; i < MIN(ran_count, (int)ARRAY_SIZE(ran)); i++)
+		n += ran[i] == routine;
+	return n;
+}
+
+/* Has to be ready for the keyboard, so quick, and done at boot */
+static void keyboard_init(void)
+{
+	udelay(KEYBOARD_INIT_US);
+}
+DECLARE_HOOK(HOOK_INIT, keyboard_init, HOOK_PRIO_DEFAULT);
+
+/* Slow, but nothing needs them straight away */
+static void tables_init(void)
+{
+	udelay(TABLES_INIT_US);
+	record_run(tables_init);
+}
+DECLARE_LAZY_INIT(tables_init, HOOK_PRIO_DEFAULT + 1, LAZY_INIT_AFTER_BOOT);
+
+static void cache_init(void)
+{
+	record_run(cache_init);
+}
+DECLARE_LAZY_INIT(cache_init, HOOK_PRIO_DEFAULT, LAZY_INIT_AFTER_BOOT);
+
+/* Slower, and only used by the AP */
+static void sensor_init(void)
+{
+	udelay(SENSOR_INIT_US);
+	record_run(sensor_init);
+}
+DECLARE_LAZY_INIT(sensor_init, HOOK_PRIO_DEFAULT, LAZY_INIT_AP_ON);
+
+/* Used by the AP too, but also by something before then */
+static void clock_init(void)
+{
+	record_run(clock_init);
+}
+DECLARE_LAZY_INIT(clock_init, HOOK_PRIO_DEFAULT, LAZY_INIT_AP_ON);
+
+static void port_init(void)
+{
+	/* Needs the clock first */
+	lazy_init(clock_init);
+	record_run(port_init);
+}
+DECLARE_LAZY_INIT(port_init, HOOK_PRIO_DEFAULT, LAZY_INIT_AP_ON);
+
+/* Used from interrupt context */
+static void light_init(void)
+{
+	record_run(light_init);
+}
+DECLARE_LAZY_INIT(light_init, HOOK_PRIO_DEFAULT, LAZY_INIT_AP_ON);
+
+static int want_light_isr;
+static int light_isr_count;
+static int light_ready;
+
+static void light_isr(void)
+{
+	light_ready = lazy_init(light_init);
+	light_isr_count++;
+}
+
+void interrupt_generator(void)
+{
+	while (1) {
+		udelay(MSEC);
+		if (want_light_isr) {
+			want_light_isr = 0;
+			task_trigger_test_interrupt(light_isr);
+		}
+	}
+}
+
+static void port_init_deferred(void)
+{
+	lazy_init(port_init);
+}
+DECLARE_DEFERRED(port_init_deferred);
+
+static struct {
+	struct ec_response_boot_timeline r;
+	struct ec_boot_timeline_entry entries[CONFIG_BOOT_TIMELINE_ENTRIES];
+} resp;
+
+/* Read the timeline a few entries at a time, as a host would */
+static int get_timeline(void)
+{
+	struct {
+		struct ec_response_boot_timeline r;
+		struct ec_boot_timeline_entry entries[5];
+	} page;
+	struct ec_params_boot_timeline p = { .index = 0 };
+	int rv;
+
+	do {
+		rv = test_send_host_command(EC_CMD_BOOT_TIMELINE, 0, &p,
+					    sizeof(p), &page, sizeof(page));
+		if (rv != EC_RES_SUCCESS)
+			return rv;
+		memcpy(resp.entries + p.index, page.entries,
+		       page.r.count * sizeof(page.entries[0]));
+		p.index += page.r.count;
+	} while (page.r.count);
+
+	resp.r = page.r;
+	resp.r.count = p.index;
+	return EC_RES_SUCCESS;
+}
+
+static const struct ec_boot_timeline_entry *find(int type, int id,
+						   void (*routine)(void))
+{
+	int i;
+
+	for (i = 0; i < resp.r.count; i++) {
+		const struct ec_boot_timeline_entry *e = resp.entries + i;
+
+		if (e->type != type)
+			continue;
+		if (type == EC_BOOT_TIMELINE_STEP && e->id == id)
+			return e;
+		if (type != EC_BOOT_TIMELINE_STEP &&
+		    e->arg == (uint32_t)(uintptr_t)routine)
+			return e;
+	}
+	return NULL;
+}
+
+static const struct ec_boot_timeline_entry *find_step(int step)
+{
+	return find(EC_BOOT_TIMELINE_STEP, step, NULL);
+}
+
+static int index_of(const struct ec_boot_timeline_entry *e)
+{
+	return e ? e - resp.entries : -1;
+}
+
+/* The emulator's sleeps end early, so wait for something to happen */
+static void wait_for(int *count, int want)
+{
+	int i;
+
+	for (i = 0; i < 100 && *count < want; i++)
+		msleep(10);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_boot(void)
+{
+	const struct ec_boot_timeline_entry *e;
+	static const int steps[] = {
+		EC_BOOT_TIMELINE_TIMER,
+		EC_BOOT_TIMELINE_UART,
+		EC_BOOT_TIMELINE_INITS_DONE,
+		EC_BOOT_TIMELINE_HOOK_INIT,
+		EC_BOOT_TIMELINE_TASKS,
+	};
+	int hook_init, tasks;
+	int i;
+
+	TEST_EQ(get_timeline(), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.r.flags, 0, "0x%x");
+	TEST_EQ(resp.r.recorded, resp.r.kept, "%d");
+	TEST_EQ(resp.r.count, resp.r.kept, "%d");
+
+	for (i = 0; i < ARRAY_SIZE(steps); i++) {
+		TEST_NE(find_step(steps[i]), NULL, "%p");
+		if (i)
+			TEST_LT(index_of(find_step(steps[i - 1])),
+				index_of(find_step(steps[i])), "%d");
+	}
+	TEST_EQ(find_step(EC_BOOT_TIMELINE_AP_STARTUP), NULL, "%p");
+
+	/* Each HOOK_INIT routine, timed */
+	hook_init = index_of(find_step(EC_BOOT_TIMELINE_HOOK_INIT));
+	tasks = index_of(find_step(EC_BOOT_TIMELINE_TASKS));
+	e = find(EC_BOOT_TIMELINE_INIT, 0, keyboard_init);
+	TEST_NE(e, NULL, "%p");
+	TEST_ASSERT(index_of(e) > hook_init && index_of(e) < tasks);
+	TEST_ASSERT(e->duration_us >= KEYBOARD_INIT_US);
+
+	/* Without the slow ones */
+	TEST_EQ(find(EC_BOOT_TIMELINE_INIT, 0, tables_init), NULL, "%p");
+	TEST_EQ(find(EC_BOOT_TIMELINE_INIT, 0, sensor_init), NULL, "%p");
+	TEST_ASSERT(resp.entries[tasks].time_us -
+		    resp.entries[hook_init].time_us < TABLES_INIT_US);
+
+	return EC_SUCCESS;
+}
+
+static int test_after_boot(void)
+{
+	const struct ec_boot_timeline_entry *e;
+
+	wait_for(&ran_count, 2);
+
+	/* Once, in priority order */
+	TEST_EQ(ran_count, 2, "%d");
+	TEST_EQ(ran[0], cache_init, "%p");
+	TEST_EQ(ran[1], tables_init, "%p");
+
+	TEST_EQ(get_timeline(), EC_RES_SUCCESS, "%d");
+	e = find(EC_BOOT_TIMELINE_LAZY, 0, tables_init);
+	TEST_NE(e, NULL, "%p");
+	TEST_EQ(e->id, EC_BOOT_TIMELINE_LAZY_AFTER_BOOT, "%d");
+	TEST_ASSERT(e->duration_us >= TABLES_INIT_US);
+	TEST_LT(index_of(find_step(EC_BOOT_TIMELINE_TASKS)), index_of(e),
+		"%d");
+
+	/* The AP isn't on, so nothing needs the rest yet */
+	TEST_EQ(times_run(sensor_init), 0, "%d");
+	TEST_EQ(find(EC_BOOT_TIMELINE_LAZY, 0, sensor_init), NULL, "%p");
+
+	return EC_SUCCESS;
+}
+
+static int test_first_use(void)
+{
+	const struct ec_boot_timeline_entry *e;
+
+	/* Used by another task, and taking what it needs along */
+	hook_call_deferred(&port_init_deferred_data, 0);
+	wait_for(&ran_count, 4);
+	TEST_EQ(ran_count, 4, "%d");
+	TEST_EQ(ran[2], clock_init, "%p");
+	TEST_EQ(ran[3], port_init, "%p");
+
+	/* Only the first time */
+	lazy_init(port_init);
+	lazy_init(clock_init);
+	TEST_EQ(ran_count, 4, "%d");
+
+	TEST_EQ(get_timeline(), EC_RES_SUCCESS, "%d");
+	e = find(EC_BOOT_TIMELINE_LAZY, 0, port_init);
+	TEST_NE(e, NULL, "%p");
+	TEST_EQ(e->id, EC_BOOT_TIMELINE_LAZY_FIRST_USE, "%d");
+	e = find(EC_BOOT_TIMELINE_LAZY, 0, clock_init);
+	TEST_NE(e, NULL, "%p");
+	TEST_EQ(e->id, EC_BOOT_TIMELINE_LAZY_FIRST_USE, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_interrupt(void)
+{
+	const struct ec_boot_timeline_entry *e;
+
+	/* Can only be asked for, and run soon in the hook task */
+	want_light_isr = 1;
+	wait_for(&light_isr_count, 1);
+	TEST_EQ(light_isr_count, 1, "%d");
+	TEST_EQ(light_ready, 0, "%d");
+	wait_for(&ran_count, 5);
+	TEST_EQ(ran_count, 5, "%d");
+	TEST_EQ(ran[4], light_init, "%p");
+
+	/* Then it's done */
+	want_light_isr = 1;
+	wait_for(&light_isr_count, 2);
+	TEST_EQ(light_ready, 1, "%d");
+	TEST_EQ(lazy_init(light_init), 1, "%d");
+	TEST_EQ(ran_count, 5, "%d");
+
+	TEST_EQ(get_timeline(), EC_RES_SUCCESS, "%d");
+	e = find(EC_BOOT_TIMELINE_LAZY, 0, light_init);
+	TEST_NE(e, NULL, "%p");
+	TEST_EQ(e->id, EC_BOOT_TIMELINE_LAZY_FIRST_USE, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_ap_on(void)
+{
+	const struct ec_boot_timeline_entry *e;
+
+	test_chipset_on();
+	wait_for(&ran_count, 6);
+
+	TEST_EQ(ran_count, 6, "%d");
+	TEST_EQ(ran[5], sensor_init, "%p");
+	TEST_EQ(times_run(port_init), 1, "%d");
+
+	TEST_EQ(get_timeline(), EC_RES_SUCCESS, "%d");
+	e = find(EC_BOOT_TIMELINE_LAZY, 0, sensor_init);
+	TEST_NE(e, NULL, "%p");
+	TEST_EQ(e->id, EC_BOOT_TIMELINE_LAZY_AP_ON, "%d");
+	TEST_ASSERT(e->duration_us >= SENSOR_INIT_US);
+	TEST_LT(index_of(find_step(EC_BOOT_TIMELINE_AP_STARTUP)),
+		index_of(e), "%d");
+
+	/* Powering on again doesn't run anything again */
+	test_chipset_off();
+	msleep(30);
+	test_chipset_on();
+	msleep(30);
+	TEST_EQ(ran_count, 6, "%d");
+
+	UART_INJECT("boottimeline\n");
+	msleep(30);
+
+	return EC_SUCCESS;
+}
+
+static int test_paging(void)
+{
+	struct ec_params_boot_timeline p = { .index = 1 };
+	struct {
+		struct ec_response_boot_timeline r;
+		struct ec_boot_timeline_entry entries[2];
+	} page;
+
+	TEST_EQ(get_timeline(), EC_RES_SUCCESS, "%d");
+
+	TEST_EQ(test_send_host_command(EC_CMD_BOOT_TIMELINE, 0, &p, sizeof(p),
+				       &page, sizeof(page)),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(page.r.count, 2, "%d");
+	TEST_ASSERT_ARRAY_EQ((uint8_t *)page.entries,
+			     (uint8_t *)(resp.entries + 1),
+			     sizeof(page.entries));
+
+	/* Past the end */
+	p.index = resp.r.kept;
+	TEST_EQ(test_send_host_command(EC_CMD_BOOT_TIMELINE, 0, &p, sizeof(p),
+				       &page, sizeof(page)),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(page.r.count, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_boot);
+	RUN_TEST(test_after_boot);
+	RUN_TEST(test_first_use);
+	RUN_TEST(test_interrupt);
+	RUN_TEST(test_ap_on);
+	RUN_TEST(test_paging);
+
+	test_print_result();
+}
@@ -18,6 +18,7 @@ test-list-host += battery_get_params_smart
 test-list-host += bklight_lid
 test-list-host += bklight_passthru
 test-list-host += body_detection
+test-list-host += boot_timeline
 test-list-host += button
 test-list-host += cbi
 test-list-host += cec
@@ -26,17 +27,23 @@ test-list-host += charge_manager_drp_charging
 test-list-host += charge_ramp
 test-list-host += compile_time_macros
 test-list-host += console_edit
+test-list-host += console_read_seq
 test-list-host += crc
+test-list-host += ec_flash_update
+test-list-host += ectool_serve
 test-list-host += entropy
 test-list-host += extpwr_gpio
 test-list-host += fan
+test-list-host += fan_rpm_control
 test-list-host += flash
+test-list-host += flash_write_queue
 test-list-host += float
 test-list-host += fp
 test-list-host += fpsensor
 test-list-host += fpsensor_crypto
 test-list-host += fpsensor_state
 test-list-host += gyro_cal
+test-list-host += hook_concurrent
 test-list-host += hooks
 test-list-host += host_command
 test-list-host += i2c_bitbang
@@ -48,7 +55,7 @@ test-list-host += is_enabled_error
 test-list-host += kasa
 test-list-host += kb_8042
 test-list-host += kb_mkbp
-#test-list-host += kb_scan	# crbug.com/976974
+test-list-host += kb_scan
 test-list-host += lid_sw
 test-list-host += lightbar
 test-list-host += mag_cal
@@ -59,10 +66,12 @@ test-list-host += motion_lid
 test-list-host += motion_sense_fifo
 test-list-host += mutex
 test-list-host += newton_fit
+test-list-host += ocpc
 test-list-host += online_calibration
 test-list-host += online_calibration_spoof
 test-list-host += pingpong
 test-list-host += power_button
+test-list-host += power_timeline
 test-list-host += printf
 test-list-host += queue
 test-list-host += rsa
@@ -72,10 +81,14 @@ test-list-host += sbs_charging_v2
 test-list-host += sha256
 test-list-host += sha256_unrolled
 test-list-host += shmalloc
+test-list-host += spi_nor
 test-list-host += static_if
 test-list-host += static_if_error
 test-list-host += system
+test-list-host += sysjump
+test-list-host += task_stats
 test-list-host += thermal
+test-list-host += thermal_ramp
 test-list-host += timer_dos
 test-list-host += uptime
 test-list-host += usb_common
@@ -128,6 +141,7 @@ battery_get_params_smart-y=battery_get_params_smart.o
 bklight_lid-y=bklight_lid.o
 bklight_passthru-y=bklight_passthru.o
 body_detection-y=body_detection.o body_detection_data_literals.o motion_common.o
+boot_timeline-y=boot_timeline.o
 button-y=button.o
 cbi-y=cbi.o
 cec-y=cec.o
@@ -136,17 +150,24 @@ charge_manager_drp_charging-y=charge_manager.o
 charge_ramp-y+=charge_ramp.o
 compile_time_macros-y=compile_time_macros.o
 console_edit-y=console_edit.o
+console_read_seq-y=console_read_seq.o
 crc-y=crc.o
+ec_flash_update-y=ec_flash_update.o ../util/ec_flash.o
+ectool_serve-y=ectool_serve.o ../util/ectool_serve.o
+dirs-y+=util
 entropy-y=entropy.o
 extpwr_gpio-y=extpwr_gpio.o
 fan-y=fan.o
+fan_rpm_control-y=fan_rpm_control.o
 flash-y=flash.o
 flash_physical-y=flash_physical.o
 flash_write_protect-y=flash_write_protect.o
+flash_write_queue-y=flash_write_queue.o
 fpsensor-y=fpsensor.o
 fpsensor_crypto-y=fpsensor_crypto.o
 fpsensor_state-y=fpsensor_state.o
 gyro_cal-y=gyro_cal.o gyro_cal_init_for_test.o
+hook_concurrent-y=hook_concurrent.o
 hooks-y=hooks.o
 host_command-y=host_command.o
 i2c_bitbang-y=i2c_bitbang.o
@@ -165,6 +186,7 @@ motion_angle-y=motion_angle.o motion_angle_data_literals.o motion_common.o
 motion_angle_tablet-y=motion_angle_tablet.o motion_angle_data_literals_tablet.o motion_common.o
 motion_lid-y=motion_lid.o
 motion_sense_fifo-y=motion_sense_fifo.o
+ocpc-y=ocpc.o
 online_calibration-y=online_calibration.o
 online_calibration_spoof-y=online_calibration_spoof.o gyro_cal_init_for_test.o
 kasa-y=kasa.o
@@ -173,6 +195,7 @@ mutex-y=mutex.o
 newton_fit-y=newton_fit.o
 pingpong-y=pingpong.o
 power_button-y=power_button.o
+power_timeline-y=power_timeline.o
 powerdemo-y=powerdemo.o
 printf-y=printf.o
 queue-y=queue.o
@@ -187,11 +210,15 @@ sbs_charging_v2-y=sbs_charging_v2.o
 sha256-y=sha256.o
 sha256_unrolled-y=sha256.o
 shmalloc-y=shmalloc.o
+spi_nor-y=spi_nor.o
 static_if-y=static_if.o
 stm32f_rtc-y=stm32f_rtc.o
 stress-y=stress.o
 system-y=system.o
+sysjump-y=sysjump.o
+task_stats-y=task_stats.o
 thermal-y=thermal.o
+thermal_ramp-y=thermal_ramp.o
 timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
 uptime-y=uptime.o
@@ -0,0 +1,201 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test reading console output by sequence number.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "printf.h"
+#include "test_util.h"
+#include "util.h"
+
+#define TX_BUF_SIZE CONFIG_UART_TX_BUF_SIZE
+
+static struct {
+	struct ec_response_console_read_seq r;
+	char data[2 * TX_BUF_SIZE];
+} resp;
+
+/*****************************************************************************/
+/* Test utilities */
+
+/* Returns the number of data bytes read, or -1 on error */
+static int read_seq(uint32_t seq, int size)
+{
+	struct ec_params_console_read_seq params = { .seq = seq };
+	struct host_cmd_handler_args args;
+
+	memset(&resp, 0, sizeof(resp));
+	args.version = 0;
+	args.command = EC_CMD_CONSOLE_READ_SEQ;
+	args.params = &params;
+	args.params_size = sizeof(params);
+	args.response = &resp;
+	args.response_max = sizeof(resp.r) + size;
+	args.response_size = 0;
+
+	if (host_command_process(&args) != EC_RES_SUCCESS)
+		return -1;
+
+	return args.response_size - sizeof(resp.r);
+}
+
+static uint32_t get_head(void)
+{
+	cflush();
+	read_seq(0, 0);
+	return resp.r.head;
+}
+
+/* Print lines "<n>:abcdefghijklmnopqrstuvwxyz\n" with n from 0 to count-1 */
+static void print_lines(int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		ccprintf("%02d:abcdefghijklmnopqrstuvwxyz\n", i % 100);
+		cflush();
+	}
+}
+
+/* The console turns "\n" into "\r\n" */
+#define LINE_SIZE 31
+
+/*****************************************************************************/
+/* Tests */
+
+/*
+ * The TEST_* macros print too, so each test reads everything it needs before
+ * checking any of it.
+ */
+
+static int test_follow(void)
+{
+	struct ec_response_console_read_seq first;
+	char data[7];
+	uint32_t head = get_head();
+	int size, more;
+
+	ccputs("hello\n");
+	cflush();
+
+	size = read_seq(head, sizeof(resp.data));
+	first = resp.r;
+	memcpy(data, resp.data, sizeof(data));
+
+	/* Caught up: nothing more until something else is printed */
+	more = read_seq(head + size, sizeof(resp.data));
+
+	TEST_EQ(size, 7, "%d");
+	TEST_ASSERT_ARRAY_EQ(data, "hello\r\n", 7);
+	TEST_EQ(first.seq, head, "%u");
+	TEST_EQ(first.head, head + 7, "%u");
+	TEST_EQ(first.lost, 0, "%u");
+	TEST_EQ(first.flags, 0, "%d");
+
+	TEST_EQ(more, 0, "%d");
+	TEST_EQ(resp.r.seq, head + 7, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_chunks(void)
+{
+	char expected[8 * LINE_SIZE + 1];
+	char data[8 * LINE_SIZE];
+	char whole[8 * LINE_SIZE];
+	uint32_t head, seq;
+	int lost = 0, gaps = 0;
+	int i, size, whole_size;
+
+	for (i = 0; i < 8; i++)
+		snprintf(expected + i * LINE_SIZE, LINE_SIZE + 1,
+			 "%02d:abcdefghijklmnopqrstuvwxyz\r\n", i);
+
+	/* Start a few lines before the end of the ring, so the lines wrap */
+	while ((get_head() & (TX_BUF_SIZE - 1)) < TX_BUF_SIZE - 4 * LINE_SIZE)
+		ccputs(".");
+	ccputs("\n");
+	head = get_head();
+	print_lines(8);
+
+	/* Read it back in one go */
+	whole_size = read_seq(head, sizeof(resp.data));
+	memcpy(whole, resp.data, sizeof(whole));
+
+	/* And 7 bytes at a time */
+	seq = head;
+	for (i = 0; i < sizeof(data); i += size) {
+		size = read_seq(seq, MIN(7, (int)sizeof(data) - i));
+		if (size <= 0)
+			break;
+		if (resp.r.seq != seq)
+			gaps++;
+		lost += resp.r.lost;
+		memcpy(data + i, resp.data, size);
+		seq += size;
+	}
+
+	TEST_EQ(seq, head + 8 * LINE_SIZE, "%u");
+	TEST_EQ(gaps, 0, "%d");
+	TEST_EQ(lost, 0, "%d");
+	TEST_ASSERT_ARRAY_EQ(data, expected, sizeof(data));
+
+	TEST_EQ(whole_size, 8 * LINE_SIZE, "%d");
+	TEST_ASSERT_ARRAY_EQ(whole, expected, sizeof(whole));
+
+	return EC_SUCCESS;
+}
+
+static int test_lost(void)
+{
+	uint32_t head = get_head();
+	int lines = 3 * TX_BUF_SIZE / LINE_SIZE;
+	int size;
+
+	print_lines(lines);
+
+	/* Only the last TX_BUF_SIZE - 1 bytes are left */
+	size = read_seq(head, sizeof(resp.data));
+	TEST_EQ(size, TX_BUF_SIZE - 1, "%d");
+	TEST_EQ(resp.r.head, head + lines * LINE_SIZE, "%u");
+	TEST_EQ(resp.r.seq, resp.r.head - size, "%u");
+	TEST_EQ(resp.r.lost, resp.r.seq - head, "%u");
+	TEST_EQ(resp.r.flags, 0, "%d");
+
+	/* The data ends with the last line printed */
+	TEST_ASSERT_ARRAY_EQ(resp.data + size - LINE_SIZE + 2,
+			     ":abcdefghijklmnopqrstuvwxyz\r\n", LINE_SIZE - 2);
+
+	return EC_SUCCESS;
+}
+
+static int test_restarted(void)
+{
+	uint32_t head = get_head();
+	int size;
+
+	/* A sequence number from before a restart is past the head */
+	size = read_seq(head + 1000, sizeof(resp.data));
+	TEST_EQ(resp.r.flags, EC_CONSOLE_READ_SEQ_RESTARTED, "%d");
+	TEST_EQ(resp.r.lost, 0, "%u");
+	TEST_EQ(resp.r.seq + size, resp.r.head, "%u");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_follow);
+	RUN_TEST(test_chunks);
+	RUN_TEST(test_lost);
+	RUN_TEST(test_restarted);
+
+	test_print_result();
+}
@@ -0,0 +1,264 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Tests for ec_flash_update() in util/ec_flash.c, against a mock EC */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "test_util.h"
+#include "util.h"
+
+#include "../util/comm-host.h"
+#include "../util/ec_flash.h"
+
+#define FLASH_SIZE (64 * 1024)
+#define ERASE_SIZE 1024
+#define NUM_BLOCKS (FLASH_SIZE / ERASE_SIZE)
+/* ec_flash_update() merges erase blocks into pieces of this size */
+#define PIECE_SIZE 4096
+#define WRITE_SIZE 4
+
+/* Largest parameters and response, as for a protocol v3 EC */
+#define MAX_OUTSIZE 536
+#define MAX_INSIZE 512
+
+/*****************************************************************************/
+/* Mock EC */
+
+int ec_max_outsize = MAX_OUTSIZE;
+int ec_max_insize = MAX_INSIZE;
+static uint8_t outbuf[MAX_OUTSIZE];
+static uint8_t inbuf[MAX_INSIZE];
+void *ec_outbuf = outbuf;
+void *ec_inbuf = inbuf;
+
+static uint8_t flash[FLASH_SIZE];
+static int erase_count[NUM_BLOCKS];
+
+/* Whether the EC queues flash operations, so erases can be pipelined */
+static int queued;
+
+/* Async erase in progress, and how many more polls it takes */
+static int async_offset, async_size;
+static int async_polls = -1;
+
+static int erase(int offset, int size)
+{
+	int i;
+
+	if (offset % ERASE_SIZE || size % ERASE_SIZE ||
+	    offset + size > FLASH_SIZE)
+		return -EECRESULT - EC_RES_INVALID_PARAM;
+
+	for (i = offset / ERASE_SIZE; i < (offset + size) / ERASE_SIZE; i++)
+		erase_count[i]++;
+	memset(flash + offset, 0xff, size);
+	return 0;
+}
+
+static int busy_with(int offset, int size)
+{
+	return async_polls >= 0 && offset < async_offset + async_size &&
+		async_offset < offset + size;
+}
+
+int ec_command(int command, int version, const void *outdata, int outsize,
+	       void *indata, int insize)
+{
+	switch (command) {
+	case EC_CMD_FLASH_INFO: {
+		struct ec_response_flash_info_1 *r = indata;
+
+		memset(r, 0, insize);
+		r->flash_size = FLASH_SIZE;
+		r->write_block_size = WRITE_SIZE;
+		r->erase_block_size = ERASE_SIZE;
+		r->protect_block_size = ERASE_SIZE;
+		if (version >= 1)
+			r->write_ideal_size = WRITE_SIZE;
+		return version >= 1 ? sizeof(*r) :
+			sizeof(struct ec_response_flash_info);
+	}
+	case EC_CMD_FLASH_READ: {
+		const struct ec_params_flash_read *p = outdata;
+
+		if (p->size > insize || p->offset + p->size > FLASH_SIZE ||
+		    busy_with(p->offset, p->size))
+			return -EECRESULT - EC_RES_INVALID_PARAM;
+		memcpy(indata, flash + p->offset, p->size);
+		return p->size;
+	}
+	case EC_CMD_FLASH_WRITE: {
+		const struct ec_params_flash_write *p = outdata;
+		const uint8_t *data = (const uint8_t *)(p + 1);
+		int i;
+
+		if (p->offset + p->size > FLASH_SIZE ||
+		    busy_with(p->offset, p->size))
+			return -EECRESULT - EC_RES_INVALID_PARAM;
+		/* Only erased flash can be programmed */
+		for (i = 0; i < p->size; i++) {
+			if (flash[p->offset + i] != 0xff)
+				return -EECRESULT - EC_RES_ERROR;
+			flash[p->offset + i] = data[i];
+		}
+		return 0;
+	}
+	case EC_CMD_FLASH_ERASE:
+		if (version == 0) {
+			const struct ec_params_flash_erase *p = outdata;
+
+			return erase(p->offset, p->size);
+		} else {
+			const struct ec_params_flash_erase_v1 *p = outdata;
+
+			if (p->cmd == FLASH_ERASE_SECTOR_ASYNC) {
+				if (async_polls >= 0)
+					return -EECRESULT - EC_RES_BUSY;
+				async_offset = p->params.offset;
+				async_size = p->params.size;
+				async_polls = 2;
+				return 0;
+			}
+			if (p->cmd == FLASH_ERASE_GET_RESULT) {
+				if (async_polls < 0)
+					return 0;
+				if (async_polls--)
+					return -EECRESULT - EC_RES_BUSY;
+				return erase(async_offset, async_size);
+			}
+			return -EECRESULT - EC_RES_INVALID_PARAM;
+		}
+	}
+
+	return -EECRESULT - EC_RES_INVALID_COMMAND;
+}
+
+int ec_cmd_version_supported(int cmd, int ver)
+{
+	switch (cmd) {
+	case EC_CMD_FLASH_INFO:
+		return ver <= 1;
+	case EC_CMD_FLASH_WRITE:
+		return ver <= EC_VER_FLASH_WRITE;
+	case EC_CMD_FLASH_ERASE:
+		return ver == 0 || queued;
+	case EC_CMD_FLASH_QUEUE_INFO:
+		return queued && ver == EC_VER_FLASH_QUEUE_INFO;
+	}
+	return 0;
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+/* What each piece of the image needs */
+enum piece {
+	CLEAN,		/* Already up to date */
+	ERASED,		/* Erased on the EC */
+	DIRTY,		/* Holds other data */
+};
+
+static const enum piece pieces[] = {
+	DIRTY, CLEAN, ERASED, DIRTY, ERASED, ERASED, DIRTY, CLEAN,
+	DIRTY, DIRTY, ERASED, CLEAN, DIRTY, ERASED, CLEAN, DIRTY,
+};
+BUILD_ASSERT(ARRAY_SIZE(pieces) * PIECE_SIZE == FLASH_SIZE);
+
+static uint8_t image[FLASH_SIZE];
+
+static void setup(void)
+{
+	int i, j;
+
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		uint8_t *old = flash + i * PIECE_SIZE;
+		uint8_t *new = image + i * PIECE_SIZE;
+
+		for (j = 0; j < PIECE_SIZE; j++)
+			new[j] = (i * 7 + j * 13) & 0xff;
+		if (pieces[i] == CLEAN)
+			memcpy(old, new, PIECE_SIZE);
+		else if (pieces[i] == ERASED)
+			memset(old, 0xff, PIECE_SIZE);
+		else
+			memset(old, i, PIECE_SIZE);
+	}
+	memset(erase_count, 0, sizeof(erase_count));
+	async_polls = -1;
+}
+
+static int check_update(void)
+{
+	struct ec_flash_update_stats stats;
+	int blocks_per_piece = PIECE_SIZE / ERASE_SIZE;
+	int dirty = 0, clean = 0;
+	int i;
+
+	setup();
+	TEST_EQ(ec_flash_update(image, 0, FLASH_SIZE, &stats), 0, "%d");
+	TEST_ASSERT_ARRAY_EQ(flash, image, FLASH_SIZE);
+	TEST_EQ(async_polls, -1, "%d");
+
+	/* Every dirty block is erased exactly once, and nothing else is */
+	for (i = 0; i < NUM_BLOCKS; i++) {
+		enum piece p = pieces[i / blocks_per_piece];
+
+		TEST_EQ(erase_count[i], p == DIRTY ? 1 : 0, "%d");
+	}
+
+	for (i = 0; i < ARRAY_SIZE(pieces); i++) {
+		dirty += pieces[i] == DIRTY;
+		clean += pieces[i] == CLEAN;
+	}
+	TEST_EQ(stats.bytes_total, FLASH_SIZE, "%d");
+	TEST_EQ(stats.bytes_skipped, clean * PIECE_SIZE, "%d");
+	TEST_EQ(stats.bytes_written, FLASH_SIZE - clean * PIECE_SIZE, "%d");
+	TEST_EQ(stats.blocks_erased, dirty, "%d");
+
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_update_sync(void)
+{
+	queued = 0;
+	return check_update();
+}
+
+static int test_update_pipelined(void)
+{
+	queued = 1;
+	return check_update();
+}
+
+static int test_update_unchanged(void)
+{
+	struct ec_flash_update_stats stats;
+
+	queued = 1;
+	setup();
+	memcpy(flash, image, FLASH_SIZE);
+
+	TEST_EQ(ec_flash_update(image, 0, FLASH_SIZE, &stats), 0, "%d");
+	TEST_EQ(stats.bytes_skipped, FLASH_SIZE, "%d");
+	TEST_EQ(stats.bytes_written, 0, "%d");
+	TEST_EQ(stats.blocks_erased, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_update_sync);
+	RUN_TEST(test_update_pipelined);
+	RUN_TEST(test_update_unchanged);
+
+	test_print_result();
+}
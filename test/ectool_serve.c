@@ -0,0 +1,271 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Tests for "ectool serve" in util/ectool_serve.c: the server runs in a child
+ * process, and its commands talk to the emulated EC.
+ */
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "common.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "test_util.h"
+#include "util.h"
+
+#include "../util/ectool.h"
+
+/* Idle time after which the server drops a client */
+#define IDLE_SECS 1
+
+/*****************************************************************************/
+/* Commands served */
+
+static int cmd_hello(int argc, char *argv[])
+{
+	struct ec_params_hello p = { .in_data = 0xa0b0c0d0 };
+	struct ec_response_hello r;
+	struct host_cmd_handler_args args = {
+		.command = EC_CMD_HELLO,
+		.params = &p,
+		.params_size = sizeof(p),
+		.response = &r,
+		.response_max = sizeof(r),
+	};
+
+	/* The EC's own handler, as the other tasks aren't in this process */
+	if (host_command_process(&args) != EC_RES_SUCCESS)
+		return -1;
+	if (r.out_data != 0xa1b2c3d4) {
+		fprintf(stderr, "Expected response 0x%08x, got 0x%08x\n",
+			0xa1b2c3d4, r.out_data);
+		return -1;
+	}
+
+	printf("EC says hello!\n");
+	return 0;
+}
+
+/* Like the many ectool commands which give up on bad input */
+static int cmd_bail(int argc, char *argv[])
+{
+	printf("About to give up\n");
+	fprintf(stderr, "Bad input\n");
+	exit(3);
+}
+
+static const struct command commands[] = {
+	{"bail", cmd_bail},
+	{"hello", cmd_hello},
+	{"serve", cmd_serve},
+};
+
+const struct command *find_command(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(commands); i++)
+		if (!strcasecmp(name, commands[i].name))
+			return commands + i;
+	return NULL;
+}
+
+int split_command_line(char *line, char **args, int max_args)
+{
+	char *c;
+	int n = 0;
+
+	c = strchr(line, '#');
+	if (c)
+		*c = '\0';
+	for (c = strtok(line, " \t\r\n"); c && n < max_args;
+	     c = strtok(NULL, " \t\r\n"))
+		args[n++] = c;
+	return n;
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static pid_t server;
+
+static int connect_client(void)
+{
+	struct sockaddr_un addr;
+	int fd;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static int start_server(void)
+{
+	char idle[8];
+	char *argv[] = { "serve", socket_path, idle, NULL };
+	char banner[sizeof("Serving on ") + sizeof(socket_path)];
+	int out[2];
+	int len;
+
+	snprintf(socket_path, sizeof(socket_path), "/tmp/ectool_serve.%d",
+		 (int)getpid());
+	snprintf(idle, sizeof(idle), "%d", IDLE_SECS);
+
+	if (pipe(out))
+		return -1;
+	fflush(stdout);
+	server = fork();
+	if (server < 0)
+		return -1;
+	if (!server) {
+		dup2(out[1], STDOUT_FILENO);
+		close(out[0]);
+		close(out[1]);
+		_exit(cmd_serve(ARRAY_SIZE(argv) - 1, argv) ? 1 : 0);
+	}
+
+	/* It says so once it listens */
+	close(out[1]);
+	len = read(out[0], banner, sizeof(banner) - 1);
+	close(out[0]);
+	if (len <= 0)
+		return -1;
+	banner[len] = '\0';
+	return strncmp(banner, "Serving on ", 11) ? -1 : 0;
+}
+
+static void stop_server(void)
+{
+	kill(server, SIGTERM);
+	waitpid(server, NULL, 0);
+}
+
+/* Send one command line, and read the reply to it into reply */
+static int request(int fd, const char *line, char *reply, int size)
+{
+	int len = 0;
+	int n;
+
+	if (write(fd, line, strlen(line)) != strlen(line))
+		return -1;
+
+	while (len < size - 1) {
+		n = read(fd, reply + len, 1);
+		if (n <= 0)
+			return -1;
+		if (reply[len++] == '\n')
+			break;
+	}
+	reply[len] = '\0';
+	return 0;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_hello(void)
+{
+	char reply[256];
+	int fd = connect_client();
+
+	TEST_ASSERT(fd >= 0);
+	/* The EC's console shows up in the output too, on the host */
+	TEST_EQ(request(fd, "hello\n", reply, sizeof(reply)), 0, "%d");
+	TEST_EQ(strstr(reply, "{\"command\":\"hello\",\"rc\":0,"), reply,
+		"%p");
+	TEST_NE(strstr(reply, "EC says hello!\\n\",\"error\":\"\"}\n"), NULL,
+		"%p");
+
+	/* A second command on the same connection */
+	TEST_EQ(request(fd, "HELLO # again\n", reply, sizeof(reply)), 0,
+		"%d");
+	TEST_NE(strstr(reply, "\"rc\":0,"), NULL, "%p");
+	TEST_NE(strstr(reply, "EC says hello!"), NULL, "%p");
+
+	TEST_EQ(request(fd, "nosuchcommand\n", reply, sizeof(reply)), 0,
+		"%d");
+	TEST_NE(strstr(reply, "\"rc\":-1,"), NULL, "%p");
+	TEST_NE(strstr(reply, "Unknown command 'nosuchcommand'"), NULL, "%p");
+
+	close(fd);
+	return EC_SUCCESS;
+}
+
+static int test_exit(void)
+{
+	char reply[256];
+	int fd = connect_client();
+
+	TEST_ASSERT(fd >= 0);
+
+	/* A command which exits only ends itself, and says why */
+	TEST_EQ(request(fd, "bail\n", reply, sizeof(reply)), 0, "%d");
+	TEST_ASSERT(!strcmp(reply, "{\"command\":\"bail\",\"rc\":3,"
+				   "\"output\":\"About to give up\\n\","
+				   "\"error\":\"Bad input\\n\"}\n"));
+
+	TEST_EQ(request(fd, "hello\n", reply, sizeof(reply)), 0, "%d");
+	TEST_NE(strstr(reply, "\"rc\":0,"), NULL, "%p");
+
+	close(fd);
+	return EC_SUCCESS;
+}
+
+static int test_clients(void)
+{
+	char reply[256];
+	int idle_fd = connect_client();
+	int fd;
+
+	TEST_ASSERT(idle_fd >= 0);
+
+	/* A client which sends nothing doesn't hold up the others */
+	fd = connect_client();
+	TEST_ASSERT(fd >= 0);
+	TEST_EQ(request(fd, "hello\n", reply, sizeof(reply)), 0, "%d");
+	TEST_NE(strstr(reply, "\"rc\":0,"), NULL, "%p");
+	close(fd);
+
+	/* And is hung up on once it has been quiet for long enough */
+	TEST_EQ((int)read(idle_fd, reply, sizeof(reply)), 0, "%d");
+	close(idle_fd);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	if (start_server()) {
+		ccprintf("Server didn't start\n");
+		test_fail();
+	} else {
+		RUN_TEST(test_hello);
+		RUN_TEST(test_exit);
+		RUN_TEST(test_clients);
+		stop_server();
+	}
+
+	test_print_result();
+}
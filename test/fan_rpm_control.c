@@ -0,0 +1,346 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the EC-side fan RPM control loop against a simulated fan.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "fan.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "math_util.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/*****************************************************************************/
+/* Simulated fan */
+
+/*
+ * The fan settles at PLANT_GAIN rpm per percent of duty, less PLANT_OFFSET,
+ * with a PLANT_TAU_MS time constant. It doesn't turn at all below
+ * PLANT_MIN_DUTY. That's about 10% slower than the linear fan the
+ * controller's feed-forward assumes.
+ */
+#define PLANT_GAIN 46
+#define PLANT_OFFSET 100
+#define PLANT_TAU_MS 300
+#define PLANT_MIN_DUTY 15
+
+/* How often, and by how much, the fan controller's own RPM mode steps */
+#define CHIP_STEP_MS 50
+#define CHIP_DEADBAND_PCT 1
+
+static int plant_duty;
+static int plant_rpm_mode;
+static int plant_target;
+static int plant_mrpm;		/* 1/1000 rpm */
+static int plant_stuck;
+static int plant_glitch_every;
+static int plant_reads;
+static int duty_writes;
+static uint32_t plant_noise = 1;
+static timestamp_t plant_time;
+
+static void plant_advance(void)
+{
+	uint64_t now = get_time().val;
+	int ss;
+
+	if (!plant_time.val)
+		plant_time.val = now;
+
+	for (; plant_time.val + MSEC <= now; plant_time.val += MSEC) {
+		int rpm = plant_mrpm / 1000;
+
+		/* Emulate the usual hardware loop: a percent at a time */
+		if (plant_rpm_mode && !(plant_time.val / MSEC % CHIP_STEP_MS)) {
+			int band = plant_target * CHIP_DEADBAND_PCT / 100;
+
+			if (rpm < plant_target - band && plant_duty < 100)
+				plant_duty++;
+			else if (rpm > plant_target + band && plant_duty > 0)
+				plant_duty--;
+		}
+
+		ss = 0;
+		if (!plant_stuck && plant_duty >= PLANT_MIN_DUTY)
+			ss = PLANT_GAIN * plant_duty - PLANT_OFFSET;
+		plant_mrpm += (ss * 1000 - plant_mrpm) / PLANT_TAU_MS;
+	}
+}
+
+static int plant_rpm(void)
+{
+	plant_advance();
+	return plant_mrpm / 1000;
+}
+
+void fan_set_duty(int ch, int percent)
+{
+	plant_advance();
+	plant_duty = percent;
+	duty_writes++;
+}
+
+int fan_get_duty(int ch)
+{
+	return plant_duty;
+}
+
+void fan_set_rpm_mode(int ch, int rpm_mode)
+{
+	plant_advance();
+	plant_rpm_mode = rpm_mode;
+}
+
+int fan_get_rpm_mode(int ch)
+{
+	return plant_rpm_mode;
+}
+
+void fan_set_rpm_target(int ch, int rpm)
+{
+	plant_advance();
+	plant_target = rpm;
+}
+
+int fan_get_rpm_target(int ch)
+{
+	return plant_target;
+}
+
+int fan_get_rpm_actual(int ch)
+{
+	int rpm = plant_rpm();
+
+	/* A tach reading that's just wrong, now and then */
+	if (plant_glitch_every && !(++plant_reads % plant_glitch_every))
+		return 0;
+
+	/* And +/-1% of jitter on the rest */
+	plant_noise = plant_noise * 1103515245 + 12345;
+	return rpm + (int)((plant_noise >> 16) % 101 - 50) * rpm / 5000;
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+void set_thermal_control_enabled(int fan, int enable);
+
+struct step_response {
+	int settle_ms;
+	int overshoot;
+};
+
+/*
+ * Watch the simulated fan (not the tach) for a while after a change of
+ * target, and work out how long it took to stay within 5% of it, and how far
+ * past it it went.
+ */
+static void measure(int target, int ms, struct step_response *r)
+{
+	int band = target / 20;
+	int last_out = 0;
+	int t, rpm;
+
+	r->overshoot = 0;
+	for (t = 0; t < ms; t += 10) {
+		rpm = plant_rpm();
+		r->overshoot = MAX(r->overshoot, rpm - target);
+		if (ABS(rpm - target) > band)
+			last_out = t + 10;
+		msleep(10);
+	}
+	r->settle_ms = last_out;
+}
+
+static int get_telemetry(struct ec_response_fan_telemetry *r)
+{
+	struct ec_params_fan_telemetry p = { .fan_idx = 0 };
+
+	return test_send_host_command(EC_CMD_FAN_TELEMETRY, 0, &p, sizeof(p),
+				      r, sizeof(*r));
+}
+
+#define FAN_RPM_START (fans[0].rpm->rpm_start)
+
+/* Targets for 13% and 76% of thermal demand */
+#define RPM_LOW 1484
+#define RPM_HIGH 4030
+
+static struct step_response chip_step;
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_chip_loop(void)
+{
+	/* How the fan controller's own RPM mode copes, for comparison */
+	fan_set_rpm_mode(0, 1);
+	fan_set_rpm_target(0, RPM_LOW);
+	sleep(10);
+
+	fan_set_rpm_target(0, RPM_HIGH);
+	measure(RPM_HIGH, 8000, &chip_step);
+	ccprintf("chip loop: settled in %d ms, overshoot %d rpm\n",
+		 chip_step.settle_ms, chip_step.overshoot);
+
+	fan_set_rpm_mode(0, 0);
+	fan_set_duty(0, 0);
+	sleep(2);
+
+	return EC_SUCCESS;
+}
+
+static int test_step_response(void)
+{
+	struct ec_response_fan_telemetry t;
+	struct step_response r;
+
+	set_thermal_control_enabled(0, 1);
+	TEST_EQ(fan_get_rpm_mode(0), 0, "%d");
+	/* The fan is kicked at its start speed, then slowed to the target */
+	fan_set_percent_needed(0, 13);
+	TEST_EQ(fan_rpm_control_get_target(0), FAN_RPM_START, "%d");
+	sleep(2);
+	fan_set_percent_needed(0, 13);
+	TEST_EQ(fan_rpm_control_get_target(0), RPM_LOW, "%d");
+	sleep(8);
+	TEST_ASSERT(ABS(plant_rpm() - RPM_LOW) <= RPM_LOW / 20);
+
+	fan_set_percent_needed(0, 76);
+	measure(RPM_HIGH, 8000, &r);
+	ccprintf("EC loop: settled in %d ms, overshoot %d rpm\n",
+		 r.settle_ms, r.overshoot);
+
+	TEST_ASSERT(r.settle_ms < chip_step.settle_ms / 2);
+	TEST_ASSERT(r.overshoot <= RPM_HIGH / 50);
+	TEST_ASSERT(r.overshoot < chip_step.overshoot);
+
+	/*
+	 * The EC saw much the same thing from the tach, if a little later: it
+	 * samples less often, and the fan creeps into the band slowly.
+	 */
+	TEST_EQ(get_telemetry(&t), EC_RES_SUCCESS, "%d");
+	TEST_EQ(t.target_rpm, RPM_HIGH, "%d");
+	TEST_ASSERT(t.flags & EC_FAN_TELEMETRY_RPM_MODE);
+	TEST_ASSERT(t.flags & EC_FAN_TELEMETRY_SETTLED);
+	TEST_ASSERT(!(t.flags & EC_FAN_TELEMETRY_STALLED));
+	ccprintf("EC saw: settled in %d ms\n", t.settle_ms);
+	TEST_ASSERT(t.settle_ms + 100 >= r.settle_ms);
+	TEST_ASSERT(t.settle_ms <= r.settle_ms + 500);
+	TEST_ASSERT(ABS(t.rpm - RPM_HIGH) <= RPM_HIGH / 20);
+
+	return EC_SUCCESS;
+}
+
+static int test_tach_glitches(void)
+{
+	struct ec_response_fan_telemetry t;
+	int i;
+
+	/* The odd zero reading doesn't disturb the fan */
+	plant_glitch_every = 7;
+	for (i = 0; i < 30; i++) {
+		msleep(100);
+		TEST_EQ(get_telemetry(&t), EC_RES_SUCCESS, "%d");
+		TEST_ASSERT(ABS(t.rpm - RPM_HIGH) <= RPM_HIGH / 20);
+		TEST_ASSERT(ABS(plant_rpm() - RPM_HIGH) <= RPM_HIGH / 20);
+	}
+	TEST_ASSERT(!(t.flags & EC_FAN_TELEMETRY_STALLED));
+	plant_glitch_every = 0;
+
+	return EC_SUCCESS;
+}
+
+static int test_stall(void)
+{
+	struct ec_response_fan_telemetry t;
+	uint16_t *mapped = (uint16_t *)host_get_memmap(EC_MEMMAP_FAN);
+
+	plant_stuck = 1;
+	msleep(CONFIG_FAN_RPM_CONTROL_STALL_MS / 2);
+	TEST_EQ(get_telemetry(&t), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(!(t.flags & EC_FAN_TELEMETRY_STALLED));
+
+	/* Stalled, and kicked as hard as possible */
+	sleep(2);
+	TEST_EQ(get_telemetry(&t), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(t.flags & EC_FAN_TELEMETRY_STALLED);
+	TEST_EQ(t.duty, 100, "%d");
+	TEST_EQ(t.stall_count, 1, "%d");
+	TEST_EQ(mapped[0], EC_FAN_SPEED_STALLED, "%d");
+
+	/* Once it turns again, it's back under control */
+	plant_stuck = 0;
+	sleep(3);
+	TEST_EQ(get_telemetry(&t), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(!(t.flags & EC_FAN_TELEMETRY_STALLED));
+	TEST_EQ(t.stall_count, 1, "%d");
+	TEST_ASSERT(ABS(plant_rpm() - RPM_HIGH) <= RPM_HIGH / 20);
+	TEST_ASSERT(mapped[0] != EC_FAN_SPEED_STALLED);
+
+	return EC_SUCCESS;
+}
+
+static int test_high_target(void)
+{
+	/* Far above what the fan can do, so flat out */
+	fan_rpm_control_set_target(0, 25000);
+	msleep(500);
+	TEST_EQ(plant_duty, 100, "%d");
+
+	fan_rpm_control_set_target(0, RPM_HIGH);
+	sleep(3);
+	TEST_ASSERT(ABS(plant_rpm() - RPM_HIGH) <= RPM_HIGH / 20);
+
+	return EC_SUCCESS;
+}
+
+static int test_off(void)
+{
+	struct ec_response_fan_telemetry t;
+	int writes;
+
+	/* No demand means no duty, and no stall either */
+	fan_set_percent_needed(0, 0);
+	sleep(3);
+	TEST_EQ(get_telemetry(&t), EC_RES_SUCCESS, "%d");
+	TEST_EQ(t.duty, 0, "%d");
+	TEST_EQ(plant_duty, 0, "%d");
+	TEST_ASSERT(!(t.flags & EC_FAN_TELEMETRY_STALLED));
+	TEST_EQ(t.stall_count, 1, "%d");
+
+	/* And the loop has stopped */
+	writes = duty_writes;
+	sleep(1);
+	TEST_EQ(duty_writes, writes, "%d");
+
+	/* Until there's demand again */
+	fan_set_percent_needed(0, 76);
+	sleep(2);
+	fan_set_percent_needed(0, 76);
+	sleep(6);
+	TEST_ASSERT(duty_writes > writes);
+	TEST_ASSERT(ABS(plant_rpm() - RPM_HIGH) <= RPM_HIGH / 20);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_chip_loop);
+	RUN_TEST(test_step_response);
+	RUN_TEST(test_tach_glitches);
+	RUN_TEST(test_stall);
+	RUN_TEST(test_high_target);
+	RUN_TEST(test_off);
+
+	test_print_result();
+}
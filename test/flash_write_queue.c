@@ -0,0 +1,419 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Tests for flash write coalescing and the background erase queue */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "flash.h"
+#include "host_command.h"
+#include "sha256.h"
+#include "system.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Start of the RW region, which can be overwritten while running RO */
+#define TEST_OFFSET CONFIG_EC_WRITABLE_STORAGE_OFF
+
+#define IDEAL CONFIG_FLASH_WRITE_IDEAL_SIZE
+
+static char testdata[2 * IDEAL];
+
+/*****************************************************************************/
+/* Mock functions */
+
+void host_send_response(struct host_cmd_handler_args *args)
+{
+	/* Do nothing */
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+static int host_command_write(int offset, int size, const char *data)
+{
+	uint8_t buf[sizeof(struct ec_params_flash_write) + 2 * IDEAL];
+	struct ec_params_flash_write *params =
+		(struct ec_params_flash_write *)buf;
+
+	params->offset = offset;
+	params->size = size;
+	memcpy(params + 1, data, size);
+
+	return test_send_host_command(EC_CMD_FLASH_WRITE, EC_VER_FLASH_WRITE,
+				      buf, size + sizeof(*params), NULL, 0);
+}
+
+static int host_command_read(int offset, int size, char *out)
+{
+	struct ec_params_flash_read params;
+
+	params.offset = offset;
+	params.size = size;
+
+	return test_send_host_command(EC_CMD_FLASH_READ, 0, &params,
+				      sizeof(params), out, size);
+}
+
+static int host_command_erase_v1(int cmd, int offset, int size)
+{
+	struct ec_params_flash_erase_v1 params;
+
+	memset(&params, 0, sizeof(params));
+	params.cmd = cmd;
+	params.params.offset = offset;
+	params.params.size = size;
+
+	return test_send_host_command(EC_CMD_FLASH_ERASE, 1, &params,
+				      sizeof(params), NULL, 0);
+}
+
+static int host_command_queue_info(int flags,
+				   struct ec_response_flash_queue_info *r)
+{
+	struct ec_params_flash_queue_info params;
+
+	memset(&params, 0, sizeof(params));
+	params.flags = flags;
+
+	return test_send_host_command(EC_CMD_FLASH_QUEUE_INFO, 0, &params,
+				      sizeof(params), r, sizeof(*r));
+}
+
+static int host_command_hash(int offset, int size,
+			     struct ec_response_vboot_hash *r)
+{
+	struct ec_params_vboot_hash params;
+
+	memset(&params, 0, sizeof(params));
+	params.cmd = EC_VBOOT_HASH_RECALC;
+	params.hash_type = EC_VBOOT_HASH_TYPE_SHA256;
+	params.offset = offset;
+	params.size = size;
+
+	return test_send_host_command(EC_CMD_VBOOT_HASH, 0, &params,
+				      sizeof(params), r, sizeof(*r));
+}
+
+static int host_command_reboot(void)
+{
+	struct ec_params_reboot_ec params;
+
+	memset(&params, 0, sizeof(params));
+	params.cmd = EC_REBOOT_COLD;
+
+	return test_send_host_command(EC_CMD_REBOOT_EC, 0, &params,
+				      sizeof(params), NULL, 0);
+}
+
+static int wait_erase_result(void)
+{
+	int retry = 100;
+	int rv;
+
+	do {
+		rv = host_command_erase_v1(FLASH_ERASE_GET_RESULT,
+					   TEST_OFFSET, 0);
+		if (rv != EC_RES_BUSY)
+			return rv;
+		msleep(10);
+	} while (--retry);
+
+	return EC_RES_TIMEOUT;
+}
+
+static int is_erased(int offset, int size)
+{
+	int i;
+
+	for (i = 0; i < size; i++)
+		if ((__host_flash[offset + i] & 0xff) != 0xff)
+			return 0;
+	return 1;
+}
+
+static void reset_flash(void)
+{
+	struct ec_response_flash_queue_info r;
+
+	/* Let any pending flush land, then start from erased flash */
+	msleep(100);
+	memset(__host_flash + TEST_OFFSET, 0xff, 4 * CONFIG_FLASH_BANK_SIZE);
+	host_command_queue_info(EC_FLASH_QUEUE_INFO_RESET, &r);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_coalesce(void)
+{
+	struct ec_response_flash_queue_info r;
+	int chunk = 16;
+	int i;
+
+	reset_flash();
+
+	/* Small contiguous writes are held until an ideal block fills */
+	for (i = 0; i < IDEAL - chunk; i += chunk)
+		TEST_ASSERT(host_command_write(TEST_OFFSET + i, chunk,
+					       testdata + i) == EC_RES_SUCCESS);
+	TEST_ASSERT(is_erased(TEST_OFFSET, IDEAL));
+
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.write_pending, IDEAL - chunk, "%d");
+	TEST_EQ(r.physical_writes, 0, "%d");
+
+	TEST_ASSERT(host_command_write(TEST_OFFSET + i, chunk,
+				       testdata + i) == EC_RES_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET, testdata, IDEAL);
+
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.write_requests, IDEAL / chunk, "%d");
+	TEST_EQ(r.write_bytes, IDEAL, "%d");
+	TEST_EQ(r.physical_writes, 1, "%d");
+	TEST_EQ(r.write_pending, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_unaligned_coalesce(void)
+{
+	struct ec_response_flash_queue_info r;
+	int start = IDEAL - 8;
+
+	reset_flash();
+
+	/* A write straddling an ideal block boundary is split at it */
+	TEST_ASSERT(host_command_write(TEST_OFFSET + start, 24,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET + start, testdata, 8);
+	TEST_ASSERT(is_erased(TEST_OFFSET + IDEAL, 16));
+
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.physical_writes, 1, "%d");
+	TEST_EQ(r.write_pending, 16, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_direct_write(void)
+{
+	struct ec_response_flash_queue_info r;
+
+	reset_flash();
+
+	/* Aligned ideal-size writes bypass the buffer */
+	TEST_ASSERT(host_command_write(TEST_OFFSET, 2 * IDEAL,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET, testdata, 2 * IDEAL);
+
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.physical_writes, 1, "%d");
+	TEST_EQ(r.write_pending, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_flush(void)
+{
+	char buf[16];
+
+	reset_flash();
+
+	/* Reading back flushes the buffer */
+	TEST_ASSERT(host_command_write(TEST_OFFSET, 16,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT(is_erased(TEST_OFFSET, 16));
+	TEST_ASSERT(host_command_read(TEST_OFFSET, 16, buf) == EC_RES_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(buf, testdata, 16);
+
+	/* A non-contiguous write flushes the earlier one */
+	TEST_ASSERT(host_command_write(TEST_OFFSET + IDEAL, 16,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT(host_command_write(TEST_OFFSET + 3 * IDEAL, 16,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET + IDEAL, testdata, 16);
+	TEST_ASSERT(is_erased(TEST_OFFSET + 3 * IDEAL, 16));
+
+	/* The buffer is flushed in the background once the host goes quiet */
+	msleep(100);
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET + 3 * IDEAL, testdata,
+			     16);
+
+	return EC_SUCCESS;
+}
+
+static int test_erase_queue(void)
+{
+	struct ec_response_flash_queue_info r;
+	int i;
+
+	reset_flash();
+	memset(__host_flash + TEST_OFFSET, 0, 4 * CONFIG_FLASH_BANK_SIZE);
+
+	/* Misaligned requests are rejected immediately */
+	TEST_EQ(host_command_erase_v1(FLASH_ERASE_SECTOR_ASYNC,
+				      TEST_OFFSET + 1, CONFIG_FLASH_ERASE_SIZE),
+		EC_RES_INVALID_PARAM, "%d");
+
+	for (i = 0; i < 4; i++)
+		TEST_EQ(host_command_erase_v1(FLASH_ERASE_SECTOR_ASYNC,
+				TEST_OFFSET + i * CONFIG_FLASH_BANK_SIZE,
+				CONFIG_FLASH_BANK_SIZE), EC_RES_SUCCESS, "%d");
+
+	/* Nothing has been erased yet, and the queue is full */
+	TEST_ASSERT(!is_erased(TEST_OFFSET, CONFIG_FLASH_BANK_SIZE));
+	TEST_EQ(host_command_erase_v1(FLASH_ERASE_SECTOR_ASYNC,
+				TEST_OFFSET + 4 * CONFIG_FLASH_BANK_SIZE,
+				CONFIG_FLASH_BANK_SIZE), EC_RES_BUSY, "%d");
+	TEST_EQ(host_command_erase_v1(FLASH_ERASE_GET_RESULT, TEST_OFFSET, 0),
+		EC_RES_BUSY, "%d");
+
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.erase_depth, 4, "%d");
+	TEST_EQ(r.erase_depth_max, 4, "%d");
+
+	/* Writing into the second bank erases up to and including it first */
+	TEST_ASSERT(host_command_write(TEST_OFFSET + CONFIG_FLASH_BANK_SIZE,
+				       2 * IDEAL, testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT(is_erased(TEST_OFFSET, CONFIG_FLASH_BANK_SIZE));
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET +
+			     CONFIG_FLASH_BANK_SIZE, testdata, 2 * IDEAL);
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.erase_depth, 2, "%d");
+
+	/* The rest is erased in the background */
+	TEST_EQ(wait_erase_result(), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(is_erased(TEST_OFFSET + 2 * CONFIG_FLASH_BANK_SIZE,
+			      2 * CONFIG_FLASH_BANK_SIZE));
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET +
+			     CONFIG_FLASH_BANK_SIZE, testdata, 2 * IDEAL);
+
+	TEST_ASSERT(host_command_queue_info(EC_FLASH_QUEUE_INFO_RESET,
+					    &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.erase_bytes, 4 * CONFIG_FLASH_BANK_SIZE, "%d");
+	TEST_EQ(r.erase_depth, 0, "%d");
+	TEST_ASSERT(host_command_queue_info(0, &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.erase_bytes, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_erase_after_write(void)
+{
+	reset_flash();
+
+	/* Buffered data written before an erase doesn't survive it */
+	TEST_ASSERT(host_command_write(TEST_OFFSET, 16,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_EQ(host_command_erase_v1(FLASH_ERASE_SECTOR_ASYNC, TEST_OFFSET,
+				      CONFIG_FLASH_BANK_SIZE),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(wait_erase_result(), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(is_erased(TEST_OFFSET, CONFIG_FLASH_BANK_SIZE));
+
+	return EC_SUCCESS;
+}
+
+static int test_hash(void)
+{
+	struct ec_response_vboot_hash r;
+	struct sha256_ctx ctx;
+	uint8_t *expected;
+	char erased[IDEAL - 16];
+
+	reset_flash();
+	memset(erased, 0xff, sizeof(erased));
+
+	/* Hashing mapped storage writes the buffered data first */
+	TEST_ASSERT(host_command_write(TEST_OFFSET, 16,
+				       testdata) == EC_RES_SUCCESS);
+	TEST_ASSERT(is_erased(TEST_OFFSET, 16));
+	TEST_ASSERT(host_command_hash(TEST_OFFSET, IDEAL,
+				      &r) == EC_RES_SUCCESS);
+	TEST_EQ(r.status, EC_VBOOT_HASH_STATUS_DONE, "%d");
+
+	SHA256_init(&ctx);
+	SHA256_update(&ctx, (const uint8_t *)testdata, 16);
+	SHA256_update(&ctx, (const uint8_t *)erased, sizeof(erased));
+	expected = SHA256_final(&ctx);
+	TEST_ASSERT_ARRAY_EQ(r.hash_digest, expected, SHA256_DIGEST_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_reboot_written(void)
+{
+	/* The write held in RAM before the reboot made it to flash */
+	TEST_ASSERT_ARRAY_EQ(__host_flash + TEST_OFFSET + IDEAL, testdata, 16);
+	TEST_ASSERT(is_erased(TEST_OFFSET + IDEAL + 16, 16));
+
+	return EC_SUCCESS;
+}
+
+static void run_test_step1(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(testdata); i++)
+		testdata[i] = i;
+
+	RUN_TEST(test_coalesce);
+	RUN_TEST(test_unaligned_coalesce);
+	RUN_TEST(test_direct_write);
+	RUN_TEST(test_flush);
+	RUN_TEST(test_erase_queue);
+	RUN_TEST(test_erase_after_write);
+	RUN_TEST(test_hash);
+
+	if (test_get_error_count())
+		test_reboot_to_next_step(TEST_STATE_FAILED);
+
+	/* A cold reboot writes the buffered data before resetting */
+	reset_flash();
+	host_command_write(TEST_OFFSET + IDEAL, 16, testdata);
+	system_set_scratchpad(TEST_STATE_MASK(TEST_STATE_STEP_2));
+	host_command_reboot();
+
+	/* Shouldn't reach here */
+	test_reboot_to_next_step(TEST_STATE_FAILED);
+}
+
+static void run_test_step2(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(testdata); i++)
+		testdata[i] = i;
+
+	RUN_TEST(test_reboot_written);
+
+	if (test_get_error_count())
+		test_reboot_to_next_step(TEST_STATE_FAILED);
+	else
+		test_reboot_to_next_step(TEST_STATE_PASSED);
+}
+
+void test_run_step(uint32_t state)
+{
+	if (state & TEST_STATE_MASK(TEST_STATE_STEP_1))
+		run_test_step1();
+	else if (state & TEST_STATE_MASK(TEST_STATE_STEP_2))
+		run_test_step2();
+}
+
+int task_test(void *data)
+{
+	test_run_multistep();
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	msleep(30); /* Wait for TASK_ID_TEST to initialize */
+	task_wake(TASK_ID_TEST);
+}
@@ -317,6 +317,8 @@ test_static int test_derive_encryption_key_failure_rollback_fail(void)
 	static const uint8_t unused_salt[FP_CONTEXT_ENCRYPTION_SALT_BYTES]
 		= { 0 };
 
+	/* GIVEN that no key is cached. */
+	fp_clear_key_cache();
 	/* GIVEN that reading the rollback secret will fail. */
 	mock_ctrl_rollback.get_secret_fail = true;
 	/* THEN the derivation will fail. */
@@ -614,6 +616,301 @@ test_static int test_command_read_match_secret_unreadable(void)
 	return EC_SUCCESS;
 }
 
+/* Plain and encrypted copies of fp_template[0], as seen by the host. */
+static uint8_t fake_template[FP_ALGORITHM_TEMPLATE_SIZE];
+static uint8_t enc_template[FP_ALGORITHM_ENCRYPTED_TEMPLATE_SIZE];
+
+static int download_template(uint32_t fgr, uint8_t *out)
+{
+	struct ec_params_fp_frame params;
+	uint32_t offset;
+	int rv;
+
+	for (offset = 0; offset < sizeof(enc_template); offset += params.size) {
+		params.offset = ((fgr + FP_FRAME_INDEX_TEMPLATE)
+				 << FP_FRAME_INDEX_SHIFT) | offset;
+		params.size = MIN(128, sizeof(enc_template) - offset);
+		rv = test_send_host_command(EC_CMD_FP_FRAME, 0, &params,
+					    sizeof(params), out + offset,
+					    params.size);
+		if (rv != EC_RES_SUCCESS)
+			return rv;
+	}
+	return EC_RES_SUCCESS;
+}
+
+static int upload_chunk(const uint8_t *in, uint32_t offset, uint32_t size,
+			bool commit)
+{
+	uint8_t buf[sizeof(struct ec_params_fp_template) +
+		    sizeof(enc_template)];
+	struct ec_params_fp_template *params = (void *)buf;
+
+	params->offset = offset;
+	params->size = size | (commit ? FP_TEMPLATE_COMMIT : 0);
+	memcpy(params->data, in + offset, size);
+	return test_send_host_command(EC_CMD_FP_TEMPLATE, 0, params,
+				      sizeof(*params) + size, NULL, 0);
+}
+
+/* Upload |in| in order, in chunks of |chunk| bytes. */
+static int upload_template(const uint8_t *in, uint32_t chunk)
+{
+	uint32_t offset;
+	uint32_t size;
+	int rv;
+
+	for (offset = 0; offset < sizeof(enc_template); offset += size) {
+		size = MIN(chunk, sizeof(enc_template) - offset);
+		rv = upload_chunk(in, offset, size,
+				  offset + size == sizeof(enc_template));
+		if (rv != EC_RES_SUCCESS)
+			return rv;
+	}
+	return EC_RES_SUCCESS;
+}
+
+static void fill_template(void)
+{
+	int i;
+
+	for (i = 0; i < sizeof(fake_template); i++)
+		fake_template[i] = i * 7;
+	memcpy(fp_template[0], fake_template, sizeof(fp_template[0]));
+	memcpy(fp_positive_match_salt[0], fake_positive_match_salt,
+	       sizeof(fp_positive_match_salt[0]));
+}
+
+static int check_template_restored(void)
+{
+	TEST_EQ(templ_valid, 1, "%d");
+	TEST_ASSERT_ARRAY_EQ(fp_template[0], fake_template,
+			     sizeof(fp_template[0]));
+	TEST_ASSERT_ARRAY_EQ(fp_positive_match_salt[0],
+			     fake_positive_match_salt,
+			     sizeof(fp_positive_match_salt[0]));
+	return EC_SUCCESS;
+}
+
+static void clear_templates(void)
+{
+	templ_valid = 0;
+	fp_clear_finger_context(0);
+}
+
+test_static int test_command_template_download(void)
+{
+	struct ec_fp_template_encryption_metadata *enc_info =
+		(void *)enc_template;
+	uint8_t again[sizeof(enc_template)];
+	timestamp_t now = get_time();
+
+	/* GIVEN one enrolled template. */
+	memset(user_id, 0, sizeof(user_id));
+	fill_template();
+	templ_valid = 1;
+
+	/* THEN it can be downloaded encrypted. */
+	TEST_EQ(download_template(0, enc_template), EC_RES_SUCCESS, "%d");
+	TEST_EQ(enc_info->struct_version, FP_TEMPLATE_FORMAT_VERSION, "%d");
+	TEST_ASSERT(!bytes_are_trivial(enc_info->tag, sizeof(enc_info->tag)));
+	TEST_ASSERT(memcmp(enc_template + sizeof(*enc_info), fp_template[0],
+			   sizeof(fp_template[0])));
+
+	/* AND not more than once per second. */
+	set_time(now);
+	TEST_EQ(download_template(0, again), EC_RES_BUSY, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_command_template_upload_streamed(void)
+{
+	struct fp_template_upload *up = &fp_template_upload;
+	/* Odd sized chunks so that GCM sees partial blocks. */
+	const uint32_t chunk = 100;
+	uint32_t offset;
+
+	clear_templates();
+
+	/* WHEN all but the last chunk are uploaded in order. */
+	for (offset = 0; offset + chunk < sizeof(enc_template);
+	     offset += chunk)
+		TEST_EQ(upload_chunk(enc_template, offset, chunk, false),
+			EC_RES_SUCCESS, "%d");
+
+	/* THEN they have been deciphered in place already. */
+	TEST_ASSERT(!up->buffered);
+	TEST_EQ(up->deciphered,
+		(uint32_t)(offset -
+			   sizeof(struct ec_fp_template_encryption_metadata)),
+		"%d");
+	TEST_EQ(fp_enc_buffer[sizeof(struct ec_fp_template_encryption_metadata) +
+			      1],
+		7, "%d");
+
+	/* AND the key schedule is kept for the next chunk. */
+	TEST_ASSERT(!bytes_are_trivial((uint8_t *)&up->gcm, sizeof(up->gcm)));
+
+	/* AND nothing reaches the template before the tag is checked. */
+	TEST_ASSERT(bytes_are_trivial(fp_template[0], sizeof(fp_template[0])));
+
+	/* AND the commit only checks the tag. */
+	TEST_EQ(upload_chunk(enc_template, offset,
+			     sizeof(enc_template) - offset, true),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(check_template_restored(), EC_SUCCESS, "%d");
+	TEST_EQ(up->blob_size, 0, "%d");
+	TEST_ASSERT(bytes_are_trivial((uint8_t *)&up->gcm, sizeof(up->gcm)));
+
+	return EC_SUCCESS;
+}
+
+test_static int test_command_template_upload_bad_tag(void)
+{
+	uint8_t corrupted[sizeof(enc_template)];
+
+	clear_templates();
+
+	/* GIVEN a template with one flipped bit. */
+	memcpy(corrupted, enc_template, sizeof(corrupted));
+	corrupted[sizeof(corrupted) - 1] ^= 1;
+
+	/* THEN the upload fails and nothing is left in the template. */
+	TEST_EQ(upload_template(corrupted, 64), EC_RES_UNAVAILABLE, "%d");
+	TEST_EQ(templ_valid, 0, "%d");
+	TEST_ASSERT(bytes_are_trivial(fp_template[0], sizeof(fp_template[0])));
+	TEST_ASSERT(bytes_are_trivial(fp_positive_match_salt[0],
+				      sizeof(fp_positive_match_salt[0])));
+
+	/* AND the same template uploads fine on the next attempt. */
+	TEST_EQ(upload_template(enc_template, 64), EC_RES_SUCCESS, "%d");
+	TEST_EQ(check_template_restored(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_command_template_upload_bad_chunk(void)
+{
+	struct fp_template_upload *up = &fp_template_upload;
+	struct ec_params_fp_template params;
+
+	clear_templates();
+
+	/* GIVEN a template being deciphered as it comes in. */
+	TEST_EQ(upload_chunk(enc_template, 0, 200, false), EC_RES_SUCCESS,
+		"%d");
+	TEST_ASSERT(!bytes_are_trivial((uint8_t *)&up->gcm, sizeof(up->gcm)));
+
+	/* WHEN the host sends a chunk past the end of the buffer. */
+	params.offset = sizeof(fp_enc_buffer) + 1;
+	params.size = 0;
+	TEST_EQ(test_send_host_command(EC_CMD_FP_TEMPLATE, 0, &params,
+				       sizeof(params), NULL, 0),
+		EC_RES_INVALID_PARAM, "%d");
+
+	/* THEN the key is wiped. */
+	TEST_ASSERT(up->buffered);
+	TEST_ASSERT(bytes_are_trivial((uint8_t *)&up->gcm, sizeof(up->gcm)));
+
+	/* AND the rest of the template can still be committed. */
+	TEST_EQ(upload_chunk(enc_template, 200, sizeof(enc_template) - 200,
+			     true),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(check_template_restored(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_command_template_upload_out_of_order(void)
+{
+	const uint32_t half = sizeof(enc_template) / 2;
+
+	clear_templates();
+
+	/* WHEN the second half is uploaded before the first one. */
+	TEST_EQ(upload_chunk(enc_template, 200, half - 200, false),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(upload_chunk(enc_template, 0, 200, false), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(upload_chunk(enc_template, half, 100, false), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(upload_chunk(enc_template, half + 100,
+			     sizeof(enc_template) - half - 100, true),
+		EC_RES_SUCCESS, "%d");
+
+	/* THEN the template is deciphered on commit instead. */
+	TEST_EQ(check_template_restored(), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_key_cache(void)
+{
+	static uint8_t key[SBP_ENC_KEY_LEN];
+	static uint8_t cached_key[SBP_ENC_KEY_LEN];
+	static const uint8_t salt[FP_CONTEXT_ENCRYPTION_SALT_BYTES] = { 1 };
+	static const uint8_t other_salt[FP_CONTEXT_ENCRYPTION_SALT_BYTES] = {
+		2
+	};
+
+	/* GIVEN an empty cache. */
+	fp_clear_key_cache();
+	mock_ctrl_rollback.get_secret_calls = 0;
+
+	/* THEN the key of a salt is only derived once. */
+	TEST_EQ(derive_encryption_key(key, salt), EC_SUCCESS, "%d");
+	TEST_EQ(derive_encryption_key(cached_key, salt), EC_SUCCESS, "%d");
+	TEST_EQ(mock_ctrl_rollback.get_secret_calls, 1, "%d");
+	TEST_ASSERT_ARRAY_EQ(key, cached_key, sizeof(key));
+
+	/* THEN EVEN IF reading the rollback secret would fail now. */
+	mock_ctrl_rollback.get_secret_fail = true;
+	TEST_EQ(derive_encryption_key(cached_key, salt), EC_SUCCESS, "%d");
+	TEST_ASSERT_ARRAY_EQ(key, cached_key, sizeof(key));
+
+	/* THEN the key of another salt still needs it. */
+	TEST_EQ(derive_encryption_key(cached_key, other_salt),
+		EC_ERROR_HW_INTERNAL, "%d");
+
+	/* THEN it is derived again after the rollback block is rewritten. */
+	mock_ctrl_rollback.update_count++;
+	TEST_EQ(derive_encryption_key(cached_key, salt), EC_ERROR_HW_INTERNAL,
+		"%d");
+	mock_ctrl_rollback.get_secret_fail = false;
+	TEST_EQ(derive_encryption_key(cached_key, salt), EC_SUCCESS, "%d");
+	TEST_EQ(mock_ctrl_rollback.get_secret_calls, 4, "%d");
+
+	/* THEN it is derived again after the context is cleared. */
+	fp_reset_and_clear_context();
+	TEST_EQ(derive_encryption_key(cached_key, salt), EC_SUCCESS, "%d");
+	TEST_EQ(mock_ctrl_rollback.get_secret_calls, 5, "%d");
+	TEST_ASSERT_ARRAY_EQ(key, cached_key, sizeof(key));
+
+	return EC_SUCCESS;
+}
+
+test_static int test_key_cache_template_upload(void)
+{
+	struct fp_crypto_stats before = fp_crypto_stats;
+
+	/* GIVEN a fresh user context. */
+	fp_reset_and_clear_context();
+	mock_ctrl_rollback.get_secret_calls = 0;
+
+	/* WHEN a template is uploaded in many chunks. */
+	TEST_EQ(upload_template(enc_template, 128), EC_RES_SUCCESS, "%d");
+	TEST_EQ(templ_valid, 1, "%d");
+
+	/* THEN its key was only derived once. */
+	TEST_EQ(mock_ctrl_rollback.get_secret_calls, 1, "%d");
+	TEST_EQ(fp_crypto_stats.ikm_reads - before.ikm_reads, 1, "%d");
+	TEST_EQ(fp_crypto_stats.derivations - before.derivations, 1, "%d");
+
+	fp_reset_and_clear_context();
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	RUN_TEST(test_hkdf_expand);
@@ -639,5 +936,12 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_command_read_match_secret_wrong_finger);
 	RUN_TEST(test_command_read_match_secret_timeout);
 	RUN_TEST(test_command_read_match_secret_unreadable);
+	RUN_TEST(test_command_template_download);
+	RUN_TEST(test_command_template_upload_streamed);
+	RUN_TEST(test_command_template_upload_bad_tag);
+	RUN_TEST(test_command_template_upload_bad_chunk);
+	RUN_TEST(test_command_template_upload_out_of_order);
+	RUN_TEST(test_key_cache);
+	RUN_TEST(test_key_cache_template_upload);
 	test_print_result();
 }
@@ -7,7 +7,9 @@
 
 #include "common.h"
 #include "ec_commands.h"
+#include "fpsensor.h"
 #include "fpsensor_state.h"
+#include "mock/fp_sensor_mock.h"
 #include "mock/fpsensor_state_mock.h"
 #include "test_util.h"
 #include "util.h"
@@ -186,6 +188,111 @@ test_static int test_fp_set_maintenance_mode(void)
 	return EC_SUCCESS;
 }
 
+static int match(int fgr, int expected_tried)
+{
+	int32_t idx;
+	uint32_t updated;
+	int res;
+
+	mock_ctrl_fp_sensor.fp_finger_match_template = fp_template[fgr];
+	mock_ctrl_fp_sensor.fp_finger_match_templates_tried = 0;
+	res = fp_match_templates(fp_buffer, &idx, &updated);
+	TEST_EQ(res, EC_MKBP_FP_ERR_MATCH_YES_UPDATED, "%d");
+	TEST_EQ(idx, fgr, "%d");
+	TEST_EQ(updated, BIT(fgr), "0x%x");
+	TEST_EQ(mock_ctrl_fp_sensor.fp_finger_match_templates_tried,
+		expected_tried, "%d");
+	TEST_EQ(fp_templates_tried, expected_tried, "%d");
+	return EC_SUCCESS;
+}
+
+test_static int test_fp_match_most_recent_first(void)
+{
+	/* GIVEN 4 enrolled templates that never matched. */
+	fp_reset_and_clear_context();
+	templ_valid = 4;
+
+	/* THEN they are tried in enrollment order. */
+	TEST_EQ(match(2, 3), EC_SUCCESS, "%d");
+	/* THEN the last matched template is tried first. */
+	TEST_EQ(match(2, 1), EC_SUCCESS, "%d");
+	TEST_EQ(match(0, 2), EC_SUCCESS, "%d");
+	TEST_EQ(match(3, 4), EC_SUCCESS, "%d");
+	TEST_EQ(match(2, 3), EC_SUCCESS, "%d");
+	TEST_EQ(match(0, 3), EC_SUCCESS, "%d");
+
+	/* THEN a replaced template loses its history. */
+	fp_clear_finger_context(0);
+	TEST_EQ(match(1, 4), EC_SUCCESS, "%d");
+	TEST_EQ(match(0, 4), EC_SUCCESS, "%d");
+
+	mock_ctrl_fp_sensor = MOCK_CTRL_DEFAULT_FP_SENSOR;
+	return EC_SUCCESS;
+}
+
+test_static int test_fp_match_stops_early(void)
+{
+	int32_t idx;
+	uint32_t updated;
+
+	fp_reset_and_clear_context();
+	templ_valid = 3;
+
+	/* GIVEN no template matches. */
+	mock_ctrl_fp_sensor.fp_finger_match_template = fp_template[4];
+	/* THEN all of them are tried. */
+	TEST_EQ(fp_match_templates(fp_buffer, &idx, &updated),
+		EC_MKBP_FP_ERR_MATCH_NO, "%d");
+	TEST_EQ(idx, FP_NO_SUCH_TEMPLATE, "%d");
+	TEST_EQ(updated, 0, "%d");
+	TEST_EQ(fp_templates_tried, 3, "%d");
+
+	/* GIVEN a low quality image. */
+	mock_ctrl_fp_sensor.fp_finger_match_template = NULL;
+	mock_ctrl_fp_sensor.fp_finger_match_return =
+		EC_MKBP_FP_ERR_MATCH_NO_LOW_QUALITY;
+	/* THEN the other templates are not tried. */
+	TEST_EQ(fp_match_templates(fp_buffer, &idx, &updated),
+		EC_MKBP_FP_ERR_MATCH_NO_LOW_QUALITY, "%d");
+	TEST_EQ(idx, FP_NO_SUCH_TEMPLATE, "%d");
+	TEST_EQ(fp_templates_tried, 1, "%d");
+
+	/* GIVEN a library error. */
+	mock_ctrl_fp_sensor.fp_finger_match_return = -1;
+	TEST_ASSERT(fp_match_templates(fp_buffer, &idx, &updated) < 0);
+	TEST_EQ(fp_templates_tried, 1, "%d");
+
+	mock_ctrl_fp_sensor = MOCK_CTRL_DEFAULT_FP_SENSOR;
+	return EC_SUCCESS;
+}
+
+test_static int test_fp_command_stats(void)
+{
+	struct ec_response_fp_stats_v1 resp;
+	int32_t idx;
+	uint32_t updated;
+
+	fp_reset_and_clear_context();
+	templ_valid = 3;
+	mock_ctrl_fp_sensor.fp_finger_match_template = fp_template[1];
+	TEST_EQ(fp_match_templates(fp_buffer, &idx, &updated),
+		EC_MKBP_FP_ERR_MATCH_YES_UPDATED, "%d");
+
+	/* THEN version 1 reports the templates tried. */
+	TEST_EQ(test_send_host_command(EC_CMD_FP_STATS, 1, NULL, 0, &resp,
+				       sizeof(resp)), EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.templates_tried, 2, "%d");
+	TEST_EQ(resp.template_time_us[2], 0, "%d");
+
+	/* THEN version 0 is unchanged. */
+	TEST_EQ(test_send_host_command(EC_CMD_FP_STATS, 0, NULL, 0, &resp,
+				       sizeof(struct ec_response_fp_stats)),
+		EC_RES_SUCCESS, "%d");
+
+	mock_ctrl_fp_sensor = MOCK_CTRL_DEFAULT_FP_SENSOR;
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	RUN_TEST(test_fp_enc_status_valid_flags);
@@ -194,5 +301,8 @@ void run_test(int argc, char **argv)
 	RUN_TEST(test_set_fp_tpm_seed_again);
 	RUN_TEST(test_fp_set_sensor_mode);
 	RUN_TEST(test_fp_set_maintenance_mode);
+	RUN_TEST(test_fp_match_most_recent_first);
+	RUN_TEST(test_fp_match_stops_early);
+	RUN_TEST(test_fp_command_stats);
 	test_print_result();
 }
@@ -0,0 +1,205 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test running CHIPSET_* hooks concurrently on hook worker tasks.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "hooks.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+struct hook_run {
+	task_id_t task;
+	timestamp_t start;
+	timestamp_t end;
+};
+
+static void run_for(struct hook_run *r, int ms)
+{
+	uint64_t deadline;
+
+	r->task = task_get_current();
+	r->start = get_time();
+
+	/* The emulator's sleeps end early on any event, like a wake */
+	deadline = r->start.val + ms * MSEC;
+	while (get_time().val < deadline)
+		usleep(deadline - get_time().val);
+
+	r->end = get_time();
+}
+
+/*****************************************************************************/
+/* Simulated resume work */
+
+/*
+ * A sensor, a retimer and a TCPC to bring back up, each on its own bus, and
+ * the TCPC's low-power exit to do once it's up.  And a routine that hasn't
+ * said it can run alongside the others.
+ */
+#define SENSOR_MS 20
+#define RETIMER_MS 30
+#define TCPC_MS 25
+#define TCPC_LPM_MS 5
+#define LEGACY_MS 10
+#define SERIAL_MS (SENSOR_MS + RETIMER_MS + TCPC_MS + TCPC_LPM_MS + LEGACY_MS)
+
+static struct hook_run sensor_run, retimer_run, tcpc_run, tcpc_lpm_run;
+static struct hook_run legacy_run, last_run;
+static uint64_t last_start_after;
+
+static void sensor_resume(void)
+{
+	run_for(&sensor_run, SENSOR_MS);
+}
+DECLARE_CONCURRENT_HOOK(HOOK_CHIPSET_RESUME, sensor_resume, HOOK_PRIO_DEFAULT,
+			NULL);
+
+static void retimer_resume(void)
+{
+	run_for(&retimer_run, RETIMER_MS);
+}
+DECLARE_CONCURRENT_HOOK(HOOK_CHIPSET_RESUME, retimer_resume,
+			HOOK_PRIO_DEFAULT, NULL);
+
+static void tcpc_resume(void)
+{
+	run_for(&tcpc_run, TCPC_MS);
+}
+DECLARE_CONCURRENT_HOOK(HOOK_CHIPSET_RESUME, tcpc_resume, HOOK_PRIO_DEFAULT,
+			NULL);
+
+static void tcpc_lpm_exit(void)
+{
+	run_for(&tcpc_lpm_run, TCPC_LPM_MS);
+}
+DECLARE_CONCURRENT_HOOK(HOOK_CHIPSET_RESUME, tcpc_lpm_exit,
+			HOOK_PRIO_DEFAULT, tcpc_resume);
+
+static void legacy_resume(void)
+{
+	run_for(&legacy_run, LEGACY_MS);
+}
+DECLARE_HOOK(HOOK_CHIPSET_RESUME, legacy_resume, HOOK_PRIO_DEFAULT);
+
+static void last_resume(void)
+{
+	/* When everything of the priority before was done */
+	last_start_after = MAX(MAX(sensor_run.end.val, retimer_run.end.val),
+			       MAX(tcpc_lpm_run.end.val, legacy_run.end.val));
+	run_for(&last_run, 0);
+}
+DECLARE_HOOK(HOOK_CHIPSET_RESUME, last_resume, HOOK_PRIO_LAST);
+
+/* Routines that wait for each other still get run */
+static int loop_a_runs, loop_b_runs;
+static void loop_b(void);
+
+static void loop_a(void)
+{
+	loop_a_runs++;
+}
+DECLARE_CONCURRENT_HOOK(HOOK_CHIPSET_SUSPEND, loop_a, HOOK_PRIO_DEFAULT,
+			loop_b);
+
+static void loop_b(void)
+{
+	loop_b_runs++;
+}
+DECLARE_CONCURRENT_HOOK(HOOK_CHIPSET_SUSPEND, loop_b, HOOK_PRIO_DEFAULT,
+			loop_a);
+
+/* Other hook types are run as usual */
+static struct hook_run ac_a_run, ac_b_run;
+
+static void ac_change_a(void)
+{
+	run_for(&ac_a_run, 5);
+}
+DECLARE_CONCURRENT_HOOK(HOOK_AC_CHANGE, ac_change_a, HOOK_PRIO_DEFAULT, NULL);
+
+static void ac_change_b(void)
+{
+	run_for(&ac_b_run, 5);
+}
+DECLARE_CONCURRENT_HOOK(HOOK_AC_CHANGE, ac_change_b, HOOK_PRIO_DEFAULT, NULL);
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_resume_latency(void)
+{
+	timestamp_t start = get_time();
+	int ms;
+
+	hook_notify(HOOK_CHIPSET_RESUME);
+	ms = (get_time().val - start.val) / MSEC;
+	ccprintf("resume hooks took %d ms, %d ms one at a time\n", ms,
+		 SERIAL_MS);
+
+	/* No longer than the slowest chain, with a worker for each */
+	TEST_ASSERT(ms >= RETIMER_MS);
+	TEST_ASSERT(ms <= MAX(RETIMER_MS, TCPC_MS + TCPC_LPM_MS) + 1);
+
+	/* Everything ran, on more than one task */
+	TEST_ASSERT(sensor_run.end.val && retimer_run.end.val);
+	TEST_ASSERT(tcpc_run.end.val && tcpc_lpm_run.end.val);
+	TEST_ASSERT(legacy_run.end.val && last_run.end.val);
+	TEST_ASSERT(sensor_run.task != retimer_run.task ||
+		    sensor_run.task != tcpc_run.task);
+
+	return EC_SUCCESS;
+}
+
+static int test_ordering(void)
+{
+	/* The low-power exit waited for the TCPC */
+	TEST_ASSERT(tcpc_lpm_run.start.val >= tcpc_run.end.val);
+
+	/* The routine that didn't opt in ran on the notifying task */
+	TEST_EQ(legacy_run.task, task_get_current(), "%d");
+
+	/* And the next priority waited for all of the last */
+	TEST_EQ(last_run.task, task_get_current(), "%d");
+	TEST_ASSERT(last_run.start.val >= last_start_after);
+
+	return EC_SUCCESS;
+}
+
+static int test_ordering_loop(void)
+{
+	hook_notify(HOOK_CHIPSET_SUSPEND);
+	TEST_EQ(loop_a_runs, 1, "%d");
+	TEST_EQ(loop_b_runs, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_other_types(void)
+{
+	hook_notify(HOOK_AC_CHANGE);
+	TEST_EQ(ac_a_run.task, task_get_current(), "%d");
+	TEST_EQ(ac_b_run.task, task_get_current(), "%d");
+	TEST_ASSERT(ac_a_run.end.val <= ac_b_run.start.val ||
+		    ac_b_run.end.val <= ac_a_run.start.val);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_resume_latency);
+	RUN_TEST(test_ordering);
+	RUN_TEST(test_ordering_loop);
+	RUN_TEST(test_other_types);
+
+	test_print_result();
+}
@@ -31,6 +31,10 @@
 		old = fifo_add_count; \
 	} while (0)
 
+/* Runtime keys use the default volume up position */
+#define KEYBOARD_ROW_VOL_UP KEYBOARD_DEFAULT_ROW_VOL_UP
+#define KEYBOARD_COL_VOL_UP KEYBOARD_DEFAULT_COL_VOL_UP
+
 static uint8_t mock_state[KEYBOARD_COLS_MAX];
 static int column_driven;
 static int fifo_add_count;
@@ -201,6 +205,84 @@ static int deghost_test(void)
 	return EC_SUCCESS;
 }
 
+/* Reference O(cols^2) ghosting check, for comparison */
+static int ref_has_ghosting(const uint8_t *state)
+{
+	int c, c2;
+
+	for (c = 0; c < keyboard_cols; c++) {
+		for (c2 = c + 1; c2 < keyboard_cols; c2++) {
+			uint8_t common = state[c] & state[c2];
+
+			if (common & (common - 1))
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+static int deghost_pattern_test(void)
+{
+	uint8_t state[KEYBOARD_COLS_MAX] = { 0 };
+	uint32_t seed = 0x1234;
+	int i, c;
+
+	TEST_ASSERT(!has_ghosting(state));
+
+	/* (1, 1) (1, 2) (2, 1) (2, 2) form ghosting keys */
+	state[1] = BIT(1) | BIT(2);
+	state[2] = BIT(1) | BIT(2);
+	TEST_ASSERT(has_ghosting(state));
+
+	/* Releasing one corner clears it */
+	state[2] = BIT(2);
+	TEST_ASSERT(!has_ghosting(state));
+
+	/* (1, 1) (2, 0) (2, 1) don't form ghosting keys */
+	state[0] = BIT(2);
+	state[1] = BIT(1) | BIT(2);
+	state[2] = 0;
+	TEST_ASSERT(!has_ghosting(state));
+
+	/* Ghosting between the first and the last column */
+	memset(state, 0, sizeof(state));
+	state[0] = BIT(3) | BIT(7);
+	state[keyboard_cols - 1] = BIT(3) | BIT(7);
+	TEST_ASSERT(has_ghosting(state));
+
+	/* Another pair sharing two rows, then releasing the first pair */
+	state[5] = BIT(0) | BIT(4);
+	state[9] = BIT(0) | BIT(4) | BIT(6);
+	TEST_ASSERT(has_ghosting(state));
+	state[0] = 0;
+	state[keyboard_cols - 1] = 0;
+	TEST_ASSERT(has_ghosting(state));
+	state[9] = BIT(4) | BIT(6);
+	TEST_ASSERT(!has_ghosting(state));
+
+	/* Many columns sharing a single row never ghost */
+	for (c = 0; c < keyboard_cols; c++)
+		state[c] = BIT(5);
+	TEST_ASSERT(!has_ghosting(state));
+
+	/* Random sequences, changing a few columns at a time */
+	for (i = 0; i < 2000; i++) {
+		seed = prng(seed);
+		c = seed % keyboard_cols;
+		/* Keep the matrix sparse most of the time */
+		state[c] = (seed >> 8) & (seed >> 16) & (seed >> 24);
+		if ((seed & 0xf) == 0)
+			memset(state, 0, sizeof(state));
+		TEST_ASSERT(has_ghosting(state) == ref_has_ghosting(state));
+	}
+
+	memset(state, 0, sizeof(state));
+	TEST_ASSERT(!has_ghosting(state));
+
+	return EC_SUCCESS;
+}
+
 static int debounce_test(void)
 {
 	int old_count = fifo_add_count;
@@ -424,6 +506,7 @@ static void run_test_step1(void)
 	test_reset();
 
 	RUN_TEST(deghost_test);
+	RUN_TEST(deghost_pattern_test);
 	RUN_TEST(debounce_test);
 	RUN_TEST(simulate_key_test);
 #ifdef EMU_BUILD
@@ -0,0 +1,318 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the OCPC charging loop against a simulated battery and charger.
+ */
+
+#include "battery.h"
+#include "charge_state_v2.h"
+#include "charger.h"
+#include "chipset.h"
+#include "common.h"
+#include "console.h"
+#include "math_util.h"
+#include "ocpc.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/*****************************************************************************/
+/* Simulated battery and charger */
+
+/*
+ * The secondary charger drives VSYS, and the battery takes whatever current
+ * the drop across Rsys+Rbatt gives. The fuel gauge averages that over about
+ * two iterations of the loop, and the pack voltage creeps up as it charges.
+ */
+#define PLANT_MOHMS 150
+#define VBATT_START_MV 7600
+#define CHARGE_MV 8400
+#define CHARGE_MA 2000
+
+static int plant_vsys_mv;
+static int plant_vbatt_uv;
+static int plant_ibatt_ma;
+static int plant_ibus_ma;
+static int plant_icl_reached;
+static int desired_ma = CHARGE_MA;
+
+static void plant_step(void)
+{
+	int i = MAX(plant_vsys_mv - plant_vbatt_uv / 1000, 0) * 1000 /
+		PLANT_MOHMS;
+
+	plant_ibatt_ma += (i - plant_ibatt_ma) / 2;
+	plant_vbatt_uv += plant_ibatt_ma / 20;
+	plant_ibus_ma = plant_ibatt_ma / 2;
+}
+
+static const struct battery_info bat_info = {
+	.voltage_max = 8400,
+	.voltage_normal = 7400,
+	.voltage_min = 6000,
+	.precharge_current = 64,
+};
+
+const struct battery_info *battery_get_info(void)
+{
+	return &bat_info;
+}
+
+void battery_get_params(struct batt_params *batt)
+{
+	memset(batt, 0, sizeof(*batt));
+	batt->voltage = plant_vbatt_uv / 1000;
+	batt->current = plant_ibatt_ma;
+	batt->desired_voltage = CHARGE_MV;
+	batt->desired_current = desired_ma;
+	batt->is_present = BP_YES;
+}
+
+int battery_is_charge_fet_disabled(void)
+{
+	return 0;
+}
+
+enum battery_disconnect_state battery_get_disconnect_state(void)
+{
+	return BATTERY_NOT_DISCONNECTED;
+}
+
+int charge_get_active_chg_chip(void)
+{
+	return CHARGER_SECONDARY;
+}
+
+uint8_t board_get_charger_chip_count(void)
+{
+	return CHARGER_NUM;
+}
+
+static const struct charger_info chg_info = {
+	.name = "MockCharger",
+	.current_step = 64,
+};
+
+const struct charger_info *charger_get_info(void)
+{
+	return &chg_info;
+}
+
+void charger_get_params(struct charger_params *chg)
+{
+	memset(chg, 0, sizeof(*chg));
+}
+
+enum ec_error_list charger_set_vsys_compensation(int chgnum,
+						 struct ocpc_data *ocpc,
+						 int current_ma,
+						 int voltage_mv)
+{
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+enum ec_error_list charger_enable_linear_charge(int chgnum, bool enable)
+{
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+enum ec_error_list charger_is_icl_reached(int chgnum, bool *reached)
+{
+	*reached = plant_icl_reached;
+	return EC_SUCCESS;
+}
+
+enum ec_error_list charger_set_voltage(int chgnum, int voltage)
+{
+	if (chgnum == CHARGER_SECONDARY)
+		plant_vsys_mv = voltage;
+	return EC_SUCCESS;
+}
+
+enum ec_error_list charger_get_voltage(int chgnum, int *voltage)
+{
+	/* The primary only sees VSYS past Rsys, which isn't modeled */
+	*voltage = chgnum == CHARGER_SECONDARY ? plant_vsys_mv :
+						 plant_vbatt_uv / 1000;
+	return EC_SUCCESS;
+}
+
+enum ec_error_list charger_get_current(int chgnum, int *current)
+{
+	return EC_ERROR_UNIMPLEMENTED;
+}
+
+enum ec_error_list charger_get_vbus_voltage(int port, int *voltage)
+{
+	*voltage = port == CHARGER_SECONDARY ? 15000 : 0;
+	return EC_SUCCESS;
+}
+
+enum ec_error_list charger_get_input_current(int chgnum, int *input_current)
+{
+	*input_current = chgnum == CHARGER_SECONDARY ? plant_ibus_ma : 0;
+	return EC_SUCCESS;
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+static struct ocpc_data ocpc;
+
+struct step_response {
+	int settle;		/* Iterations to stay within 5% of target */
+	int overshoot;		/* mA */
+	int ripple;		/* mA peak to peak, over the second half */
+};
+
+static void start_charging(void)
+{
+	plant_vbatt_uv = VBATT_START_MV * 1000;
+	plant_ibatt_ma = 0;
+	plant_icl_reached = 0;
+	desired_ma = CHARGE_MA;
+
+	memset(&ocpc, 0, sizeof(ocpc));
+	ocpc.active_chg_chip = CHARGER_SECONDARY;
+	ocpc.chg_flags[CHARGER_SECONDARY] = OCPC_NO_ISYS_MEAS_CAP;
+	ocpc_init(&ocpc);
+	ocpc_reset(&ocpc);
+}
+
+static void run_loop(int iterations, struct step_response *r)
+{
+	int input_current = 3000;
+	int lo = INT32_MAX;
+	int hi = 0;
+	int n, err;
+
+	memset(r, 0, sizeof(*r));
+	for (n = 0; n < iterations; n++) {
+		plant_step();
+		ocpc_config_secondary_charger(&input_current, &ocpc,
+					      CHARGE_MV, desired_ma);
+
+		err = plant_ibatt_ma - desired_ma;
+		r->overshoot = MAX(r->overshoot, err);
+		if (ABS(err) > desired_ma / 20)
+			r->settle = n + 1;
+		if (n >= iterations / 2) {
+			lo = MIN(lo, plant_ibatt_ma);
+			hi = MAX(hi, plant_ibatt_ma);
+		}
+	}
+	r->ripple = hi - lo;
+}
+
+static struct step_response default_start;
+static struct step_response default_step;
+
+/* Start charging, then drop to half the current once it's settled */
+static void run_steps(struct step_response *start, struct step_response *step)
+{
+	start_charging();
+	run_loop(100, start);
+	desired_ma = CHARGE_MA / 2;
+	run_loop(100, step);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_default_gains(void)
+{
+	/* With the system on, nothing is measured, so nothing is tuned */
+	test_chipset_on();
+	msleep(30);
+	run_steps(&default_start, &default_step);
+	ccprintf("default gains: started in %d, overshoot %dmA\n",
+		 default_start.settle, default_start.overshoot);
+	ccprintf("default gains: stepped in %d, ripple %dmA\n",
+		 default_step.settle, default_step.ripple);
+	TEST_EQ(ocpc.combined_rsys_rbatt_mo, CONFIG_OCPC_DEF_RBATT_MOHMS, "%d");
+
+	/* Ramping up doesn't wind up the loop */
+	TEST_ASSERT(default_start.overshoot <= CHARGE_MA / 20);
+
+	return EC_SUCCESS;
+}
+
+static int test_characterize(void)
+{
+	struct step_response r;
+
+	/* Charging with the system off measures the resistance */
+	test_chipset_off();
+	msleep(30);
+	start_charging();
+	run_loop(300, &r);
+	test_chipset_on();
+	msleep(30);
+
+	ccprintf("measured %dmOhm\n", ocpc.combined_rsys_rbatt_mo);
+	TEST_ASSERT(ABS(ocpc.combined_rsys_rbatt_mo - PLANT_MOHMS) <=
+		    PLANT_MOHMS / 10);
+
+	return EC_SUCCESS;
+}
+
+static int test_tuned_gains(void)
+{
+	struct step_response start, step;
+
+	run_steps(&start, &step);
+	ccprintf("tuned gains: started in %d, overshoot %dmA\n",
+		 start.settle, start.overshoot);
+	ccprintf("tuned gains: stepped in %d, ripple %dmA\n",
+		 step.settle, step.ripple);
+	TEST_ASSERT(ABS(ocpc.combined_rsys_rbatt_mo - PLANT_MOHMS) <=
+		    PLANT_MOHMS / 10);
+
+	TEST_ASSERT(start.settle < default_start.settle / 2);
+	TEST_ASSERT(start.overshoot <= CHARGE_MA / 20);
+	TEST_ASSERT(step.settle < default_step.settle / 2);
+	TEST_ASSERT(step.ripple <= chg_info.current_step / 4);
+	TEST_ASSERT(step.ripple < default_step.ripple / 4);
+
+	return EC_SUCCESS;
+}
+
+static int test_input_limited(void)
+{
+	struct step_response r;
+
+	start_charging();
+	desired_ma = CHARGE_MA / 2;
+	run_loop(100, &r);
+
+	/*
+	 * A higher target that can't be met for a while doesn't wind the loop
+	 * up: once the limit goes away, it doesn't overshoot.
+	 */
+	desired_ma = CHARGE_MA;
+	plant_icl_reached = 1;
+	run_loop(100, &r);
+	TEST_ASSERT(ABS(plant_ibatt_ma - CHARGE_MA / 2) <= CHARGE_MA / 20);
+
+	plant_icl_reached = 0;
+	run_loop(200, &r);
+	ccprintf("after input limit: settled in %d, overshoot %dmA\n",
+		 r.settle, r.overshoot);
+	TEST_ASSERT(r.overshoot <= CHARGE_MA / 20);
+	TEST_ASSERT(ABS(plant_ibatt_ma - CHARGE_MA) <= CHARGE_MA / 20);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_default_gains);
+	RUN_TEST(test_characterize);
+	RUN_TEST(test_tuned_gains);
+	RUN_TEST(test_input_limited);
+
+	test_print_result();
+}
@@ -0,0 +1,380 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test the power sequencing timeline against a simulated chipset.
+ */
+
+#include "chipset.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "gpio.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "power.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+const struct power_signal_info power_signal_list[] = {
+	[PP3300_A_PGOOD] = {
+		GPIO_PG_PP3300_A, POWER_SIGNAL_ACTIVE_HIGH, "PP3300_A_PGOOD"
+	},
+	[SLP_S5_DEASSERTED] = {
+		GPIO_SLP_S5_L, POWER_SIGNAL_ACTIVE_HIGH, "SLP_S5_DEASSERTED"
+	},
+	[SLP_S3_DEASSERTED] = {
+		GPIO_SLP_S3_L, POWER_SIGNAL_ACTIVE_HIGH, "SLP_S3_DEASSERTED"
+	},
+};
+BUILD_ASSERT(ARRAY_SIZE(power_signal_list) == POWER_SIGNAL_COUNT);
+
+#define IN_PGOOD POWER_SIGNAL_MASK(PP3300_A_PGOOD)
+#define IN_SLP_S5 POWER_SIGNAL_MASK(SLP_S5_DEASSERTED)
+#define IN_SLP_S3 POWER_SIGNAL_MASK(SLP_S3_DEASSERTED)
+
+/*****************************************************************************/
+/* Simulated chipset */
+
+/*
+ * The rails take RAIL_RAMP_MS to come up, then the AP takes AP_BOOT_MS to
+ * leave S5 and AP_RESUME_MS more to leave S3.
+ */
+#define RAIL_RAMP_MS 5
+#define AP_BOOT_MS 20
+#define AP_RESUME_MS 10
+
+/* And a couple of hooks that take their time */
+#define SLOW_RESUME_MS 30
+#define SLOW_SUSPEND_MS 5
+
+static void sim_ap_resume(void)
+{
+	gpio_set_level(GPIO_SLP_S3_L, 1);
+}
+DECLARE_DEFERRED(sim_ap_resume);
+
+static void sim_ap_boot(void)
+{
+	gpio_set_level(GPIO_SLP_S5_L, 1);
+	hook_call_deferred(&sim_ap_resume_data, AP_RESUME_MS * MSEC);
+}
+DECLARE_DEFERRED(sim_ap_boot);
+
+static void sim_rails_up(void)
+{
+	gpio_set_level(GPIO_PG_PP3300_A, 1);
+	hook_call_deferred(&sim_ap_boot_data, AP_BOOT_MS * MSEC);
+}
+DECLARE_DEFERRED(sim_rails_up);
+
+void chipset_force_shutdown(enum chipset_shutdown_reason reason)
+{
+	gpio_set_level(GPIO_SLP_S3_L, 0);
+	gpio_set_level(GPIO_SLP_S5_L, 0);
+}
+
+void chipset_reset(enum chipset_reset_reason reason)
+{
+}
+
+enum power_state power_chipset_init(void)
+{
+	return POWER_G3;
+}
+
+enum power_state power_handle_state(enum power_state state)
+{
+	switch (state) {
+	case POWER_G3S5:
+		hook_call_deferred(&sim_rails_up_data, RAIL_RAMP_MS * MSEC);
+		if (power_wait_signals(IN_PGOOD))
+			return POWER_S5G3;
+		return POWER_S5;
+
+	case POWER_S5:
+		if (power_get_signals() & IN_SLP_S5)
+			return POWER_S5S3;
+		break;
+
+	case POWER_S5S3:
+		hook_notify(HOOK_CHIPSET_STARTUP);
+		return POWER_S3;
+
+	case POWER_S3:
+		if (power_get_signals() & IN_SLP_S3)
+			return POWER_S3S0;
+		if (!(power_get_signals() & IN_SLP_S5))
+			return POWER_S3S5;
+		break;
+
+	case POWER_S3S0:
+		hook_notify(HOOK_CHIPSET_RESUME);
+		return POWER_S0;
+
+	case POWER_S0:
+		if (!(power_get_signals() & IN_SLP_S3))
+			return POWER_S0S3;
+		break;
+
+	case POWER_S0S3:
+		hook_notify(HOOK_CHIPSET_SUSPEND);
+		return POWER_S3;
+
+	case POWER_S3S5:
+		hook_notify(HOOK_CHIPSET_SHUTDOWN);
+		return POWER_S5;
+
+	case POWER_S5G3:
+		gpio_set_level(GPIO_PG_PP3300_A, 0);
+		hook_notify(HOOK_CHIPSET_SHUTDOWN_COMPLETE);
+		return POWER_G3;
+
+	default:
+		break;
+	}
+
+	return state;
+}
+
+static void slow_resume(void)
+{
+	msleep(SLOW_RESUME_MS);
+}
+DECLARE_HOOK(HOOK_CHIPSET_RESUME, slow_resume, HOOK_PRIO_DEFAULT);
+
+static void slow_suspend(void)
+{
+	msleep(SLOW_SUSPEND_MS);
+}
+DECLARE_HOOK(HOOK_CHIPSET_SUSPEND, slow_suspend, HOOK_PRIO_DEFAULT);
+
+/*****************************************************************************/
+/* Test utilities */
+
+/* Read a few entries at a time, to exercise paging */
+#define PAGE_ENTRIES 4
+
+static struct ec_power_timeline_entry entries[CONFIG_POWER_TIMELINE_ENTRIES];
+static uint32_t next_seq;
+
+static int get_timeline(uint32_t seq, struct ec_response_power_timeline *r,
+			int size)
+{
+	struct ec_params_power_timeline p = { .seq = seq };
+
+	return test_send_host_command(EC_CMD_POWER_TIMELINE, 0, &p, sizeof(p),
+				      r, size);
+}
+
+/* Read whatever has been added since the last call, and return how much */
+static int read_timeline(void)
+{
+	struct {
+		struct ec_response_power_timeline r;
+		struct ec_power_timeline_entry e[PAGE_ENTRIES];
+	} resp;
+	int count = 0;
+
+	do {
+		if (get_timeline(next_seq, &resp.r, sizeof(resp)) ||
+		    resp.r.seq != next_seq ||
+		    count + resp.r.count > ARRAY_SIZE(entries))
+			return -1;
+		memcpy(entries + count, resp.r.entries,
+		       resp.r.count * sizeof(entries[0]));
+		count += resp.r.count;
+		next_seq = resp.r.next_seq;
+	} while (resp.r.count);
+
+	return count;
+}
+
+/* Index of the first matching entry at or after from, or -1 */
+static int find(int count, int from, int type, int id)
+{
+	int i;
+
+	for (i = MAX(from, 0); i < count; i++)
+		if (entries[i].type == type && entries[i].id == id)
+			return i;
+	return -1;
+}
+
+static int find_hook(int count, int from, void (*routine)(void))
+{
+	int i;
+
+	for (i = MAX(from, 0); i < count; i++)
+		if (entries[i].type == EC_POWER_TIMELINE_HOOK &&
+		    entries[i].arg == (uint32_t)(uintptr_t)routine)
+			return i;
+	return -1;
+}
+
+static int since(int from, int to)
+{
+	return entries[to].time_us - entries[from].time_us;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_power_on(void)
+{
+	int n, g3s5, s5, s5s3, s3, s3s0, s0, i, latency;
+
+	TEST_ASSERT(read_timeline() >= 0);
+	chipset_exit_hard_off();
+	msleep(100);
+	TEST_ASSERT(chipset_in_state(CHIPSET_STATE_ON));
+
+	n = read_timeline();
+	TEST_ASSERT(n > 0);
+	g3s5 = find(n, 0, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_G3S5);
+	s5 = find(n, g3s5, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S5);
+	s5s3 = find(n, s5, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S5S3);
+	s3 = find(n, s5s3, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S3);
+	s3s0 = find(n, s3, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S3S0);
+	s0 = find(n, s3s0, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S0);
+	TEST_ASSERT(g3s5 >= 0 && s5 >= 0 && s5s3 >= 0);
+	TEST_ASSERT(s3 >= 0 && s3s0 >= 0 && s0 >= 0);
+
+	/* The wait for the rails, and the edge that ended it */
+	i = find(n, g3s5, EC_POWER_TIMELINE_WAIT, 0);
+	TEST_ASSERT(i > g3s5 && i < s5);
+	TEST_EQ(entries[i].arg, IN_PGOOD, "0x%x");
+	TEST_EQ(entries[i].value, 0, "%d");
+	TEST_ASSERT(entries[i].duration_us >= RAIL_RAMP_MS * MSEC);
+	TEST_ASSERT(entries[i].duration_us <= (RAIL_RAMP_MS + 1) * MSEC);
+	i = find(n, g3s5, EC_POWER_TIMELINE_SIGNAL, PP3300_A_PGOOD);
+	TEST_ASSERT(i > g3s5 && i < s5);
+	TEST_EQ(entries[i].value, 1, "%d");
+
+	/* The AP left S5, which started the S5->S0 transition */
+	i = find(n, s5, EC_POWER_TIMELINE_SIGNAL, SLP_S5_DEASSERTED);
+	TEST_ASSERT(i > s5 && i < s5s3);
+	TEST_EQ(entries[i].value, 1, "%d");
+
+	/* Which took as long as the AP did, and the slow hook */
+	i = find_hook(n, s3s0, slow_resume);
+	TEST_ASSERT(i > s3s0 && i < s0);
+	TEST_EQ(entries[i].id, EC_POWER_TIMELINE_HOOK_RESUME, "%d");
+	TEST_ASSERT(entries[i].duration_us >= SLOW_RESUME_MS * MSEC);
+	TEST_ASSERT(entries[i].duration_us <= (SLOW_RESUME_MS + 1) * MSEC);
+
+	latency = since(s5s3, s0);
+	ccprintf("S5->S0 took %d us\n", latency);
+	TEST_ASSERT(latency >= (AP_RESUME_MS + SLOW_RESUME_MS) * MSEC);
+	TEST_ASSERT(latency <= (AP_RESUME_MS + SLOW_RESUME_MS + 2) * MSEC);
+
+	return EC_SUCCESS;
+}
+
+static int test_suspend(void)
+{
+	int n, edge, s0s3, s3, i, latency;
+
+	gpio_set_level(GPIO_SLP_S3_L, 0);
+	msleep(20);
+	TEST_ASSERT(chipset_in_state(CHIPSET_STATE_SUSPEND));
+
+	n = read_timeline();
+	TEST_ASSERT(n > 0);
+	edge = find(n, 0, EC_POWER_TIMELINE_SIGNAL, SLP_S3_DEASSERTED);
+	s0s3 = find(n, edge, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S0S3);
+	s3 = find(n, s0s3, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S3);
+	TEST_ASSERT(edge >= 0 && s0s3 > edge && s3 > s0s3);
+	TEST_EQ(entries[edge].value, 0, "%d");
+
+	i = find_hook(n, s0s3, slow_suspend);
+	TEST_ASSERT(i > s0s3 && i < s3);
+	TEST_EQ(entries[i].id, EC_POWER_TIMELINE_HOOK_SUSPEND, "%d");
+	TEST_ASSERT(entries[i].duration_us >= SLOW_SUSPEND_MS * MSEC);
+
+	latency = since(edge, s3);
+	ccprintf("S0->S3 took %d us\n", latency);
+	TEST_ASSERT(latency >= SLOW_SUSPEND_MS * MSEC);
+	TEST_ASSERT(latency <= (SLOW_SUSPEND_MS + 2) * MSEC);
+
+	return EC_SUCCESS;
+}
+
+static int test_overrun(void)
+{
+	struct ec_response_power_timeline r;
+	uint32_t next;
+	int i;
+
+	/* Enough suspend/resume cycles to go round the ring */
+	for (i = 0; i < CONFIG_POWER_TIMELINE_ENTRIES / 4; i++) {
+		gpio_set_level(GPIO_SLP_S3_L, 1);
+		msleep(50);
+		TEST_ASSERT(chipset_in_state(CHIPSET_STATE_ON));
+		gpio_set_level(GPIO_SLP_S3_L, 0);
+		msleep(20);
+		TEST_ASSERT(chipset_in_state(CHIPSET_STATE_SUSPEND));
+	}
+
+	/* Asking for the future gets nothing, but says where the end is */
+	TEST_EQ(get_timeline(next_seq + 1000, &r, sizeof(r)), EC_RES_SUCCESS,
+		"%d");
+	TEST_EQ(r.count, 0, "%d");
+	TEST_EQ(r.seq, r.next_seq, "%d");
+	next = r.next_seq;
+	TEST_ASSERT(next - next_seq > CONFIG_POWER_TIMELINE_ENTRIES);
+
+	/* Asking for what's been overwritten skips to the oldest entry */
+	TEST_EQ(get_timeline(next_seq, &r, sizeof(r)), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.seq, next - CONFIG_POWER_TIMELINE_ENTRIES, "%d");
+
+	/* From where the whole ring can be read */
+	next_seq = r.seq;
+	TEST_EQ(read_timeline(), CONFIG_POWER_TIMELINE_ENTRIES, "%d");
+	TEST_EQ(next_seq, next, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_shutdown(void)
+{
+	int n, edge, s3s5, s5, s5g3, g3;
+
+	gpio_set_level(GPIO_SLP_S5_L, 0);
+	msleep(20);
+	TEST_ASSERT(chipset_in_state(CHIPSET_STATE_SOFT_OFF));
+
+	n = read_timeline();
+	edge = find(n, 0, EC_POWER_TIMELINE_SIGNAL, SLP_S5_DEASSERTED);
+	s3s5 = find(n, edge, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S3S5);
+	s5 = find(n, s3s5, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S5);
+	TEST_ASSERT(edge >= 0 && s3s5 > edge && s5 > s3s5);
+	TEST_EQ(entries[edge].value, 0, "%d");
+
+	/* And off altogether, once the AP has been gone a while */
+	sleep(11);
+	TEST_ASSERT(chipset_in_state(CHIPSET_STATE_HARD_OFF));
+	n = read_timeline();
+	s5g3 = find(n, 0, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_S5G3);
+	g3 = find(n, s5g3, EC_POWER_TIMELINE_STATE, EC_POWER_TIMELINE_G3);
+	TEST_ASSERT(s5g3 >= 0 && g3 > s5g3);
+	TEST_ASSERT(since(s5g3, g3) < MSEC);
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	/* Let the chipset task settle in G3 */
+	msleep(10);
+
+	RUN_TEST(test_power_on);
+	RUN_TEST(test_suspend);
+	RUN_TEST(test_overrun);
+	RUN_TEST(test_shutdown);
+
+	test_print_result();
+}
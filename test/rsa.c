@@ -8,6 +8,7 @@
 #include "console.h"
 #include "common.h"
 #include "rsa.h"
+#include "sha256.h"
 #include "test_util.h"
 #include "util.h"
 
@@ -25,6 +26,7 @@ static uint32_t rsa_workbuf[3 * RSANUMBYTES/4];
 
 void run_test(int argc, char **argv)
 {
+	uint8_t digest[SHA256_DIGEST_SIZE];
 	int good;
 
 	good = rsa_verify(rsa_key, sig, hash, rsa_workbuf);
@@ -53,6 +55,23 @@ void run_test(int argc, char **argv)
 	}
 	ccprintf("RSA verify FAILED (as expected)\n");
 
+	/* The signed digest can be recovered without the hash */
+	good = rsa_recover_digest(rsa_key, sig, digest, rsa_workbuf);
+	if (!good || memcmp(digest, hash, sizeof(digest))) {
+		ccprintf("RSA digest recovery FAILED\n");
+		test_fail();
+		return;
+	}
+	ccprintf("RSA digest recovery OK\n");
+
+	good = rsa_recover_digest(rsa_key, sig+1, digest, rsa_workbuf);
+	if (good) {
+		ccprintf("RSA digest recovery OK (expected fail)\n");
+		test_fail();
+		return;
+	}
+	ccprintf("RSA digest recovery FAILED (as expected)\n");
+
 	test_pass();
 }
 
@@ -0,0 +1,331 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Tests for the SFDP-based Serial NOR flash driver, against a simulated part */
+
+#include "common.h"
+#include "console.h"
+#include "spi.h"
+#include "spi_nor.h"
+#include "sfdp.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#define SIM_CAPACITY (64 * 1024)
+#define SIM_PAGE_SIZE 256
+
+/* Simulated busy time, in SPI clocks, of page program and sector erase */
+#define SIM_PROGRAM_CLOCKS 1024
+#define SIM_ERASE_CLOCKS 8192
+
+/* SFDP v1.5 header, one parameter header, BFPT v1.5 at 0x10 */
+static const uint32_t sim_sfdp[] = {
+	SFDP_HEADER_DWORD_1('S', 'F', 'D', 'P'),
+	SFDP_HEADER_DWORD_2(0, 1, 5),
+	SFDP_1_5_PARAMETER_HEADER_DWORD_1(16, 1, 5,
+			BASIC_FLASH_PARAMETER_TABLE_1_5_ID_LSB),
+	SFDP_1_5_PARAMETER_HEADER_DWORD_2(
+			BASIC_FLASH_PARAMETER_TABLE_1_5_ID_MSB, 0x10),
+	/* DW1: 1-1-2 Fast Read, 3B addressing, 4KiB erase */
+	BFPT_1_0_DWORD_1(0, 0, 0, 0, 0, 1, 0x20, 0, 0, 1, 1),
+	BFPT_1_0_DWORD_2(0, SIM_CAPACITY * 8 - 1),
+	0xffffffff,
+	BFPT_1_0_DWORD_4(0xff, 0, 0, 0x3b, 0, 8),
+	0xffffffff,
+	0xffffffff,
+	0xffffffff,
+	BFPT_1_0_DWORD_8(0xd8, 16, 0x20, 12),
+	0xffffffff,
+	0xffffffff,
+	BFPT_1_5_DWORD_11(0, 0, 0, 0, 0, 0, 0, 0, 8, 0),
+	0xffffffff,
+	0xffffffff,
+	0xffffffff,
+	0xffffffff,
+	0xffffffff,
+};
+
+static struct {
+	uint8_t flash[SIM_CAPACITY];
+	int wel;
+	int in_4b;
+	uint64_t busy_until;
+	/* Statistics */
+	uint64_t clocks;
+	int transactions;
+	int violations;
+	uint8_t last_opcode;
+} sim;
+
+struct spi_nor_device_t spi_nor_devices[] = {
+	{
+		.name = "sim",
+		.spi_master = SPI_NOR_DEVICE,
+		.timeout_usec = SECOND,
+		/* Defaults, which SFDP discovery updates */
+		.capacity = 4096,
+		.page_size = 1,
+		.in_4b_addressing_mode = 0,
+	},
+};
+const unsigned int spi_nor_devices_used = ARRAY_SIZE(spi_nor_devices);
+
+/*****************************************************************************/
+/* Simulated SPI NOR device */
+
+static uint32_t sim_address(const uint8_t *txdata, int *len)
+{
+	if (sim.in_4b) {
+		*len = 5;
+		return (txdata[1] << 24) | (txdata[2] << 16) |
+		       (txdata[3] << 8) | txdata[4];
+	}
+	*len = 4;
+	return (txdata[1] << 16) | (txdata[2] << 8) | txdata[3];
+}
+
+/* Overrides the mock in chip/host/spi_master.c */
+int spi_transaction(const struct spi_device_t *spi_device,
+		    const uint8_t *txdata, int txlen,
+		    uint8_t *rxdata, int rxlen)
+{
+	int busy = sim.clocks < sim.busy_until;
+	uint32_t addr;
+	int len;
+	int i;
+
+	sim.clocks += 8 * (txlen + rxlen);
+	sim.transactions++;
+	sim.last_opcode = txdata[0];
+
+	/* Only the status register may be accessed while busy */
+	if (busy && txdata[0] != SPI_NOR_OPCODE_READ_STATUS) {
+		sim.violations++;
+		return EC_ERROR_BUSY;
+	}
+
+	switch (txdata[0]) {
+	case SPI_NOR_OPCODE_READ_STATUS:
+		rxdata[0] = (busy ? SPI_NOR_STATUS_REGISTER_WIP : 0) |
+			    (sim.wel ? SPI_NOR_STATUS_REGISTER_WEL : 0);
+		break;
+	case SPI_NOR_OPCODE_WRITE_ENABLE:
+		sim.wel = 1;
+		break;
+	case SPI_NOR_OPCODE_WRITE_DISABLE:
+		sim.wel = 0;
+		break;
+	case SPI_NOR_DRIVER_SPECIFIED_OPCODE_ENTER_4B:
+	case SPI_NOR_DRIVER_SPECIFIED_OPCODE_EXIT_4B:
+		sim.in_4b =
+			txdata[0] == SPI_NOR_DRIVER_SPECIFIED_OPCODE_ENTER_4B;
+		sim.wel = 0;
+		break;
+	case SPI_NOR_OPCODE_JEDEC_ID:
+		memset(rxdata, 0, rxlen);
+		rxdata[0] = 0xef;
+		break;
+	case SPI_NOR_OPCODE_SFDP:
+		addr = (txdata[1] << 16) | (txdata[2] << 8) | txdata[3];
+		for (i = 0; i < rxlen; i++, addr++)
+			rxdata[i] = addr < sizeof(sim_sfdp) ?
+				((const uint8_t *)sim_sfdp)[addr] : 0xff;
+		break;
+	case SPI_NOR_OPCODE_SLOW_READ:
+	case SPI_NOR_OPCODE_FAST_READ:
+		addr = sim_address(txdata, &len);
+		/* Fast Read needs 8 wait state clocks after the address */
+		if (txdata[0] == SPI_NOR_OPCODE_FAST_READ)
+			len++;
+		if (txlen != len || addr + rxlen > SIM_CAPACITY)
+			return EC_ERROR_INVAL;
+		memcpy(rxdata, sim.flash + addr, rxlen);
+		break;
+	case SPI_NOR_OPCODE_PAGE_PROGRAM:
+		addr = sim_address(txdata, &len);
+		if (!sim.wel || addr >= SIM_CAPACITY)
+			return EC_ERROR_ACCESS_DENIED;
+		/* Data past the end of the page wraps around, as on hardware */
+		for (i = len; i < txlen; i++) {
+			sim.flash[addr] &= txdata[i];
+			addr = (addr & ~(SIM_PAGE_SIZE - 1)) |
+			       ((addr + 1) & (SIM_PAGE_SIZE - 1));
+		}
+		sim.wel = 0;
+		sim.busy_until = sim.clocks + SIM_PROGRAM_CLOCKS;
+		break;
+	case SPI_NOR_DRIVER_SPECIFIED_OPCODE_4KIB_ERASE:
+	case SPI_NOR_DRIVER_SPECIFIED_OPCODE_64KIB_ERASE:
+		addr = sim_address(txdata, &len);
+		i = txdata[0] == SPI_NOR_DRIVER_SPECIFIED_OPCODE_4KIB_ERASE ?
+			4096 : 65536;
+		if (!sim.wel || addr % i || addr + i > SIM_CAPACITY)
+			return EC_ERROR_ACCESS_DENIED;
+		memset(sim.flash + addr, 0xff, i);
+		sim.wel = 0;
+		sim.busy_until = sim.clocks + SIM_ERASE_CLOCKS;
+		break;
+	default:
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+
+	return EC_SUCCESS;
+}
+
+static void sim_reset_stats(void)
+{
+	sim.clocks = 0;
+	sim.busy_until = 0;
+	sim.transactions = 0;
+	sim.violations = 0;
+}
+
+static void sim_report(const char *name, int bytes)
+{
+	ccprintf("%s: %d Bytes, %d transactions, %d clocks, "
+		 "%d.%03d Bytes/clock\n", name, bytes, sim.transactions,
+		 (int)sim.clocks, (int)(bytes / sim.clocks),
+		 (int)(bytes * 1000ULL / sim.clocks % 1000));
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_sfdp_init(void)
+{
+	const struct spi_nor_device_t *dev = &spi_nor_devices[0];
+
+	TEST_ASSERT(spi_nor_init() == EC_SUCCESS);
+
+	TEST_EQ(dev->capacity, SIM_CAPACITY, "%d");
+	TEST_EQ((int)dev->page_size, SIM_PAGE_SIZE, "%d");
+	TEST_EQ(dev->in_4b_addressing_mode, 0, "%d");
+	TEST_EQ(dev->read_opcode, SPI_NOR_OPCODE_FAST_READ, "%d");
+	TEST_EQ(dev->read_dummy_bytes, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_read(void)
+{
+	const struct spi_nor_device_t *dev = &spi_nor_devices[0];
+	static uint8_t data[3 * CONFIG_SPI_NOR_MAX_READ_SIZE];
+	int i;
+
+	for (i = 0; i < SIM_CAPACITY; i++)
+		sim.flash[i] = i * 7 + (i >> 8);
+
+	/* Unaligned reads spanning several chunks */
+	sim_reset_stats();
+	TEST_ASSERT(spi_nor_read(dev, 0x123, sizeof(data), data) ==
+		    EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(data, sim.flash + 0x123, sizeof(data));
+	TEST_EQ(sim.transactions, 3, "%d");
+	TEST_EQ(sim.last_opcode, SPI_NOR_OPCODE_FAST_READ, "%d");
+	sim_report("Fast read", sizeof(data));
+
+	/* At most 5 command Bytes of overhead per chunk */
+	TEST_ASSERT(sim.clocks <= 8 * (sizeof(data) + 3 * 5));
+
+	/* A small read is a single transaction */
+	sim_reset_stats();
+	TEST_ASSERT(spi_nor_read(dev, SIM_CAPACITY - 3, 3, data) ==
+		    EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(data, sim.flash + SIM_CAPACITY - 3, 3);
+	TEST_EQ(sim.transactions, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_slow_read(void)
+{
+	struct spi_nor_device_t *dev = &spi_nor_devices[0];
+	uint8_t opcode = dev->read_opcode;
+	uint8_t dummy = dev->read_dummy_bytes;
+	uint8_t data[300];
+	int rv;
+
+	/* Without CONFIG_SPI_NOR_FAST_READ, parts use the slow read opcode */
+	dev->read_opcode = 0;
+	dev->read_dummy_bytes = 0;
+	sim_reset_stats();
+	rv = spi_nor_read(dev, 0x4000, sizeof(data), data);
+	dev->read_opcode = opcode;
+	dev->read_dummy_bytes = dummy;
+
+	TEST_ASSERT(rv == EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(data, sim.flash + 0x4000, sizeof(data));
+	TEST_EQ(sim.last_opcode, SPI_NOR_OPCODE_SLOW_READ, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_erase(void)
+{
+	const struct spi_nor_device_t *dev = &spi_nor_devices[0];
+	int i;
+
+	TEST_EQ(spi_nor_erase(dev, 0x1001, 4096), EC_ERROR_INVAL, "%d");
+	TEST_EQ(spi_nor_erase(dev, 0x1000, 100), EC_ERROR_INVAL, "%d");
+
+	sim_reset_stats();
+	TEST_ASSERT(spi_nor_erase(dev, 0x1000, 3 * 4096) == EC_SUCCESS);
+	TEST_EQ(sim.violations, 0, "%d");
+	for (i = 0x1000; i < 0x4000; i++)
+		TEST_ASSERT(sim.flash[i] == 0xff);
+	/* Neighbors are untouched */
+	TEST_ASSERT(sim.flash[0xfff] != 0xff || sim.flash[0xffe] != 0xff);
+	TEST_ASSERT(sim.flash[0x4000] == (uint8_t)(0x4000 * 7 + 0x40));
+
+	return EC_SUCCESS;
+}
+
+static int test_write(void)
+{
+	const struct spi_nor_device_t *dev = &spi_nor_devices[0];
+	static uint8_t data[2000];
+	int offset = 0x1000 + 100;
+	int i;
+
+	for (i = 0; i < sizeof(data); i++)
+		data[i] = i ^ 0x5a;
+
+	sim_reset_stats();
+	TEST_ASSERT(spi_nor_write(dev, offset, sizeof(data), data) ==
+		    EC_SUCCESS);
+	sim_report("Page program", sizeof(data));
+
+	/* Every page program waited for the previous one */
+	TEST_EQ(sim.violations, 0, "%d");
+	/* The last page program finished before returning */
+	TEST_ASSERT(sim.clocks >= sim.busy_until);
+	TEST_ASSERT_ARRAY_EQ(sim.flash + offset, data, sizeof(data));
+	TEST_ASSERT(sim.flash[offset - 1] == 0xff);
+	TEST_ASSERT(sim.flash[offset + sizeof(data)] == 0xff);
+
+	/* Read it back through the driver */
+	memset(data, 0, sizeof(data));
+	TEST_ASSERT(spi_nor_read(dev, offset, sizeof(data), data) ==
+		    EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(sim.flash + offset, data, sizeof(data));
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	memset(sim.flash, 0xff, sizeof(sim.flash));
+
+	RUN_TEST(test_sfdp_init);
+	RUN_TEST(test_read);
+	RUN_TEST(test_slow_read);
+	RUN_TEST(test_erase);
+	RUN_TEST(test_write);
+
+	test_print_result();
+}
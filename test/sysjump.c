@@ -0,0 +1,259 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test preserving state across a jump between images, and timing the jump.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "panic.h"
+#include "sysjump.h"
+#include "system.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* A tag of the sort modules add without a slot */
+#define TEST_SYSJUMP_TAG 0x5453 /* "TS" */
+#define TEST_SYSJUMP_VERSION 3
+
+static const uint8_t test_state[] = { 0x12, 0x34, 0x56, 0x78, 0x9a };
+
+#define SYSJUMP_DELAY_US (5 * MSEC)
+#define INIT_DELAY_US (3 * MSEC)
+
+static void test_preserve_state(void)
+{
+	/* Slow to preserve its state */
+	udelay(SYSJUMP_DELAY_US);
+	system_add_jump_tag(TEST_SYSJUMP_TAG, TEST_SYSJUMP_VERSION,
+			    sizeof(test_state), test_state);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, test_preserve_state, HOOK_PRIO_DEFAULT);
+
+/*
+ * The emulator keeps its clock across jumps by itself, so preserve the time
+ * as common/timer.c does on an EC.
+ */
+static void test_preserve_time(void)
+{
+	timestamp_t ts = get_time();
+
+	system_add_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+			     sizeof(ts), &ts);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, test_preserve_time, HOOK_PRIO_DEFAULT);
+
+static void test_restore_state(void)
+{
+	/* And slow to start up again */
+	udelay(INIT_DELAY_US);
+}
+DECLARE_HOOK(HOOK_INIT, test_restore_state, HOOK_PRIO_DEFAULT);
+
+static struct jump_data *get_jump_data(void)
+{
+	return (struct jump_data *)(get_panic_data_start() -
+				    sizeof(struct jump_data));
+}
+
+/* Start the image again, as if it had just been jumped to */
+static void restart_after_jump(void)
+{
+	get_jump_data()->magic = JUMP_DATA_MAGIC;
+	system_common_pre_init();
+}
+
+static const timestamp_t *get_timer_slot(void)
+{
+	return system_get_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+				    sizeof(timestamp_t));
+}
+
+static int get_timing(int type, int index,
+		      struct ec_response_sysjump_timing *r, int size)
+{
+	struct ec_params_sysjump_timing p = {
+		.type = type,
+		.index = index,
+	};
+
+	return test_send_host_command(EC_CMD_SYSJUMP_TIMING, 0, &p, sizeof(p),
+				      r, size);
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_before_jump(void)
+{
+	struct ec_response_sysjump_timing r;
+
+	/* Only allowed while jumping */
+	TEST_NE(system_add_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+				     sizeof(test_state), test_state),
+		EC_SUCCESS, "%d");
+
+	/* Nothing to time yet */
+	TEST_EQ(get_timing(EC_SYSJUMP_TIMING_INIT, 0, &r, sizeof(r)),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.flags, 0, "0x%x");
+	TEST_EQ(r.run, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_jump(void)
+{
+	system_run_image_copy(EC_IMAGE_RW);
+
+	/* Shouldn't reach here */
+	return EC_ERROR_UNKNOWN;
+}
+
+static int test_slots(void)
+{
+	const uint8_t *data;
+	int version, size;
+
+	/* The timer's slot was found, but only as the version it is */
+	TEST_NE(get_timer_slot(), NULL, "%p");
+	TEST_EQ(system_get_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION + 1,
+				     sizeof(timestamp_t)), NULL, "%p");
+	TEST_EQ(system_get_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+				     sizeof(uint32_t)), NULL, "%p");
+
+	/* Nothing preserved the keyboard's state */
+	TEST_EQ(system_get_jump_slot(JUMP_TAG_KEYBOARD, 2, 3), NULL, "%p");
+
+	/* Tags without a slot are still found */
+	data = system_get_jump_tag(TEST_SYSJUMP_TAG, &version, &size);
+	TEST_NE(data, NULL, "%p");
+	TEST_EQ(version, TEST_SYSJUMP_VERSION, "%d");
+	TEST_EQ(size, (int)sizeof(test_state), "%d");
+	TEST_ASSERT_ARRAY_EQ(data, test_state, sizeof(test_state));
+
+	return EC_SUCCESS;
+}
+
+static int test_timing(void)
+{
+	struct {
+		struct ec_response_sysjump_timing r;
+		struct ec_sysjump_timing_hook hooks[16];
+	} resp;
+	struct ec_response_sysjump_timing *r = &resp.r;
+	uint32_t test_init = (uint32_t)(uintptr_t)test_restore_state;
+	int found = 0;
+	int i;
+
+	UART_INJECT("sysjumptime\n");
+	msleep(30);
+
+	TEST_EQ(get_timing(EC_SYSJUMP_TIMING_SYSJUMP, 0, r, sizeof(resp)),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(r->flags, EC_SYSJUMP_TIMING_JUMPED | EC_SYSJUMP_TIMING_PREV,
+		"0x%x");
+	TEST_ASSERT(r->sysjump_us >= SYSJUMP_DELAY_US);
+	TEST_ASSERT(r->init_us >= INIT_DELAY_US);
+	TEST_ASSERT(r->run >= 1);
+	TEST_EQ(r->count, r->kept, "%d");
+	for (i = 0; i < r->count; i++)
+		found |= r->hooks[i].duration_us >= SYSJUMP_DELAY_US;
+	TEST_ASSERT(found);
+
+	/* This image's HOOK_INIT routines can be told apart */
+	TEST_EQ(get_timing(EC_SYSJUMP_TIMING_INIT, 0, r, sizeof(resp)),
+		EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(r->run > 1);
+	found = 0;
+	for (i = 0; i < r->count; i++) {
+		if (r->hooks[i].routine == test_init) {
+			TEST_ASSERT(r->hooks[i].duration_us >= INIT_DELAY_US);
+			found = 1;
+		}
+	}
+	TEST_ASSERT(found);
+
+	/* And read a few at a time */
+	TEST_EQ(get_timing(EC_SYSJUMP_TIMING_INIT, 1, r, sizeof(resp)),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(r->count, MIN(r->kept - 1, (int)ARRAY_SIZE(resp.hooks)), "%d");
+
+	TEST_EQ(get_timing(3, 0, r, sizeof(resp)), EC_RES_INVALID_PARAM, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_corrupt(void)
+{
+	uint8_t *data;
+	int size;
+
+	UART_INJECT("jumptags\n");
+	msleep(30);
+
+	/* Something scribbles on the tags between images */
+	data = (uint8_t *)system_get_jump_tag(TEST_SYSJUMP_TAG, NULL, &size);
+	TEST_NE(data, NULL, "%p");
+	data[1] ^= 0x01;
+	restart_after_jump();
+
+	/* None of them can be trusted */
+	TEST_EQ(get_timer_slot(), NULL, "%p");
+	TEST_EQ(system_get_jump_tag(TEST_SYSJUMP_TAG, NULL, &size), NULL,
+		"%p");
+	TEST_EQ(get_jump_data()->jump_tag_total, 0, "%d");
+	TEST_EQ(system_get_reset_flags() & EC_RESET_FLAG_SYSJUMP,
+		EC_RESET_FLAG_SYSJUMP, "0x%x");
+
+	return EC_SUCCESS;
+}
+
+static int test_no_checksum(void)
+{
+	const timestamp_t t = { .val = 0x123456789aULL };
+	struct jump_data *jd = get_jump_data();
+
+	/*
+	 * An image from before the checksum adds its tags just the same, but
+	 * leaves them unsealed.
+	 */
+	jd->magic = JUMP_DATA_MAGIC;
+	jd->jump_tag_total = 0;
+	TEST_EQ(system_add_jump_slot(JUMP_TAG_TIMER, TIMER_SYSJUMP_VERSION,
+				     sizeof(t), &t), EC_SUCCESS, "%d");
+	TEST_EQ(system_add_jump_tag(TEST_SYSJUMP_TAG, TEST_SYSJUMP_VERSION,
+				    sizeof(test_state), test_state),
+		EC_SUCCESS, "%d");
+	restart_after_jump();
+
+	/* They're taken as they are */
+	TEST_NE(get_timer_slot(), NULL, "%p");
+	TEST_EQ(get_timer_slot()->le.lo, t.le.lo, "0x%x");
+	TEST_EQ(get_timer_slot()->le.hi, t.le.hi, "0x%x");
+	TEST_NE(system_get_jump_tag(TEST_SYSJUMP_TAG, NULL, NULL), NULL, "%p");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	if (system_get_image_copy() == EC_IMAGE_RO) {
+		RUN_TEST(test_before_jump);
+		RUN_TEST(test_jump);
+	} else {
+		RUN_TEST(test_slots);
+		RUN_TEST(test_timing);
+		RUN_TEST(test_corrupt);
+		RUN_TEST(test_no_checksum);
+	}
+
+	test_print_result();
+}
@@ -0,0 +1,123 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Tests for per-task scheduling statistics */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+/* Time the worker spends busy for each wakeup */
+#define WORK_US 1000
+
+#define EVENT_A TASK_EVENT_CUSTOM_BIT(0)
+#define EVENT_B TASK_EVENT_CUSTOM_BIT(1)
+
+void worker_task(void *u)
+{
+	while (1) {
+		task_wait_event(-1);
+		udelay(WORK_US);
+	}
+}
+
+static int get_stats(int task_id, int flags, struct ec_response_task_stats *r)
+{
+	struct ec_params_task_stats params;
+
+	memset(&params, 0, sizeof(params));
+	params.task_id = task_id;
+	params.flags = flags;
+
+	return test_send_host_command(EC_CMD_TASK_STATS, 0, &params,
+				      sizeof(params), r, sizeof(*r));
+}
+
+static void send_and_run(uint32_t event)
+{
+	task_set_event(TASK_ID_WORKER, event);
+	/* Let the worker run and go back to waiting */
+	msleep(10);
+}
+
+static int test_wakeups(void)
+{
+	struct ec_response_task_stats r;
+
+	TEST_EQ(get_stats(TASK_ID_WORKER, EC_TASK_STATS_RESET, &r),
+		EC_RES_SUCCESS, "%d");
+
+	send_and_run(EVENT_A);
+	send_and_run(EVENT_A);
+	send_and_run(EVENT_A | EVENT_B);
+
+	TEST_EQ(get_stats(TASK_ID_WORKER, 0, &r), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(strncmp(r.name, "WORKER", sizeof(r.name)) == 0);
+	TEST_EQ(r.task_count, TASK_ID_COUNT, "%d");
+	TEST_EQ(r.wakeups, 3, "%d");
+	TEST_EQ(r.event_wakeups[0], 3, "%d");
+	TEST_EQ(r.event_wakeups[1], 1, "%d");
+	TEST_EQ(r.event_wakeups[2], 0, "%d");
+	TEST_ASSERT(r.run_time_us >= 3 * WORK_US);
+	TEST_ASSERT(r.stack_used > 0);
+
+	/* Reading with the reset flag reports, then clears the counters */
+	TEST_EQ(get_stats(TASK_ID_WORKER, EC_TASK_STATS_RESET, &r),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.wakeups, 3, "%d");
+	TEST_EQ(get_stats(TASK_ID_WORKER, 0, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.wakeups, 0, "%d");
+	TEST_EQ(r.event_wakeups[0], 0, "%d");
+	TEST_ASSERT(r.run_time_us == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_latency(void)
+{
+	struct ec_response_task_stats r;
+
+	TEST_EQ(get_stats(TASK_ID_WORKER, EC_TASK_STATS_RESET, &r),
+		EC_RES_SUCCESS, "%d");
+
+	/*
+	 * The test runner has the highest priority, so the worker can't run
+	 * until it sleeps: the latency covers the whole busy wait.
+	 */
+	task_set_event(TASK_ID_WORKER, EVENT_A);
+	udelay(5 * WORK_US);
+	msleep(10);
+
+	TEST_EQ(get_stats(TASK_ID_WORKER, 0, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.wakeups, 1, "%d");
+	TEST_ASSERT(r.max_latency_us >= 5 * WORK_US);
+
+	return EC_SUCCESS;
+}
+
+static int test_invalid_task(void)
+{
+	struct ec_response_task_stats r;
+
+	TEST_EQ(get_stats(TASK_ID_COUNT, 0, &r), EC_RES_INVALID_PARAM, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+	wait_for_task_started();
+
+	RUN_TEST(test_wakeups);
+	RUN_TEST(test_latency);
+	RUN_TEST(test_invalid_task);
+
+	test_print_result();
+}
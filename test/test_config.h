@@ -31,6 +31,11 @@
 #define CONFIG_BASE32
 #endif
 
+#ifdef TEST_BOOT_TIMELINE
+#define CONFIG_BOOT_TIMELINE
+#define CONFIG_LAZY_INIT
+#endif
+
 #ifdef TEST_BKLIGHT_LID
 #define CONFIG_BACKLIGHT_LID
 #endif
@@ -49,6 +54,12 @@
 #define CONFIG_MALLOC
 #endif
 
+#ifdef TEST_FLASH_WRITE_QUEUE
+#define CONFIG_FLASH_DEFERRED_ERASE
+#define CONFIG_FLASH_WRITE_QUEUE
+#define CONFIG_VBOOT_HASH
+#endif
+
 #ifdef TEST_KB_8042
 #define CONFIG_KEYBOARD_PROTOCOL_8042
 #endif
@@ -260,6 +271,24 @@ enum sensor_id {
 #define CONFIG_MALLOC
 #endif
 
+#ifdef TEST_SPI_NOR
+#define CONFIG_CMD_SPI_NOR
+#define CONFIG_SPI_NOR
+#define CONFIG_SPI_NOR_MAX_MESSAGE_SIZE 264
+#define CONFIG_SPI_NOR_MAX_READ_SIZE 256
+#define CONFIG_SPI_NOR_MAX_WRITE_SIZE 256
+#define CONFIG_SPI_NOR_FAST_READ
+#define SPI_NOR_DEVICE_COUNT 1
+enum spi_device {
+	SPI_NOR_DEVICE = 0,
+};
+#endif
+
+#ifdef TEST_SYSJUMP
+#define CONFIG_CMD_JUMPTAGS
+#define CONFIG_SYSJUMP_TIMING
+#endif
+
 #ifdef TEST_SBS_CHARGING_V2
 #define CONFIG_BATTERY
 #define CONFIG_BATTERY_MOCK
@@ -277,6 +306,29 @@ int board_discharge_on_ac(int enabled);
 #define I2C_PORT_CHARGER 0
 #endif
 
+#ifdef TEST_OCPC
+#define CONFIG_OCPC
+#define CONFIG_OCPC_DEF_RBATT_MOHMS 60
+#define CONFIG_OCPC_PID_AUTOTUNE
+#undef CONFIG_CHARGER_SINGLE_CHIP
+#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+#endif
+
+#ifdef TEST_POWER_TIMELINE
+#define CONFIG_POWER_COMMON
+#define CONFIG_POWER_TIMELINE
+enum power_signal {
+	PP3300_A_PGOOD,
+	SLP_S5_DEASSERTED,
+	SLP_S3_DEASSERTED,
+	POWER_SIGNAL_COUNT,
+};
+#endif
+
+#ifdef TEST_TASK_STATS
+#define CONFIG_TASK_STATS
+#endif
+
 #ifdef TEST_THERMAL
 #define CONFIG_CHIPSET_CAN_THROTTLE
 #define CONFIG_FANS 1
@@ -290,10 +342,28 @@ int board_discharge_on_ac(int enabled);
 int ncp15wb_calculate_temp(uint16_t adc);
 #endif
 
+#ifdef TEST_THERMAL_RAMP
+#define CONFIG_CHIPSET_CAN_THROTTLE
+#define CONFIG_FANS 1
+#define CONFIG_TEMP_SENSOR
+#define CONFIG_THROTTLE_AP
+#define CONFIG_THERMAL_FAST_SAMPLE_MS 50
+#define CONFIG_THERMAL_FAN_PID
+#endif
+
 #ifdef TEST_FAN
 #define CONFIG_FANS 1
 #endif
 
+#ifdef TEST_FAN_RPM_CONTROL
+#define CONFIG_FANS 1
+#define CONFIG_FAN_RPM_CONTROL
+#endif
+
+#ifdef TEST_HOOK_CONCURRENT
+#define CONFIG_HOOK_CONCURRENT
+#endif
+
 #ifdef TEST_BUTTON
 #define CONFIG_KEYBOARD_PROTOCOL_8042
 #undef CONFIG_KEYBOARD_VIVALDI
@@ -328,6 +398,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_PD_TCPMV1
 #define CONFIG_USB_PD_PORT_MAX_COUNT 1
 #define CONFIG_USB_PD_TCPC
+#define CONFIG_USB_PD_TCPC_BMC_BYTE_TABLE
 #define CONFIG_USB_PD_TCPM_STUB
 #define CONFIG_SHA256
 #define CONFIG_SW_CRC
@@ -568,9 +639,11 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #endif
 
 #ifdef TEST_VBOOT
+#define CONFIG_CMD_RWSIG_TIMING
 #define CONFIG_RWSIG
 #define CONFIG_SHA256
 #define CONFIG_RSA
+#define CONFIG_RSA_EXPONENT_3
 #define CONFIG_RWSIG_TYPE_RWSIG
 #define CONFIG_RW_B
 #define CONFIG_RW_B_MEM_OFF		CONFIG_RO_MEM_OFF
@@ -589,6 +662,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 
 #ifdef TEST_X25519
 #define CONFIG_CURVE25519
+#define CONFIG_CURVE25519_FIXED_BASE
 #endif /* TEST_X25519 */
 
 #ifdef TEST_I2C_BITBANG
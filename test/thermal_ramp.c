@@ -0,0 +1,259 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Test fast thermal sampling and PID fan control against simulated
+ * temperature ramps.
+ */
+
+#include "chipset.h"
+#include "common.h"
+#include "console.h"
+#include "fan.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "temp_sensor.h"
+#include "test_util.h"
+#include "thermal.h"
+#include "timer.h"
+#include "util.h"
+
+/*****************************************************************************/
+/* Exported data */
+
+struct ec_thermal_config thermal_params[TEMP_SENSOR_COUNT];
+
+/*****************************************************************************/
+/* Mock functions */
+
+static int mock_temp[TEMP_SENSOR_COUNT];
+static int host_throttled;
+static int cpu_throttled;
+static int cpu_shutdown;
+static int fan_pct;
+
+int mock_temp_get_val(int idx, int *temp_ptr)
+{
+	if (mock_temp[idx] >= 0) {
+		*temp_ptr = mock_temp[idx];
+		return EC_SUCCESS;
+	}
+
+	return EC_ERROR_NOT_POWERED;
+}
+
+void chipset_force_shutdown(enum chipset_shutdown_reason reason)
+{
+	cpu_shutdown = 1;
+}
+
+void chipset_throttle_cpu(int throttled)
+{
+	cpu_throttled = throttled;
+}
+
+void host_throttle_cpu(int throttled)
+{
+	host_throttled = throttled;
+}
+
+void fan_set_percent_needed(int fan, int pct)
+{
+	fan_pct = pct;
+}
+
+void smi_sensor_failure_warning(void)
+{
+}
+
+/*****************************************************************************/
+/* Test utilities */
+
+/* Ambient, and where the sensor would settle with no cooling at all */
+#define T_AMBIENT 300
+#define T_DRIVE 360
+
+static void reset_mocks(void)
+{
+	int i;
+
+	memset(thermal_params, 0, sizeof(thermal_params));
+	for (i = 0; i < TEMP_SENSOR_COUNT; i++)
+		mock_temp[i] = T_AMBIENT;
+
+	/* Let the thermal engine see the ambient temperatures */
+	sleep(2);
+
+	host_throttled = 0;
+	cpu_throttled = 0;
+	cpu_shutdown = 0;
+	fan_pct = 0;
+}
+
+/*
+ * Raise sensor 0 by step K every 10 ms until *flag is set, and return how
+ * long that took after the sensor went over limit, in us.
+ */
+static int ramp_until(int limit, int step, const int *flag)
+{
+	timestamp_t crossed = { .val = 0 };
+	int i;
+
+	/* Thresholds are picked up on the next full pass */
+	sleep(1);
+
+	for (i = 0; i < 1000 && !*flag; i++) {
+		mock_temp[0] += step;
+		if (!crossed.val && mock_temp[0] > limit)
+			crossed = get_time();
+		msleep(10);
+	}
+
+	if (!*flag || !crossed.val)
+		return -1;
+	return get_time().val - crossed.val;
+}
+
+/*****************************************************************************/
+/* Tests */
+
+static int test_time_to_throttle(void)
+{
+	int latency;
+
+	reset_mocks();
+	thermal_params[0].temp_host[EC_TEMP_THRESH_HIGH] = 350;
+
+	latency = ramp_until(350, 1, &cpu_throttled);
+	ccprintf("time to throttle: %d ms\n", latency / MSEC);
+	TEST_ASSERT(latency >= 0);
+	TEST_ASSERT(latency <= (CONFIG_THERMAL_FAST_SAMPLE_MS + 20) * MSEC);
+
+	/* And it's released just as quickly */
+	mock_temp[0] = 340;
+	msleep(CONFIG_THERMAL_FAST_SAMPLE_MS + 20);
+	TEST_ASSERT(cpu_throttled == 0);
+
+	return EC_SUCCESS;
+}
+
+static int test_time_to_shutdown(void)
+{
+	int latency;
+
+	reset_mocks();
+	thermal_params[0].temp_host[EC_TEMP_THRESH_HIGH] = 350;
+	thermal_params[0].temp_host[EC_TEMP_THRESH_HALT] = 370;
+
+	latency = ramp_until(370, 5, &cpu_shutdown);
+	ccprintf("time to shutdown: %d ms\n", latency / MSEC);
+	TEST_ASSERT(latency >= 0);
+	TEST_ASSERT(latency <= (CONFIG_THERMAL_FAST_SAMPLE_MS + 20) * MSEC);
+	TEST_ASSERT(cpu_throttled);
+
+	return EC_SUCCESS;
+}
+
+static int test_warn_is_not_fast(void)
+{
+	int latency;
+
+	reset_mocks();
+	thermal_params[0].temp_host[EC_TEMP_THRESH_WARN] = 350;
+
+	/* WARN only sensors are still sampled once a second */
+	latency = ramp_until(350, 1, &host_throttled);
+	ccprintf("time to warn: %d ms\n", latency / MSEC);
+	TEST_ASSERT(latency >= 0);
+	TEST_ASSERT(latency <= SECOND + 20 * MSEC);
+
+	return EC_SUCCESS;
+}
+
+/*
+ * Simulate sensor 2 in 1/1000 K, heated towards T_DRIVE and cooled by the
+ * fan, for the given number of seconds.
+ */
+static int simulate_plant(int *t_mk, int seconds)
+{
+	int i;
+
+	for (i = 0; i < seconds * 10; i++) {
+		/* 0.05/s towards T_DRIVE, less 0.05 K/s for each percent */
+		*t_mk += (T_DRIVE * 1000 - *t_mk) / 200 - 5 * fan_pct;
+		mock_temp[2] = *t_mk / 1000;
+		msleep(100);
+	}
+
+	return mock_temp[2];
+}
+
+static int test_pid_holds_target(void)
+{
+	int t_mk = T_AMBIENT * 1000;
+	int t;
+
+	reset_mocks();
+	thermal_params[2].temp_fan_off = 300;
+	thermal_params[2].temp_fan_max = 340;
+
+	/*
+	 * The linear curve would settle this plant around 317 K; the loop
+	 * holds it at the middle of the fan range instead.
+	 */
+	t = simulate_plant(&t_mk, 300);
+	ccprintf("settled at %d K, fan %d%%\n", t, fan_pct);
+	TEST_ASSERT(t >= 319 && t <= 321);
+	TEST_ASSERT(fan_pct >= 35 && fan_pct <= 45);
+
+	/* A step in load is recovered from too */
+	t_mk += 5000;
+	t = simulate_plant(&t_mk, 120);
+	TEST_ASSERT(t >= 319 && t <= 321);
+
+	return EC_SUCCESS;
+}
+
+static int test_pid_fallback(void)
+{
+	int t_mk = T_AMBIENT * 1000;
+
+	reset_mocks();
+	thermal_params[2].temp_fan_off = 300;
+	thermal_params[2].temp_fan_max = 340;
+	thermal_params[3].temp_fan_off = 300;
+	thermal_params[3].temp_fan_max = 400;
+	simulate_plant(&t_mk, 60);
+
+	/* Losing a fan sensor drops back to the linear curve */
+	mock_temp[3] = -1;
+	mock_temp[2] = 330;
+	sleep(2);
+	TEST_EQ(fan_pct, thermal_fan_percent(300, 340, 330), "%d");
+
+	/* As does going past the top of the range */
+	mock_temp[3] = T_AMBIENT;
+	mock_temp[2] = 345;
+	sleep(2);
+	TEST_EQ(fan_pct, 100, "%d");
+
+	/* And back below the bottom of it */
+	mock_temp[2] = T_AMBIENT;
+	sleep(2);
+	TEST_EQ(fan_pct, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_time_to_throttle);
+	RUN_TEST(test_time_to_shutdown);
+	RUN_TEST(test_warn_is_not_fast);
+	RUN_TEST(test_pid_holds_target);
+	RUN_TEST(test_pid_fallback);
+
+	test_print_result();
+}
@@ -22,6 +22,8 @@
 #define BATTERY_FULL_CHARGE_CAPACITY 5131
 #define BATTERY_REMAINING_CAPACITY 2566
 
+#define CODEC_SPEED_ITERATIONS 1000
+
 struct pd_port_t {
 	int host_mode;
 	int has_vbus;
@@ -810,6 +812,104 @@ static int test_request_with_reject(void)
 	return EC_SUCCESS;
 }
 
+static int test_codec_roundtrip(void)
+{
+	uint32_t data[7], payload[7];
+	uint16_t header;
+	int port = PORT0;
+	int m, i, len;
+
+	/* Push every byte value through the encoder and the decoder */
+	for (m = 0; m < 256; m += sizeof(data)) {
+		for (i = 0; i < sizeof(data); ++i)
+			((uint8_t *)data)[i] = m + i;
+		header = PD_HEADER(PD_DATA_VENDOR_DEF, PD_ROLE_SOURCE,
+				   PD_ROLE_DFP, m % 7, ARRAY_SIZE(data),
+				   pd_port[port].rev, 0);
+
+		len = prepare_message(port, header, ARRAY_SIZE(data), data);
+		pd_test_tx_msg_loopback(port, len);
+		memset(payload, 0, sizeof(payload));
+		TEST_EQ(pd_analyze_rx(port, payload), header, "%d");
+		pd_tx_done(port, 0);
+		TEST_ASSERT_ARRAY_EQ((uint8_t *)payload, (uint8_t *)data,
+				     sizeof(data));
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_codec_invalid_symbol(void)
+{
+	uint32_t payload[1];
+	uint16_t header = PD_HEADER(PD_DATA_VENDOR_DEF, PD_ROLE_SOURCE,
+				    PD_ROLE_DFP, 0, 1, pd_port[PORT0].rev, 0);
+	int port = PORT0;
+
+	pd_test_rx_set_preamble(port, 1);
+	pd_test_rx_msg_append_sop(port);
+	pd_test_rx_msg_append_short(port, header);
+	/* Reserved symbol 00000 in the middle of the data object */
+	pd_test_rx_msg_append_short(port, 0x1234);
+	pd_test_rx_msg_append_bits(port, 0x00, 5);
+	pd_test_rx_msg_append_4b(port, 0x6);
+	pd_test_rx_msg_append_4b(port, 0x7);
+	pd_test_rx_msg_append_4b(port, 0x8);
+	pd_test_rx_msg_append_word(port, 0);
+	pd_test_rx_msg_append_eop(port);
+	pd_test_rx_msg_append_last_edge(port);
+	pd_test_rx_msg_ready(port);
+
+	/* Rejected on the symbol, before getting to the CRC */
+	TEST_EQ(pd_analyze_rx(port, payload), PD_RX_ERR_INVAL, "%d");
+	pd_tx_done(port, 0);
+
+	/* Also in the header, rather than going on with the last one */
+	pd_test_rx_set_preamble(port, 1);
+	pd_test_rx_msg_append_sop(port);
+	pd_test_rx_msg_append_4b(port, header & 0xF);
+	pd_test_rx_msg_append_bits(port, 0x00, 5);
+	pd_test_rx_msg_append_4b(port, (header >> 8) & 0xF);
+	pd_test_rx_msg_append_4b(port, header >> 12);
+	pd_test_rx_msg_append_word(port, 0);
+	pd_test_rx_msg_append_word(port, 0);
+	pd_test_rx_msg_append_eop(port);
+	pd_test_rx_msg_append_last_edge(port);
+	pd_test_rx_msg_ready(port);
+
+	TEST_EQ(pd_analyze_rx(port, payload), PD_RX_ERR_INVAL, "%d");
+	pd_tx_done(port, 0);
+
+	return EC_SUCCESS;
+}
+
+static void test_codec_speed(void)
+{
+	uint32_t data[7], payload[7];
+	uint16_t header = PD_HEADER(PD_DATA_VENDOR_DEF, PD_ROLE_SOURCE,
+				    PD_ROLE_DFP, 0, ARRAY_SIZE(data),
+				    pd_port[PORT0].rev, 0);
+	timestamp_t t0, t1;
+	int port = PORT0;
+	int i, len;
+
+	for (i = 0; i < ARRAY_SIZE(data); ++i)
+		data[i] = 0xa5c3e187 * (i + 1);
+
+	/* Encode, loop back and decode a max-size message */
+	t0 = get_time();
+	for (i = 0; i < CODEC_SPEED_ITERATIONS; ++i) {
+		len = prepare_message(port, header, ARRAY_SIZE(data), data);
+		pd_test_tx_msg_loopback(port, len);
+		pd_analyze_rx(port, payload);
+		pd_tx_done(port, 0);
+	}
+	t1 = get_time();
+	ccprintf("PD codec duration %lld us for %d messages (tReceive %d us)\n",
+		 (long long)(t1.val - t0.val), CODEC_SPEED_ITERATIONS,
+		 PD_T_RECEIVE_MAX_US);
+}
+
 static int test_request(void)
 {
 #ifdef CONFIG_USB_PD_GIVE_BACK
@@ -907,6 +1007,11 @@ void run_test(int argc, char **argv)
 	pd_set_dual_role(PORT0, PD_DRP_TOGGLE_ON);
 	pd_set_dual_role(PORT1, PD_DRP_TOGGLE_ON);
 
+	/* do not check speed, just as a benchmark */
+	test_codec_speed();
+
+	RUN_TEST(test_codec_roundtrip);
+	RUN_TEST(test_codec_invalid_symbol);
 	RUN_TEST(test_request);
 	RUN_TEST(test_sink);
 	RUN_TEST(test_request_with_wait);
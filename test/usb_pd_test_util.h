@@ -20,6 +20,8 @@ void pd_test_rx_msg_append_4b(int port, uint8_t val);
 void pd_test_rx_msg_append_short(int port, uint16_t val);
 void pd_test_rx_msg_append_word(int port, uint32_t val);
 void pd_simulate_rx(int port);
+void pd_test_rx_msg_ready(int port);
+void pd_test_tx_msg_loopback(int port, int len);
 
 /* Verify Tx message */
 int pd_test_tx_msg_verify_kcode(int port, uint8_t kcode);
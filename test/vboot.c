@@ -131,11 +131,45 @@ static int test_vboot(void)
 	return EC_SUCCESS;
 }
 
+static int test_rwsig_check_order(void)
+{
+	struct vboot_key k;
+	struct vboot_sig s;
+	const struct rwsig_timing *t = rwsig_get_timing();
+	uint8_t *rw = (uint8_t *)CONFIG_PROGRAM_MEMORY_BASE + CONFIG_RW_MEM_OFF;
+
+	reset_data(&k, &s);
+	memcpy((void *)CONFIG_RO_PUBKEY_ADDR, &k, sizeof(k));
+	memset(rw, 0xff, CONFIG_RW_SIZE);
+	memset(rw, 0x55, s.vb21_sig.data_size);
+	memcpy((void *)CONFIG_RW_SIG_ADDR, &s, sizeof(s));
+
+	/* The signature is well formed, but it doesn't sign this image. */
+	TEST_ASSERT(!rwsig_check_signature());
+	TEST_EQ(t->hash_bytes, s.vb21_sig.data_size, "%d");
+
+	/* A corrupted signature is rejected before RW is hashed. */
+	s.sig_data[0] ^= 0x01;
+	memcpy((void *)CONFIG_RW_SIG_ADDR, &s, sizeof(s));
+	TEST_ASSERT(!rwsig_check_signature());
+	TEST_EQ(t->hash_bytes, 0, "%d");
+
+	/* The timings of the last check are on the console. */
+	test_capture_console(1);
+	UART_INJECT("rwsigtiming\n");
+	msleep(30);
+	test_capture_console(0);
+	TEST_NE(strstr(test_get_captured_console(), "(0 bytes)"), NULL, "%p");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, char **argv)
 {
 	test_reset();
 
 	RUN_TEST(test_vboot);
+	RUN_TEST(test_rwsig_check_order);
 
 	test_print_result();
 }
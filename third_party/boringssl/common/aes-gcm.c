@@ -372,6 +372,14 @@ void gcm_ghash_p8(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
 #endif
 #endif
 
+// GCM_CTR_CHUNK is the number of bytes handed to a |ctr128_f| at once by the
+// *_ctr32 functions, before hashing them.
+#if defined(GHASH_CHUNK)
+#define GCM_CTR_CHUNK GHASH_CHUNK
+#else
+#define GCM_CTR_CHUNK 512
+#endif
+
 #ifdef GHASH
 // kSizeTWithoutLower4Bits is a mask that can be used to zero the lower four
 // bits of a |size_t|.
@@ -836,6 +844,206 @@ int CRYPTO_gcm128_decrypt(GCM128_CONTEXT *ctx, const void *key,
   return 1;
 }
 
+int CRYPTO_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream) {
+  unsigned int n, ctr;
+  uint64_t mlen = ctx->len.u[1];
+#ifdef GCM_FUNCREF_4BIT
+  void (*gcm_gmult_p)(uint64_t Xi[2], const u128 Htable[16]) = ctx->gmult;
+#ifdef GHASH
+  void (*gcm_ghash_p)(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
+                      size_t len) = ctx->ghash;
+#endif
+#endif
+
+  mlen += len;
+  if (mlen > ((UINT64_C(1) << 36) - 32) ||
+      (sizeof(len) == 8 && mlen < len)) {
+    return 0;
+  }
+  ctx->len.u[1] = mlen;
+
+  if (ctx->ares) {
+    // First call to encrypt finalizes GHASH(AAD)
+    GCM_MUL(ctx, Xi);
+    ctx->ares = 0;
+  }
+
+  n = ctx->mres;
+  if (n) {
+    while (n && len) {
+      ctx->Xi.c[n] ^= *(out++) = *(in++) ^ ctx->EKi.c[n];
+      --len;
+      n = (n + 1) % 16;
+    }
+    if (n == 0) {
+      GCM_MUL(ctx, Xi);
+    } else {
+      ctx->mres = n;
+      return 1;
+    }
+  }
+
+  ctr = CRYPTO_bswap4(ctx->Yi.d[3]);
+
+  // Hash each chunk right after encrypting it, while it is still in cache.
+  while (len >= GCM_CTR_CHUNK) {
+    (*stream)(in, out, GCM_CTR_CHUNK / 16, key, ctx->Yi.c);
+    ctr += GCM_CTR_CHUNK / 16;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+#ifdef GHASH
+    GHASH(ctx, out, GCM_CTR_CHUNK);
+#else
+    for (size_t j = 0; j < GCM_CTR_CHUNK; j += 16) {
+      for (size_t i = 0; i < 16; i += sizeof(size_t)) {
+        ctx->Xi.t[i / sizeof(size_t)] ^= load_word_le(out + j + i);
+      }
+      GCM_MUL(ctx, Xi);
+    }
+#endif
+    out += GCM_CTR_CHUNK;
+    in += GCM_CTR_CHUNK;
+    len -= GCM_CTR_CHUNK;
+  }
+  size_t len_blocks = len & ~(size_t)15;
+  if (len_blocks != 0) {
+    size_t j = len_blocks / 16;
+
+    (*stream)(in, out, j, key, ctx->Yi.c);
+    ctr += (unsigned int)j;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    in += len_blocks;
+    len -= len_blocks;
+#ifdef GHASH
+    GHASH(ctx, out, len_blocks);
+    out += len_blocks;
+#else
+    while (j--) {
+      for (size_t i = 0; i < 16; i += sizeof(size_t)) {
+        ctx->Xi.t[i / sizeof(size_t)] ^= load_word_le(out + i);
+      }
+      GCM_MUL(ctx, Xi);
+      out += 16;
+    }
+#endif
+  }
+  if (len) {
+    (*ctx->block)(ctx->Yi.c, ctx->EKi.c, key);
+    ++ctr;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    while (len--) {
+      ctx->Xi.c[n] ^= out[n] = in[n] ^ ctx->EKi.c[n];
+      ++n;
+    }
+  }
+
+  ctx->mres = n;
+  return 1;
+}
+
+int CRYPTO_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream) {
+  unsigned int n, ctr;
+  uint64_t mlen = ctx->len.u[1];
+#ifdef GCM_FUNCREF_4BIT
+  void (*gcm_gmult_p)(uint64_t Xi[2], const u128 Htable[16]) = ctx->gmult;
+#ifdef GHASH
+  void (*gcm_ghash_p)(uint64_t Xi[2], const u128 Htable[16], const uint8_t *inp,
+                      size_t len) = ctx->ghash;
+#endif
+#endif
+
+  mlen += len;
+  if (mlen > ((UINT64_C(1) << 36) - 32) ||
+      (sizeof(len) == 8 && mlen < len)) {
+    return 0;
+  }
+  ctx->len.u[1] = mlen;
+
+  if (ctx->ares) {
+    // First call to decrypt finalizes GHASH(AAD)
+    GCM_MUL(ctx, Xi);
+    ctx->ares = 0;
+  }
+
+  n = ctx->mres;
+  if (n) {
+    while (n && len) {
+      uint8_t c = *(in++);
+      *(out++) = c ^ ctx->EKi.c[n];
+      ctx->Xi.c[n] ^= c;
+      --len;
+      n = (n + 1) % 16;
+    }
+    if (n == 0) {
+      GCM_MUL(ctx, Xi);
+    } else {
+      ctx->mres = n;
+      return 1;
+    }
+  }
+
+  ctr = CRYPTO_bswap4(ctx->Yi.d[3]);
+
+  // The ciphertext has to be hashed before it is overwritten, in case
+  // |in| == |out|.
+  while (len >= GCM_CTR_CHUNK) {
+#ifdef GHASH
+    GHASH(ctx, in, GCM_CTR_CHUNK);
+#else
+    for (size_t j = 0; j < GCM_CTR_CHUNK; j += 16) {
+      for (size_t i = 0; i < 16; i += sizeof(size_t)) {
+        ctx->Xi.t[i / sizeof(size_t)] ^= load_word_le(in + j + i);
+      }
+      GCM_MUL(ctx, Xi);
+    }
+#endif
+    (*stream)(in, out, GCM_CTR_CHUNK / 16, key, ctx->Yi.c);
+    ctr += GCM_CTR_CHUNK / 16;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    out += GCM_CTR_CHUNK;
+    in += GCM_CTR_CHUNK;
+    len -= GCM_CTR_CHUNK;
+  }
+  size_t len_blocks = len & ~(size_t)15;
+  if (len_blocks != 0) {
+    size_t j = len_blocks / 16;
+
+#ifdef GHASH
+    GHASH(ctx, in, len_blocks);
+#else
+    for (size_t k = 0; k < len_blocks; k += 16) {
+      for (size_t i = 0; i < 16; i += sizeof(size_t)) {
+        ctx->Xi.t[i / sizeof(size_t)] ^= load_word_le(in + k + i);
+      }
+      GCM_MUL(ctx, Xi);
+    }
+#endif
+    (*stream)(in, out, j, key, ctx->Yi.c);
+    ctr += (unsigned int)j;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    out += len_blocks;
+    in += len_blocks;
+    len -= len_blocks;
+  }
+  if (len) {
+    (*ctx->block)(ctx->Yi.c, ctx->EKi.c, key);
+    ++ctr;
+    ctx->Yi.d[3] = CRYPTO_bswap4(ctr);
+    while (len--) {
+      uint8_t c = in[n];
+      ctx->Xi.c[n] ^= c;
+      out[n] = c ^ ctx->EKi.c[n];
+      ++n;
+    }
+  }
+
+  ctx->mres = n;
+  return 1;
+}
+
 int CRYPTO_gcm128_finish(GCM128_CONTEXT *ctx, const uint8_t *tag, size_t len) {
   uint64_t alen = ctx->len.u[0] << 3;
   uint64_t clen = ctx->len.u[1] << 3;
@@ -739,6 +739,91 @@ void aes_nohw_encrypt(const uint8_t *in, uint8_t *out,
   PUTU32(out + 12, s3);
 }
 
+// aes_nohw_encrypt_rounds runs rounds 2 to Nr on the state |t| left by the
+// first round, and writes the final state back to |t|.
+static inline void aes_nohw_encrypt_rounds(uint32_t t[4], const AES_KEY *key) {
+  const uint32_t *rk = key->rd_key + 8;
+  uint32_t s0, s1, s2, s3, t0 = t[0], t1 = t[1], t2 = t[2], t3 = t[3];
+  int r = key->rounds >> 1;
+
+  while (--r) {
+    s0 = Te0[(t0 >> 24)] ^ Te1[(t1 >> 16) & 0xff] ^ Te2[(t2 >> 8) & 0xff] ^
+         Te3[(t3) & 0xff] ^ rk[0];
+    s1 = Te0[(t1 >> 24)] ^ Te1[(t2 >> 16) & 0xff] ^ Te2[(t3 >> 8) & 0xff] ^
+         Te3[(t0) & 0xff] ^ rk[1];
+    s2 = Te0[(t2 >> 24)] ^ Te1[(t3 >> 16) & 0xff] ^ Te2[(t0 >> 8) & 0xff] ^
+         Te3[(t1) & 0xff] ^ rk[2];
+    s3 = Te0[(t3 >> 24)] ^ Te1[(t0 >> 16) & 0xff] ^ Te2[(t1 >> 8) & 0xff] ^
+         Te3[(t2) & 0xff] ^ rk[3];
+
+    t0 = Te0[(s0 >> 24)] ^ Te1[(s1 >> 16) & 0xff] ^ Te2[(s2 >> 8) & 0xff] ^
+         Te3[(s3) & 0xff] ^ rk[4];
+    t1 = Te0[(s1 >> 24)] ^ Te1[(s2 >> 16) & 0xff] ^ Te2[(s3 >> 8) & 0xff] ^
+         Te3[(s0) & 0xff] ^ rk[5];
+    t2 = Te0[(s2 >> 24)] ^ Te1[(s3 >> 16) & 0xff] ^ Te2[(s0 >> 8) & 0xff] ^
+         Te3[(s1) & 0xff] ^ rk[6];
+    t3 = Te0[(s3 >> 24)] ^ Te1[(s0 >> 16) & 0xff] ^ Te2[(s1 >> 8) & 0xff] ^
+         Te3[(s2) & 0xff] ^ rk[7];
+
+    rk += 8;
+  }
+
+  t[0] = (Te2[(t0 >> 24)] & 0xff000000) ^ (Te3[(t1 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t2 >> 8) & 0xff] & 0x0000ff00) ^ (Te1[(t3) & 0xff] & 0x000000ff) ^
+         rk[0];
+  t[1] = (Te2[(t1 >> 24)] & 0xff000000) ^ (Te3[(t2 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t3 >> 8) & 0xff] & 0x0000ff00) ^ (Te1[(t0) & 0xff] & 0x000000ff) ^
+         rk[1];
+  t[2] = (Te2[(t2 >> 24)] & 0xff000000) ^ (Te3[(t3 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t0 >> 8) & 0xff] & 0x0000ff00) ^ (Te1[(t1) & 0xff] & 0x000000ff) ^
+         rk[2];
+  t[3] = (Te2[(t3 >> 24)] & 0xff000000) ^ (Te3[(t0 >> 16) & 0xff] & 0x00ff0000) ^
+         (Te0[(t1 >> 8) & 0xff] & 0x0000ff00) ^ (Te1[(t2) & 0xff] & 0x000000ff) ^
+         rk[3];
+}
+
+void aes_nohw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                   size_t blocks, const AES_KEY *key,
+                                   const uint8_t ivec[16]) {
+  const uint32_t *rk = key->rd_key;
+  // Only the last word of the counter block changes from block to block.
+  const uint32_t s0 = GETU32(ivec) ^ rk[0];
+  const uint32_t s1 = GETU32(ivec + 4) ^ rk[1];
+  const uint32_t s2 = GETU32(ivec + 8) ^ rk[2];
+  uint32_t ctr = GETU32(ivec + 12);
+  uint32_t s3, t0_partial, t1, t2, t3, t[4];
+  int i;
+
+  while (blocks) {
+    // In the first round, the low byte of the counter only feeds
+    // Te3[s3 & 0xff] in column 0. Everything else stays the same for the
+    // next (up to) 256 blocks, so compute it once.
+    s3 = ctr ^ rk[3];
+    t0_partial = Te0[(s0 >> 24)] ^ Te1[(s1 >> 16) & 0xff] ^
+                 Te2[(s2 >> 8) & 0xff] ^ rk[4];
+    t1 = Te0[(s1 >> 24)] ^ Te1[(s2 >> 16) & 0xff] ^ Te2[(s3 >> 8) & 0xff] ^
+         Te3[(s0) & 0xff] ^ rk[5];
+    t2 = Te0[(s2 >> 24)] ^ Te1[(s3 >> 16) & 0xff] ^ Te2[(s0 >> 8) & 0xff] ^
+         Te3[(s1) & 0xff] ^ rk[6];
+    t3 = Te0[(s3 >> 24)] ^ Te1[(s0 >> 16) & 0xff] ^ Te2[(s1 >> 8) & 0xff] ^
+         Te3[(s2) & 0xff] ^ rk[7];
+
+    do {
+      t[0] = t0_partial ^ Te3[(ctr ^ rk[3]) & 0xff];
+      t[1] = t1;
+      t[2] = t2;
+      t[3] = t3;
+      aes_nohw_encrypt_rounds(t, key);
+      for (i = 0; i < 4; i++) {
+        PUTU32(out + 4 * i, GETU32(in + 4 * i) ^ t[i]);
+      }
+      in += 16;
+      out += 16;
+      ++ctr;
+    } while (--blocks && (ctr & 0xff));
+  }
+}
+
 void aes_nohw_decrypt(const uint8_t *in, uint8_t *out,
 		      const AES_KEY *key) {
   const uint32_t *rk;
@@ -819,3 +819,177 @@ void x25519_scalar_mult(uint8_t out[32],
   fe_mul(x2, x2, z2);
   fe_tobytes(out, x2);
 }
+
+#ifdef CONFIG_CURVE25519_FIXED_BASE
+/*
+ * Fixed-base scalar multiplication for public key generation.
+ *
+ * Instead of running the Montgomery ladder from u = 9, the scalar is
+ * multiplied with the edwards25519 base point using a comb: bit i * s + c of
+ * the scalar, for each of the n teeth i, selects one of 2^n - 1 precomputed
+ * points in column c. That costs s doublings and s additions rather than 255
+ * ladder steps. The table is generated at build time by
+ * util/gen_x25519_comb.c and its size is set by CONFIG_CURVE25519_COMB_TEETH.
+ *
+ * The formulas are the ref10 ones for twisted Edwards curves with a = -1,
+ * which are complete on edwards25519, so the identity needs no special case.
+ */
+#include "x25519_comb_table.h"
+
+/* (X:Y:Z) satisfying x=X/Z, y=Y/Z */
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+} ge_p2;
+
+/* (X:Y:Z:T) satisfying x=X/Z, y=Y/Z, XY=ZT */
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+  fe T;
+} ge_p3;
+
+/* ((X:Z),(Y:T)) satisfying x=X/Z, y=Y/T */
+typedef struct {
+  fe X;
+  fe Y;
+  fe Z;
+  fe T;
+} ge_p1p1;
+
+typedef struct {
+  fe yplusx;
+  fe yminusx;
+  fe xy2d;
+} ge_precomp;
+
+static void ge_p3_0(ge_p3 *h) {
+  fe_0(h->X);
+  fe_1(h->Y);
+  fe_1(h->Z);
+  fe_0(h->T);
+}
+
+static void ge_p3_to_p2(ge_p2 *r, const ge_p3 *p) {
+  fe_copy(r->X, p->X);
+  fe_copy(r->Y, p->Y);
+  fe_copy(r->Z, p->Z);
+}
+
+static void ge_p1p1_to_p3(ge_p3 *r, const ge_p1p1 *p) {
+  fe_mul(r->X, p->X, p->T);
+  fe_mul(r->Y, p->Y, p->Z);
+  fe_mul(r->Z, p->Z, p->T);
+  fe_mul(r->T, p->X, p->Y);
+}
+
+/* r = 2 * p */
+static void ge_p2_dbl(ge_p1p1 *r, const ge_p2 *p) {
+  fe t0;
+
+  fe_sq(r->X, p->X);
+  fe_sq(r->Z, p->Y);
+  /* 2*Z^2, computed as Z*(2*Z) to keep the limbs within fe_mul's bounds. */
+  fe_add(t0, p->Z, p->Z);
+  fe_mul(r->T, p->Z, t0);
+  fe_add(r->Y, p->X, p->Y);
+  fe_sq(t0, r->Y);
+  fe_add(r->Y, r->Z, r->X);
+  fe_sub(r->Z, r->Z, r->X);
+  fe_sub(r->X, t0, r->Y);
+  fe_sub(r->T, r->T, r->Z);
+}
+
+/* r = p + q */
+static void ge_madd(ge_p1p1 *r, const ge_p3 *p, const ge_precomp *q) {
+  fe t0;
+
+  fe_add(r->X, p->Y, p->X);
+  fe_sub(r->Y, p->Y, p->X);
+  fe_mul(r->Z, r->X, q->yplusx);
+  fe_mul(r->Y, r->Y, q->yminusx);
+  fe_mul(r->T, q->xy2d, p->T);
+  fe_add(t0, p->Z, p->Z);
+  fe_sub(r->X, r->Z, r->Y);
+  fe_add(r->Y, r->Z, r->Y);
+  fe_add(r->Z, t0, r->T);
+  fe_sub(r->T, t0, r->T);
+}
+
+/* Returns 1 if b == c and 0 otherwise, without branching. */
+static uint8_t equal(unsigned b, unsigned c) {
+  uint32_t x = b ^ c;
+  x -= 1;
+  return x >> 31;
+}
+
+/* Loads entry |pos| of the comb table, with 0 being the identity. Every
+ * entry is read so that the memory access pattern doesn't depend on |pos|. */
+static void table_select(ge_precomp *t, unsigned pos) {
+  uint8_t buf[3][32] = {{1}, {1}, {0}};
+  unsigned i, j;
+
+  for (i = 0; i < ARRAY_SIZE(k25519CombTable); i++) {
+    uint8_t mask = -equal(pos, i + 1);
+    const uint8_t *entry = k25519CombTable[i][0];
+
+    for (j = 0; j < sizeof(buf); j++)
+      buf[j / 32][j % 32] ^= mask & (buf[j / 32][j % 32] ^ entry[j]);
+  }
+
+  fe_frombytes(t->yplusx, buf[0]);
+  fe_frombytes(t->yminusx, buf[1]);
+  fe_frombytes(t->xy2d, buf[2]);
+}
+
+/* Gathers bit i * X25519_COMB_SPACING + col of |e| into bit i of the
+ * result. */
+static unsigned comb_index(const uint8_t e[32], int col) {
+  unsigned idx = 0;
+  int i;
+
+  for (i = 0; i < X25519_COMB_TEETH; i++) {
+    int pos = i * X25519_COMB_SPACING + col;
+
+    if (pos < 255)
+      idx |= (unsigned)(1 & (e[pos / 8] >> (pos & 7))) << i;
+  }
+  return idx;
+}
+
+void x25519_scalar_mult_base(uint8_t out[32], const uint8_t scalar[32]) {
+  ge_p3 h;
+  ge_p2 s;
+  ge_p1p1 r;
+  ge_precomp t;
+  fe zplusy, zminusy;
+  int col;
+
+  uint8_t e[32];
+  memcpy(e, scalar, 32);
+  e[0] &= 248;
+  e[31] &= 127;
+  e[31] |= 64;
+
+  ge_p3_0(&h);
+  for (col = X25519_COMB_SPACING - 1; col >= 0; --col) {
+    ge_p3_to_p2(&s, &h);
+    ge_p2_dbl(&r, &s);
+    ge_p1p1_to_p3(&h, &r);
+
+    table_select(&t, comb_index(e, col));
+    ge_madd(&r, &h, &t);
+    ge_p1p1_to_p3(&h, &r);
+  }
+
+  /* The birational map from edwards25519 to curve25519 is u = (1+y)/(1-y),
+   * and y = Y/Z, so u = (Z+Y)/(Z-Y). */
+  fe_add(zplusy, h.Z, h.Y);
+  fe_sub(zminusy, h.Z, h.Y);
+  fe_invert(zminusy, zminusy);
+  fe_mul(zplusy, zplusy, zminusy);
+  fe_tobytes(out, zplusy);
+}
+#endif /* CONFIG_CURVE25519_FIXED_BASE */
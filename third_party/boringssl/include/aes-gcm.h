@@ -57,6 +57,12 @@
 typedef void (*block128_f)(const uint8_t in[16], uint8_t out[16],
                            const void *key);
 
+// ctr128_f is the type of a function that performs CTR-mode encryption of
+// |blocks| blocks with a 32-bit, big-endian counter in the last 4 bytes of
+// |ivec|. |ivec| is not updated.
+typedef void (*ctr128_f)(const uint8_t *in, uint8_t *out, size_t blocks,
+                         const void *key, const uint8_t ivec[16]);
+
 // GCM definitions
 typedef struct { uint64_t hi,lo; } u128;
 
@@ -133,6 +139,22 @@ int CRYPTO_gcm128_decrypt(GCM128_CONTEXT *ctx, const void *key,
                                          const uint8_t *in, uint8_t *out,
                                          size_t len);
 
+// CRYPTO_gcm128_encrypt_ctr32 encrypts |len| bytes from |in| to |out| using
+// a CTR function that processes several blocks per call. The |key| must be
+// the same key that was passed to |CRYPTO_gcm128_init|. It returns one on
+// success and zero otherwise.
+int CRYPTO_gcm128_encrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream);
+
+// CRYPTO_gcm128_decrypt_ctr32 decrypts |len| bytes from |in| to |out| using
+// a CTR function that processes several blocks per call. The |key| must be
+// the same key that was passed to |CRYPTO_gcm128_init|. It returns one on
+// success and zero otherwise.
+int CRYPTO_gcm128_decrypt_ctr32(GCM128_CONTEXT *ctx, const void *key,
+                                const uint8_t *in, uint8_t *out, size_t len,
+                                ctr128_f stream);
+
 // CRYPTO_gcm128_finish calculates the authenticator and compares it against
 // |len| bytes of |tag|. It returns one on success and zero otherwise.
 int CRYPTO_gcm128_finish(GCM128_CONTEXT *ctx, const uint8_t *tag,
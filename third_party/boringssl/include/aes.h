@@ -49,6 +49,7 @@
 #ifndef __CROS_EC_AES_H
 #define __CROS_EC_AES_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 #define AES_ENCRYPT 1
@@ -79,6 +80,14 @@ int aes_nohw_set_encrypt_key(const uint8_t *key, unsigned bits,
                              AES_KEY *aeskey);
 int aes_nohw_set_decrypt_key(const uint8_t *key, unsigned bits,
                              AES_KEY *aeskey);
+/*
+ * aes_nohw_ctr32_encrypt_blocks encrypts |blocks| blocks from |in| to |out| in
+ * CTR mode. The last 4 bytes of |ivec| are a big-endian counter, which wraps
+ * around without carrying into the rest of |ivec|. |ivec| is not updated.
+ */
+void aes_nohw_ctr32_encrypt_blocks(const uint8_t *in, uint8_t *out,
+                                   size_t blocks, const AES_KEY *key,
+                                   const uint8_t ivec[16]);
 
 /**
  * AES_set_encrypt_key configures |aeskey| to encrypt with the |bits|-bit key,
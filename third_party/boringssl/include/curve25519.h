@@ -67,4 +67,11 @@ void x25519_scalar_mult(uint8_t out[32],
 			const uint8_t scalar[32],
 			const uint8_t point[32]);
 
+/*
+ * Low-level fixed-base x25519 function, computing the public value of
+ * @scalar from precomputed tables. Only defined by the generic implementation
+ * when CONFIG_CURVE25519_FIXED_BASE is enabled. Must not be called directly.
+ */
+void x25519_scalar_mult_base(uint8_t out[32], const uint8_t scalar[32]);
+
 #endif /* __CROS_EC_CURVE25519_H */
@@ -8,7 +8,7 @@
 
 # See Makefile for description.
 host-util-bin-y += ectool lbplay stm32mon ec_sb_firmware_update lbcc \
-	ec_parse_panicinfo cbi-util iteflash
+	ec_parse_panicinfo cbi-util iteflash ec_logd
 build-util-art-y += util/export_taskinfo.so
 
 build-util-bin-$(CHIP_NPCX) += ecst
@@ -29,11 +29,12 @@ comm-objs=$(util-lock-objs:%=lock/%) comm-host.o comm-dev.o
 comm-objs+=comm-lpc.o comm-i2c.o misc_util.o
 
 iteflash-objs = iteflash.o usb_if.o
-ectool-objs=ectool.o ectool_keyscan.o ec_flash.o ec_panicinfo.o $(comm-objs)
+ectool-objs=ectool.o ectool_keyscan.o ectool_serve.o ec_flash.o ec_panicinfo.o $(comm-objs)
 ectool_servo-objs=$(ectool-objs) comm-servo-spi.o
 ec_sb_firmware_update-objs=ec_sb_firmware_update.o $(comm-objs) misc_util.o
 ec_sb_firmware_update-objs+=powerd_lock.o
 lbplay-objs=lbplay.o $(comm-objs)
+ec_logd-objs=ec_logd.o $(comm-objs)
 
 util/ectool.c: $(out)/ec_version.h
 
@@ -81,6 +82,10 @@ $(out)/ipi_table_gen.inc: $(out)/util/gen_ipi_table
 	$(call quiet,ipi_table,IPITBL )
 endif
 
+ifneq ($(CONFIG_CURVE25519_FIXED_BASE),)
+build-util-bin-y += gen_x25519_comb
+endif
+
 ifneq ($(CONFIG_TOUCHPAD_HASH_FW),)
 build-util-bin-y += gen_touchpad_hash
 
@@ -9,6 +9,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "comm-host.h"
 #include "cros_ec_dev.h"
@@ -29,6 +30,8 @@ int ec_max_outsize, ec_max_insize;
 void *ec_outbuf;
 void *ec_inbuf;
 static int command_offset;
+int ec_poll_spin_usec = EC_POLL_SPIN_AUTO;
+static struct ec_command_stats command_stats = { .min_us = UINT32_MAX };
 
 int comm_init_dev(const char *device_name) __attribute__((weak));
 int comm_init_lpc(void) __attribute__((weak));
@@ -73,14 +76,51 @@ void set_command_offset(int offset)
 	command_offset = offset;
 }
 
+static uint64_t monotonic_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void account_command(uint64_t usec, int rv)
+{
+	struct ec_command_stats *s = &command_stats;
+	uint32_t us = usec > UINT32_MAX ? UINT32_MAX : usec;
+
+	s->count++;
+	if (rv < 0)
+		s->errors++;
+	s->total_us += us;
+	if (us < s->min_us)
+		s->min_us = us;
+	if (us > s->max_us)
+		s->max_us = us;
+	s->histogram[us ? 31 - __builtin_clz(us) : 0]++;
+}
+
+void ec_get_command_stats(struct ec_command_stats *stats)
+{
+	*stats = command_stats;
+	if (!stats->count)
+		stats->min_us = 0;
+}
+
 int ec_command(int command, int version,
 	       const void *outdata, int outsize,
 	       void *indata, int insize)
 {
+	uint64_t start = monotonic_usec();
+	int rv;
+
 	/* Offset command code to support sub-devices */
-	return ec_command_proto(command_offset + command, version,
-				outdata, outsize,
-				indata, insize);
+	rv = ec_command_proto(command_offset + command, version,
+			      outdata, outsize,
+			      indata, insize);
+
+	account_command(monotonic_usec() - start, rv);
+	return rv;
 }
 
 int comm_init_alt(int interfaces, const char *device_name, int i2c_bus)
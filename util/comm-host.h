@@ -72,6 +72,30 @@ int ec_command(int command, int version,
  */
 void set_command_offset(int offset);
 
+/*
+ * How long, in microseconds, transports that poll the EC for completion may
+ * busy-wait before they start sleeping between polls. 0 never busy-waits;
+ * EC_POLL_SPIN_AUTO (the default) adapts it to how long recent commands took.
+ */
+#define EC_POLL_SPIN_AUTO -1
+extern int ec_poll_spin_usec;
+
+/* Latency of the ec_command() calls made so far */
+struct ec_command_stats {
+	uint32_t count;
+	uint32_t errors;
+	uint64_t total_us;
+	uint32_t min_us;
+	uint32_t max_us;
+	/* Number of commands which took [2^i, 2^(i+1)) us; 0 us counts in 0 */
+	uint32_t histogram[32];
+};
+
+/**
+ * Get the latency statistics of the ec_command() calls made so far.
+ */
+void ec_get_command_stats(struct ec_command_stats *stats);
+
 /**
  * Send a command to the EC.  Returns the length of output data returned (0 if
  * none), or negative on error.  This is the low-level interface implemented
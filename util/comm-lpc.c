@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <sys/io.h>
 #include <sys/param.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "comm-host.h"
@@ -17,16 +18,60 @@
 #define INITIAL_UDELAY 5     /* 5 us */
 #define MAXIMUM_UDELAY 10000 /* 10 ms */
 
+/* Bounds of the adaptive busy-wait before falling back to usleep() */
+#define SPIN_MIN_USEC 20
+#define SPIN_MAX_USEC 500
+
+/* Moving average of how long the EC stays busy after a command, in us */
+static int avg_busy_usec = SPIN_MIN_USEC;
+
+static int usec_since(const struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000 +
+		(now.tv_nsec - start->tv_nsec) / 1000;
+}
+
+static void account_busy(int usec)
+{
+	avg_busy_usec = (7 * avg_busy_usec + usec) / 8;
+}
+
 /*
  * Wait for the EC to be unbusy.  Returns 0 if unbusy, non-zero if
  * timeout.
  */
 static int wait_for_ec(int status_addr, int timeout_usec)
 {
-	int i;
+	struct timespec start;
+	int spin_usec = ec_poll_spin_usec;
+	int i = 0;
 	int delay = INITIAL_UDELAY;
 
-	for (i = 0; i < timeout_usec; i += delay) {
+	if (spin_usec == EC_POLL_SPIN_AUTO)
+		spin_usec = MIN(MAX(2 * avg_busy_usec, SPIN_MIN_USEC),
+				SPIN_MAX_USEC);
+
+	/*
+	 * Most commands complete within tens of microseconds, which is less
+	 * than the scheduler takes to wake us up from even the shortest
+	 * usleep(). So poll without sleeping for a little while first, for
+	 * a bit longer than commands have been taking lately.
+	 */
+	if (spin_usec > 0) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		do {
+			i = usec_since(&start);
+			if (!(inb(status_addr) & EC_LPC_STATUS_BUSY_MASK)) {
+				account_busy(i);
+				return 0;
+			}
+		} while (i < MIN(spin_usec, timeout_usec));
+	}
+
+	for (; i < timeout_usec; i += delay) {
 		/*
 		 * Delay first, in case we just sent out a command but the EC
 		 * hasn't raised the busy flag.  However, I think this doesn't
@@ -36,8 +81,11 @@ static int wait_for_ec(int status_addr, int timeout_usec)
 		 */
 		usleep(MIN(delay, timeout_usec - i));
 
-		if (!(inb(status_addr) & EC_LPC_STATUS_BUSY_MASK))
+		if (!(inb(status_addr) & EC_LPC_STATUS_BUSY_MASK)) {
+			if (spin_usec > 0)
+				account_busy(usec_since(&start));
 			return 0;
+		}
 
 		/* Increase the delay interval after a few rapid checks */
 		if (i > 20)
@@ -8,14 +8,20 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include "comm-host.h"
+#include "ec_flash.h"
 #include "misc_util.h"
 #include "timer.h"
 
 static const uint32_t ERASE_ASYNC_TIMEOUT = 10 * SECOND;
 static const uint32_t ERASE_ASYNC_WAIT = 500 * MSEC;
 static const int FLASH_ERASE_BUSY_RV = -EECRESULT - EC_RES_BUSY;
+/* Poll interval for erases queued behind writes by ec_flash_update() */
+static const uint32_t ERASE_PIPELINE_WAIT = 2 * MSEC;
+/* ec_flash_update() merges erase blocks into pieces of at least this size */
+static const int UPDATE_SEGMENT_SIZE = 4096;
 
 int ec_flash_read(uint8_t *buf, int offset, int size)
 {
@@ -132,15 +138,15 @@ static int get_flash_write_size(void)
 	return write_size;
 }
 
-int ec_flash_write(const uint8_t *buf, int offset, int size)
+/**
+ * @return Number of bytes to send per EC_CMD_FLASH_WRITE, negative on failure
+ */
+static int get_flash_write_step(void)
 {
-	struct ec_params_flash_write *p =
-		(struct ec_params_flash_write *)ec_outbuf;
 	int write_size;
-	int pdata_max_size = (int)(ec_max_outsize - sizeof(*p));
+	int pdata_max_size =
+		(int)(ec_max_outsize - sizeof(struct ec_params_flash_write));
 	int step;
-	int rv;
-	int i;
 
 	/*
 	 * Determine whether we can use version 1 of the EC_CMD_FLASH_WRITE
@@ -168,8 +174,16 @@ int ec_flash_write(const uint8_t *buf, int offset, int size)
 		return -1;
 	}
 
-	/* Write data in chunks */
-	printf("Write size %d...\n", step);
+	return step;
+}
+
+static int flash_write_chunks(const uint8_t *buf, int offset, int size,
+			      int step)
+{
+	struct ec_params_flash_write *p =
+		(struct ec_params_flash_write *)ec_outbuf;
+	int rv;
+	int i;
 
 	for (i = 0; i < size; i += step) {
 		p->offset = offset + i;
@@ -186,6 +200,20 @@ int ec_flash_write(const uint8_t *buf, int offset, int size)
 	return 0;
 }
 
+int ec_flash_write(const uint8_t *buf, int offset, int size)
+{
+	int step;
+
+	step = get_flash_write_step();
+	if (step < 0)
+		return step;
+
+	/* Write data in chunks */
+	printf("Write size %d...\n", step);
+
+	return flash_write_chunks(buf, offset, size, step);
+}
+
 int ec_flash_erase(int offset, int size)
 {
 	struct ec_params_flash_erase p;
@@ -229,3 +257,308 @@ int ec_flash_erase_async(int offset, int size)
 	}
 	return rv;
 }
+
+/* Erase geometry of the EC flash, from EC_CMD_FLASH_INFO */
+struct flash_layout {
+	uint32_t flags;
+	int erase_size;			/* Used if there are no banks */
+	int num_banks;
+	struct ec_flash_bank *banks;
+};
+
+static int get_flash_layout(struct flash_layout *layout)
+{
+	int rv;
+
+	memset(layout, 0, sizeof(*layout));
+
+	if (ec_cmd_version_supported(EC_CMD_FLASH_INFO, 2)) {
+		struct ec_params_flash_info_2 p = { 0 };
+		struct ec_response_flash_info_2 *r = ec_inbuf;
+		int banks_len;
+
+		p.num_banks_desc = (ec_max_insize - sizeof(*r)) /
+				   sizeof(struct ec_flash_bank);
+		rv = ec_command(EC_CMD_FLASH_INFO, 2, &p, sizeof(p),
+				r, ec_max_insize);
+		if (rv < 0)
+			return rv;
+
+		layout->flags = r->flags;
+		layout->num_banks = r->num_banks_desc;
+		banks_len = layout->num_banks * sizeof(struct ec_flash_bank);
+		layout->banks = malloc(banks_len);
+		if (!layout->banks)
+			return -1;
+		memcpy(layout->banks, r->banks, banks_len);
+	} else if (ec_cmd_version_supported(EC_CMD_FLASH_INFO, 1)) {
+		struct ec_response_flash_info_1 r;
+
+		rv = ec_command(EC_CMD_FLASH_INFO, 1, NULL, 0, &r, sizeof(r));
+		if (rv < 0)
+			return rv;
+		layout->flags = r.flags;
+		layout->erase_size = r.erase_block_size;
+	} else {
+		struct ec_response_flash_info r;
+
+		rv = get_flash_info_v0(&r);
+		if (rv < 0)
+			return rv;
+		layout->erase_size = r.erase_block_size;
+	}
+
+	return 0;
+}
+
+/**
+ * @return Size of the erase block containing offset, or 0 if unknown.
+ */
+static int get_erase_size(const struct flash_layout *layout, int offset)
+{
+	int start = 0;
+	int i;
+
+	if (!layout->num_banks)
+		return layout->erase_size;
+
+	for (i = 0; i < layout->num_banks; i++) {
+		const struct ec_flash_bank *b = &layout->banks[i];
+		int bank_len = b->count << b->size_exp;
+
+		if (offset < start + bank_len)
+			return 1 << b->erase_size_exp;
+		start += bank_len;
+	}
+
+	return 0;
+}
+
+static int is_erased(const uint8_t *buf, int size, uint32_t flags)
+{
+	uint8_t erased = (flags & EC_FLASH_INFO_ERASE_TO_0) ? 0 : 0xff;
+	int i;
+
+	for (i = 0; i < size; i++)
+		if (buf[i] != erased)
+			return 0;
+	return 1;
+}
+
+static uint64_t get_time_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * SECOND + ts.tv_nsec / 1000;
+}
+
+static int flash_erase_start(int offset, int size)
+{
+	struct ec_params_flash_erase_v1 p = { 0 };
+
+	p.cmd = FLASH_ERASE_SECTOR_ASYNC;
+	p.params.offset = offset;
+	p.params.size = size;
+
+	return ec_command(EC_CMD_FLASH_ERASE, 1, &p, sizeof(p), NULL, 0);
+}
+
+static int flash_erase_wait(int offset)
+{
+	struct ec_params_flash_erase_v1 p = { 0 };
+	uint32_t timeout = 0;
+	int rv;
+
+	p.cmd = FLASH_ERASE_GET_RESULT;
+	p.params.offset = offset;
+
+	do {
+		rv = ec_command(EC_CMD_FLASH_ERASE, 1, &p, sizeof(p), NULL, 0);
+		if (rv >= 0)
+			return rv;
+		usleep(ERASE_PIPELINE_WAIT);
+		timeout += ERASE_PIPELINE_WAIT;
+	} while (timeout < ERASE_ASYNC_TIMEOUT);
+
+	return rv;
+}
+
+/* Erase block state for ec_flash_update() */
+enum block_state {
+	BLOCK_CLEAN,		/* Already holds the new contents */
+	BLOCK_ERASED,		/* Erased; only needs writing */
+	BLOCK_DIRTY,		/* Needs erasing and writing */
+};
+
+struct flash_block {
+	int offset;		/* Offset from the start of the image */
+	int size;
+	enum block_state state;
+};
+
+int ec_flash_update(const uint8_t *buf, int offset, int size,
+		    struct ec_flash_update_stats *stats)
+{
+	struct flash_layout layout;
+	struct flash_block *blocks = NULL;
+	uint8_t *rbuf = NULL;
+	uint64_t start_us = get_time_us();
+	int num_blocks = 0;
+	int erasing = -1;
+	int erase_size;
+	int pipelined;
+	int step;
+	int pos;
+	int rv;
+	int i, next;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->bytes_total = size;
+
+	if (size <= 0)
+		return -1;
+
+	step = get_flash_write_step();
+	if (step < 0)
+		return step;
+
+	rv = get_flash_layout(&layout);
+	if (rv < 0)
+		goto out;
+
+	/*
+	 * Only overlap erases with writes when the EC queues flash operations;
+	 * otherwise an async erase may race with writes on the EC.
+	 */
+	pipelined = ec_cmd_version_supported(EC_CMD_FLASH_ERASE, 1) &&
+		ec_cmd_version_supported(EC_CMD_FLASH_QUEUE_INFO,
+					 EC_VER_FLASH_QUEUE_INFO);
+
+	/* Split the image into erase blocks */
+	for (pos = 0; pos < size; pos += erase_size, num_blocks++) {
+		erase_size = get_erase_size(&layout, offset + pos);
+		if (erase_size <= 0 || (offset + pos) % erase_size ||
+		    size - pos < erase_size) {
+			fprintf(stderr, "Image at 0x%x+0x%x is not aligned to "
+				"erase blocks\n", offset, size);
+			rv = -1;
+			goto out;
+		}
+	}
+
+	blocks = calloc(num_blocks, sizeof(*blocks));
+	rbuf = malloc(size);
+	if (!blocks || !rbuf) {
+		fprintf(stderr, "Unable to allocate buffer.\n");
+		rv = -1;
+		goto out;
+	}
+
+	for (pos = 0, i = 0; i < num_blocks; pos += blocks[i].size, i++) {
+		blocks[i].offset = pos;
+		blocks[i].size = get_erase_size(&layout, offset + pos);
+	}
+
+	/* Compare against the current contents to find what must change */
+	rv = ec_flash_read(rbuf, offset, size);
+	if (rv < 0)
+		goto out;
+
+	for (i = 0; i < num_blocks; i++) {
+		struct flash_block *b = &blocks[i];
+
+		if (!memcmp(rbuf + b->offset, buf + b->offset, b->size)) {
+			b->state = BLOCK_CLEAN;
+			stats->bytes_skipped += b->size;
+		} else if (is_erased(rbuf + b->offset, b->size,
+				     layout.flags)) {
+			b->state = BLOCK_ERASED;
+		} else {
+			b->state = BLOCK_DIRTY;
+		}
+	}
+
+	/*
+	 * Merge neighbouring blocks in the same state so small erase blocks
+	 * don't limit the size of each erase and write, while keeping pieces
+	 * small enough for erases to overlap with writes.
+	 */
+	for (i = 1, next = 0; i < num_blocks; i++) {
+		struct flash_block *prev = &blocks[next];
+
+		if (blocks[i].state == prev->state &&
+		    prev->size < UPDATE_SEGMENT_SIZE)
+			prev->size += blocks[i].size;
+		else
+			blocks[++next] = blocks[i];
+	}
+	num_blocks = next + 1;
+
+	/*
+	 * Program the blocks which changed.  When pipelined, the erase of the
+	 * next dirty block runs on the EC while this block is being written.
+	 */
+	for (i = 0; i < num_blocks; i++) {
+		struct flash_block *b = &blocks[i];
+
+		if (b->state == BLOCK_CLEAN)
+			continue;
+
+		if (b->state == BLOCK_DIRTY) {
+			if (erasing == i) {
+				rv = flash_erase_wait(offset + b->offset);
+				erasing = -1;
+			} else {
+				rv = ec_flash_erase(offset + b->offset,
+						    b->size);
+			}
+			if (rv < 0) {
+				fprintf(stderr, "Erase error at offset %d\n",
+					b->offset);
+				goto out;
+			}
+			stats->blocks_erased++;
+		}
+
+		/*
+		 * An erase still running is always of the next dirty block,
+		 * so only start one once the last has been waited for.
+		 */
+		if (pipelined && erasing < 0) {
+			for (next = i + 1; next < num_blocks; next++)
+				if (blocks[next].state == BLOCK_DIRTY)
+					break;
+			/* Fall back to a synchronous erase if this fails */
+			if (next < num_blocks &&
+			    flash_erase_start(offset + blocks[next].offset,
+					      blocks[next].size) >= 0)
+				erasing = next;
+		}
+
+		rv = flash_write_chunks(buf + b->offset, offset + b->offset,
+					b->size, step);
+		if (rv < 0)
+			goto out;
+		stats->bytes_written += b->size;
+	}
+
+	/* Verify only what was rewritten */
+	for (i = 0; i < num_blocks; i++) {
+		struct flash_block *b = &blocks[i];
+
+		if (b->state == BLOCK_CLEAN)
+			continue;
+		rv = ec_flash_verify(buf + b->offset, offset + b->offset,
+				     b->size);
+		if (rv < 0)
+			goto out;
+	}
+
+out:
+	stats->usec = get_time_us() - start_us;
+	free(layout.banks);
+	free(blocks);
+	free(rbuf);
+	return rv < 0 ? rv : 0;
+}
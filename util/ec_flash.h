@@ -39,6 +39,34 @@ int ec_flash_verify(const uint8_t *buf, int offset, int size);
  */
 int ec_flash_write(const uint8_t *buf, int offset, int size);
 
+/* Statistics from ec_flash_update() */
+struct ec_flash_update_stats {
+	int bytes_total;	/* Size of the image */
+	int bytes_skipped;	/* Bytes in erase blocks already up to date */
+	int bytes_written;	/* Bytes sent to the EC */
+	int blocks_erased;	/* Erase blocks which had to be erased */
+	uint64_t usec;		/* Elapsed time, including verification */
+};
+
+/**
+ * Update EC flash memory with a new image, rewriting only what changed
+ *
+ * Reads back the current contents and skips erase blocks which already hold
+ * the new data.  Blocks which differ are erased (unless already erased),
+ * written with the largest supported packets and verified.  If the EC queues
+ * flash operations, the erase of the next block overlaps the writes to the
+ * current one.
+ *
+ * @param buf		Source buffer
+ * @param offset	Offset in EC flash to write; must be erase-aligned
+ * @param size		Number of bytes to write; must be erase-aligned
+ * @param stats		Filled with update statistics
+ *
+ * @return 0 if success, negative if error.
+ */
+int ec_flash_update(const uint8_t *buf, int offset, int size,
+		    struct ec_flash_update_stats *stats);
+
 /**
  * Erase EC flash memory
  *
@@ -0,0 +1,153 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Daemon that streams the EC console log to a file.
+ */
+
+#include <getopt.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "comm-host.h"
+#include "misc_util.h"
+
+/* Poll interval while the EC is quiet, and while it is printing */
+#define DEFAULT_IDLE_INTERVAL_MS 1000
+#define BUSY_INTERVAL_MS 50
+
+static volatile sig_atomic_t reopen_log;
+static volatile sig_atomic_t stop;
+
+static void on_sighup(int sig)
+{
+	reopen_log = 1;
+}
+
+static void on_stop(int sig)
+{
+	stop = 1;
+}
+
+static void usage(const char *name)
+{
+	printf("Usage: %s [options] <logfile>\n"
+	       "\n"
+	       "Appends the EC console output to <logfile>, marking any\n"
+	       "output that was overwritten before it could be read.\n"
+	       "SIGHUP reopens <logfile>, for log rotation.\n"
+	       "\n"
+	       "Options:\n"
+	       "  -d       Run in the background\n"
+	       "  -i <ms>  Poll interval while the EC is quiet (default %d)\n"
+	       "  -n       Only log new output, not what the EC has buffered\n",
+	       name, DEFAULT_IDLE_INTERVAL_MS);
+}
+
+int main(int argc, char *argv[])
+{
+	int idle_interval_ms = DEFAULT_IDLE_INTERVAL_MS;
+	int background = 0;
+	int new_only = 0;
+	const char *path;
+	uint32_t seq = 0;
+	FILE *log;
+	int rv, c;
+
+	while ((c = getopt(argc, argv, "di:nh")) != -1) {
+		switch (c) {
+		case 'd':
+			background = 1;
+			break;
+		case 'i':
+			idle_interval_ms = atoi(optarg);
+			if (idle_interval_ms <= 0) {
+				fprintf(stderr, "Bad interval %s\n", optarg);
+				return 1;
+			}
+			break;
+		case 'n':
+			new_only = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind != argc - 1) {
+		usage(argv[0]);
+		return 1;
+	}
+	path = argv[optind];
+
+	/*
+	 * Only use the /dev interface: the kernel serializes commands there,
+	 * while the others would need the GEC lock held for our lifetime.
+	 */
+	if (comm_init_dev(NULL)) {
+		fprintf(stderr, "Couldn't initialize /dev.\n");
+		return 1;
+	}
+
+	if (comm_init_buffer()) {
+		fprintf(stderr, "Couldn't initialize buffers\n");
+		return 1;
+	}
+
+	if (!ec_cmd_version_supported(EC_CMD_CONSOLE_READ_SEQ, 0)) {
+		fprintf(stderr, "EC can't stream its console\n");
+		return 1;
+	}
+
+	log = fopen(path, "a");
+	if (!log) {
+		perror("Error opening log file");
+		return 1;
+	}
+
+	if (background && daemon(0, 0)) {
+		perror("Error going to the background");
+		return 1;
+	}
+
+	signal(SIGHUP, on_sighup);
+	signal(SIGINT, on_stop);
+	signal(SIGTERM, on_stop);
+
+	if (new_only) {
+		FILE *null = fopen("/dev/null", "w");
+
+		if (null) {
+			ec_console_read_seq(&seq, null, 0);
+			fclose(null);
+		}
+	}
+
+	rv = ec_console_read_seq(&seq, log, 0);
+	while (!stop) {
+		if (rv < 0) {
+			fprintf(log, "\n[EC read error %d]\n", rv);
+			rv = 0;
+		}
+		fflush(log);
+
+		if (reopen_log) {
+			reopen_log = 0;
+			fclose(log);
+			log = fopen(path, "a");
+			if (!log)
+				return 1;
+		}
+
+		/* Keep up with bursts, and stay out of the way otherwise */
+		usleep(1000 * (rv > 0 ? BUSY_INTERVAL_MS : idle_interval_ms));
+		rv = ec_console_read_seq(&seq, log, 1);
+	}
+
+	fclose(log);
+	return 0;
+}
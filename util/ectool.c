@@ -47,6 +47,8 @@ enum {
 	OPT_NAME,
 	OPT_ASCII,
 	OPT_I2C_BUS,
+	OPT_SPIN,
+	OPT_STATS,
 };
 
 static struct option long_opts[] = {
@@ -55,6 +57,8 @@ static struct option long_opts[] = {
 	{"name", 1, 0, OPT_NAME},
 	{"ascii", 0, 0, OPT_ASCII},
 	{"i2c_bus", 1, 0, OPT_I2C_BUS},
+	{"spin", 1, 0, OPT_SPIN},
+	{"stats", 0, 0, OPT_STATS},
 	{NULL, 0, 0, 0}
 };
 
@@ -72,6 +76,8 @@ const char help_str[] =
 	"      Turn on automatic fan speed control.\n"
 	"  backlight <enabled>\n"
 	"      Enable/disable LCD backlight\n"
+	"  batch [<file>]\n"
+	"      Run the commands in <file> (or stdin), one per line\n"
 	"  battery\n"
 	"      Prints battery info\n"
 	"  batterycutoff [at-shutdown]\n"
@@ -80,6 +86,8 @@ const char help_str[] =
 	"      Read or write board-specific battery parameter\n"
 	"  boardversion\n"
 	"      Prints the board version\n"
+	"  boottimeline [<slow_us>]\n"
+	"      Prints how long each step of booting and each init routine took\n"
 	"  button [vup|vdown|rec] <Delay-ms>\n"
 	"      Simulates button press.\n"
 	"  cbi\n"
@@ -96,8 +104,9 @@ const char help_str[] =
 	"      Prints chip info\n"
 	"  cmdversions <cmd>\n"
 	"      Prints supported version mask for a command number\n"
-	"  console\n"
-	"      Prints the last output to the EC debug console\n"
+	"  console [-f]\n"
+	"      Prints the last output to the EC debug console; -f keeps\n"
+	"      printing new output as it comes\n"
 	"  cec\n"
 	"      Read or write CEC messages and settings\n"
 	"  echash [CMDS]\n"
@@ -126,12 +135,15 @@ const char help_str[] =
 	"      Set the maximum external power limit\n"
 	"  fanduty <percent>\n"
 	"      Forces the fan PWM to a constant duty cycle\n"
+	"  fantelemetry [<index> | all]\n"
+	"      Prints the EC's fan RPM control loop state\n"
 	"  flasherase <offset> <size>\n"
 	"      Erases EC flash\n"
 	"  flasheraseasync <offset> <size>\n"
 	"      Erases EC flash asynchronously\n"
-	"  flashinfo\n"
-	"      Prints information on the EC flash\n"
+	"  flashinfo [reset]\n"
+	"      Prints information on the EC flash; reset clears the write\n"
+	"      queue counters\n"
 	"  flashspiinfo\n"
 	"      Prints information on EC SPI flash, if present\n"
 	"  flashpd <dev_id> <port> <filename>\n"
@@ -140,6 +152,9 @@ const char help_str[] =
 	"      Prints or sets EC flash protection state\n"
 	"  flashread <offset> <size> <outfile>\n"
 	"      Reads from EC flash to a file\n"
+	"  flashupdate <offset> <infile>\n"
+	"      Rewrites only the erase blocks of EC flash which differ from\n"
+	"      a file, then verifies them\n"
 	"  flashwrite <offset> <infile>\n"
 	"      Writes to EC flash from a file\n"
 	"  forcelidopen <enable>\n"
@@ -230,6 +245,8 @@ const char help_str[] =
 	"      Print history of port 80 write\n"
 	"  powerinfo\n"
 	"      Prints power-related information\n"
+	"  powertimeline [<slow_us>]\n"
+	"      Prints the power sequencing timeline and transition latencies\n"
 	"  protoinfo\n"
 	"       Prints EC host protocol information\n"
 	"  pse\n"
@@ -286,6 +303,8 @@ const char help_str[] =
 	"      Control the behavior of RWSIG task.\n"
 	"  rwsigstatus (DEPRECATED; use \"rwsig status\"\n"
 	"      Run RW signature verification and get status.\n"
+	"  serve <socket> [idle_secs]\n"
+	"      Run commands sent to a Unix socket, replying in JSON\n"
 	"  sertest\n"
 	"      Serial output test for COM2\n"
 	"  smartdischarge\n"
@@ -294,8 +313,12 @@ const char help_str[] =
 	"      Stress test the ec host command interface.\n"
 	"  sysinfo [flags|reset_flags|firmware_copy]\n"
 	"      Display system info.\n"
+	"  sysjumptime [<slow_us>]\n"
+	"      Prints how long the jump to the running image took, by hook\n"
 	"  switches\n"
 	"      Prints current EC switch positions\n"
+	"  taskstats [reset]\n"
+	"      Prints per-task run time, wakeups and scheduling latency\n"
 	"  temps <sensorid>\n"
 	"      Print temperature.\n"
 	"  tempsinfo <sensorid>\n"
@@ -384,10 +407,14 @@ void print_help(const char *prog, int print_cmds)
 	printf("Usage: %s [--dev=n] [--interface=dev|i2c|lpc] [--i2c_bus=n]",
 	       prog);
 	printf("[--name=cros_ec|cros_fp|cros_pd|cros_scp|cros_ish] [--ascii] ");
-	printf("<command> [params]\n\n");
+	printf("[--spin=auto|usec] [--stats] <command> [params]\n\n");
 	printf("  --i2c_bus=n  Specifies the number of an I2C bus to use. For\n"
 	       "               example, to use /dev/i2c-7, pass --i2c_bus=7.\n"
-	       "               Implies --interface=i2c.\n\n");
+	       "               Implies --interface=i2c.\n");
+	printf("  --spin=usec  How long to busy-wait for a command to complete\n"
+	       "               before sleeping between polls (LPC only).\n"
+	       "               Defaults to auto, which adapts it to the EC.\n");
+	printf("  --stats      Print command latency statistics at exit.\n\n");
 	if (print_cmds)
 		puts(help_str);
 	else
@@ -1305,6 +1332,39 @@ int cmd_flash_info(int argc, char *argv[])
 		       r.write_ideal_size, r.flags);
 	}
 
+	if (ec_cmd_version_supported(EC_CMD_FLASH_QUEUE_INFO,
+				     EC_VER_FLASH_QUEUE_INFO)) {
+		struct ec_params_flash_queue_info qp;
+		struct ec_response_flash_queue_info qr;
+
+		memset(&qp, 0, sizeof(qp));
+		if (argc > 1 && !strcasecmp(argv[1], "reset"))
+			qp.flags = EC_FLASH_QUEUE_INFO_RESET;
+
+		rv = ec_command(EC_CMD_FLASH_QUEUE_INFO,
+				EC_VER_FLASH_QUEUE_INFO, &qp, sizeof(qp),
+				&qr, sizeof(qr));
+		if (rv < 0)
+			return rv;
+
+		printf("WriteRequests %u\nWriteBytes %u\n",
+		       qr.write_requests, qr.write_bytes);
+		printf("PhysicalWrites %u\nWriteTimeUs %u\n",
+		       qr.physical_writes, qr.write_time_us);
+		if (qr.write_time_us)
+			printf("WriteKBps %u\n", (uint32_t)
+			       ((uint64_t)qr.write_bytes * 1000 /
+				qr.write_time_us));
+		printf("EraseBytes %u\nEraseTimeUs %u\n",
+		       qr.erase_bytes, qr.erase_time_us);
+		if (qr.erase_time_us)
+			printf("EraseKBps %u\n", (uint32_t)
+			       ((uint64_t)qr.erase_bytes * 1000 /
+				qr.erase_time_us));
+		printf("WritePending %u\nEraseQueueDepth %u (max %u)\n",
+		       qr.write_pending, qr.erase_depth, qr.erase_depth_max);
+	}
+
 	return 0;
 }
 
@@ -1465,6 +1525,51 @@ int cmd_flash_write(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_flash_update(int argc, char *argv[])
+{
+	struct ec_flash_update_stats stats;
+	int offset, size;
+	int rv;
+	char *e;
+	char *buf;
+
+	if (argc < 3) {
+		fprintf(stderr, "Usage: %s <offset> <filename>\n", argv[0]);
+		return -1;
+	}
+
+	offset = strtol(argv[1], &e, 0);
+	if ((e && *e) || offset < 0 || offset > MAX_FLASH_SIZE) {
+		fprintf(stderr, "Bad offset.\n");
+		return -1;
+	}
+
+	/* Read the input file */
+	buf = read_file(argv[2], &size);
+	if (!buf)
+		return -1;
+
+	printf("Updating %d bytes at offset %d...\n", size, offset);
+
+	rv = ec_flash_update((const uint8_t *)buf, offset, size, &stats);
+
+	free(buf);
+
+	if (rv < 0)
+		return rv;
+
+	printf("Skipped %d of %d bytes, wrote %d bytes, erased %d blocks\n",
+	       stats.bytes_skipped, stats.bytes_total, stats.bytes_written,
+	       stats.blocks_erased);
+	/* Throughput of what was actually written, not what was skipped */
+	if (stats.usec)
+		printf("%.3f s, %.3f MB/s written\n", stats.usec / 1000000.0,
+		       (double)stats.bytes_written / stats.usec);
+
+	printf("done.\n");
+	return 0;
+}
+
 int cmd_flash_erase(int argc, char *argv[])
 {
 	int offset, size;
@@ -1884,6 +1989,189 @@ sysinfo_error_usage:
 	return -1;
 }
 
+static int sysjump_timing_hooks(int type, const char *name, uint32_t slow_us)
+{
+	struct ec_params_sysjump_timing p = { .type = type, .index = 0 };
+	struct ec_response_sysjump_timing *r = ec_inbuf;
+	const struct ec_sysjump_timing_hook *h;
+	int i, rv;
+
+	do {
+		rv = ec_command(EC_CMD_SYSJUMP_TIMING, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+
+		if (!p.index)
+			printf("%-13s %8u us\n", name,
+			       type == EC_SYSJUMP_TIMING_SYSJUMP ?
+			       r->sysjump_us : r->init_us);
+		for (i = 0; i < r->count; i++) {
+			h = r->hooks + i;
+			printf("  0x%08x  %8u us%s\n", h->routine,
+			       h->duration_us,
+			       h->duration_us >= slow_us ? " (slow)" : "");
+		}
+		p.index += r->count;
+	} while (r->count);
+
+	if (r->run > r->kept)
+		printf("  (%d more)\n", r->run - r->kept);
+
+	return 0;
+}
+
+int cmd_sysjump_timing(int argc, char *argv[])
+{
+	struct ec_params_sysjump_timing p = { .type = EC_SYSJUMP_TIMING_INIT };
+	struct ec_response_sysjump_timing r;
+	uint32_t slow_us = 1000;
+	char *end;
+	int rv;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [<slow_us>]\n", argv[0]);
+		return -1;
+	}
+	if (argc == 2) {
+		slow_us = strtoul(argv[1], &end, 0);
+		if (*end) {
+			fprintf(stderr, "Bad slow_us.\n");
+			return -1;
+		}
+	}
+
+	rv = ec_command(EC_CMD_SYSJUMP_TIMING, 0, &p, sizeof(p), &r,
+			sizeof(r));
+	if (rv < 0)
+		return rv;
+
+	if (!(r.flags & EC_SYSJUMP_TIMING_JUMPED)) {
+		printf("Not jumped to\n");
+		return 0;
+	}
+
+	if (r.flags & EC_SYSJUMP_TIMING_PREV) {
+		printf("Prepare:      %8u us\n", r.prepare_us);
+		rv = sysjump_timing_hooks(EC_SYSJUMP_TIMING_SYSJUMP,
+					  "HOOK_SYSJUMP:", slow_us);
+		if (rv < 0)
+			return rv;
+	}
+	printf("Boot:         %8u us\n", r.boot_us);
+	rv = sysjump_timing_hooks(EC_SYSJUMP_TIMING_INIT, "HOOK_INIT:",
+				  slow_us);
+	if (rv < 0)
+		return rv;
+
+	printf("Total:        %8u us\n",
+	       r.prepare_us + r.sysjump_us + r.boot_us + r.init_us);
+
+	return 0;
+}
+
+static const char * const boot_timeline_steps[] = {
+	[EC_BOOT_TIMELINE_TIMER] = "timer",
+	[EC_BOOT_TIMELINE_UART] = "uart",
+	[EC_BOOT_TIMELINE_KEYBOARD_SCAN] = "keyboard scan",
+	[EC_BOOT_TIMELINE_INITS_DONE] = "inits done",
+	[EC_BOOT_TIMELINE_HOOK_INIT] = "HOOK_INIT",
+	[EC_BOOT_TIMELINE_TASKS] = "tasks",
+	[EC_BOOT_TIMELINE_AP_STARTUP] = "AP startup",
+};
+BUILD_ASSERT(ARRAY_SIZE(boot_timeline_steps) == EC_BOOT_TIMELINE_STEP_COUNT);
+
+static const char * const boot_timeline_lazy[] = {
+	[EC_BOOT_TIMELINE_LAZY_FIRST_USE] = "first use",
+	[EC_BOOT_TIMELINE_LAZY_AFTER_BOOT] = "after boot",
+	[EC_BOOT_TIMELINE_LAZY_AP_ON] = "AP on",
+};
+BUILD_ASSERT(ARRAY_SIZE(boot_timeline_lazy) == EC_BOOT_TIMELINE_LAZY_COUNT);
+
+int cmd_boot_timeline(int argc, char *argv[])
+{
+	struct ec_params_boot_timeline p = { .index = 0 };
+	struct ec_response_boot_timeline *r = ec_inbuf;
+	const struct ec_boot_timeline_entry *e;
+	uint32_t step[EC_BOOT_TIMELINE_STEP_COUNT];
+	uint32_t done = 0, init_us = 0, lazy_us = 0;
+	uint32_t slow_us = 1000;
+	char *end;
+	int i, rv;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [<slow_us>]\n", argv[0]);
+		return -1;
+	}
+	if (argc == 2) {
+		slow_us = strtoul(argv[1], &end, 0);
+		if (*end) {
+			fprintf(stderr, "Bad slow_us.\n");
+			return -1;
+		}
+	}
+
+	do {
+		rv = ec_command(EC_CMD_BOOT_TIMELINE, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+
+		if (!p.index && (r->flags & EC_BOOT_TIMELINE_JUMPED))
+			printf("Jumped to; the clock carried on from the "
+			       "last image\n");
+		for (i = 0; i < r->count; i++) {
+			e = r->entries + i;
+			printf("%10u  ", e->time_us);
+			switch (e->type) {
+			case EC_BOOT_TIMELINE_STEP:
+				printf("%s\n",
+				       e->id < ARRAY_SIZE(boot_timeline_steps)
+				       ? boot_timeline_steps[e->id] : "?");
+				if (e->id < EC_BOOT_TIMELINE_STEP_COUNT) {
+					step[e->id] = e->time_us;
+					done |= BIT(e->id);
+				}
+				break;
+			case EC_BOOT_TIMELINE_INIT:
+				printf("init 0x%08x took %u us%s\n", e->arg,
+				       e->duration_us,
+				       e->duration_us >= slow_us ?
+				       " (slow)" : "");
+				init_us += e->duration_us;
+				break;
+			case EC_BOOT_TIMELINE_LAZY:
+				printf("lazy init 0x%08x (%s) took %u us%s\n",
+				       e->arg,
+				       e->id < ARRAY_SIZE(boot_timeline_lazy)
+				       ? boot_timeline_lazy[e->id] : "?",
+				       e->duration_us,
+				       e->duration_us >= slow_us ?
+				       " (slow)" : "");
+				lazy_us += e->duration_us;
+				break;
+			default:
+				printf("?\n");
+				break;
+			}
+		}
+		p.index += r->count;
+	} while (r->count);
+
+	if (r->recorded > r->kept)
+		printf("(%d more)\n", r->recorded - r->kept);
+
+	printf("HOOK_INIT routines: %8u us\n", init_us);
+	printf("Lazy init:          %8u us\n", lazy_us);
+	if ((done & BIT(EC_BOOT_TIMELINE_TIMER)) &&
+	    (done & BIT(EC_BOOT_TIMELINE_TASKS)))
+		printf("Tasks running:      %8u us after the clock started\n",
+		       step[EC_BOOT_TIMELINE_TASKS] -
+		       step[EC_BOOT_TIMELINE_TIMER]);
+
+	return 0;
+}
+
 int cmd_rollback_info(int argc, char *argv[])
 {
 	struct ec_response_rollback_info r;
@@ -2080,11 +2368,15 @@ int cmd_fp_seed(int argc, char *argv[])
 
 int cmd_fp_stats(int argc, char *argv[])
 {
-	struct ec_response_fp_stats r;
+	struct ec_response_fp_stats_v1 r;
 	int rv;
 	unsigned long long ts;
+	int cmdver = ec_cmd_version_supported(EC_CMD_FP_STATS, 1) ? 1 : 0;
+	int rsize = cmdver == 1 ? sizeof(r)
+				: sizeof(struct ec_response_fp_stats);
+	int i;
 
-	rv = ec_command(EC_CMD_FP_STATS, 0, NULL, 0, &r, sizeof(r));
+	rv = ec_command(EC_CMD_FP_STATS, cmdver, NULL, 0, &r, rsize);
 	if (rv < 0)
 		return rv;
 
@@ -2102,6 +2394,13 @@ int cmd_fp_stats(int argc, char *argv[])
 	else
 		printf("%d us (finger: %d)\n", r.matching_time_us,
 			r.template_matched);
+	if (cmdver == 1 && !(r.timestamps_invalid & FPSTATS_MATCHING_INV)) {
+		printf("Templates tried:    %u\n", r.templates_tried);
+		for (i = 0; i < FP_STATS_MAX_TEMPLATES; i++)
+			if (r.template_time_us[i])
+				printf("  finger %d:        %u us\n", i,
+				       r.template_time_us[i]);
+	}
 
 	printf("Last overall time:  ");
 	if (r.timestamps_invalid)
@@ -3405,6 +3704,60 @@ int cmd_pwm_get_fan_rpm(int argc, char *argv[])
 	return 0;
 }
 
+static int print_fan_telemetry(int idx)
+{
+	struct ec_params_fan_telemetry p;
+	struct ec_response_fan_telemetry r;
+	int rv;
+
+	p.fan_idx = idx;
+	rv = ec_command(EC_CMD_FAN_TELEMETRY, 0, &p, sizeof(p), &r, sizeof(r));
+	if (rv < 0)
+		return rv;
+
+	printf("Fan %d:\n", idx);
+	printf("  Mode:      %s%s\n",
+	       r.flags & EC_FAN_TELEMETRY_RPM_MODE ? "rpm" : "duty",
+	       r.flags & EC_FAN_TELEMETRY_STALLED ? " (stalled)" : "");
+	printf("  Target:    %d rpm\n", r.target_rpm);
+	printf("  Actual:    %d rpm (raw %d)\n", r.rpm, r.raw_rpm);
+	printf("  Duty:      %d%%\n", r.duty);
+	if (r.flags & EC_FAN_TELEMETRY_SETTLED)
+		printf("  Settled:   %u ms\n", r.settle_ms);
+	else
+		printf("  Settled:   no\n");
+	printf("  Overshoot: %d rpm\n", r.overshoot_rpm);
+	printf("  Stalls:    %d\n", r.stall_count);
+
+	return 0;
+}
+
+int cmd_fan_telemetry(int argc, char *argv[])
+{
+	int i, num_fans, rv;
+
+	num_fans = get_num_fans();
+	if (argc < 2 || !strcasecmp(argv[1], "all")) {
+		for (i = 0; i < num_fans; i++) {
+			rv = print_fan_telemetry(i);
+			if (rv < 0)
+				return rv;
+		}
+	} else {
+		char *e;
+		int idx;
+
+		idx = strtol(argv[1], &e, 0);
+		if ((e && *e) || idx < 0 || idx >= num_fans) {
+			fprintf(stderr, "Bad index.\n");
+			return -1;
+		}
+
+		return print_fan_telemetry(idx);
+	}
+
+	return 0;
+}
 
 int cmd_pwm_set_fan_rpm(int argc, char *argv[])
 {
@@ -6504,6 +6857,167 @@ int cmd_power_info(int argc, char *argv[])
 }
 
 
+static const char * const power_timeline_states[] = {
+	[EC_POWER_TIMELINE_G3] = "G3",
+	[EC_POWER_TIMELINE_S5] = "S5",
+	[EC_POWER_TIMELINE_S3] = "S3",
+	[EC_POWER_TIMELINE_S0] = "S0",
+	[EC_POWER_TIMELINE_S0IX] = "S0ix",
+	[EC_POWER_TIMELINE_G3S5] = "G3->S5",
+	[EC_POWER_TIMELINE_S5S3] = "S5->S3",
+	[EC_POWER_TIMELINE_S3S0] = "S3->S0",
+	[EC_POWER_TIMELINE_S0S3] = "S0->S3",
+	[EC_POWER_TIMELINE_S3S5] = "S3->S5",
+	[EC_POWER_TIMELINE_S5G3] = "S5->G3",
+	[EC_POWER_TIMELINE_S0IXS0] = "S0ix->S0",
+	[EC_POWER_TIMELINE_S0S0IX] = "S0->S0ix",
+};
+BUILD_ASSERT(ARRAY_SIZE(power_timeline_states) ==
+	     EC_POWER_TIMELINE_STATE_COUNT);
+
+static const char * const power_timeline_hooks[] = {
+	[EC_POWER_TIMELINE_HOOK_PRE_INIT] = "PRE_INIT",
+	[EC_POWER_TIMELINE_HOOK_STARTUP] = "STARTUP",
+	[EC_POWER_TIMELINE_HOOK_RESUME] = "RESUME",
+	[EC_POWER_TIMELINE_HOOK_SUSPEND] = "SUSPEND",
+	[EC_POWER_TIMELINE_HOOK_RESUME_INIT] = "RESUME_INIT",
+	[EC_POWER_TIMELINE_HOOK_SUSPEND_COMPLETE] = "SUSPEND_COMPLETE",
+	[EC_POWER_TIMELINE_HOOK_SHUTDOWN] = "SHUTDOWN",
+	[EC_POWER_TIMELINE_HOOK_SHUTDOWN_COMPLETE] = "SHUTDOWN_COMPLETE",
+	[EC_POWER_TIMELINE_HOOK_RESET] = "RESET",
+};
+BUILD_ASSERT(ARRAY_SIZE(power_timeline_hooks) ==
+	     EC_POWER_TIMELINE_HOOK_COUNT);
+
+/* Latencies of one kind of transition, from the state it starts with */
+struct power_timeline_latency {
+	const char *name;
+	int from;
+	int to;
+	uint32_t start;
+	int started;
+	int count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint64_t total_us;
+};
+
+static void power_timeline_track(struct power_timeline_latency *l,
+				 const struct ec_power_timeline_entry *e)
+{
+	uint32_t us;
+
+	if (e->id == l->from) {
+		l->start = e->time_us;
+		l->started = 1;
+	} else if (e->id == l->to && l->started) {
+		us = e->time_us - l->start;
+		printf("    %s took %u us\n", l->name, us);
+		if (!l->count || us < l->min_us)
+			l->min_us = us;
+		if (us > l->max_us)
+			l->max_us = us;
+		l->total_us += us;
+		l->count++;
+		l->started = 0;
+	} else if (e->id != EC_POWER_TIMELINE_S3 &&
+		   e->id != EC_POWER_TIMELINE_S3S0) {
+		/* Went somewhere else along the way */
+		l->started = 0;
+	}
+}
+
+int cmd_power_timeline(int argc, char *argv[])
+{
+	struct ec_params_power_timeline p = { .seq = 0 };
+	struct ec_response_power_timeline *r = ec_inbuf;
+	const struct ec_power_timeline_entry *e;
+	struct power_timeline_latency latency[] = {
+		{ "S5->S0", EC_POWER_TIMELINE_S5S3, EC_POWER_TIMELINE_S0 },
+		{ "S0->S3", EC_POWER_TIMELINE_S0S3, EC_POWER_TIMELINE_S3 },
+	};
+	uint32_t slow_us = 10000;
+	uint32_t last = 0;
+	int slow = 0;
+	int i, rv;
+	char *end;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [<slow_us>]\n", argv[0]);
+		return -1;
+	}
+	if (argc == 2) {
+		slow_us = strtoul(argv[1], &end, 0);
+		if (*end) {
+			fprintf(stderr, "Bad slow_us.\n");
+			return -1;
+		}
+	}
+
+	do {
+		rv = ec_command(EC_CMD_POWER_TIMELINE, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (r->seq != p.seq)
+			printf("(%u entries lost)\n", r->seq - p.seq);
+
+		for (i = 0; i < r->count; i++) {
+			e = r->entries + i;
+			printf("%10u +%8u  ", e->time_us,
+			       last ? e->time_us - last : 0);
+			last = e->time_us;
+
+			switch (e->type) {
+			case EC_POWER_TIMELINE_SIGNAL:
+				printf("signal %d => %d\n", e->id, e->value);
+				break;
+			case EC_POWER_TIMELINE_STATE:
+				printf("state %s\n",
+				       e->id < ARRAY_SIZE(power_timeline_states)
+				       ? power_timeline_states[e->id] : "?");
+				power_timeline_track(latency + 0, e);
+				power_timeline_track(latency + 1, e);
+				break;
+			case EC_POWER_TIMELINE_HOOK:
+				printf("hook %s 0x%08x took %u us%s\n",
+				       e->id < ARRAY_SIZE(power_timeline_hooks)
+				       ? power_timeline_hooks[e->id] : "?",
+				       e->arg, e->duration_us,
+				       e->duration_us >= slow_us ? " (slow)" : "");
+				if (e->duration_us >= slow_us)
+					slow++;
+				break;
+			case EC_POWER_TIMELINE_WAIT:
+				printf("wait for 0x%04x %s after %u us\n",
+				       e->arg, e->value ? "timed out" : "done",
+				       e->duration_us);
+				break;
+			default:
+				printf("type %d?\n", e->type);
+				break;
+			}
+		}
+
+		p.seq = r->next_seq;
+	} while (r->count);
+
+	printf("\n");
+	for (i = 0; i < ARRAY_SIZE(latency); i++) {
+		if (!latency[i].count) {
+			printf("%s: none\n", latency[i].name);
+			continue;
+		}
+		printf("%s: %d, min %u us, avg %u us, max %u us\n",
+		       latency[i].name, latency[i].count, latency[i].min_us,
+		       (uint32_t)(latency[i].total_us / latency[i].count),
+		       latency[i].max_us);
+	}
+	printf("Hooks taking %u us or more: %d\n", slow_us, slow);
+
+	return 0;
+}
+
 int cmd_pse(int argc, char *argv[])
 {
 	struct ec_params_pse p;
@@ -6913,6 +7427,53 @@ int cmd_switches(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_task_stats(int argc, char *argv[])
+{
+	struct ec_params_task_stats p;
+	struct ec_response_task_stats r;
+	int task_count = 1;
+	int rv;
+	int i, bit;
+
+	memset(&p, 0, sizeof(p));
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "reset")) {
+			fprintf(stderr, "Usage: %s [reset]\n", argv[0]);
+			return -1;
+		}
+		p.flags |= EC_TASK_STATS_RESET;
+	}
+
+	printf("Task Name             Run (s)     ISR (s)  Wakeups "
+	       "MaxLat(us) StkWake\n");
+	for (i = 0; i < task_count; i++) {
+		p.task_id = i;
+		rv = ec_command(EC_CMD_TASK_STATS, 0, &p, sizeof(p),
+				&r, sizeof(r));
+		if (rv < 0)
+			return rv;
+		task_count = r.task_count;
+
+		printf("%4d %-16s %11.6f %11.6f %8u %10u ", i, r.name,
+		       r.run_time_us / 1000000.0, r.isr_time_us / 1000000.0,
+		       r.wakeups, r.max_latency_us);
+		if (r.stack_size)
+			printf("%u/%u\n", r.stack_used, r.stack_size);
+		else
+			printf("%u\n", r.stack_used);
+
+		/* Which events woke the task, as bit:count */
+		if (!r.wakeups)
+			continue;
+		printf("     events:");
+		for (bit = 0; bit < EC_TASK_STATS_EVENT_BITS; bit++)
+			if (r.event_wakeups[bit])
+				printf(" %d:%u", bit, r.event_wakeups[bit]);
+		printf("\n");
+	}
+
+	return 0;
+}
 
 int cmd_wireless(int argc, char *argv[])
 {
@@ -8555,8 +9116,36 @@ int cmd_rtc_get_alarm(int argc, char *argv[])
 int cmd_console(int argc, char *argv[])
 {
 	char *out = (char *)ec_inbuf;
+	uint32_t seq = 0;
+	int follow = 0;
 	int rv;
 
+	if (argc > 1) {
+		if (strcmp(argv[1], "-f")) {
+			fprintf(stderr, "Usage: %s [-f]\n", argv[0]);
+			return -1;
+		}
+		follow = 1;
+	}
+
+	if (ec_cmd_version_supported(EC_CMD_CONSOLE_READ_SEQ, 0)) {
+		rv = ec_console_read_seq(&seq, stdout, 0);
+		while (follow && rv >= 0) {
+			fflush(stdout);
+			usleep(100000);
+			rv = ec_console_read_seq(&seq, stdout, 1);
+		}
+		if (rv < 0)
+			return rv;
+		printf("\n");
+		return 0;
+	}
+
+	if (follow) {
+		fprintf(stderr, "EC can't stream its console\n");
+		return -1;
+	}
+
 	/* Snapshot the EC console */
 	rv = ec_command(EC_CMD_CONSOLE_SNAPSHOT, 0, NULL, 0, NULL, 0);
 	if (rv < 0)
@@ -10287,6 +10876,8 @@ int cmd_cec(int argc, char *argv[])
 	return -1;
 }
 
+int cmd_batch(int argc, char *argv[]);
+
 /* NULL-terminated list of commands */
 const struct command commands[] = {
 	{"adcread", cmd_adc_read},
@@ -10294,10 +10885,12 @@ const struct command commands[] = {
 	{"apreset", cmd_apreset},
 	{"autofanctrl", cmd_thermal_auto_fan_ctrl},
 	{"backlight", cmd_lcd_backlight},
+	{"batch", cmd_batch},
 	{"battery", cmd_battery},
 	{"batterycutoff", cmd_battery_cut_off},
 	{"batteryparam", cmd_battery_vendor_param},
 	{"boardversion", cmd_board_version},
+	{"boottimeline", cmd_boot_timeline},
 	{"button", cmd_button},
 	{"cbi", cmd_cbi},
 	{"chargecurrentlimit", cmd_charge_current_limit},
@@ -10321,10 +10914,12 @@ const struct command commands[] = {
 	{"eventsetwakemask", cmd_host_event_set_wake_mask},
 	{"extpwrlimit", cmd_ext_power_limit},
 	{"fanduty", cmd_fanduty},
+	{"fantelemetry", cmd_fan_telemetry},
 	{"flasherase", cmd_flash_erase},
 	{"flasheraseasync", cmd_flash_erase},
 	{"flashprotect", cmd_flash_protect},
 	{"flashread", cmd_flash_read},
+	{"flashupdate", cmd_flash_update},
 	{"flashwrite", cmd_flash_write},
 	{"flashinfo", cmd_flash_info},
 	{"flashspiinfo", cmd_flash_spi_info},
@@ -10375,6 +10970,7 @@ const struct command commands[] = {
 	{"pdchipinfo", cmd_pd_chip_info},
 	{"pdwritelog", cmd_pd_write_log},
 	{"powerinfo", cmd_power_info},
+	{"powertimeline", cmd_power_timeline},
 	{"protoinfo", cmd_proto_info},
 	{"pse", cmd_pse},
 	{"pstoreinfo", cmd_pstore_info},
@@ -10399,12 +10995,15 @@ const struct command commands[] = {
 	{"rwsig", cmd_rwsig},
 	{"rwsigaction", cmd_rwsig_action_legacy},
 	{"rwsigstatus", cmd_rwsig_status},
+	{"serve", cmd_serve},
 	{"sertest", cmd_serial_test},
 	{"smartdischarge", cmd_smart_discharge},
 	{"stress", cmd_stress_test},
 	{"sysinfo", cmd_sysinfo},
+	{"sysjumptime", cmd_sysjump_timing},
 	{"port80flood", cmd_port_80_flood},
 	{"switches", cmd_switches},
+	{"taskstats", cmd_task_stats},
 	{"temps", cmd_temperature},
 	{"tempsinfo", cmd_temp_sensor_info},
 	{"test", cmd_test},
@@ -10430,6 +11029,118 @@ const struct command commands[] = {
 	{NULL, NULL}
 };
 
+const struct command *find_command(const char *name)
+{
+	const struct command *cmd;
+
+	for (cmd = commands; cmd->name; cmd++) {
+		if (!strcasecmp(name, cmd->name))
+			return cmd;
+	}
+	return NULL;
+}
+
+int split_command_line(char *line, char **args, int max_args)
+{
+	char *tok, *save;
+	int nargs = 0;
+
+	for (tok = strtok_r(line, " \t\r\n", &save);
+	     tok && *tok != '#' && nargs < max_args;
+	     tok = strtok_r(NULL, " \t\r\n", &save))
+		args[nargs++] = tok;
+
+	return nargs;
+}
+
+/*
+ * Run many commands from one process, to save the cost of starting ectool
+ * and finding the EC for each of them. Commands which call exit() on error
+ * end the batch.
+ */
+int cmd_batch(int argc, char *argv[])
+{
+	char line[1024];
+	char *args[COMMAND_MAX_ARGS];
+	const struct command *cmd;
+	FILE *f = stdin;
+	int line_num = 0;
+	int failed = 0;
+	int nargs, rv;
+
+	if (argc > 2) {
+		fprintf(stderr, "Usage: %s [<file>]\n", argv[0]);
+		return -1;
+	}
+
+	if (argc == 2 && strcmp(argv[1], "-")) {
+		f = fopen(argv[1], "r");
+		if (!f) {
+			perror("Error opening batch file");
+			return -1;
+		}
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		line_num++;
+
+		nargs = split_command_line(line, args, ARRAY_SIZE(args));
+		if (!nargs)
+			continue;
+
+		cmd = find_command(args[0]);
+		if (!cmd || cmd->handler == cmd_batch ||
+		    cmd->handler == cmd_serve) {
+			fprintf(stderr, "line %d: Unknown command '%s'\n",
+				line_num, args[0]);
+			failed++;
+			continue;
+		}
+
+		rv = cmd->handler(nargs, args);
+		fflush(stdout);
+		if (rv) {
+			fprintf(stderr, "line %d: %s failed (%d)\n",
+				line_num, args[0], rv);
+			failed++;
+		}
+	}
+
+	if (f != stdin)
+		fclose(f);
+
+	return failed ? -1 : 0;
+}
+
+static void print_command_stats(void)
+{
+	struct ec_command_stats s;
+	int percentiles[] = { 50, 90, 99 };
+	uint32_t seen;
+	int i, p;
+
+	ec_get_command_stats(&s);
+	if (!s.count)
+		return;
+
+	fprintf(stderr, "%u commands, %u failed\n", s.count, s.errors);
+	fprintf(stderr, "latency (us): min %u, avg %llu, max %u\n",
+		s.min_us, (unsigned long long)(s.total_us / s.count),
+		s.max_us);
+
+	/* The histogram only gives the power of two each falls under */
+	fprintf(stderr, "latency (us):");
+	for (p = 0, i = 0, seen = 0; p < ARRAY_SIZE(percentiles); p++) {
+		while (i < ARRAY_SIZE(s.histogram) &&
+		       (uint64_t)(seen + s.histogram[i]) * 100 <
+		       (uint64_t)s.count * percentiles[p])
+			seen += s.histogram[i++];
+		fprintf(stderr, " p%d < %llu%s", percentiles[p],
+			2ULL << MIN(i, 31),
+			p < ARRAY_SIZE(percentiles) - 1 ? "," : "\n");
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	const struct command *cmd;
@@ -10439,6 +11150,7 @@ int main(int argc, char *argv[])
 	char device_name[41] = CROS_EC_DEV_NAME;
 	int rv = 1;
 	int parse_error = 0;
+	int print_stats = 0;
 	char *e;
 	int i;
 
@@ -10488,6 +11200,20 @@ int main(int argc, char *argv[])
 		case OPT_ASCII:
 			ascii_mode = 1;
 			break;
+		case OPT_SPIN:
+			if (!strcasecmp(optarg, "auto")) {
+				ec_poll_spin_usec = EC_POLL_SPIN_AUTO;
+				break;
+			}
+			ec_poll_spin_usec = strtol(optarg, &e, 0);
+			if (!*optarg || (e && *e) || ec_poll_spin_usec < 0) {
+				fprintf(stderr, "Invalid --spin\n");
+				parse_error = 1;
+			}
+			break;
+		case OPT_STATS:
+			print_stats = 1;
+			break;
 		}
 	}
 
@@ -10526,8 +11252,19 @@ int main(int argc, char *argv[])
 		exit(1);
 	}
 
+	cmd = find_command(argv[optind]);
+
 	/* Prefer /dev method, which supports built-in mutex */
-	if (!(interfaces & COMM_DEV) || comm_init_dev(device_name)) {
+	if (cmd && cmd->handler == cmd_serve) {
+		/*
+		 * Don't hold the GEC lock for as long as the server runs: it
+		 * only uses /dev, like ec_logd.
+		 */
+		if (!(interfaces & COMM_DEV) || comm_init_dev(device_name)) {
+			fprintf(stderr, "serve needs the /dev interface\n");
+			exit(1);
+		}
+	} else if (!(interfaces & COMM_DEV) || comm_init_dev(device_name)) {
 		/* If dev is excluded or isn't supported, find alternative */
 		if (acquire_gec_lock(GEC_LOCK_TIMEOUT_SECS) < 0) {
 			fprintf(stderr, "Could not acquire GEC lock.\n");
@@ -10545,11 +11282,11 @@ int main(int argc, char *argv[])
 	}
 
 	/* Handle commands */
-	for (cmd = commands; cmd->name; cmd++) {
-		if (!strcasecmp(argv[optind], cmd->name)) {
-			rv = cmd->handler(argc - optind, argv + optind);
-			goto out;
-		}
+	if (cmd) {
+		rv = cmd->handler(argc - optind, argv + optind);
+		if (print_stats)
+			print_command_stats();
+		goto out;
 	}
 
 	/* If we're still here, command was unknown */
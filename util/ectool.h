@@ -40,3 +40,47 @@ struct command {
  * The key matrix is read from the fdt.
  */
 int cmd_keyscan(int argc, char *argv[]);
+
+/* Maximum number of arguments on one batch or serve command line */
+#define COMMAND_MAX_ARGS 64
+
+/**
+ * Find an `ectool` command by name.
+ *
+ * @param name The command name, matched case-insensitively
+ * @return The command, or NULL if there is none by that name.
+ */
+const struct command *find_command(const char *name);
+
+/**
+ * Split a command line into arguments, in place.
+ *
+ * Arguments are separated by whitespace, and a '#' starts a comment.
+ *
+ * @param line The line to split, which is modified
+ * @param args Where to store pointers to the arguments
+ * @param max_args The size of `args`
+ * @return The number of arguments found.
+ */
+int split_command_line(char *line, char **args, int max_args);
+
+/**
+ * Serve `ectool` commands on a Unix socket
+ *
+ * ectool serve <socket> [idle_secs]
+ *
+ * Keeps the connection to the EC open and runs each newline-terminated
+ * command line sent to <socket>, replying with one line of JSON per command:
+ *
+ *   {"command":"<name>","rc":<rc>,"output":"<stdout>","error":"<stderr>"}
+ *
+ * Each client is served by its own process, and dropped once it has sent
+ * nothing for idle_secs (60 by default). Each command runs in a process of
+ * its own too, so one that exits on bad input only ends itself; rc is then
+ * its exit status.
+ *
+ * Runs until interrupted. Only works over the /dev interface, where the
+ * kernel serializes commands, so that other ectools can still get to the EC
+ * meanwhile.
+ */
+int cmd_serve(int argc, char *argv[]);
@@ -0,0 +1,333 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Long-running ectool that takes its commands from a Unix socket, so that
+ * callers don't pay for finding and probing the EC on every command.
+ */
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "compile_time_macros.h"
+#include "ectool.h"
+
+/* Longest command line accepted from a client */
+#define SERVE_MAX_LINE 1024
+
+/* How long a client may stay connected without sending a command */
+#define SERVE_IDLE_SECS 60
+
+static volatile sig_atomic_t stop;
+
+static void on_stop(int sig)
+{
+	stop = 1;
+}
+
+static void json_string(FILE *out, const char *s, size_t len)
+{
+	size_t i;
+
+	fputc('"', out);
+	for (i = 0; i < len; i++) {
+		unsigned char c = s[i];
+
+		if (c == '"' || c == '\\')
+			fprintf(out, "\\%c", c);
+		else if (c == '\n')
+			fputs("\\n", out);
+		else if (c == '\r')
+			fputs("\\r", out);
+		else if (c == '\t')
+			fputs("\\t", out);
+		else if (c < 0x20 || c >= 0x7f)
+			fprintf(out, "\\u%04x", c);
+		else
+			fputc(c, out);
+	}
+	fputc('"', out);
+}
+
+/*
+ * Write out everything captured in f, and empty it for the next command.
+ * Commands write to it through their stdout or stderr file descriptor, so
+ * read it through the descriptor too rather than through stdio.
+ */
+static void json_capture(FILE *out, FILE *f)
+{
+	int fd = fileno(f);
+	char *buf;
+	off_t len;
+
+	fflush(f);
+	len = lseek(fd, 0, SEEK_CUR);
+	buf = len > 0 ? malloc(len) : NULL;
+	if (buf)
+		len = pread(fd, buf, len, 0);
+	if (!buf || len < 0)
+		len = 0;
+	json_string(out, buf, len);
+	free(buf);
+
+	if (ftruncate(fd, 0) || lseek(fd, 0, SEEK_SET))
+		perror("Error clearing captured output");
+}
+
+/*
+ * Run one command with its output going to the capture files. It runs in a
+ * child process, so that a command which calls exit() on bad input only ends
+ * itself. The child starts off from the state of the server, so the tuning
+ * of the EC interface carries over, but its command latency statistics don't
+ * come back.
+ */
+static int run_command(const struct command *cmd, int argc, char *argv[],
+		       FILE *cap_out, FILE *cap_err)
+{
+	int rv_pipe[2];
+	int status;
+	int rv = -1;
+	ssize_t n;
+	pid_t pid;
+
+	if (pipe(rv_pipe)) {
+		fprintf(cap_err, "Error creating pipe: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* Don't leave the child anything buffered to write out again. */
+	fflush(stdout);
+	fflush(stderr);
+	fflush(cap_out);
+	fflush(cap_err);
+	pid = fork();
+	if (pid < 0) {
+		fprintf(cap_err, "Error forking: %s\n", strerror(errno));
+		close(rv_pipe[0]);
+		close(rv_pipe[1]);
+		return -1;
+	}
+
+	if (!pid) {
+		close(rv_pipe[0]);
+		if (dup2(fileno(cap_out), STDOUT_FILENO) < 0 ||
+		    dup2(fileno(cap_err), STDERR_FILENO) < 0)
+			_exit(1);
+		rv = cmd->handler(argc, argv);
+		fflush(stdout);
+		fflush(stderr);
+		if (write(rv_pipe[1], &rv, sizeof(rv)) != sizeof(rv))
+			_exit(1);
+		_exit(0);
+	}
+
+	/* Nothing comes through the pipe if the command exits on its own. */
+	close(rv_pipe[1]);
+	do {
+		n = read(rv_pipe[0], &rv, sizeof(rv));
+	} while (n < 0 && errno == EINTR);
+	close(rv_pipe[0]);
+	while (waitpid(pid, &status, 0) < 0 && errno == EINTR)
+		;
+
+	if (n != sizeof(rv)) {
+		rv = -1;
+		if (WIFEXITED(status))
+			rv = WEXITSTATUS(status);
+		else if (WIFSIGNALED(status))
+			fprintf(cap_err, "Killed by signal %d\n",
+				WTERMSIG(status));
+	}
+	return rv;
+}
+
+static void serve_line(FILE *out, char *line, FILE *cap_out, FILE *cap_err)
+{
+	char *args[COMMAND_MAX_ARGS];
+	const struct command *cmd;
+	int nargs, rv;
+
+	nargs = split_command_line(line, args, ARRAY_SIZE(args));
+	if (!nargs)
+		return;
+
+	cmd = find_command(args[0]);
+	if (!cmd || cmd->handler == cmd_serve) {
+		fprintf(cap_err, "Unknown command '%s'\n", args[0]);
+		rv = -1;
+	} else {
+		rv = run_command(cmd, nargs, args, cap_out, cap_err);
+	}
+
+	fputs("{\"command\":", out);
+	json_string(out, args[0], strlen(args[0]));
+	fprintf(out, ",\"rc\":%d,\"output\":", rv);
+	json_capture(out, cap_out);
+	fputs(",\"error\":", out);
+	json_capture(out, cap_err);
+	fputs("}\n", out);
+	fflush(out);
+}
+
+/*
+ * Serve the commands of one client, until it hangs up or stays quiet for
+ * idle_secs. Runs in its own process, so other clients aren't kept waiting.
+ */
+static void serve_client(int fd, int idle_secs)
+{
+	struct timeval idle = { .tv_sec = idle_secs };
+	char line[SERVE_MAX_LINE];
+	FILE *cap_out, *cap_err;
+	FILE *in, *out;
+	int out_fd;
+
+	/* A timed out read fails like the end of the connection. */
+	if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle))) {
+		perror("Error setting client timeout");
+		close(fd);
+		return;
+	}
+
+	cap_out = tmpfile();
+	cap_err = tmpfile();
+	out_fd = dup(fd);
+	in = fdopen(fd, "r");
+	out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+	if (!cap_out || !cap_err || !in || !out) {
+		perror("Error setting up client");
+		if (cap_out)
+			fclose(cap_out);
+		if (cap_err)
+			fclose(cap_err);
+		if (in)
+			fclose(in);
+		else
+			close(fd);
+		if (out)
+			fclose(out);
+		else if (out_fd >= 0)
+			close(out_fd);
+		return;
+	}
+
+	while (!stop && fgets(line, sizeof(line), in)) {
+		if (!strchr(line, '\n') && !feof(in)) {
+			fputs("{\"command\":null,\"rc\":-1,\"output\":\"\","
+			      "\"error\":\"Line too long\"}\n", out);
+			fflush(out);
+			break;
+		}
+		serve_line(out, line, cap_out, cap_err);
+		if (ferror(out))
+			break;
+	}
+
+	fclose(in);
+	fclose(out);
+	fclose(cap_out);
+	fclose(cap_err);
+}
+
+int cmd_serve(int argc, char *argv[])
+{
+	struct sockaddr_un addr;
+	struct sigaction sa;
+	struct stat st;
+	int idle_secs = SERVE_IDLE_SECS;
+	int listen_fd, fd;
+	char *e;
+	pid_t pid;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "Usage: %s <socket> [idle_secs]\n", argv[0]);
+		return -1;
+	}
+	if (argc > 2) {
+		idle_secs = strtol(argv[2], &e, 0);
+		if (*e || idle_secs <= 0) {
+			fprintf(stderr, "Bad idle time '%s'\n", argv[2]);
+			return -1;
+		}
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	if (strlen(argv[1]) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long\n");
+		return -1;
+	}
+	strcpy(addr.sun_path, argv[1]);
+
+	/* Only clear away a stale socket, never some other file. */
+	if (!lstat(addr.sun_path, &st)) {
+		if (!S_ISSOCK(st.st_mode)) {
+			fprintf(stderr, "%s exists and is not a socket\n",
+				addr.sun_path);
+			return -1;
+		}
+		unlink(addr.sun_path);
+	}
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0) {
+		perror("Error creating socket");
+		return -1;
+	}
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(listen_fd, 4)) {
+		perror("Error listening on socket");
+		close(listen_fd);
+		return -1;
+	}
+
+	/* No SA_RESTART, so that accept() and reads give up on a signal. */
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_stop;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+	signal(SIGPIPE, SIG_IGN);
+	/* Let the client processes go without having to wait for them. */
+	signal(SIGCHLD, SIG_IGN);
+
+	printf("Serving on %s\n", addr.sun_path);
+	fflush(stdout);
+
+	/*
+	 * Each client gets its own process. The kernel serializes commands
+	 * to the EC, as it does for separate ectools.
+	 */
+	while (!stop) {
+		fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("Error accepting connection");
+			break;
+		}
+
+		pid = fork();
+		if (!pid) {
+			close(listen_fd);
+			/* run_command() waits for its commands. */
+			signal(SIGCHLD, SIG_DFL);
+			serve_client(fd, idle_secs);
+			_exit(0);
+		}
+		if (pid < 0)
+			perror("Error forking for client");
+		close(fd);
+	}
+
+	close(listen_fd);
+	unlink(addr.sun_path);
+	return 0;
+}
@@ -0,0 +1,326 @@
+/* Copyright 2021 The Chromium OS Authors. All rights reserved.
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Generate the fixed-base comb table used by x25519_scalar_mult_base().
+ *
+ * With n = CONFIG_CURVE25519_COMB_TEETH teeth spaced s = ceil(255 / n) bits
+ * apart, entry j - 1 of the table holds the edwards25519 point
+ *
+ *     sum over set bits i of j: 2^(i * s) * B
+ *
+ * in the (y + x, y - x, 2 * d * x * y) form expected by ge_madd().
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+
+#define FPRINTF(format, args...) fprintf(fout, format, ## args)
+
+#ifndef CONFIG_CURVE25519_COMB_TEETH
+#error "CONFIG_CURVE25519_COMB_TEETH must be defined."
+#endif
+
+#define TEETH CONFIG_CURVE25519_COMB_TEETH
+#define SPACING ((255 + TEETH - 1) / TEETH)
+#define ENTRIES ((1 << TEETH) - 1)
+
+#if TEETH < 1 || TEETH > 8
+#error "CONFIG_CURVE25519_COMB_TEETH must be between 1 and 8."
+#endif
+
+/*
+ * Field elements mod 2^255 - 19, in five 51-bit limbs. Speed does not matter
+ * here, so every operation leaves its result fully carried.
+ */
+typedef struct {
+	uint64_t v[5];
+} fe;
+
+struct point {
+	fe x;
+	fe y;
+};
+
+#define MASK51 ((UINT64_C(1) << 51) - 1)
+
+static void fe_carry(fe *h)
+{
+	int pass;
+	int i;
+
+	for (pass = 0; pass < 3; pass++) {
+		for (i = 0; i < 4; i++) {
+			h->v[i + 1] += h->v[i] >> 51;
+			h->v[i] &= MASK51;
+		}
+		h->v[0] += 19 * (h->v[4] >> 51);
+		h->v[4] &= MASK51;
+	}
+}
+
+static void fe_small(fe *h, uint64_t n)
+{
+	memset(h, 0, sizeof(*h));
+	h->v[0] = n;
+}
+
+static void fe_add(fe *h, const fe *f, const fe *g)
+{
+	int i;
+
+	for (i = 0; i < 5; i++)
+		h->v[i] = f->v[i] + g->v[i];
+	fe_carry(h);
+}
+
+static void fe_sub(fe *h, const fe *f, const fe *g)
+{
+	int i;
+
+	/* Add 2 * p first so that no limb goes negative. */
+	h->v[0] = f->v[0] + 2 * (MASK51 - 18) - g->v[0];
+	for (i = 1; i < 5; i++)
+		h->v[i] = f->v[i] + 2 * MASK51 - g->v[i];
+	fe_carry(h);
+}
+
+static void fe_mul(fe *h, const fe *f, const fe *g)
+{
+	unsigned __int128 t[5] = { 0 };
+	uint64_t carry = 0;
+	int i, j;
+
+	for (i = 0; i < 5; i++) {
+		for (j = 0; j < 5; j++) {
+			unsigned __int128 p =
+				(unsigned __int128)f->v[i] * g->v[j];
+
+			if (i + j < 5)
+				t[i + j] += p;
+			else
+				t[i + j - 5] += p * 19;
+		}
+	}
+
+	for (i = 0; i < 5; i++) {
+		t[i] += carry;
+		h->v[i] = (uint64_t)t[i] & MASK51;
+		carry = (uint64_t)(t[i] >> 51);
+	}
+	h->v[0] += 19 * carry;
+	fe_carry(h);
+}
+
+static void fe_invert(fe *h, const fe *f)
+{
+	/* p - 2 = 2^255 - 21 */
+	fe r;
+	int i;
+
+	fe_small(&r, 1);
+	for (i = 254; i >= 0; i--) {
+		fe_mul(&r, &r, &r);
+		if (i > 4 || i == 3 || i == 1 || i == 0)
+			fe_mul(&r, &r, f);
+	}
+	*h = r;
+}
+
+static void fe_frombytes(fe *h, const uint8_t s[32])
+{
+	int i;
+
+	memset(h, 0, sizeof(*h));
+	for (i = 0; i < 255; i++)
+		h->v[i / 51] |= (uint64_t)((s[i / 8] >> (i % 8)) & 1) << (i % 51);
+}
+
+static void fe_tobytes(uint8_t s[32], const fe *f)
+{
+	fe h = *f;
+	int i;
+
+	/* After fe_carry() the value is below 2^255, so at most p too big. */
+	if (h.v[1] == MASK51 && h.v[2] == MASK51 && h.v[3] == MASK51 &&
+	    h.v[4] == MASK51 && h.v[0] >= MASK51 - 18) {
+		h.v[0] -= MASK51 - 18;
+		h.v[1] = h.v[2] = h.v[3] = h.v[4] = 0;
+	}
+
+	memset(s, 0, 32);
+	for (i = 0; i < 255; i++)
+		s[i / 8] |= ((h.v[i / 51] >> (i % 51)) & 1) << (i % 8);
+}
+
+static int fe_equal(const fe *f, const fe *g)
+{
+	uint8_t a[32], b[32];
+
+	fe_tobytes(a, f);
+	fe_tobytes(b, g);
+	return !memcmp(a, b, sizeof(a));
+}
+
+/* d = -121665 / 121666 */
+static void curve_d(fe *d)
+{
+	fe num, den;
+
+	fe_small(&num, 0);
+	fe_small(&den, 121665);
+	fe_sub(&num, &num, &den);
+	fe_small(&den, 121666);
+	fe_invert(&den, &den);
+	fe_mul(d, &num, &den);
+}
+
+/* Affine twisted Edwards addition with a = -1; complete for edwards25519. */
+static void point_add(struct point *r, const struct point *p,
+		      const struct point *q, const fe *d)
+{
+	fe x1y2, y1x2, x1x2, y1y2, t, one, num, den;
+
+	fe_mul(&x1y2, &p->x, &q->y);
+	fe_mul(&y1x2, &p->y, &q->x);
+	fe_mul(&x1x2, &p->x, &q->x);
+	fe_mul(&y1y2, &p->y, &q->y);
+	fe_mul(&t, &x1x2, &y1y2);
+	fe_mul(&t, &t, d);
+	fe_small(&one, 1);
+
+	fe_add(&num, &x1y2, &y1x2);
+	fe_add(&den, &one, &t);
+	fe_invert(&den, &den);
+	fe_mul(&r->x, &num, &den);
+
+	fe_add(&num, &y1y2, &x1x2);
+	fe_sub(&den, &one, &t);
+	fe_invert(&den, &den);
+	fe_mul(&r->y, &num, &den);
+}
+
+static int on_curve(const struct point *p, const fe *d)
+{
+	fe xx, yy, lhs, rhs, one;
+
+	/* -x^2 + y^2 == 1 + d * x^2 * y^2 */
+	fe_mul(&xx, &p->x, &p->x);
+	fe_mul(&yy, &p->y, &p->y);
+	fe_sub(&lhs, &yy, &xx);
+	fe_mul(&rhs, &xx, &yy);
+	fe_mul(&rhs, &rhs, d);
+	fe_small(&one, 1);
+	fe_add(&rhs, &rhs, &one);
+	return fe_equal(&lhs, &rhs);
+}
+
+static void print_fe(FILE *fout, const fe *f, int last)
+{
+	uint8_t s[32];
+	int i;
+
+	fe_tobytes(s, f);
+	FPRINTF("\t\t{");
+	for (i = 0; i < 32; i++)
+		FPRINTF("%s0x%02x,", i % 8 ? " " : "\n\t\t\t", s[i]);
+	FPRINTF("\n\t\t}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+	/* The edwards25519 base point, which maps to u = 9. */
+	static const uint8_t base_x[32] = {
+		0x1a, 0xd5, 0x25, 0x8f, 0x60, 0x2d, 0x56, 0xc9,
+		0xb2, 0xa7, 0x25, 0x95, 0x60, 0xc7, 0x2c, 0x69,
+		0x5c, 0xdc, 0xd6, 0xfd, 0x31, 0xe2, 0xa4, 0xc0,
+		0xfe, 0x53, 0x6e, 0xcd, 0xd3, 0x36, 0x69, 0x21,
+	};
+	static const uint8_t base_y[32] = {
+		0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+		0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+	};
+	struct point teeth[TEETH];
+	struct point table[ENTRIES + 1];
+	FILE *fout;
+	fe d, d2;
+	int i, j;
+
+	if (argc != 2) {
+		fprintf(stderr, "USAGE: %s <output>\n", argv[0]);
+		return 1;
+	}
+
+	curve_d(&d);
+	fe_add(&d2, &d, &d);
+
+	/* teeth[i] = 2^(i * SPACING) * B */
+	fe_frombytes(&teeth[0].x, base_x);
+	fe_frombytes(&teeth[0].y, base_y);
+	if (!on_curve(&teeth[0], &d)) {
+		fprintf(stderr, "Base point is not on the curve\n");
+		return 1;
+	}
+	for (i = 1; i < TEETH; i++) {
+		teeth[i] = teeth[i - 1];
+		for (j = 0; j < SPACING; j++)
+			point_add(&teeth[i], &teeth[i], &teeth[i], &d);
+	}
+
+	/* table[j] = table[j without its lowest bit] + teeth[lowest bit] */
+	fe_small(&table[0].x, 0);
+	fe_small(&table[0].y, 1);
+	for (j = 1; j <= ENTRIES; j++) {
+		point_add(&table[j], &table[j & (j - 1)],
+			  &teeth[__builtin_ctz(j)], &d);
+		if (!on_curve(&table[j], &d)) {
+			fprintf(stderr, "Comb entry %d is not on the curve\n",
+				j);
+			return 1;
+		}
+	}
+
+	fout = fopen(argv[1], "w");
+
+	if (!fout) {
+		fprintf(stderr, "Cannot open output file %s\n", argv[1]);
+		return 1;
+	}
+
+	FPRINTF("/* This is a generated file. Do not modify. */\n");
+	FPRINTF("\n");
+	FPRINTF("#define X25519_COMB_TEETH %d\n", TEETH);
+	FPRINTF("#define X25519_COMB_SPACING %d\n", SPACING);
+	FPRINTF("\n");
+	FPRINTF("/*\n");
+	FPRINTF(" * Entry j - 1 holds sum(2^(i * %d) * B) over the set bits i "
+		"of j,\n", SPACING);
+	FPRINTF(" * as (y + x, y - x, 2 * d * x * y).\n");
+	FPRINTF(" */\n");
+	FPRINTF("static const uint8_t k25519CombTable[%d][3][32] = {\n",
+		ENTRIES);
+	for (j = 1; j <= ENTRIES; j++) {
+		fe yplusx, yminusx, xy2d;
+
+		fe_add(&yplusx, &table[j].y, &table[j].x);
+		fe_sub(&yminusx, &table[j].y, &table[j].x);
+		fe_mul(&xy2d, &table[j].x, &table[j].y);
+		fe_mul(&xy2d, &xy2d, &d2);
+
+		FPRINTF("\t{\n");
+		print_fe(fout, &yplusx, 0);
+		print_fe(fout, &yminusx, 0);
+		print_fe(fout, &xy2d, 1);
+		FPRINTF("\t}%s\n", j == ENTRIES ? "" : ",");
+	}
+	FPRINTF("};\n");
+
+	fclose(fout);
+
+	return 0;
+}
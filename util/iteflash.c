@@ -9,6 +9,7 @@
 #include <fcntl.h>
 #include <ftdi.h>
 #include <getopt.h>
+#include <inttypes.h>
 #include <linux/i2c-dev.h>
 #include <linux/i2c.h>
 #include <signal.h>
@@ -17,6 +18,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
 
@@ -119,6 +122,7 @@ struct iteflash_config {
 	int usb_vid;
 	int usb_pid;
 	int verify;  /* boolean */
+	int diff;  /* boolean */
 	char *usb_serial;
 	char *i2c_dev_path;
 	const struct i2c_interface *i2c_if;
@@ -126,15 +130,20 @@ struct iteflash_config {
 	size_t range_size;
 };
 
+struct file_i2c_dev;
+
 struct common_hnd {
 	struct iteflash_config conf;
 	int flash_size;
 	int flash_cmd_v2;      /* boolean */
 	int dbgr_addr_3bytes;  /* boolean */
+	/* Payload bytes moved over I2C, in either direction */
+	uint64_t bytes_transferred;
 	union {
 		int i2c_dev_fd;
 		struct usb_endpoint uep;
 		struct ftdi_context *ftdi_hnd;
+		struct file_i2c_dev *file_dev;
 	};
 };
 
@@ -196,6 +205,7 @@ static inline int i2c_byte_transfer(struct common_hnd *chnd, uint8_t addr,
 	if (exit_requested)
 		return -1;
 
+	chnd->bytes_transferred += numbytes;
 	return chnd->conf.i2c_if->byte_transfer(chnd, addr, data, write,
 		numbytes);
 }
@@ -482,6 +492,179 @@ exit_xfer:
 	return ret;
 }
 
+/*
+ * File-backed fake of the ITE DBGR I2C interface.
+ *
+ * This emulates just enough of the DBGR register file and of the SPI flash
+ * behind follow mode for iteflash to run against a flash image on disk, so
+ * the programming flows can be exercised without hardware.  Register 0x05
+ * drives FSCE#, and bytes written to or read from register 0x08 (or the
+ * block address) are clocked through the emulated SPI flash.
+ *
+ * The flash is strict about programming: a byte already programmed since its
+ * last erase can't be programmed again, as on parts that don't allow a page
+ * to be programmed twice.
+ */
+struct file_i2c_dev {
+	int fd;
+	uint8_t *flash;
+	uint8_t *programmed;	/* Per byte, boolean, programmed since erase */
+	size_t size;
+	uint8_t reg;		/* Last DBGR register selected */
+	uint8_t regs[256];
+	int spi_cs;		/* boolean, FSCE# asserted */
+	int spi_wel;		/* boolean, write enable latch */
+	uint8_t spi_cmd;
+	int spi_pos;		/* Bytes clocked in since FSCE# asserted */
+	uint32_t spi_addr;
+};
+
+/* GigaDevice KGD flash ID */
+static const uint8_t file_flash_id[] = {0xC8, 0x40, 0x13};
+
+static void file_spi_erase(struct file_i2c_dev *dev, uint32_t size)
+{
+	uint32_t addr = dev->spi_addr & ~(size - 1);
+
+	if (dev->spi_wel && addr + size <= dev->size) {
+		memset(dev->flash + addr, 0xff, size);
+		memset(dev->programmed + addr, 0, size);
+	}
+	dev->spi_wel = 0;
+}
+
+static void file_spi_write(struct file_i2c_dev *dev, uint8_t data)
+{
+	int pos = dev->spi_pos++;
+
+	if (!dev->spi_cs)
+		return;
+
+	if (pos == 0) {
+		dev->spi_cmd = data;
+		dev->spi_addr = 0;
+		switch (data) {
+		case SPI_CMD_WRITE_ENABLE:
+			dev->spi_wel = 1;
+			break;
+		case SPI_CMD_WRITE_DISABLE:
+			dev->spi_wel = 0;
+			break;
+		case SPI_CMD_CHIP_ERASE:
+			if (dev->spi_wel) {
+				memset(dev->flash, 0xff, dev->size);
+				memset(dev->programmed, 0, dev->size);
+			}
+			dev->spi_wel = 0;
+			break;
+		}
+		return;
+	}
+
+	switch (dev->spi_cmd) {
+	case SPI_CMD_FAST_READ:
+	case SPI_CMD_PAGE_PROGRAM:
+	case SPI_CMD_SECTOR_ERASE_1K:
+	case SPI_CMD_SECTOR_ERASE_4K:
+		if (pos <= 3) {
+			dev->spi_addr = (dev->spi_addr << 8) | data;
+			if (pos == 3 && dev->spi_cmd == SPI_CMD_SECTOR_ERASE_1K)
+				file_spi_erase(dev, 1 << 10);
+			else if (pos == 3 &&
+				 dev->spi_cmd == SPI_CMD_SECTOR_ERASE_4K)
+				file_spi_erase(dev, 1 << 12);
+			break;
+		}
+		if (dev->spi_cmd != SPI_CMD_PAGE_PROGRAM)
+			break;
+		/* Programming 0xff leaves a byte alone */
+		if (dev->spi_wel && dev->spi_addr < dev->size &&
+		    data != 0xff) {
+			if (dev->programmed[dev->spi_addr])
+				fprintf(stderr, "Fake EC: 0x%08x programmed "
+					"twice without an erase\n",
+					dev->spi_addr);
+			else
+				dev->flash[dev->spi_addr] = data;
+			dev->programmed[dev->spi_addr] = 1;
+		}
+		/* Page program wraps around within the page */
+		dev->spi_addr = (dev->spi_addr & ~(PAGE_SIZE - 1)) |
+				((dev->spi_addr + 1) & (PAGE_SIZE - 1));
+		break;
+	}
+}
+
+static uint8_t file_spi_read(struct file_i2c_dev *dev)
+{
+	int pos = dev->spi_pos++;
+	uint8_t data = 0xff;
+
+	if (!dev->spi_cs)
+		return data;
+
+	switch (dev->spi_cmd) {
+	case SPI_CMD_READ_STATUS:
+		/* Never busy */
+		data = dev->spi_wel ? 0x02 : 0x00;
+		break;
+	case SPI_CMD_RDID:
+		if ((size_t)(pos - 1) < sizeof(file_flash_id))
+			data = file_flash_id[pos - 1];
+		break;
+	case SPI_CMD_FAST_READ:
+		/* Three address bytes and a dummy byte precede the data */
+		if (pos > 4 && dev->spi_addr < dev->size)
+			data = dev->flash[dev->spi_addr++];
+		break;
+	}
+
+	return data;
+}
+
+static int file_i2c_byte_transfer(struct common_hnd *chnd, uint8_t addr,
+				  uint8_t *data, int write, int numbytes)
+{
+	struct file_i2c_dev *dev = chnd->file_dev;
+	int i;
+
+	switch (addr) {
+	case I2C_CMD_ADDR:
+		if (write && numbytes)
+			dev->reg = data[numbytes - 1];
+		break;
+	case I2C_DATA_ADDR:
+	case I2C_BLOCK_ADDR:
+		for (i = 0; i < numbytes; i++) {
+			if (addr == I2C_BLOCK_ADDR || dev->reg == 0x08) {
+				if (write)
+					file_spi_write(dev, data[i]);
+				else
+					data[i] = file_spi_read(dev);
+			} else if (write) {
+				dev->regs[dev->reg] = data[i];
+				/* Register 0x05 bit 1 low asserts FSCE# */
+				if (dev->reg == 0x05) {
+					dev->spi_cs = !(data[i] & 0x02);
+					dev->spi_pos = 0;
+					if (dev->spi_cmd ==
+					    SPI_CMD_PAGE_PROGRAM)
+						dev->spi_wel = 0;
+					dev->spi_cmd = 0;
+				}
+			} else {
+				data[i] = dev->regs[dev->reg];
+			}
+		}
+		break;
+	default:
+		/* Nothing else (e.g. an I2C mux) is on the fake bus */
+		break;
+	}
+
+	return 0;
+}
+
 static int i2c_write_byte(struct common_hnd *chnd, uint8_t cmd, uint8_t data)
 {
 	int ret;
@@ -1430,7 +1613,8 @@ static int command_erase2(struct common_hnd *chnd, uint32_t len,
 			  uint32_t off, uint32_t reset)
 {
 	int res = -EIO;
-	int page = 0;
+	uint32_t sector_size = sector_erase_pages * PAGE_SIZE;
+	int page = off / PAGE_SIZE;
 	uint32_t remaining = len;
 
 	/*
@@ -1442,8 +1626,9 @@ static int command_erase2(struct common_hnd *chnd, uint32_t len,
 
 	printf("Erasing flash...erase size=%d\n", len);
 
-	if (off != 0 || len != chnd->flash_size) {
-		fprintf(stderr, "Only full chip erase is supported\n");
+	if (off % sector_size || len % sector_size ||
+	    off + len > chnd->flash_size) {
+		fprintf(stderr, "Erase range must be sector aligned\n");
 		return -EINVAL;
 	}
 
@@ -1815,6 +2000,167 @@ failed_write:
 
 
 
+static int is_erased(const uint8_t *buf, uint32_t size)
+{
+	while (size--)
+		if (*buf++ != 0xff)
+			return 0;
+	return 1;
+}
+
+/* Page program every non-blank block of [offset, offset + size). */
+static int program_range(struct common_hnd *chnd, const uint8_t *buf,
+			 uint32_t offset, uint32_t size)
+{
+	int block_write_size = chnd->conf.block_write_size;
+	uint32_t end = offset + size;
+	uint32_t cnt;
+	int ret;
+
+	/* Page program instruction allows up to 256 bytes */
+	if (block_write_size > PAGE_SIZE)
+		block_write_size = PAGE_SIZE;
+
+	ret = spi_flash_follow_mode(chnd, "Page program");
+	while (!ret && offset < end) {
+		cnt = (end - offset > block_write_size) ?
+			block_write_size : end - offset;
+		if (!is_erased(&buf[offset], cnt) &&
+		    command_write_pages3(chnd, offset, cnt,
+					 (uint8_t *)&buf[offset]) < 0)
+			ret = -EIO;
+		offset += cnt;
+	}
+
+	spi_flash_command_short(chnd, SPI_CMD_WRITE_DISABLE,
+		"SPI write disable");
+	spi_flash_follow_mode_exit(chnd, "Page program");
+	return ret;
+}
+
+/*
+ * Return zero on success, a negative error value on failures.
+ *
+ * Delta update: read the current flash content back and only erase and
+ * program the sectors which differ from the image.  A sector is always
+ * erased before it is programmed again: whether the eflash allows pages to
+ * be programmed twice is not reported by the chip.  When verification is
+ * enabled, only the rewritten sectors are read back.
+ */
+static int write_flash_diff(struct common_hnd *chnd, const char *filename)
+{
+	uint32_t sector_size = sector_erase_pages * PAGE_SIZE;
+	int size = chnd->flash_size;
+	uint8_t *buf = malloc(size);
+	uint8_t *old = malloc(size);
+	uint8_t *dirty = calloc(size / sector_size, 1);
+	uint32_t i, span, run, nsectors;
+	int changed = 0;
+	struct timespec start, end;
+	FILE *hnd;
+	int res, ret = 0;
+
+	if (!buf || !old || !dirty) {
+		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
+			size);
+		ret = -ENOMEM;
+		goto exit;
+	}
+
+	hnd = fopen(filename, "r");
+	if (!hnd) {
+		fprintf(stderr, "%s: Cannot open file %s for reading\n",
+			__func__, filename);
+		ret = -EIO;
+		goto exit;
+	}
+	res = fread(buf, 1, size, hnd);
+	if (res <= 0) {
+		fprintf(stderr, "%s: Failed to read %d bytes from %s with "
+			"ferror() %d\n", __func__, size, filename, ferror(hnd));
+		fclose(hnd);
+		ret = -EIO;
+		goto exit;
+	}
+	fclose(hnd);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	chnd->bytes_transferred = 0;
+
+	span = (res + sector_size - 1) / sector_size * sector_size;
+	nsectors = span / sector_size;
+
+	printf("Comparing %d bytes at 0x%08x.......\n", res, 0);
+	if (command_read_pages(chnd, 0, span, old) != span) {
+		ret = -EIO;
+		goto exit;
+	}
+	/* Preserve whatever follows the image in its last sector */
+	memcpy(buf + res, old + res, span - res);
+
+	for (i = 0; i < nsectors; i++) {
+		uint32_t base = i * sector_size;
+
+		if (memcmp(&buf[base], &old[base], sector_size)) {
+			dirty[i] = 1;
+			changed++;
+		}
+	}
+
+	printf("\n\r%d of %d sectors differ\n", changed, nsectors);
+
+	/* Erase runs of adjacent sectors with one call each */
+	for (i = 0; i < nsectors; i += run) {
+		for (run = 0; i + run < nsectors && dirty[i + run]; run++)
+			;
+		if (!run) {
+			run = 1;
+			continue;
+		}
+		if (command_erase2(chnd, run * sector_size, i * sector_size,
+				   0) < 0) {
+			ret = -EIO;
+			goto exit;
+		}
+	}
+
+	/* Program, then only verify what was written */
+	for (i = 0; i < nsectors; i++) {
+		uint32_t base = i * sector_size;
+
+		if (!dirty[i])
+			continue;
+
+		draw_spinner(nsectors - i, nsectors);
+		if (program_range(chnd, buf, base, sector_size) < 0) {
+			ret = -EIO;
+			goto exit;
+		}
+
+		if (!chnd->conf.verify)
+			continue;
+		if (command_read_pages(chnd, base, sector_size, &old[base]) !=
+		    sector_size || memcmp(&old[base], &buf[base], sector_size)) {
+			fprintf(stderr, "\n%s: Verify failed at 0x%08x\n",
+				__func__, base);
+			ret = -EIO;
+			goto exit;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("\n\rWriting Done. %d bytes rewritten, %" PRIu64 " bytes "
+		"transferred in %.2f s\n", changed * sector_size,
+		chnd->bytes_transferred, (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9);
+
+exit:
+	free(buf);
+	free(old);
+	free(dirty);
+	return ret;
+}
+
 /* Return zero on success, a non-zero value on failures. */
 static int verify_flash(struct common_hnd *chnd, const char *filename,
 			uint32_t offset)
@@ -1973,6 +2319,97 @@ static int ftdi_i2c_interface_shutdown(struct common_hnd *chnd)
 	return 0;
 }
 
+static int file_i2c_interface_init(struct common_hnd *chnd)
+{
+	static const uint16_t sizes_kb[] = {128, 192, 256, 384, 512, 0, 1024};
+	struct file_i2c_dev *dev;
+	struct stat st;
+	size_t addr;
+	int i;
+
+	if (!chnd->conf.i2c_dev_path) {
+		fprintf(stderr, "Must set --i2c_dev_path to a flash image "
+				"when using the file interface.\n");
+		return -1;
+	}
+
+	dev = calloc(1, sizeof(*dev));
+	if (!dev) {
+		fprintf(stderr, "Cannot allocate file interface state\n");
+		return -ENOMEM;
+	}
+
+	dev->fd = open(chnd->conf.i2c_dev_path, O_RDWR);
+	if (dev->fd < 0 || fstat(dev->fd, &st)) {
+		perror("Failed to open flash image");
+		goto failed;
+	}
+	dev->size = st.st_size;
+
+	/* The image size selects the CHIPVER flash size field */
+	for (i = 0; i < ARRAY_SIZE(sizes_kb); i++)
+		if (sizes_kb[i] && dev->size == sizes_kb[i] * 1024)
+			break;
+	if (i == ARRAY_SIZE(sizes_kb)) {
+		fprintf(stderr, "Unsupported flash image size %zu\n",
+			dev->size);
+		goto failed;
+	}
+
+	dev->flash = mmap(NULL, dev->size, PROT_READ | PROT_WRITE,
+			  MAP_SHARED, dev->fd, 0);
+	if (dev->flash == MAP_FAILED) {
+		perror("Failed to map flash image");
+		goto failed;
+	}
+
+	/* Whatever isn't erased was programmed before */
+	dev->programmed = malloc(dev->size);
+	if (!dev->programmed) {
+		fprintf(stderr, "Cannot allocate file interface state\n");
+		munmap(dev->flash, dev->size);
+		goto failed;
+	}
+	for (addr = 0; addr < dev->size; addr++)
+		dev->programmed[addr] = dev->flash[addr] != 0xff;
+
+	/* DX chip ID, so the v2 (page program capable) flow is used */
+	dev->regs[0x00] = CHIP_ID >> 8;
+	dev->regs[0x01] = CHIP_ID & 0xff;
+	dev->regs[0x02] = (i << 5) | 0x03;
+
+	chnd->file_dev = dev;
+	printf("Using flash image %s as a fake EC\n",
+		chnd->conf.i2c_dev_path);
+	return 0;
+
+failed:
+	if (dev->fd >= 0)
+		close(dev->fd);
+	free(dev);
+	return -1;
+}
+
+static int file_i2c_interface_shutdown(struct common_hnd *chnd)
+{
+	struct file_i2c_dev *dev = chnd->file_dev;
+	int ret = 0;
+
+	if (msync(dev->flash, dev->size, MS_SYNC) ||
+	    munmap(dev->flash, dev->size))
+		ret = -EIO;
+	close(dev->fd);
+	free(dev->programmed);
+	free(dev);
+	return ret;
+}
+
+static int file_send_special_waveform(struct common_hnd *chnd)
+{
+	/* The fake is always in DBGR mode */
+	return 0;
+}
+
 static const struct i2c_interface linux_i2c_interface = {
 	.interface_init = linux_i2c_interface_init,
 	.interface_shutdown = linux_i2c_interface_shutdown,
@@ -2010,6 +2447,14 @@ static const struct i2c_interface ftdi_i2c_interface = {
 	.default_block_write_size = FTDI_BLOCK_WRITE_SIZE,
 };
 
+static const struct i2c_interface file_i2c_interface = {
+	.interface_init = file_i2c_interface_init,
+	.interface_shutdown = file_i2c_interface_shutdown,
+	.send_special_waveform = file_send_special_waveform,
+	.byte_transfer = file_i2c_byte_transfer,
+	.default_block_write_size = PAGE_SIZE,
+};
+
 static int post_waveform_work(struct common_hnd *chnd)
 {
 	int ret;
@@ -2050,6 +2495,7 @@ static int strdup_with_errmsg(const char *source, char **dest, const char *name)
 static const struct option longopts[] = {
 	{"block-write-size", 1, 0, 'b'},
 	{"debug", 0, 0, 'd'},
+	{"diff", 0, 0, 'f'},
 	{"erase", 0, 0, 'e'},
 	{"help", 0, 0, 'h'},
 	{"i2c-dev-path", 1, 0, 'D'},
@@ -2072,17 +2518,23 @@ static const struct option longopts[] = {
 static void display_usage(const char *program)
 {
 	fprintf(stderr, "Usage: %s [-d] [-v <VID>] [-p <PID>] \\\n"
-		"\t[-c <linux|ccd|ftdi>] [-D /dev/i2c-<N>] [-i <1|2>] [-S] \\\n"
-		"\t[-s <serial>] [-e] [-r <file>] [-W <0|1|false|true>] \\\n"
-		"\t[-w <file>] [-R base[:size]] [-m] [-b <size>]\n",
+		"\t[-c <linux|ccd|ftdi|file>] [-D /dev/i2c-<N>] [-i <1|2>] \\\n"
+		"\t[-S] [-s <serial>] [-e] [-r <file>] [-W <0|1|false|true>] \\\n"
+		"\t[-w <file>] [-f] [-R base[:size]] [-m] [-b <size>]\n",
 		program);
 	fprintf(stderr, "-d, --debug : Output debug traces.\n");
 	fprintf(stderr, "-e, --erase : Erase all the flash content.\n");
-	fprintf(stderr, "-c, --i2c-interface <linux|ccd|ftdi> : I2C interface "
-			"to use\n");
+	fprintf(stderr, "-f, --diff : With --write, only erase and program "
+			"the sectors\n"
+			"\twhich differ from <file>.\n");
+	fprintf(stderr, "-c, --i2c-interface <linux|ccd|ftdi|file> : I2C "
+			"interface to use;\n"
+			"\t'file' emulates an EC backed by a flash image\n");
 	fprintf(stderr, "-D, --i2c-dev-path /dev/i2c-<N> : Path to "
 			"Linux i2c-dev file e.g. /dev/i2c-5;\n"
-			"\tonly applicable with --i2c-interface=linux\n");
+			"\tonly applicable with --i2c-interface=linux, or the "
+			"flash\n"
+			"\timage with --i2c-interface=file\n");
 	fprintf(stderr, "-i, --interface <1> : FTDI interface: A=1, B=2,"
 			" ...\n");
 	fprintf(stderr, "-m, --i2c-mux : Enable i2c-mux (to EC).\n"
@@ -2153,7 +2605,7 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 	int opt, idx, ret = 0;
 
 	while (!ret &&
-	       (opt = getopt_long(argc, argv, "?b:c:D:dehi:mp:R:r:s:uv:W:w:Zz",
+	       (opt = getopt_long(argc, argv, "?b:c:D:defhi:mp:R:r:s:uv:W:w:Zz",
 				  longopts, &idx)) != -1) {
 		switch (opt) {
 		case 'b':
@@ -2166,6 +2618,8 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 				conf->i2c_if = &ccd_i2c_interface;
 			} else if (!strcasecmp(optarg, "ftdi")) {
 				conf->i2c_if = &ftdi_i2c_interface;
+			} else if (!strcasecmp(optarg, "file")) {
+				conf->i2c_if = &file_i2c_interface;
 			} else {
 				fprintf(stderr, "Unexpected -c / "
 					"--i2c-interface value: %s\n", optarg);
@@ -2182,6 +2636,9 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 		case 'e':
 			conf->erase = 1;
 			break;
+		case 'f':
+			conf->diff = 1;
+			break;
 		case 'h':
 		case '?':
 			display_usage(argv[0]);
@@ -2241,6 +2698,12 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 		}
 	}
 
+	if (!ret && conf->diff && conf->erase) {
+		fprintf(stderr, "-f / --diff and -e / --erase are mutually "
+			"exclusive\n");
+		ret = -1;
+	}
+
 	if (ret)
 		config_release(conf);
 	return ret;
@@ -2367,7 +2830,18 @@ int main(int argc, char **argv)
 		dbgr_reset(&chnd, RSTS_VCCDO_PW_ON|RSTS_HGRST|RSTS_GRST);
 	}
 
-	if (chnd.conf.output_filename) {
+	if (chnd.conf.output_filename && chnd.conf.diff) {
+		/* Delta updates rely on sector erase and page program */
+		if (!chnd.flash_cmd_v2 || eflash_type != EFLASH_TYPE_KGD) {
+			fprintf(stderr, "--diff is only supported on KGD "
+				"eflash\n");
+			ret = -EINVAL;
+			goto return_after_init;
+		}
+		ret = write_flash_diff(&chnd, chnd.conf.output_filename);
+		if (ret)
+			goto return_after_init;
+	} else if (chnd.conf.output_filename) {
 		if (chnd.flash_cmd_v2)
 			switch (eflash_type) {
 			case EFLASH_TYPE_8315:
@@ -121,6 +121,37 @@ int ec_get_cmd_versions(int cmd, uint32_t *pmask)
 	return 0;
 }
 
+int ec_console_read_seq(uint32_t *seq, FILE *out, int report_loss)
+{
+	struct ec_params_console_read_seq p;
+	struct ec_response_console_read_seq *r = ec_inbuf;
+	int total = 0;
+	int rv;
+
+	do {
+		p.seq = *seq;
+		rv = ec_command(EC_CMD_CONSOLE_READ_SEQ, 0, &p, sizeof(p),
+				ec_inbuf, ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < sizeof(*r))
+			return -1;
+		rv -= sizeof(*r);
+
+		if (r->flags & EC_CONSOLE_READ_SEQ_RESTARTED)
+			fprintf(out, "\n[EC restarted]\n");
+		else if (r->lost && report_loss)
+			fprintf(out, "\n[%u bytes lost]\n", r->lost);
+		report_loss = 1;
+
+		fwrite(r->data, 1, rv, out);
+		*seq = r->seq + rv;
+		total += rv;
+	} while (rv > 0 && *seq != r->head);
+
+	return total;
+}
+
 /**
  * Return non-zero if the EC supports the command and version
  *
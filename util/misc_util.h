@@ -6,6 +6,9 @@
 #ifndef __UTIL_MISC_UTIL_H
 #define __UTIL_MISC_UTIL_H
 
+#include <stdint.h>
+#include <stdio.h>
+
 /* Don't use a macro where an inline will do... */
 static inline int MIN(int a, int b) { return a < b ? a : b; }
 static inline int MAX(int a, int b) { return a > b ? a : b; }
@@ -57,6 +60,22 @@ int ec_get_cmd_versions(int cmd, uint32_t *pmask);
  */
 int ec_cmd_version_supported(int cmd, int ver);
 
+/**
+ * Copy EC console output to a file, starting from a sequence number.
+ *
+ * Reads with EC_CMD_CONSOLE_READ_SEQ until caught up with the EC. Bytes that
+ * were overwritten before they could be read, and EC restarts, are marked in
+ * the output.
+ *
+ * @param seq		Sequence number of the first byte wanted; updated to
+ *			that of the next byte to come.
+ * @param out		Where to write the output
+ * @param report_loss	Mark overwritten bytes in the output. Callers starting
+ *			from 0 don't care about output older than the buffer.
+ * @return number of bytes of console output copied, or <0 if error
+ */
+int ec_console_read_seq(uint32_t *seq, FILE *out, int report_loss);
+
 /**
  * Return 1 is the current kernel version is greater or equal to
  * <major>.<minor>.<sublevel>
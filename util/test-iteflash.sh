@@ -0,0 +1,80 @@
+#!/bin/bash
+#
+# Copyright 2021 The Chromium OS Authors. All rights reserved.
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+# Regression test for iteflash.  Works by running it against a flash image
+# through the file-backed fake EC (-c file) and comparing the image with
+# what should have been written.
+#
+# Usage: util/test-iteflash.sh [path to iteflash]
+
+ITEFLASH=${1:-build/host/util/iteflash}
+TMPDIR=$(mktemp -d /tmp/iteflash-test.XXXXXX)
+FLASH=$TMPDIR/flash.bin
+SIZE=$((512 * 1024))
+SECTOR=4096
+
+cleanup() {
+  rm -rf $TMPDIR
+}
+
+fail() {
+  echo "FAIL: $*"
+  cleanup
+  exit 1
+}
+
+iteflash() {
+  $ITEFLASH -c file -D $FLASH "$@" > $TMPDIR/log 2>&1 ||
+    fail "iteflash $*: $(tail -1 $TMPDIR/log)"
+}
+
+# Write <count> random sectors from <sector> on in <file>
+scribble() {
+  dd if=/dev/urandom of=$1 bs=$SECTOR seek=$2 count=$3 conv=notrunc \
+    status=none
+}
+
+trap cleanup SIGINT
+
+[ -x $ITEFLASH ] || fail "$ITEFLASH not found; build it with 'make utils'"
+
+head -c $SIZE /dev/urandom > $FLASH
+head -c $SIZE /dev/urandom > $TMPDIR/image.bin
+
+# Erase the whole chip
+iteflash -e
+cmp -s $FLASH <(head -c $SIZE /dev/zero | tr '\0' '\377') ||
+  fail "erase left data behind"
+
+# Write and read back the whole chip
+iteflash -w $TMPDIR/image.bin
+cmp -s $FLASH $TMPDIR/image.bin || fail "write"
+iteflash -r $TMPDIR/read.bin
+cmp -s $TMPDIR/read.bin $TMPDIR/image.bin || fail "read"
+
+# Delta update of random sectors, a sector which is zeroed in the image and
+# one which is zeroed on the chip.  The fake EC refuses to program a byte
+# twice, so sectors must be erased even when only bits are cleared.
+cp $TMPDIR/image.bin $TMPDIR/delta.bin
+scribble $TMPDIR/delta.bin 3 1
+scribble $TMPDIR/delta.bin 40 3
+dd if=/dev/zero of=$TMPDIR/delta.bin bs=$SECTOR seek=64 count=1 \
+  conv=notrunc status=none
+dd if=/dev/zero of=$FLASH bs=$SECTOR seek=100 count=1 conv=notrunc \
+  status=none
+iteflash -f -w $TMPDIR/delta.bin
+grep -q "6 of 128 sectors differ" $TMPDIR/log ||
+  fail "delta update didn't rewrite just the changed sectors"
+cmp -s $FLASH $TMPDIR/delta.bin || fail "delta update"
+
+# Nothing to do for an image already on the chip
+iteflash -f -w $TMPDIR/delta.bin
+grep -q "0 of 128 sectors differ" $TMPDIR/log ||
+  fail "delta update of an unchanged image"
+cmp -s $FLASH $TMPDIR/delta.bin || fail "unchanged delta update"
+
+cleanup
+echo "PASS"
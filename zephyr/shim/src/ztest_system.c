@@ -17,3 +17,15 @@ const uint8_t *system_get_jump_tag(uint16_t tag, int *version, int *size)
 {
 	return NULL;
 }
+
+int system_add_jump_slot(enum jump_tag_slot slot, int version, int size,
+			 const void *data)
+{
+	return EC_SUCCESS;
+}
+
+const void *system_get_jump_slot(enum jump_tag_slot slot, int version,
+				 int size)
+{
+	return NULL;
+}